@@ -94,6 +94,7 @@ NULL
 SH2Interface_struct *SH2CoreList[] = {
 &SH2Interpreter,
 &SH2DebugInterpreter,
+&SH2BlockInterpreter,
 #ifdef SH2_DYNAREC
 &SH2Dynarec,
 #endif
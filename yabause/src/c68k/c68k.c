@@ -244,6 +244,13 @@ void C68k_Set_WriteW(c68k_struc *cpu, C68K_WRITE *Func)
     cpu->Write_Word = Func;
 }
 
+void C68k_Set_ReadRam(c68k_struc *cpu, u32 high_adr, u32 mask, pointer ram_adr)
+{
+    cpu->ReadRam = ram_adr;
+    cpu->ReadRamEnd = ram_adr ? high_adr : 0;
+    cpu->ReadRamMask = mask;
+}
+
 // externals main functions
 ////////////////////////////
 
@@ -156,6 +156,10 @@ typedef struct {
     C68K_RESET_CALLBACK *Reset_CallBack;
 
 	pointer Fetch[C68K_FETCH_BANK];             // 32 bytes aligned
+
+    pointer ReadRam;                        // data reads below ReadRamEnd
+    u32 ReadRamEnd;                         // come from ReadRam[adr & ReadRamMask]
+    u32 ReadRamMask;
 } c68k_struc;
 
 
@@ -190,6 +194,7 @@ void    C68k_Set_ReadB(c68k_struc *cpu, C68K_READ *Func);
 void    C68k_Set_ReadW(c68k_struc *cpu, C68K_READ *Func);
 void    C68k_Set_WriteB(c68k_struc *cpu, C68K_WRITE *Func);
 void    C68k_Set_WriteW(c68k_struc *cpu, C68K_WRITE *Func);
+void    C68k_Set_ReadRam(c68k_struc *cpu, u32 high_adr, u32 mask, pointer ram_adr);
 
 u32     C68k_Get_DReg(c68k_struc *cpu, u32 num);
 u32     C68k_Get_AReg(c68k_struc *cpu, u32 num);
@@ -297,7 +297,7 @@ int CheatSave(const char *filename)
 #ifndef WORDS_BIGENDIAN
    DoubleWordSwap(num);
 #endif
-   ywrite(&check, (void *)&num, sizeof(int), 1, fp);
+   yfwrite(&check, (void *)&num, sizeof(int), 1, fp);
 
    for(i = 0; i < numcheats; i++)
    {
@@ -311,13 +311,13 @@ int CheatSave(const char *filename)
       DoubleWordSwap(cheat.val);
       DoubleWordSwap(cheat.enable);
 #endif
-      ywrite(&check, (void *)&cheat.type, sizeof(int), 1, fp);
-      ywrite(&check, (void *)&cheat.addr, sizeof(u32), 1, fp);
-      ywrite(&check, (void *)&cheat.val, sizeof(u32), 1, fp);
+      yfwrite(&check, (void *)&cheat.type, sizeof(int), 1, fp);
+      yfwrite(&check, (void *)&cheat.addr, sizeof(u32), 1, fp);
+      yfwrite(&check, (void *)&cheat.val, sizeof(u32), 1, fp);
       descsize = (u8)strlen(cheatlist[i].desc)+1;
-      ywrite(&check, (void *)&descsize, sizeof(u8), 1, fp);
-      ywrite(&check, (void *)cheatlist[i].desc, sizeof(char), descsize, fp);
-      ywrite(&check, (void *)&cheat.enable, sizeof(int), 1, fp);
+      yfwrite(&check, (void *)&descsize, sizeof(u8), 1, fp);
+      yfwrite(&check, (void *)cheatlist[i].desc, sizeof(char), descsize, fp);
+      yfwrite(&check, (void *)&cheat.enable, sizeof(int), 1, fp);
    }
 
    fclose (fp);
@@ -341,7 +341,7 @@ int CheatLoad(const char *filename)
    if ((fp = fopen(filename, "rb")) == NULL)
       return -1;
 
-   yread(&check, (void *)id, 1, 4, fp);
+   yfread(&check, (void *)id, 1, 4, fp);
    if (strncmp(id, "YCHT", 4) != 0)
    {
       fclose(fp);
@@ -350,7 +350,7 @@ int CheatLoad(const char *filename)
 
    CheatClearCodes();
 
-   yread(&check, (void *)&numcheats, sizeof(int), 1, fp);
+   yfread(&check, (void *)&numcheats, sizeof(int), 1, fp);
 #ifndef WORDS_BIGENDIAN
    DoubleWordSwap(numcheats);
 #endif
@@ -366,13 +366,13 @@ int CheatLoad(const char *filename)
    {
       u8 descsize;
 
-      yread(&check, (void *)&cheatlist[i].type, sizeof(int), 1, fp);
-      yread(&check, (void *)&cheatlist[i].addr, sizeof(u32), 1, fp);
-      yread(&check, (void *)&cheatlist[i].val, sizeof(u32), 1, fp);
-      yread(&check, (void *)&descsize, sizeof(u8), 1, fp);
-      yread(&check, (void *)desc, sizeof(char), descsize, fp);
+      yfread(&check, (void *)&cheatlist[i].type, sizeof(int), 1, fp);
+      yfread(&check, (void *)&cheatlist[i].addr, sizeof(u32), 1, fp);
+      yfread(&check, (void *)&cheatlist[i].val, sizeof(u32), 1, fp);
+      yfread(&check, (void *)&descsize, sizeof(u8), 1, fp);
+      yfread(&check, (void *)desc, sizeof(char), descsize, fp);
       CheatChangeDescriptionByIndex(i, desc);
-      yread(&check, (void *)&cheatlist[i].enable, sizeof(int), 1, fp);
+      yfread(&check, (void *)&cheatlist[i].enable, sizeof(int), 1, fp);
 #ifndef WORDS_BIGENDIAN
       DoubleWordSwap(cheatlist[i].type);
       DoubleWordSwap(cheatlist[i].addr);
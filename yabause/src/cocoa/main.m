@@ -50,6 +50,7 @@ M68K_struct *M68KCoreList[] = {
 SH2Interface_struct *SH2CoreList[] = {
     &SH2Interpreter,
     &SH2DebugInterpreter,
+    &SH2BlockInterpreter,
     NULL
 };
 
@@ -22,6 +22,7 @@
 #define CORE_H
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #ifndef ALIGNED
@@ -139,52 +140,164 @@ typedef struct {
 	unsigned int done;
 } IOCheck_struct;
 
-static INLINE void ywrite(IOCheck_struct * check, void * ptr, size_t size, size_t nmemb, FILE * stream) {
+static INLINE void yfwrite(IOCheck_struct * check, void * ptr, size_t size, size_t nmemb, FILE * stream) {
    check->done += (unsigned int)fwrite(ptr, size, nmemb, stream);
    check->size += (unsigned int)nmemb;
 }
 
-static INLINE void yread(IOCheck_struct * check, void * ptr, size_t size, size_t nmemb, FILE * stream) {
+static INLINE void yfread(IOCheck_struct * check, void * ptr, size_t size, size_t nmemb, FILE * stream) {
    check->done += (unsigned int)fread(ptr, size, nmemb, stream);
    check->size += (unsigned int)nmemb;
 }
 
-static INLINE int StateWriteHeader(FILE *fp, const char *name, int version) {
+// Save states are written through a stream that is either a FILE or a
+// memory buffer. Memory streams grow as needed and keep their buffer when
+// reset, so repeated snapshots don't allocate.
+typedef struct {
+   FILE *fp;
+   u8 *data;
+   size_t pos;
+   size_t size;
+   size_t capacity;
+   int readonly;
+} ystream_struct;
+
+static INLINE void ystream_file(ystream_struct * stream, FILE * fp) {
+   memset(stream, 0, sizeof(ystream_struct));
+   stream->fp = fp;
+}
+
+static INLINE void ystream_memory(ystream_struct * stream, const void * data, size_t size) {
+   memset(stream, 0, sizeof(ystream_struct));
+   stream->data = (u8 *)data;
+   stream->size = stream->capacity = size;
+   stream->readonly = 1;
+}
+
+static INLINE void ystream_reset(ystream_struct * stream) {
+   stream->pos = 0;
+   stream->size = 0;
+}
+
+static INLINE void ystream_free(ystream_struct * stream) {
+   if (stream->fp == NULL && !stream->readonly)
+      free(stream->data);
+   memset(stream, 0, sizeof(ystream_struct));
+}
+
+static INLINE size_t ystream_put(ystream_struct * stream, const void * ptr, size_t len) {
+   if (stream->fp)
+      return fwrite(ptr, 1, len, stream->fp);
+
+   if (stream->pos + len > stream->capacity)
+   {
+      size_t capacity = stream->capacity ? stream->capacity : 0x10000;
+      u8 *data;
+
+      if (stream->readonly)
+         return 0;
+      while (capacity < stream->pos + len)
+         capacity *= 2;
+      if ((data = (u8 *)realloc(stream->data, capacity)) == NULL)
+         return 0;
+      stream->data = data;
+      stream->capacity = capacity;
+   }
+
+   memcpy(stream->data + stream->pos, ptr, len);
+   stream->pos += len;
+   if (stream->pos > stream->size)
+      stream->size = stream->pos;
+   return len;
+}
+
+static INLINE size_t ystream_get(ystream_struct * stream, void * ptr, size_t len) {
+   if (stream->fp)
+      return fread(ptr, 1, len, stream->fp);
+
+   if (stream->pos >= stream->size)
+      return 0;
+   if (len > stream->size - stream->pos)
+      len = stream->size - stream->pos;
+   memcpy(ptr, stream->data + stream->pos, len);
+   stream->pos += len;
+   return len;
+}
+
+static INLINE long ytell(ystream_struct * stream) {
+   if (stream->fp)
+      return ftell(stream->fp);
+   return (long)stream->pos;
+}
+
+static INLINE int yseek(ystream_struct * stream, long offset, int whence) {
+   long base = 0;
+
+   if (stream->fp)
+      return fseek(stream->fp, offset, whence);
+
+   if (whence == SEEK_CUR)
+      base = (long)stream->pos;
+   else if (whence == SEEK_END)
+      base = (long)stream->size;
+   if (base + offset < 0 || (size_t)(base + offset) > stream->size)
+      return -1;
+   stream->pos = (size_t)(base + offset);
+   return 0;
+}
+
+static INLINE void ywrite(IOCheck_struct * check, void * ptr, size_t size, size_t nmemb, ystream_struct * stream) {
+   if (stream->fp)
+      check->done += (unsigned int)fwrite(ptr, size, nmemb, stream->fp);
+   else if (ystream_put(stream, ptr, size * nmemb) == size * nmemb)
+      check->done += (unsigned int)nmemb;
+   check->size += (unsigned int)nmemb;
+}
+
+static INLINE void yread(IOCheck_struct * check, void * ptr, size_t size, size_t nmemb, ystream_struct * stream) {
+   if (stream->fp)
+      check->done += (unsigned int)fread(ptr, size, nmemb, stream->fp);
+   else if (size != 0)
+      check->done += (unsigned int)(ystream_get(stream, ptr, size * nmemb) / size);
+   check->size += (unsigned int)nmemb;
+}
+
+static INLINE int StateWriteHeader(ystream_struct *fp, const char *name, int version) {
    IOCheck_struct check = { 0, 0 };
-   fprintf(fp, "%s", name);
+   ystream_put(fp, name, strlen(name));
    check.done = 0;
    check.size = 0;
    ywrite(&check, (void *)&version, sizeof(version), 1, fp);
    ywrite(&check, (void *)&version, sizeof(version), 1, fp); // place holder for size
-   return (check.done == check.size) ? ftell(fp) : -1;
+   return (check.done == check.size) ? ytell(fp) : -1;
 }
 
-static INLINE int StateFinishHeader(FILE *fp, int offset) {
+static INLINE int StateFinishHeader(ystream_struct *fp, int offset) {
    IOCheck_struct check = { 0, 0 };
    int size = 0;
-   size = ftell(fp) - offset;
-   fseek(fp, offset - 4, SEEK_SET);
+   size = ytell(fp) - offset;
+   yseek(fp, offset - 4, SEEK_SET);
    check.done = 0;
    check.size = 0;
    ywrite(&check, (void *)&size, sizeof(size), 1, fp); // write true size
-   fseek(fp, 0, SEEK_END);
+   yseek(fp, 0, SEEK_END);
    return (check.done == check.size) ? (size + 12) : -1;
 }
 
-static INLINE int StateCheckRetrieveHeader(FILE *fp, const char *name, int *version, int *size) {
+static INLINE int StateCheckRetrieveHeader(ystream_struct *fp, const char *name, int *version, int *size) {
    char id[4];
    size_t ret;
 
-   if ((ret = fread((void *)id, 1, 4, fp)) != 4)
+   if ((ret = ystream_get(fp, (void *)id, 4)) != 4)
       return -1;
 
    if (strncmp(name, id, 4) != 0)
       return -2;
 
-   if ((ret = fread((void *)version, 4, 1, fp)) != 1)
+   if ((ret = ystream_get(fp, (void *)version, 4)) != 4)
       return -1;
 
-   if (fread((void *)size, 4, 1, fp) != 1)
+   if (ystream_get(fp, (void *)size, 4) != 4)
       return -1;
 
    return 0;
@@ -1404,14 +1404,14 @@ void CartDeInit(void)
 
 //////////////////////////////////////////////////////////////////////////////
 
-int CartSaveState(FILE * fp)
+int CartSaveState(ystream_struct * fp)
 {
    int offset;
 
    offset = StateWriteHeader(fp, "CART", 1);
 
    // Write cart type
-   fwrite((void *)&CartridgeArea->carttype, 4, 1, fp);
+   ystream_put(fp, (void *)&CartridgeArea->carttype, 4);
 
    // Write the areas associated with the cart type here
 
@@ -1420,13 +1420,13 @@ int CartSaveState(FILE * fp)
 
 //////////////////////////////////////////////////////////////////////////////
 
-int CartLoadState(FILE * fp, UNUSED int version, int size)
+int CartLoadState(ystream_struct * fp, UNUSED int version, int size)
 {
    int newtype;
    size_t num_read = 0;
 
    // Read cart type
-   num_read = fread((void *)&newtype, 4, 1, fp);
+   num_read = ystream_get(fp, (void *)&newtype, 4);
 
    // Check to see if old cart type and new cart type match, if they don't,
    // reallocate memory areas
@@ -74,7 +74,7 @@ int CartInit(const char *filename, int);
 void CartFlush(void);
 void CartDeInit(void);
 
-int CartSaveState(FILE *fp);
-int CartLoadState(FILE *fp, int version, int size);
+int CartSaveState(ystream_struct *fp);
+int CartLoadState(ystream_struct *fp, int version, int size);
 
 #endif
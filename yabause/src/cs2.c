@@ -123,6 +123,8 @@ u16 FASTCALL Cs2ReadWord(SH2_struct *sh, u32 addr) {
   u16 val = 0;
   addr &= 0xFFFFF; // fix me(I should really have proper mapping)
 
+  Cs2Sync();
+
   switch(addr) {
     case 0x90008:
     case 0x9000A:
@@ -260,6 +262,8 @@ u16 FASTCALL Cs2ReadWord(SH2_struct *sh, u32 addr) {
 void FASTCALL Cs2WriteWord(SH2_struct *sh, u32 addr, u16 val) {
   addr &= 0xFFFFF; // fix me(I should really have proper mapping)
 
+  Cs2Sync();
+
   switch(addr) {
     case 0x90008:
     case 0x9000A:
@@ -300,6 +304,8 @@ u32 FASTCALL Cs2ReadLong(SH2_struct *sh, u32 addr) {
   u32 val = 0;
   addr &= 0xFFFFF; // fix me(I should really have proper mapping)
 
+  Cs2Sync();
+
   switch(addr) {
     case 0x90008:
                   val = Cs2Area->reg.HIRQ;
@@ -406,6 +412,8 @@ u32 FASTCALL Cs2ReadLong(SH2_struct *sh, u32 addr) {
 void FASTCALL Cs2WriteLong(SH2_struct *sh, u32 addr, u32 val) {
    addr &= 0xFFFFF; // fix me(I should really have proper mapping)
 
+   Cs2Sync();
+
    switch (addr)
    {
       case 0x18000:
@@ -462,6 +470,8 @@ void FASTCALL Cs2RapidCopyT1(void *dest, u32 count)
 {
    u8 *dest8 = (u8 *) dest;
 
+   Cs2Sync();
+
    if (Cs2Area->datatranstype != CDB_DATATRANSTYPE_INVALID)
    {
       // Copy as many sectors as we have left, one sector at a time
@@ -528,6 +538,8 @@ void FASTCALL Cs2RapidCopyT2(void *dest, u32 count)
 {
    u32 *dest32 = (u32 *) dest;
 
+   Cs2Sync();
+
    if (Cs2Area->datatranstype != CDB_DATATRANSTYPE_INVALID)
    {
       // Copy as many sectors as we have left, one sector at a time; copy
@@ -651,6 +663,8 @@ int Cs2ChangeCDCore(int coreid, const char *cdpath)
 {
    int i;
 
+   Cs2Sync();
+
    // Make sure the old core is freed
    if (Cs2Area->cdi != NULL)
       Cs2Area->cdi->DeInit();
@@ -720,6 +734,8 @@ void Cs2DeInit(void) {
 void Cs2Reset(void) {
   u32 i, i2;
 
+  Cs2Sync();
+
   switch (Cs2Area->cdi->GetStatus())
   {
      case 0:   
@@ -857,7 +873,37 @@ void Cs2Reset(void) {
 
 //////////////////////////////////////////////////////////////////////////////
 
-void Cs2Exec(u32 timing) {
+// Microseconds until a (microseconds * 3) counter reaches its period
+static INLINE u32 Cs2TimeToPeriod(u32 cycles, u32 period) {
+   return cycles >= period ? 0 : (period - cycles + 2) / 3;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+// How long Cs2Exec can hold time back before one of the CD block timers
+// expires. Up to then running it in one go or one slice at a time leaves
+// the same state behind.
+static u32 Cs2TimeToNextEvent(void) {
+   u32 time;
+
+   // the modem carts expect to be clocked every slice
+   if (Cs2Area->carttype == CART_NETLINK || Cs2Area->carttype == CART_JAPMODEM)
+      return 0;
+
+   time = Cs2TimeToPeriod(Cs2Area->_statuscycles, Cs2Area->_statustiming);
+   if (Cs2TimeToPeriod(Cs2Area->_periodiccycles, Cs2Area->_periodictiming) < time)
+      time = Cs2TimeToPeriod(Cs2Area->_periodiccycles, Cs2Area->_periodictiming);
+
+   // a command finishes (or is dropped) on the slice that uses up its timing
+   if (Cs2Area->_commandtiming > 0 && Cs2Area->_commandtiming < time)
+      time = Cs2Area->_commandtiming;
+
+   return time;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void Cs2Run(u32 timing) {
    Cs2Area->_statuscycles += timing * 3;
    Cs2Area->_periodiccycles += timing * 3;
 
@@ -1026,9 +1072,44 @@ void Cs2Exec(u32 timing) {
 
 //////////////////////////////////////////////////////////////////////////////
 
+/* Called once per emulation slice. Between timer expiries nothing in here
+ * is visible from outside, so the time is only added up and handed over in
+ * one go on the slice where the next command, status or sector event falls
+ * due. */
+void Cs2Exec(u32 timing) {
+   Cs2Area->_pendingtime += timing;
+   if (Cs2Area->_pendingtime < Cs2Area->_nexteventtime)
+      return;
+
+   timing = Cs2Area->_pendingtime;
+   Cs2Area->_pendingtime = 0;
+   Cs2Run(timing);
+   Cs2Area->_nexteventtime = Cs2TimeToNextEvent();
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+/* Catches the CD block up before anything reads or changes its state. The
+ * held back time never reaches a timer, and the next Cs2Exec call
+ * reschedules since the caller may be about to change them. */
+void Cs2Sync(void) {
+   if (Cs2Area->_pendingtime)
+   {
+      u32 timing = Cs2Area->_pendingtime;
+      Cs2Area->_pendingtime = 0;
+      Cs2Run(timing);
+   }
+
+   Cs2Area->_nexteventtime = 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
 /* Returns the number of (emulated) microseconds before the next sector
  * will have been completely read in */
 int Cs2GetTimeToNextSector(void) {
+   Cs2Sync();
+
    if ((Cs2Area->status & 0xF) != CDB_STAT_PLAY) {
       return 0;
    } else {
@@ -2954,7 +3035,7 @@ void Cs2GetMPEGRom(void) {
 
            if (mpgpartition->block[mpgpartition->numblocks] != NULL) {
               // read data
-              yread(&check, (void *)mpgpartition->block[mpgpartition->numblocks]->data, 1, Cs2Area->getsectsize, mpgfp);
+              yfread(&check, (void *)mpgpartition->block[mpgpartition->numblocks]->data, 1, Cs2Area->getsectsize, mpgfp);
 
               mpgpartition->numblocks++;
               mpgpartition->size += Cs2Area->getsectsize;
@@ -3816,12 +3897,14 @@ u8 Cs2GetRegionID(void)
 
 //////////////////////////////////////////////////////////////////////////////
 
-int Cs2SaveState(FILE * fp) {
+int Cs2SaveState(ystream_struct * fp) {
    int offset, i;
    IOCheck_struct check = { 0, 0 };
 
    // This is mostly kludge, but it will have to do until I have time to rewrite it all
 
+   Cs2Sync();
+
    offset = StateWriteHeader(fp, "CS2 ", 2);
 
    // Write cart type
@@ -3914,12 +3997,14 @@ int Cs2SaveState(FILE * fp) {
 
 //////////////////////////////////////////////////////////////////////////////
 
-int Cs2LoadState(FILE * fp, int version, int size) {
+int Cs2LoadState(ystream_struct * fp, int version, int size) {
    int i, i2;
    IOCheck_struct check = { 0, 0 };
 
    // This is mostly kludge, but it will have to do until I have time to rewrite it all
 
+   Cs2Sync();
+
    // Read cart type
    yread(&check, (void *)&Cs2Area->carttype, 4, 1, fp);
 
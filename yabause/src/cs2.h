@@ -235,6 +235,8 @@ typedef struct {
   u32 _periodiccycles;  // microseconds * 3
   u32 _periodictiming;  // microseconds * 3
   u32 _commandtiming;
+  u32 _pendingtime;     // microseconds Cs2Exec has not run yet
+  u32 _nexteventtime;   // microseconds until the next timer expires
   CDInterface * cdi;
 
   int carttype;
@@ -276,6 +278,7 @@ void FASTCALL   Cs2RapidCopyT1(void *dest, u32 count);
 void FASTCALL   Cs2RapidCopyT2(void *dest, u32 count);
 
 void Cs2Exec(u32);
+void Cs2Sync(void);
 int Cs2GetTimeToNextSector(void);
 void Cs2Execute(void);
 void Cs2Reset(void);
@@ -378,8 +381,8 @@ partition_struct * Cs2ReadUnFilteredSector(u32 rufsFAD);
 int Cs2ReadFilteredSector(u32 rfsFAD, partition_struct **partition);
 u8 Cs2GetIP(int autoregion);
 u8 Cs2GetRegionID(void);
-int Cs2SaveState(FILE *);
-int Cs2LoadState(FILE *, int, int);
+int Cs2SaveState(ystream_struct *);
+int Cs2LoadState(ystream_struct *, int, int);
 u32 Cs2GetMasterStackAdress(void);
 u32 Cs2GetSlaveStackAdress(void);
 
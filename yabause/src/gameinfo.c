@@ -45,46 +45,49 @@ int LoadStateSlotScreenshotStream(FILE * fp, int * outputwidth, int * outputheig
    int version, chunksize;
    int totalsize;
    size_t fread_result = 0;
+   ystream_struct stream;
+
+   ystream_file(&stream, fp);
 
    fseek(fp, 0x14, SEEK_SET);
 
-   if (StateCheckRetrieveHeader(fp, "CART", &version, &chunksize) != 0)
+   if (StateCheckRetrieveHeader(&stream, "CART", &version, &chunksize) != 0)
       return -1;
    fseek(fp, chunksize, SEEK_CUR);
 
-   if (StateCheckRetrieveHeader(fp, "CS2 ", &version, &chunksize) != 0)
+   if (StateCheckRetrieveHeader(&stream, "CS2 ", &version, &chunksize) != 0)
       return -1;
    fseek(fp, chunksize, SEEK_CUR);
 
-   if (StateCheckRetrieveHeader(fp, "MSH2", &version, &chunksize) != 0)
+   if (StateCheckRetrieveHeader(&stream, "MSH2", &version, &chunksize) != 0)
       return -1;
    fseek(fp, chunksize, SEEK_CUR);
 
-   if (StateCheckRetrieveHeader(fp, "SSH2", &version, &chunksize) != 0)
+   if (StateCheckRetrieveHeader(&stream, "SSH2", &version, &chunksize) != 0)
       return -1;
    fseek(fp, chunksize, SEEK_CUR);
 
-   if (StateCheckRetrieveHeader(fp, "SCSP", &version, &chunksize) != 0)
+   if (StateCheckRetrieveHeader(&stream, "SCSP", &version, &chunksize) != 0)
       return -1;
    fseek(fp, chunksize, SEEK_CUR);
 
-   if (StateCheckRetrieveHeader(fp, "SCU ", &version, &chunksize) != 0)
+   if (StateCheckRetrieveHeader(&stream, "SCU ", &version, &chunksize) != 0)
       return -1;
    fseek(fp, chunksize, SEEK_CUR);
 
-   if (StateCheckRetrieveHeader(fp, "SMPC", &version, &chunksize) != 0)
+   if (StateCheckRetrieveHeader(&stream, "SMPC", &version, &chunksize) != 0)
       return -1;
    fseek(fp, chunksize, SEEK_CUR);
 
-   if (StateCheckRetrieveHeader(fp, "VDP1", &version, &chunksize) != 0)
+   if (StateCheckRetrieveHeader(&stream, "VDP1", &version, &chunksize) != 0)
       return -1;
    fseek(fp, chunksize, SEEK_CUR);
 
-   if (StateCheckRetrieveHeader(fp, "VDP2", &version, &chunksize) != 0)
+   if (StateCheckRetrieveHeader(&stream, "VDP2", &version, &chunksize) != 0)
       return -1;
    fseek(fp, chunksize, SEEK_CUR);
 
-   if (StateCheckRetrieveHeader(fp, "OTHR", &version, &chunksize) != 0)
+   if (StateCheckRetrieveHeader(&stream, "OTHR", &version, &chunksize) != 0)
       return -1;
 
    fseek(fp, 0x210000, SEEK_CUR);
@@ -69,6 +69,7 @@ NULL
 SH2Interface_struct *SH2CoreList[] = {
 &SH2Interpreter,
 &SH2DebugInterpreter,
+&SH2BlockInterpreter,
 #ifdef TEST_PSP_SH2
 &SH2PSP,
 #endif
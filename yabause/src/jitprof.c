@@ -0,0 +1,464 @@
+/*  Copyright 2026 Yabause team
+
+    This file is part of Yabause.
+
+    Yabause is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Yabause is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Yabause; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+*/
+
+/*! \file jitprof.c
+    \brief Symbol maps and code statistics for the dynamic recompilers.
+
+    Each CPU's counters are only written by the thread running that CPU's
+    recompiler (the SCSP DSP runs on the sound thread), readers may see a
+    slightly stale value. Both output files are Linux only, the formats are
+    the ones perf documents in tools/perf/Documentation.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifdef __linux__
+#include <elf.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#define JITPROF_OUTPUT
+#endif
+
+#include "jitprof.h"
+#include "yabause.h"
+
+#define JITPROF_PAGE_BITS  10
+#define JITPROF_PAGE_SLOTS (1 << JITPROF_PAGE_BITS)
+
+#define JITDUMP_MAGIC      0x4A695444
+#define JITDUMP_VERSION    1
+#define JITDUMP_CODE_LOAD  0
+#define JITDUMP_CODE_CLOSE 3
+
+typedef struct
+{
+   u32 blocks;
+   u64 bytes;
+   u32 invalidations;
+   u64 compile_time;
+   u64 frame_start;
+   u64 frame_time;
+   u64 max_frame_time;
+   // Open addressed on the page number, unused slots have no invalidations
+   JitProfPage pages[JITPROF_PAGE_SLOTS];
+} JitProfCpu;
+
+typedef struct
+{
+   u32 magic;
+   u32 version;
+   u32 total_size;
+   u32 elf_mach;
+   u32 pad1;
+   u32 pid;
+   u64 timestamp;
+   u64 flags;
+} JitDumpHeader;
+
+typedef struct
+{
+   u32 id;
+   u32 total_size;
+   u64 timestamp;
+} JitDumpRecord;
+
+typedef struct
+{
+   JitDumpRecord record;
+   u32 pid;
+   u32 tid;
+   u64 vma;
+   u64 code_addr;
+   u64 code_size;
+   u64 code_index;
+} JitDumpCodeLoad;
+
+static const char *jitprof_cpu_names[JITPROF_NUM_CPUS] =
+{
+#define JITPROF_CPU(id, name) name,
+   JITPROF_CPUS
+#undef JITPROF_CPU
+};
+
+volatile int JitProfFlags = 0;
+
+static JitProfCpu jitprof_cpus[JITPROF_NUM_CPUS];
+#ifdef JITPROF_OUTPUT
+static FILE *jitprof_map = NULL;
+static FILE *jitprof_dump = NULL;
+static void *jitprof_dump_marker = NULL;
+static u64 jitprof_code_index = 0;
+#endif
+
+//////////////////////////////////////////////////////////////////////////////
+
+// perf record -k mono timestamps its samples with CLOCK_MONOTONIC, the
+// jitdump records have to use the same clock
+static u64 JitProfNow(void)
+{
+#ifdef JITPROF_OUTPUT
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (u64)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#else
+   return YabauseGetTicks();
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static double JitProfMs(u64 ticks)
+{
+#ifdef JITPROF_OUTPUT
+   return (double)ticks / 1000000.0;
+#else
+   if (yabsys.tickfreq == 0)
+      return 0.0;
+   return (double)ticks * 1000.0 / (double)yabsys.tickfreq;
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+#ifdef JITPROF_OUTPUT
+
+static int JitProfOpenMap(void)
+{
+   char path[64];
+
+   sprintf(path, "/tmp/perf-%d.map", (int)getpid());
+   if ((jitprof_map = fopen(path, "w")) == NULL)
+      return -1;
+   return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static int JitProfOpenDump(void)
+{
+   JitDumpHeader header;
+   char path[64];
+
+   sprintf(path, "/tmp/jit-%d.dump", (int)getpid());
+   if ((jitprof_dump = fopen(path, "w+")) == NULL)
+      return -1;
+
+   // perf record only finds the file through an executable mapping of it,
+   // the mapping itself is never touched
+   jitprof_dump_marker = mmap(NULL, sysconf(_SC_PAGESIZE), PROT_READ | PROT_EXEC,
+                              MAP_PRIVATE, fileno(jitprof_dump), 0);
+   if (jitprof_dump_marker == MAP_FAILED)
+   {
+      jitprof_dump_marker = NULL;
+      fclose(jitprof_dump);
+      jitprof_dump = NULL;
+      remove(path);
+      return -1;
+   }
+
+   memset(&header, 0, sizeof(header));
+   header.magic = JITDUMP_MAGIC;
+   header.version = JITDUMP_VERSION;
+   header.total_size = sizeof(header);
+#if defined(__x86_64__)
+   header.elf_mach = EM_X86_64;
+#elif defined(__i386__)
+   header.elf_mach = EM_386;
+#elif defined(__aarch64__)
+   header.elf_mach = EM_AARCH64;
+#elif defined(__arm__)
+   header.elf_mach = EM_ARM;
+#endif
+   header.pid = getpid();
+   header.timestamp = JitProfNow();
+   fwrite(&header, sizeof(header), 1, jitprof_dump);
+   fflush(jitprof_dump);
+   return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void JitProfCloseDump(void)
+{
+   JitDumpRecord record;
+
+   record.id = JITDUMP_CODE_CLOSE;
+   record.total_size = sizeof(record);
+   record.timestamp = JitProfNow();
+   fwrite(&record, sizeof(record), 1, jitprof_dump);
+
+   munmap(jitprof_dump_marker, sysconf(_SC_PAGESIZE));
+   jitprof_dump_marker = NULL;
+   fclose(jitprof_dump);
+   jitprof_dump = NULL;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void JitProfWriteCodeLoad(u64 now, const char *name, const void *code, u32 size)
+{
+   JitDumpCodeLoad load;
+   u32 name_size = strlen(name) + 1;
+
+   load.record.id = JITDUMP_CODE_LOAD;
+   load.record.total_size = sizeof(load) + name_size + size;
+   load.record.timestamp = now;
+   load.pid = getpid();
+   load.tid = syscall(SYS_gettid);
+   load.vma = load.code_addr = (u64)(pointer)code;
+   load.code_size = size;
+
+   // The SCSP DSP compiles on the sound thread, keep its records whole
+   flockfile(jitprof_dump);
+   load.code_index = jitprof_code_index++;
+   fwrite(&load, sizeof(load), 1, jitprof_dump);
+   fwrite(name, name_size, 1, jitprof_dump);
+   fwrite(code, size, 1, jitprof_dump);
+   funlockfile(jitprof_dump);
+}
+
+#endif
+
+//////////////////////////////////////////////////////////////////////////////
+
+int JitProfEnable(int flags)
+{
+   int ret = 0;
+
+#ifdef JITPROF_OUTPUT
+   if (!(flags & JITPROF_PERF_MAP) && jitprof_map != NULL)
+   {
+      fclose(jitprof_map);
+      jitprof_map = NULL;
+   }
+   else if ((flags & JITPROF_PERF_MAP) && jitprof_map == NULL && JitProfOpenMap() != 0)
+   {
+      flags &= ~JITPROF_PERF_MAP;
+      ret = -1;
+   }
+
+   if (!(flags & JITPROF_JITDUMP) && jitprof_dump != NULL)
+      JitProfCloseDump();
+   else if ((flags & JITPROF_JITDUMP) && jitprof_dump == NULL && JitProfOpenDump() != 0)
+   {
+      flags &= ~JITPROF_JITDUMP;
+      ret = -1;
+   }
+#else
+   if (flags & (JITPROF_PERF_MAP | JITPROF_JITDUMP))
+   {
+      flags &= ~(JITPROF_PERF_MAP | JITPROF_JITDUMP);
+      ret = -1;
+   }
+#endif
+
+   JitProfFlags = flags;
+   return ret;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+u64 JitProfStart(void)
+{
+   if (!JitProfFlags)
+      return 0;
+   return JitProfNow();
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void JitProfCode(int cpu, u64 start, u32 addr, const void *code, u32 size)
+{
+   JitProfCpu *prof = &jitprof_cpus[cpu];
+   u64 now;
+
+   if (!JitProfFlags)
+      return;
+
+   now = JitProfNow();
+   prof->blocks++;
+   prof->bytes += size;
+   // Profiling may have been turned on in the middle of the compile
+   if (start != 0)
+      prof->compile_time += now - start;
+
+#ifdef JITPROF_OUTPUT
+   if (jitprof_map != NULL || jitprof_dump != NULL)
+   {
+      char name[32];
+
+      sprintf(name, "%s_%08X", jitprof_cpu_names[cpu], (unsigned int)addr);
+
+      if (jitprof_map != NULL)
+         fprintf(jitprof_map, "%lx %x %s\n", (unsigned long)(pointer)code, (unsigned int)size, name);
+      if (jitprof_dump != NULL)
+         JitProfWriteCodeLoad(now, name, code, size);
+   }
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void JitProfInvalidate(int cpu, u32 addr)
+{
+   JitProfCpu *prof = &jitprof_cpus[cpu];
+   u32 page = addr >> JITPROF_PAGE_SHIFT;
+   u32 slot = (page * 0x9E3779B1) >> (32 - JITPROF_PAGE_BITS);
+   int i;
+
+   if (!JitProfFlags)
+      return;
+
+   prof->invalidations++;
+
+   // Once the table is full, new pages only show up in the total
+   for (i = 0; i < JITPROF_PAGE_SLOTS; i++)
+   {
+      JitProfPage *entry = &prof->pages[(slot + i) & (JITPROF_PAGE_SLOTS - 1)];
+
+      if (entry->invalidations == 0)
+      {
+         entry->addr = page << JITPROF_PAGE_SHIFT;
+         entry->invalidations = 1;
+         return;
+      }
+      if (entry->addr >> JITPROF_PAGE_SHIFT == page)
+      {
+         entry->invalidations++;
+         return;
+      }
+   }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void JitProfFrame(void)
+{
+   int i;
+
+   if (!JitProfFlags)
+      return;
+
+   for (i = 0; i < JITPROF_NUM_CPUS; i++)
+   {
+      JitProfCpu *prof = &jitprof_cpus[i];
+      u64 compile_time = prof->compile_time;
+
+      prof->frame_time = compile_time - prof->frame_start;
+      prof->frame_start = compile_time;
+      if (prof->frame_time > prof->max_frame_time)
+         prof->max_frame_time = prof->frame_time;
+   }
+
+#ifdef JITPROF_OUTPUT
+   // So a run that gets killed still leaves usable files behind
+   if (jitprof_map != NULL)
+      fflush(jitprof_map);
+   if (jitprof_dump != NULL)
+      fflush(jitprof_dump);
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void JitProfReset(void)
+{
+   memset(jitprof_cpus, 0, sizeof(jitprof_cpus));
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+const char *JitProfCpuName(int cpu)
+{
+   if (cpu < 0 || cpu >= JITPROF_NUM_CPUS)
+      return "";
+   return jitprof_cpu_names[cpu];
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void JitProfGetStats(int cpu, JitProfStats *stats)
+{
+   JitProfCpu *prof = &jitprof_cpus[cpu];
+
+   stats->blocks = prof->blocks;
+   stats->bytes = prof->bytes;
+   stats->invalidations = prof->invalidations;
+   stats->compile_ms = JitProfMs(prof->compile_time);
+   stats->frame_ms = JitProfMs(prof->frame_time);
+   stats->max_frame_ms = JitProfMs(prof->max_frame_time);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+int JitProfGetPages(int cpu, JitProfPage *pages, int max)
+{
+   JitProfCpu *prof = &jitprof_cpus[cpu];
+   int count = 0;
+   int i, j;
+
+   // Insertion sort, descending by invalidations
+   for (i = 0; i < JITPROF_PAGE_SLOTS; i++)
+   {
+      JitProfPage entry = prof->pages[i];
+
+      if (entry.invalidations == 0)
+         continue;
+      if (count == max && (max == 0 || pages[max - 1].invalidations >= entry.invalidations))
+         continue;
+
+      j = count < max ? count++ : max - 1;
+      for (; j > 0 && pages[j - 1].invalidations < entry.invalidations; j--)
+         pages[j] = pages[j - 1];
+      pages[j] = entry;
+   }
+
+   return count;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void JitProfPrint(void)
+{
+   int cpu, i;
+
+   fprintf(stdout, "Recompiler statistics:\n\n");
+   for (cpu = 0; cpu < JITPROF_NUM_CPUS; cpu++)
+   {
+      JitProfStats stats;
+      JitProfPage pages[4];
+      int count;
+
+      JitProfGetStats(cpu, &stats);
+      if (stats.blocks == 0 && stats.invalidations == 0)
+         continue;
+
+      fprintf(stdout, "%-8s blocks: %8u, bytes: %10llu, invalidations: %6u, compile ms: %9.3f (last frame %.3f, worst frame %.3f)\n",
+              jitprof_cpu_names[cpu], stats.blocks, (unsigned long long)stats.bytes,
+              stats.invalidations, stats.compile_ms, stats.frame_ms, stats.max_frame_ms);
+
+      count = JitProfGetPages(cpu, pages, 4);
+      for (i = 0; i < count; i++)
+         fprintf(stdout, "         page %08X invalidated %u times\n",
+                 (unsigned int)pages[i].addr, pages[i].invalidations);
+   }
+}
@@ -0,0 +1,107 @@
+/*  Copyright 2026 Yabause team
+
+    This file is part of Yabause.
+
+    Yabause is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Yabause is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Yabause; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+*/
+
+/*! \file jitprof.h
+    \brief Symbol maps and code statistics for the dynamic recompilers.
+
+    Every recompiler reports the blocks it emits and the guest code it
+    throws away. JITPROF_PERF_MAP writes each block to /tmp/perf-<pid>.map
+    and JITPROF_JITDUMP to /tmp/jit-<pid>.dump (for perf inject), so perf
+    and VTune can name the frames by CPU and guest PC instead of showing
+    bare addresses. Nothing is recorded until JitProfEnable().
+*/
+
+#ifndef _JITPROF_H_
+#define _JITPROF_H_
+
+#include "core.h"
+
+#define JITPROF_CPUS \
+   JITPROF_CPU(MSH2,    "MSH2") \
+   JITPROF_CPU(SSH2,    "SSH2") \
+   JITPROF_CPU(SH1,     "SH1") \
+   JITPROF_CPU(M68K,    "68K") \
+   JITPROF_CPU(SCUDSP,  "SCUDSP") \
+   JITPROF_CPU(SCSPDSP, "SCSPDSP")
+
+enum
+{
+#define JITPROF_CPU(id, name) JITPROF_##id,
+   JITPROF_CPUS
+#undef JITPROF_CPU
+   JITPROF_NUM_CPUS
+};
+
+// Flags for JitProfEnable()
+#define JITPROF_STATS    0x1
+#define JITPROF_PERF_MAP 0x2
+#define JITPROF_JITDUMP  0x4
+
+// Invalidations are counted per guest page of this size
+#define JITPROF_PAGE_SHIFT 12
+
+typedef struct
+{
+   u32 blocks;          // Blocks compiled
+   u64 bytes;           // Native code emitted
+   u32 invalidations;   // Pages of compiled code thrown away
+   double compile_ms;   // Time spent compiling since the last reset
+   double frame_ms;     // Compile time during the last complete frame
+   double max_frame_ms; // Worst compile time of a single frame
+} JitProfStats;
+
+typedef struct
+{
+   u32 addr;            // Guest address of the page
+   u32 invalidations;
+} JitProfPage;
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+extern volatile int JitProfFlags;
+
+/* Output files are opened on first use and stay open until their flag is
+   cleared, change the flags only while emulation is stopped. Returns -1 if
+   an output couldn't be opened, the rest is still enabled. */
+int JitProfEnable(int flags);
+
+/* Recompilers call these, they return right away when profiling is off.
+   JitProfStart() timestamps the start of a compile for JitProfCode(). */
+u64 JitProfStart(void);
+void JitProfCode(int cpu, u64 start, u32 addr, const void *code, u32 size);
+void JitProfInvalidate(int cpu, u32 addr);
+
+/* Called once per emulated frame by YabauseEmulate() */
+void JitProfFrame(void);
+void JitProfReset(void);
+
+const char *JitProfCpuName(int cpu);
+void JitProfGetStats(int cpu, JitProfStats *stats);
+/* Fills pages with the most invalidated pages first, returns the count */
+int JitProfGetPages(int cpu, JitProfPage *pages, int max);
+/* Prints the statistics of every CPU that compiled anything to stdout */
+void JitProfPrint(void);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* _JITPROF_H_ */
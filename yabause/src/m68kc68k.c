@@ -164,7 +164,11 @@ static void M68KC68KSetWriteW(M68K_WRITE *Func) {
 	C68k_Set_WriteW(&C68K, Func);
 }
 
-static void C68k_Save_State(c68k_struc *mcpu, FILE * fp)
+static void M68KC68KSetReadRam(u32 high_adr, u32 mask, pointer ram_adr) {
+	C68k_Set_ReadRam(&C68K, high_adr, mask, ram_adr);
+}
+
+static void C68k_Save_State(c68k_struc *mcpu, ystream_struct * fp)
 {
    IOCheck_struct check = { 0, 0 };
    int i = 0;
@@ -200,11 +204,11 @@ static void C68k_Save_State(c68k_struc *mcpu, FILE * fp)
    ywrite(&check, (void *)&mcpu->dirty1, sizeof(u32), 1, fp);
 }
 
-static void M68KC68KSaveState(FILE *fp) {
+static void M68KC68KSaveState(ystream_struct *fp) {
    C68k_Save_State(&C68K, fp);
 }
 
-static void C68k_Load_State(c68k_struc *mcpu, FILE * fp)
+static void C68k_Load_State(c68k_struc *mcpu, ystream_struct * fp)
 {
    IOCheck_struct check = { 0, 0 };
    int i = 0;
@@ -240,7 +244,7 @@ static void C68k_Load_State(c68k_struc *mcpu, FILE * fp)
    yread(&check, (void *)&mcpu->dirty1, sizeof(u32), 1, fp);
 }
 
-static void M68KC68KLoadState(FILE *fp) {
+static void M68KC68KLoadState(ystream_struct *fp) {
    C68k_Load_State(&C68K, fp);
 }
 
@@ -271,6 +275,7 @@ M68K_struct M68KC68K = {
 	M68KC68KSetReadW,
 	M68KC68KSetWriteB,
 	M68KC68KSetWriteW,
+	M68KC68KSetReadRam,
    M68KC68KSaveState,
    M68KC68KLoadState
 };
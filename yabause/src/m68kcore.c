@@ -141,10 +141,13 @@ static void M68KDummySetWriteB(UNUSED M68K_WRITE *Func) {
 static void M68KDummySetWriteW(UNUSED M68K_WRITE *Func) {
 }
 
-static void M68KDummySaveState(UNUSED FILE *fp) {
+static void M68KDummySetReadRam(UNUSED u32 high_adr, UNUSED u32 mask, UNUSED pointer ram_adr) {
 }
 
-static void M68KDummyLoadState(UNUSED FILE *fp) {
+static void M68KDummySaveState(UNUSED ystream_struct *fp) {
+}
+
+static void M68KDummyLoadState(UNUSED ystream_struct *fp) {
 }
 
 M68K_struct M68KDummy = {
@@ -174,6 +177,7 @@ M68K_struct M68KDummy = {
 	M68KDummySetReadW,
 	M68KDummySetWriteB,
 	M68KDummySetWriteW,
+	M68KDummySetReadRam,
    M68KDummySaveState,
    M68KDummyLoadState
 };
@@ -64,9 +64,12 @@ typedef struct {
 	void (*SetReadW)(M68K_READ *Func);
 	void (*SetWriteB)(M68K_WRITE *Func);
 	void (*SetWriteW)(M68K_WRITE *Func);
+	/* Data reads below high_adr come straight from ram_adr[adr & mask]
+	 * (stored like the fetch regions) instead of the read callbacks */
+	void (*SetReadRam)(u32 high_adr, u32 mask, pointer ram_adr);
 
-   void (*SaveState)(FILE* fp);
-   void (*LoadState)(FILE* fp);
+   void (*SaveState)(ystream_struct* fp);
+   void (*LoadState)(ystream_struct* fp);
 } M68K_struct;
 
 extern M68K_struct * M68K;
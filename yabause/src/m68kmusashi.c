@@ -24,6 +24,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
 #include "m68kmusashi.h"
 #include "musashi/m68k.h"
 #include "m68kcore.h"
+#include "memory.h"
 #include "musashi/m68kcpu.h"
 
 struct ReadWriteFuncs
@@ -34,6 +35,14 @@ struct ReadWriteFuncs
    M68K_WRITE *w_16;
 }rw_funcs;
 
+// Reads below end are taken straight from ram
+static struct
+{
+   u8 *ram;
+   u32 end;
+   u32 mask;
+} read_ram;
+
 static int M68KMusashiInit(void) {
 
    m68k_init();
@@ -118,19 +127,25 @@ static void FASTCALL M68KMusashiWriteNotify(u32 address, u32 size) {
 
 unsigned int  m68k_read_memory_8(unsigned int address)
 {
+   if (address < read_ram.end)
+      return T2ReadByte(read_ram.ram, address & read_ram.mask);
+
    return rw_funcs.r_8(address);
 }
 
 unsigned int  m68k_read_memory_16(unsigned int address)
 {
+   if (address < read_ram.end)
+      return T2ReadWord(read_ram.ram, address & read_ram.mask);
+
    return rw_funcs.r_16(address);
 }
 
 unsigned int  m68k_read_memory_32(unsigned int address)
 {
-   u16 val1 = rw_funcs.r_16(address);
+   u16 val1 = m68k_read_memory_16(address);
 
-   return (val1 << 16 | rw_funcs.r_16(address + 2));
+   return (val1 << 16 | m68k_read_memory_16(address + 2));
 }
 
 void m68k_write_memory_8(unsigned int address, unsigned int value)
@@ -165,10 +180,16 @@ static void M68KMusashiSetWriteW(M68K_WRITE *Func) {
    rw_funcs.w_16 = Func;
 }
 
-static void M68KMusashiSaveState(FILE *fp) {
+static void M68KMusashiSetReadRam(u32 high_adr, u32 mask, pointer ram_adr) {
+   read_ram.ram = (u8 *)ram_adr;
+   read_ram.end = ram_adr ? high_adr : 0;
+   read_ram.mask = mask;
+}
+
+static void M68KMusashiSaveState(ystream_struct *fp) {
 }
 
-static void M68KMusashiLoadState(FILE *fp) {
+static void M68KMusashiLoadState(ystream_struct *fp) {
 }
 
 M68K_struct M68KMusashi = {
@@ -198,6 +219,7 @@ M68K_struct M68KMusashi = {
    M68KMusashiSetReadW,
    M68KMusashiSetWriteB,
    M68KMusashiSetWriteW,
+   M68KMusashiSetReadRam,
    M68KMusashiSaveState,
    M68KMusashiLoadState
 };
\ No newline at end of file
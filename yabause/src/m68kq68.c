@@ -19,6 +19,7 @@
 */
 
 #include "yabause.h"
+#include "jitprof.h"
 #include "m68kcore.h"
 
 #include "q68/q68.h"
@@ -80,9 +81,12 @@ static void m68kq68_set_readb(M68K_READ *func);
 static void m68kq68_set_readw(M68K_READ *func);
 static void m68kq68_set_writeb(M68K_WRITE *func);
 static void m68kq68_set_writew(M68K_WRITE *func);
+static void m68kq68_set_read_ram(u32 high_addr, u32 mask, pointer ram_addr);
 
 static uint32_t dummy_read(uint32_t address);
 static void dummy_write(uint32_t address, uint32_t data);
+static void jit_notify(int event, uint32_t address,
+                       const void *native_code, uint32_t native_length);
 
 #ifdef NEED_TRAMPOLINE
 static uint32_t readb_trampoline(uint32_t address);
@@ -91,8 +95,8 @@ static void writeb_trampoline(uint32_t address, uint32_t data);
 static void writew_trampoline(uint32_t address, uint32_t data);
 #endif
 
-static void m68kq68_save_state(FILE * fp);
-static void m68kq68_load_state(FILE * fp);
+static void m68kq68_save_state(ystream_struct * fp);
+static void m68kq68_load_state(ystream_struct * fp);
 
 /*-----------------------------------------------------------------------*/
 
@@ -131,6 +135,7 @@ M68K_struct M68KQ68 = {
     .SetReadW    = m68kq68_set_readw,
     .SetWriteB   = m68kq68_set_writeb,
     .SetWriteW   = m68kq68_set_writew,
+    .SetReadRam  = m68kq68_set_read_ram,
     .SaveState   = m68kq68_save_state,
     .LoadState   = m68kq68_load_state,
 };
@@ -141,6 +146,10 @@ M68K_struct M68KQ68 = {
 
 static Q68State *state;
 
+/* Start of the block translation in progress, for jit_notify() */
+
+static u64 jit_translate_start;
+
 
 #ifdef NEED_TRAMPOLINE
 
@@ -173,6 +182,7 @@ static int m68kq68_init(void)
     q68_set_readw_func(state, dummy_read);
     q68_set_writeb_func(state, dummy_write);
     q68_set_writew_func(state, dummy_write);
+    q68_set_jit_notify_func(state, jit_notify);
 
     return 0;
 }
@@ -462,6 +472,23 @@ static void m68kq68_set_writew(M68K_WRITE *func)
 #endif
 }
 
+/*-----------------------------------------------------------------------*/
+
+/**
+ * m68kq68_set_read_ram:  Set the memory region read directly by Q68.
+ *
+ * [Parameters]
+ *     high_addr: First address past the region
+ *          mask: Mask applied to addresses within the region
+ *      ram_addr: Pointer to the memory region (NULL to disable)
+ * [Return value]
+ *     None
+ */
+static void m68kq68_set_read_ram(u32 high_addr, u32 mask, pointer ram_addr)
+{
+    q68_set_read_ram(state, (const void *)ram_addr, high_addr, mask);
+}
+
 /*************************************************************************/
 
 /**
@@ -494,6 +521,37 @@ static void dummy_write(uint32_t address, uint32_t data)
 
 /*-----------------------------------------------------------------------*/
 
+/**
+ * jit_notify:  Pass Q68's translation events on to the recompiler
+ * statistics and symbol maps.
+ *
+ * [Parameters]
+ *             event: Event type (Q68_JIT_NOTIFY_*)
+ *           address: Block start address or address written
+ *       native_code: Translated native code (TRANSLATE_END only)
+ *     native_length: Length of native code in bytes (TRANSLATE_END only)
+ * [Return value]
+ *     None
+ */
+static void jit_notify(int event, uint32_t address,
+                       const void *native_code, uint32_t native_length)
+{
+    switch (event) {
+      case Q68_JIT_NOTIFY_TRANSLATE_START:
+        jit_translate_start = JitProfStart();
+        break;
+      case Q68_JIT_NOTIFY_TRANSLATE_END:
+        JitProfCode(JITPROF_M68K, jit_translate_start, address,
+                    native_code, native_length);
+        break;
+      case Q68_JIT_NOTIFY_CLEAR:
+        JitProfInvalidate(JITPROF_M68K, address);
+        break;
+    }
+}
+
+/*-----------------------------------------------------------------------*/
+
 #ifdef NEED_TRAMPOLINE
 
 /**
@@ -525,7 +583,7 @@ static void writew_trampoline(uint32_t address, uint32_t data) {
 
 #endif  // NEED_TRAMPOLINE
 
-static void m68kq68_save_state(FILE * fp)
+static void m68kq68_save_state(ystream_struct * fp)
 {
    int i = 0;
    u32 val = 0;
@@ -556,7 +614,7 @@ static void m68kq68_save_state(FILE * fp)
    ywrite(&check, (void *)&val, sizeof(u32), 1, fp);
 }
 
-static void m68kq68_load_state(FILE * fp)
+static void m68kq68_load_state(ystream_struct * fp)
 {
    int i = 0;
    u32 val = 0;
@@ -75,6 +75,9 @@ u8 *LowWram;
 u8 *BiosRom;
 u8 *BupRam;
 
+u8 WramDirtyPages[0x200];
+u8 BupRamDirtyPages[0x10];
+
 /* This flag is set to 1 on every write to backup RAM.  Ports can freely
  * check or clear this flag to determine when backup RAM has been written,
  * e.g. for implementing autosave of backup RAM. */
@@ -226,6 +229,7 @@ u32 FASTCALL HighWramMemoryReadLong(u32 addr)
 void FASTCALL HighWramMemoryWriteByte(u32 addr, u8 val)
 {
    T2WriteByte(HighWram, addr & 0xFFFFF, val);
+   WramDirtyPages[0x100 | ((addr >> RAM_DIRTY_PAGE_SHIFT) & 0xFF)] = 1;
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -233,6 +237,7 @@ void FASTCALL HighWramMemoryWriteByte(u32 addr, u8 val)
 void FASTCALL HighWramMemoryWriteWord(u32 addr, u16 val)
 {
    T2WriteWord(HighWram, addr & 0xFFFFF, val);
+   WramDirtyPages[0x100 | ((addr >> RAM_DIRTY_PAGE_SHIFT) & 0xFF)] = 1;
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -240,6 +245,7 @@ void FASTCALL HighWramMemoryWriteWord(u32 addr, u16 val)
 void FASTCALL HighWramMemoryWriteLong(u32 addr, u32 val)
 {
    T2WriteLong(HighWram, addr & 0xFFFFF, val);
+   WramDirtyPages[0x100 | ((addr >> RAM_DIRTY_PAGE_SHIFT) & 0xFF)] = 1;
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -268,6 +274,7 @@ u32 FASTCALL LowWramMemoryReadLong(u32 addr)
 void FASTCALL LowWramMemoryWriteByte(u32 addr, u8 val)
 {
    T2WriteByte(LowWram, addr & 0xFFFFF, val);
+   WramDirtyPages[(addr >> RAM_DIRTY_PAGE_SHIFT) & 0xFF] = 1;
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -275,6 +282,7 @@ void FASTCALL LowWramMemoryWriteByte(u32 addr, u8 val)
 void FASTCALL LowWramMemoryWriteWord(u32 addr, u16 val)
 {
    T2WriteWord(LowWram, addr & 0xFFFFF, val);
+   WramDirtyPages[(addr >> RAM_DIRTY_PAGE_SHIFT) & 0xFF] = 1;
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -282,6 +290,7 @@ void FASTCALL LowWramMemoryWriteWord(u32 addr, u16 val)
 void FASTCALL LowWramMemoryWriteLong(u32 addr, u32 val)
 {
    T2WriteLong(LowWram, addr & 0xFFFFF, val);
+   WramDirtyPages[(addr >> RAM_DIRTY_PAGE_SHIFT) & 0xFF] = 1;
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -355,6 +364,7 @@ void FASTCALL BupRamMemoryWriteByte(u32 addr, u8 val)
 {
    T1WriteByte(BupRam, (addr & 0xFFFF) | 0x1, val);
    BupRamWritten = 1;
+   BupRamDirtyPages[(addr >> RAM_DIRTY_PAGE_SHIFT) & 0xF] = 1;
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -443,6 +453,7 @@ static u32 FASTCALL Sh2HighWramMemoryReadLong(SH2_struct *sh, u32 addr)
 static void FASTCALL Sh2HighWramMemoryWriteByte(SH2_struct *sh, u32 addr, u8 val)
 {
    HighWramMemoryWriteByte(addr, val);
+   SH2CheckCodeWrite(0x06000000 | (addr & 0xFFFFF));
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -450,6 +461,7 @@ static void FASTCALL Sh2HighWramMemoryWriteByte(SH2_struct *sh, u32 addr, u8 val
 static void FASTCALL Sh2HighWramMemoryWriteWord(SH2_struct *sh, u32 addr, u16 val)
 {
    HighWramMemoryWriteWord(addr, val);
+   SH2CheckCodeWrite(0x06000000 | (addr & 0xFFFFF));
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -457,6 +469,7 @@ static void FASTCALL Sh2HighWramMemoryWriteWord(SH2_struct *sh, u32 addr, u16 va
 static void FASTCALL Sh2HighWramMemoryWriteLong(SH2_struct *sh, u32 addr, u32 val)
 {
    HighWramMemoryWriteLong(addr, val);
+   SH2CheckCodeWrite(0x06000000 | (addr & 0xFFFFF));
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -485,6 +498,7 @@ static u32 FASTCALL Sh2LowWramMemoryReadLong(SH2_struct *sh, u32 addr)
 static void FASTCALL Sh2LowWramMemoryWriteByte(SH2_struct *sh, u32 addr, u8 val)
 {
    LowWramMemoryWriteByte(addr, val);
+   SH2CheckCodeWrite(0x00200000 | (addr & 0xFFFFF));
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -492,6 +506,7 @@ static void FASTCALL Sh2LowWramMemoryWriteByte(SH2_struct *sh, u32 addr, u8 val)
 static void FASTCALL Sh2LowWramMemoryWriteWord(SH2_struct *sh, u32 addr, u16 val)
 {
    LowWramMemoryWriteWord(addr, val);
+   SH2CheckCodeWrite(0x00200000 | (addr & 0xFFFFF));
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -499,6 +514,7 @@ static void FASTCALL Sh2LowWramMemoryWriteWord(SH2_struct *sh, u32 addr, u16 val
 static void FASTCALL Sh2LowWramMemoryWriteLong(SH2_struct *sh, u32 addr, u32 val)
 {
    LowWramMemoryWriteLong(addr, val);
+   SH2CheckCodeWrite(0x00200000 | (addr & 0xFFFFF));
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -607,6 +623,20 @@ static void FillMemoryArea(SH2_struct *sh, unsigned short start, unsigned short
 
 //////////////////////////////////////////////////////////////////////////////
 
+static void FillMemoryPages(SH2_struct *sh, unsigned short start, unsigned short end,
+                            u8 *mem, u32 mask, int writable)
+{
+   int i;
+
+   for (i=start; i < (end+1); i++)
+   {
+      sh->ReadPages[i] = mem ? mem + ((i << 16) & mask) : NULL;
+      sh->WritePages[i] = writable ? sh->ReadPages[i] : NULL;
+   }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
 void MappedMemoryInit(SH2_struct *msh2, SH2_struct *ssh2, SH2_struct *sh1)
 {
    SH2_struct *sh2[2] = { msh2, ssh2 };
@@ -751,6 +781,12 @@ void MappedMemoryInit(SH2_struct *msh2, SH2_struct *ssh2, SH2_struct *sh1)
                                            &Sh2HighWramMemoryWriteByte,
                                            &Sh2HighWramMemoryWriteWord,
                                            &Sh2HighWramMemoryWriteLong);
+
+      // Areas without side effects that can be accessed straight from memory
+      FillMemoryPages(sh2[i], 0x000, 0xFFF, NULL, 0, 0);
+      FillMemoryPages(sh2[i], 0x000, 0x00F, BiosRom, 0x70000, 0);
+      FillMemoryPages(sh2[i], 0x020, 0x02F, LowWram, 0xF0000, 1);
+      FillMemoryPages(sh2[i], 0x600, 0x7FF, HighWram, 0xF0000, 1);
    }
 
    if (yabsys.use_cd_block_lle)
@@ -773,6 +809,11 @@ u8 FASTCALL MappedMemoryReadByteCacheEnabled(SH2_struct *sh, u32 addr) {
 
 u8 FASTCALL MappedMemoryReadByteNocache(SH2_struct *sh, u32 addr)
 {
+   u8 *page = SH2ReadPage(sh, addr, SH2_DIRECT_AREAS);
+
+   if (LIKELY(page != NULL))
+      return T2ReadByte(page, addr & 0xFFFF);
+
    switch (addr >> 29)
    {
       case 0x0:
@@ -828,6 +869,11 @@ u16 FASTCALL MappedMemoryReadWordCacheEnabled(SH2_struct *sh, u32 addr) {
 
 u16 FASTCALL MappedMemoryReadWordNocache(SH2_struct *sh, u32 addr)
 {
+   u8 *page = SH2ReadPage(sh, addr, SH2_DIRECT_AREAS);
+
+   if (LIKELY(page != NULL))
+      return T2ReadWord(page, addr & 0xFFFF);
+
    switch (addr >> 29)
    {
       case 0x0:
@@ -883,6 +929,11 @@ u32 FASTCALL MappedMemoryReadLongCacheEnabled(SH2_struct *sh, u32 addr) {
 
 u32 FASTCALL MappedMemoryReadLongNocache(SH2_struct *sh, u32 addr)
 {
+   u8 *page = SH2ReadPage(sh, addr, SH2_DIRECT_AREAS);
+
+   if (LIKELY(page != NULL))
+      return T2ReadLong(page, addr & 0xFFFF);
+
    switch (addr >> 29)
    {
       case 0x0:
@@ -944,9 +995,19 @@ void FASTCALL MappedMemoryWriteByteCacheEnabled(SH2_struct *sh, u32 addr, u8 val
 }
 void FASTCALL MappedMemoryWriteByteNocache(SH2_struct *sh, u32 addr, u8 val)
 {
+   u8 *page;
+
 #ifdef SH2_TRACE
    sh2_trace_writeb(addr, val);
 #endif
+
+   if (LIKELY((page = SH2WritePage(sh, addr, SH2_DIRECT_AREAS)) != NULL))
+   {
+      T2WriteByte(page, addr & 0xFFFF, val);
+      SH2WramWritten(addr);
+      return;
+   }
+
    switch (addr >> 29)
    {
       case 0x0:
@@ -1007,9 +1068,19 @@ void FASTCALL MappedMemoryWriteWordCacheEnabled(SH2_struct *sh, u32 addr, u16 va
 
 void FASTCALL MappedMemoryWriteWordNocache(SH2_struct *sh, u32 addr, u16 val)
 {
+   u8 *page;
+
 #ifdef SH2_TRACE
    sh2_trace_writew(addr, val);
 #endif
+
+   if (LIKELY((page = SH2WritePage(sh, addr, SH2_DIRECT_AREAS)) != NULL))
+   {
+      T2WriteWord(page, addr & 0xFFFF, val);
+      SH2WramWritten(addr);
+      return;
+   }
+
    switch (addr >> 29)
    {
       case 0x0:
@@ -1070,9 +1141,19 @@ void FASTCALL MappedMemoryWriteLongCacheEnabled(SH2_struct *sh, u32 addr, u32 va
 
 void FASTCALL MappedMemoryWriteLongNocache(SH2_struct *sh, u32 addr, u32 val)
 {
+   u8 *page;
+
 #ifdef SH2_TRACE
    sh2_trace_writel(addr, val);
 #endif
+
+   if (LIKELY((page = SH2WritePage(sh, addr, SH2_DIRECT_AREAS)) != NULL))
+   {
+      T2WriteLong(page, addr & 0xFFFF, val);
+      SH2WramWritten(addr);
+      return;
+   }
+
    switch (addr >> 29)
    {
       case 0x0:
@@ -1266,6 +1347,7 @@ int LoadBios(const char *filename)
 
 int LoadBackupRam(const char *filename)
 {
+   memset(BupRamDirtyPages, 1, sizeof(BupRamDirtyPages));
    return T123Load(BupRam, 0x10000, 1, filename);
 }
 
@@ -1297,43 +1379,67 @@ void FormatBackupRam(void *mem, u32 size)
 
 //////////////////////////////////////////////////////////////////////////////
 
+void MemoryMarkAllDirty(void)
+{
+   memset(WramDirtyPages, 1, sizeof(WramDirtyPages));
+   memset(BupRamDirtyPages, 1, sizeof(BupRamDirtyPages));
+   memset(Vdp1RamDirtyPages, 1, sizeof(Vdp1RamDirtyPages));
+   memset(Vdp2RamDirtyPages, 1, sizeof(Vdp2RamDirtyPages));
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void MemoryClearDirty(void)
+{
+   memset(WramDirtyPages, 0, sizeof(WramDirtyPages));
+   memset(BupRamDirtyPages, 0, sizeof(BupRamDirtyPages));
+   memset(Vdp1RamDirtyPages, 0, sizeof(Vdp1RamDirtyPages));
+   memset(Vdp2RamDirtyPages, 0, sizeof(Vdp2RamDirtyPages));
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
 int YabSaveStateBuffer(void ** buffer, size_t * size)
 {
-   FILE * fp;
+   ystream_struct stream;
    int status;
-   size_t num_read = 0;
 
    if (buffer != NULL) *buffer = NULL;
    *size = 0;
 
-   fp = tmpfile();
+   memset(&stream, 0, sizeof(stream));
 
-   status = YabSaveStateStream(fp);
+   status = YabSaveStateStream(&stream, 1);
    if (status != 0)
    {
-      fclose(fp);
+      ystream_free(&stream);
       return status;
    }
 
-   fseek(fp, 0, SEEK_END);
-   *size = ftell(fp);
-   fseek(fp, 0, SEEK_SET);
+   *size = stream.size;
 
    if (buffer != NULL)
-   {
-      *buffer = malloc(*size);
-      num_read = fread(*buffer, 1, *size, fp);
-   }
+      *buffer = stream.data;
+   else
+      ystream_free(&stream);
 
-   fclose(fp);
    return 0;
 }
 
 //////////////////////////////////////////////////////////////////////////////
 
+int YabSaveStateMemory(ystream_struct * stream)
+{
+   ystream_reset(stream);
+   return YabSaveStateStream(stream, 0);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
 int YabSaveState(const char *filename)
 {
    FILE *fp;
+   ystream_struct stream;
    int status;
 
    //use a second set of savestates for movies
@@ -1344,7 +1450,8 @@ int YabSaveState(const char *filename)
    if ((fp = fopen(filename, "wb")) == NULL)
       return -1;
 
-   status = YabSaveStateStream(fp);
+   ystream_file(&stream, fp);
+   status = YabSaveStateStream(&stream, 1);
    fclose(fp);
 
    return status;
@@ -1365,7 +1472,7 @@ int YabSaveState(const char *filename)
 //    [sh2core.c] frc.div changed to frc.shift
 //    [sh2core.c] wdt probably needs to be written as well
 
-int YabSaveStateStream(FILE *fp)
+int YabSaveStateStream(ystream_struct *fp, int screenshot)
 {
    u32 i;
    int offset;
@@ -1377,19 +1484,21 @@ int YabSaveStateStream(FILE *fp)
    int movieposition;
    int temp;
    u32 temp32;
+   u8 endian;
 
    check.done = 0;
    check.size = 0;
 
    // Write signature
-   fprintf(fp, "YSS");
+   ystream_put(fp, "YSS", 3);
 
    // Write endianness byte
 #ifdef WORDS_BIGENDIAN
-   fputc(0x00, fp);
+   endian = 0x00;
 #else
-   fputc(0x01, fp);
+   endian = 0x01;
 #endif
+   ystream_put(fp, &endian, 1);
 
    // Write version(fix me)
    i = 2;
@@ -1436,45 +1545,56 @@ int YabSaveStateStream(FILE *fp)
    ywrite(&check, (void *)&yabsys.CurSH2FreqType, sizeof(int), 1, fp);
    ywrite(&check, (void *)&yabsys.IsPal, sizeof(int), 1, fp);
 
-   VIDCore->GetGlSize(&outputwidth, &outputheight);
+   // The screenshot is only there for the state slot previews, frequent
+   // snapshots leave it out and store a 0x0 image
+   outputwidth = outputheight = totalsize = 0;
+   buf = NULL;
 
-   totalsize=outputwidth * outputheight * sizeof(u32);
-
-   if ((buf = (u8 *)malloc(totalsize)) == NULL)
+   if (screenshot)
    {
-      return -2;
-   }
+      VIDCore->GetGlSize(&outputwidth, &outputheight);
+
+      totalsize=outputwidth * outputheight * sizeof(u32);
+
+      if ((buf = (u8 *)malloc(totalsize)) == NULL)
+      {
+         return -2;
+      }
 
-   YuiSwapBuffers();
-   #ifdef USE_OPENGL
-   glPixelZoom(1,1);
-   glReadBuffer(GL_BACK);
-   glReadPixels(0, 0, outputwidth, outputheight, GL_RGBA, GL_UNSIGNED_BYTE, buf);
-   #else
-   memcpy(buf, VIDCore->getFramebuffer(), totalsize);
-   #endif
-   YuiSwapBuffers();
+      YuiSwapBuffers();
+      #ifdef USE_OPENGL
+      glPixelZoom(1,1);
+      glReadBuffer(GL_BACK);
+      glReadPixels(0, 0, outputwidth, outputheight, GL_RGBA, GL_UNSIGNED_BYTE, buf);
+      #else
+      memcpy(buf, VIDCore->getFramebuffer(), totalsize);
+      #endif
+      YuiSwapBuffers();
+   }
 
    ywrite(&check, (void *)&outputwidth, sizeof(outputwidth), 1, fp);
    ywrite(&check, (void *)&outputheight, sizeof(outputheight), 1, fp);
 
-   ywrite(&check, (void *)buf, totalsize, 1, fp);
+   if (buf != NULL)
+      ywrite(&check, (void *)buf, totalsize, 1, fp);
 
-   movieposition=ftell(fp);
+   movieposition=ytell(fp);
    //write the movie to the end of the savestate
    SaveMovieInState(fp, check);
 
    i += StateFinishHeader(fp, offset);
 
    // Go back and update size
-   fseek(fp, 8, SEEK_SET);
+   yseek(fp, 8, SEEK_SET);
    ywrite(&check, (void *)&i, sizeof(i), 1, fp);
-   fseek(fp, 16, SEEK_SET);
+   yseek(fp, 16, SEEK_SET);
    ywrite(&check, (void *)&movieposition, sizeof(movieposition), 1, fp);
+   yseek(fp, 0, SEEK_END);
 
    free(buf);
 
-   OSDPushMessage(OSDMSG_STATUS, 150, "STATE SAVED");
+   if (screenshot)
+      OSDPushMessage(OSDMSG_STATUS, 150, "STATE SAVED");
 
    return 0;
 }
@@ -1483,18 +1603,11 @@ int YabSaveStateStream(FILE *fp)
 
 int YabLoadStateBuffer(const void * buffer, size_t size)
 {
-   FILE * fp;
-   int status;
-
-   fp = tmpfile();
-   fwrite(buffer, 1, size, fp);
-
-   fseek(fp, 0, SEEK_SET);
+   ystream_struct stream;
 
-   status = YabLoadStateStream(fp);
-   fclose(fp);
+   ystream_memory(&stream, buffer, size);
 
-   return status;
+   return YabLoadStateStream(&stream);
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -1502,6 +1615,7 @@ int YabLoadStateBuffer(const void * buffer, size_t size)
 int YabLoadState(const char *filename)
 {
    FILE *fp;
+   ystream_struct stream;
    int status;
 
    filename = MakeMovieStateName(filename);
@@ -1511,7 +1625,8 @@ int YabLoadState(const char *filename)
    if ((fp = fopen(filename, "rb")) == NULL)
       return -1;
 
-   status = YabLoadStateStream(fp);
+   ystream_file(&stream, fp);
+   status = YabLoadStateStream(&stream);
    fclose(fp);
 
    return status;
@@ -1519,7 +1634,7 @@ int YabLoadState(const char *filename)
 
 //////////////////////////////////////////////////////////////////////////////
 
-int YabLoadStateStream(FILE *fp)
+int YabLoadStateStream(ystream_struct *fp)
 {
    char id[3];
    u8 endian;
@@ -1560,7 +1675,7 @@ int YabLoadStateStream(FILE *fp)
       case 2:
          /* version 2 adds video recording */
          yread(&check, (void *)&framecounter, 4, 1, fp);
-		 movieposition=ftell(fp);
+		 movieposition=ytell(fp);
 		 yread(&check, (void *)&movieposition, 4, 1, fp);
          headersize = 0x14;
          break;
@@ -1584,13 +1699,13 @@ int YabLoadStateStream(FILE *fp)
    }
 
    // Make sure size variable matches actual size minus header
-   fseek(fp, 0, SEEK_END);
+   yseek(fp, 0, SEEK_END);
 
-   if (size != (ftell(fp) - headersize))
+   if (size != (ytell(fp) - headersize))
    {
       return -2;
    }
-   fseek(fp, headersize, SEEK_SET);
+   yseek(fp, headersize, SEEK_SET);
 
    // Verify version here
 
@@ -1678,6 +1793,8 @@ int YabLoadStateStream(FILE *fp)
    yread(&check, (void *)BupRam, 0x10000, 1, fp);
    yread(&check, (void *)HighWram, 0x100000, 1, fp);
    yread(&check, (void *)LowWram, 0x100000, 1, fp);
+   SH2WriteNotify(0x06000000, 0x100000);
+   SH2WriteNotify(0x00200000, 0x100000);
 
    yread(&check, (void *)&yabsys.DecilineCount, sizeof(int), 1, fp);
    yread(&check, (void *)&yabsys.LineCount, sizeof(int), 1, fp);
@@ -1698,36 +1815,42 @@ int YabLoadStateStream(FILE *fp)
 
    totalsize=outputwidth * outputheight * sizeof(u32);
 
-   if ((buf = (u8 *)malloc(totalsize)) == NULL)
+   // Memory snapshots are saved without a screenshot
+   if (totalsize > 0)
    {
-      return -2;
-   }
+      if ((buf = (u8 *)malloc(totalsize)) == NULL)
+      {
+         return -2;
+      }
 
-   yread(&check, (void *)buf, totalsize, 1, fp);
+      yread(&check, (void *)buf, totalsize, 1, fp);
 
-   YuiSwapBuffers();
+      YuiSwapBuffers();
 
-   #ifdef USE_OPENGL
-   if(VIDCore->id == VIDCORE_SOFT)
-     glRasterPos2i(0, outputheight);
-   if(VIDCore->id == VIDCORE_OGL)
-	 glRasterPos2i(0, outputheight/2);
-   #endif
+      #ifdef USE_OPENGL
+      if(VIDCore->id == VIDCORE_SOFT)
+        glRasterPos2i(0, outputheight);
+      if(VIDCore->id == VIDCORE_OGL)
+	    glRasterPos2i(0, outputheight/2);
+      #endif
 
-   VIDCore->GetGlSize(&curroutputwidth, &curroutputheight);
-   #ifdef USE_OPENGL
-   glPixelZoom((float)curroutputwidth / (float)outputwidth, ((float)curroutputheight / (float)outputheight));
-   glDrawPixels(outputwidth, outputheight, GL_RGBA, GL_UNSIGNED_BYTE, buf);
-   #endif
-   YuiSwapBuffers();
-   free(buf);
+      VIDCore->GetGlSize(&curroutputwidth, &curroutputheight);
+      #ifdef USE_OPENGL
+      glPixelZoom((float)curroutputwidth / (float)outputwidth, ((float)curroutputheight / (float)outputheight));
+      glDrawPixels(outputwidth, outputheight, GL_RGBA, GL_UNSIGNED_BYTE, buf);
+      #endif
+      YuiSwapBuffers();
+      free(buf);
+   }
 
-   fseek(fp, movieposition, SEEK_SET);
+   yseek(fp, movieposition, SEEK_SET);
    MovieReadState(fp);
    }
 
    ScspUnMuteAudio(SCSP_MUTE_SYSTEM);
 
+   MemoryMarkAllDirty();
+
    OSDPushMessage(OSDMSG_STATUS, 150, "STATE LOADED");
 
    return 0;
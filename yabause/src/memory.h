@@ -374,6 +374,22 @@ extern u8 *BiosRom;
 extern u8 *BupRam;
 extern u8 BupRamWritten;
 
+// 4KB pages of RAM written since the rewind buffer last took a snapshot.
+// WramDirtyPages holds low WRAM in 0x00-0xFF and high WRAM in 0x100-0x1FF.
+#define RAM_DIRTY_PAGE_SHIFT 12
+
+extern u8 WramDirtyPages[0x200];
+extern u8 BupRamDirtyPages[0x10];
+
+// addr is a SH2 address of either WRAM, high WRAM is the one with bit 26 set
+static INLINE void WramMarkDirty(u32 addr)
+{
+   WramDirtyPages[((addr >> 18) & 0x100) | ((addr >> RAM_DIRTY_PAGE_SHIFT) & 0xFF)] = 1;
+}
+
+void MemoryMarkAllDirty(void);
+void MemoryClearDirty(void);
+
 typedef void (FASTCALL *writebytefunc)(SH2_struct *, u32, u8);
 typedef void (FASTCALL *writewordfunc)(SH2_struct *, u32, u16);
 typedef void (FASTCALL *writelongfunc)(SH2_struct *, u32, u32);
@@ -420,10 +436,13 @@ int YabSaveState(const char *filename);
 int YabLoadState(const char *filename);
 int YabSaveStateSlot(const char *dirpath, u8 slot);
 int YabLoadStateSlot(const char *dirpath, u8 slot);
-int YabSaveStateStream(FILE *stream);
-int YabLoadStateStream(FILE *stream);
+int YabSaveStateStream(ystream_struct *stream, int screenshot);
+int YabLoadStateStream(ystream_struct *stream);
 int YabSaveStateBuffer(void **buffer, size_t *size);
 int YabLoadStateBuffer(const void *buffer, size_t size);
+// Saves without a screenshot into stream, which is reset first and keeps
+// its buffer between calls
+int YabSaveStateMemory(ystream_struct *stream);
 
 
 u8 FASTCALL UnhandledMemoryReadByte(USED_IF_DEBUG u32 addr);
@@ -379,30 +379,31 @@ int PlayMovie(const char *filename) {
 
 //////////////////////////////////////////////////////////////////////////////
 
-void SaveMovieInState(FILE* fp, IOCheck_struct check) {
+void SaveMovieInState(ystream_struct* fp, IOCheck_struct check) {
 
 	struct MovieBufferStruct tempbuffer;
 
-	fseek(fp, 0, SEEK_END);
+	yseek(fp, 0, SEEK_END);
 
 	if(Movie.Status == Recording || Movie.Status == Playback) {
 		tempbuffer=ReadMovieIntoABuffer(Movie.fp);
 
-		fwrite(&tempbuffer.size, 4, 1, fp);
-		fwrite(tempbuffer.data, tempbuffer.size, 1, fp);
+		ystream_put(fp, &tempbuffer.size, 4);
+		ystream_put(fp, tempbuffer.data, tempbuffer.size);
+		free(tempbuffer.data);
 	}
 }
 
 //////////////////////////////////////////////////////////////////////////////
 
-void MovieReadState(FILE* fp) {
+void MovieReadState(ystream_struct* fp) {
 
 	ReadMovieInState(fp);
 	MovieLoadState();//file pointer and truncation
 
 }
 
-void ReadMovieInState(FILE* fp) {
+void ReadMovieInState(ystream_struct* fp) {
 
 	struct MovieBufferStruct tempbuffer;
 	int fpos;
@@ -411,7 +412,7 @@ void ReadMovieInState(FILE* fp) {
 	//overwrite the main movie on disk if we are recording or read+write playback
 	if(Movie.Status == Recording || (Movie.Status == Playback && Movie.ReadOnly == 0)) {
 
-		fpos=ftell(fp);//where we are in the savestate
+		fpos=ytell(fp);//where we are in the savestate
 
       if (fpos < 0)
       {
@@ -419,17 +420,18 @@ void ReadMovieInState(FILE* fp) {
          return;
       }
 
-      num_read = fread(&tempbuffer.size, 4, 1, fp);//size
+      num_read = ystream_get(fp, &tempbuffer.size, 4);//size
 		if ((tempbuffer.data = (char *)malloc(tempbuffer.size)) == NULL)
 		{
 			return;
 		}
-      num_read = fread(tempbuffer.data, 1, tempbuffer.size, fp);//movie
-		fseek(fp, fpos, SEEK_SET);//reset savestate position
+      num_read = ystream_get(fp, tempbuffer.data, tempbuffer.size);//movie
+		yseek(fp, fpos, SEEK_SET);//reset savestate position
 
 		rewind(Movie.fp);
 		fwrite(tempbuffer.data, 1, tempbuffer.size, Movie.fp);
 		rewind(Movie.fp);
+		free(tempbuffer.data);
 	}
 }
 
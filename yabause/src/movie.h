@@ -54,8 +54,8 @@ struct MovieBufferStruct ReadMovieIntoABuffer(FILE* fp);
 
 void MovieLoadState(void);
 
-void SaveMovieInState(FILE* fp, IOCheck_struct check);
-void ReadMovieInState(FILE* fp); 
+void SaveMovieInState(ystream_struct* fp, IOCheck_struct check);
+void ReadMovieInState(ystream_struct* fp); 
 
 void TestWrite(struct MovieBufferStruct tempbuffer);
 
@@ -71,7 +71,7 @@ void StopMovie(void);
 
 const char *MakeMovieStateName(const char *filename);
 
-void MovieReadState(FILE* fp);
+void MovieReadState(ystream_struct* fp);
 
 void PauseOrUnpause(void);
 
@@ -1,198 +1,507 @@
-/* copyright Patrick Kooman, 2002
+/*  Copyright 2026 Yabause team
 
-  Lightweight C & C++ profiler. Works both in
-  debug- and release mode. For more info, read:
+    This file is part of Yabause.
 
-  http://www.2dgame-tutorial.com/sdl/profile.htm
+    Yabause is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
 
-  You are free to use / modify / re-distribute this code.
+    Yabause is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
 
-  */
+    You should have received a copy of the GNU General Public License
+    along with Yabause; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+*/
 
 /*! \file profile.c
-    \brief Lightweight C & C++ profiler.
+    \brief Tracing profiler for the frame loop and the video threads.
+
+    Every thread that records an event gets its own ring buffer, only that
+    thread ever writes to it so no locking is needed. Readers take the ring
+    head and walk back from there. ProfileReset() bumps a generation number
+    that each thread checks before recording, so rings are only ever cleared
+    by their owner.
 */
 
 #if !defined(SYS_PROFILE_H) && !defined(DONT_PROFILE)
 
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifdef WIN32
+#include <windows.h>
+#endif
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define PROFILE_USE_TSC
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#define PROFILE_USE_TSC
+#endif
+
 #include "profile.h"
+#include "yabause.h"
+
+#define PROFILE_RING_SIZE   (1 << 17)
+#define PROFILE_RING_MASK   (PROFILE_RING_SIZE - 1)
+#define PROFILE_MAX_THREADS 32
+
+#ifdef _MSC_VER
+#define PROFILE_TLS __declspec(thread)
+#define PROFILE_ADD(p, v) InterlockedExchangeAdd((volatile LONG *)(p), (v))
+#define PROFILE_CAS(p, o, n) (InterlockedCompareExchange((volatile LONG *)(p), (n), (o)) == (LONG)(o))
+#define PROFILE_PUBLISH(p, v) (*(p) = (v))
+#define PROFILE_READ(p) (*(p))
+#else
+#define PROFILE_TLS __thread
+#define PROFILE_ADD(p, v) __sync_fetch_and_add((p), (v))
+#define PROFILE_CAS(p, o, n) __sync_bool_compare_and_swap((p), (o), (n))
+#define PROFILE_PUBLISH(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define PROFILE_READ(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#endif
+
+typedef struct
+{
+   u64 time;
+   u32 tag;
+   u32 begin;
+} ProfileEvent;
+
+typedef struct
+{
+   ProfileEvent events[PROFILE_RING_SIZE];
+   u32 head;
+   u32 generation;
+   u32 id;
+   volatile u32 unused;    // Owner has exited, up for reuse
+   char name[32];
+   u64 start[PROFILE_NUM_TAGS];
+   u64 total[PROFILE_NUM_TAGS];
+   u32 calls[PROFILE_NUM_TAGS];
+} ProfileRing;
+
+static const char *profile_tag_names[PROFILE_NUM_TAGS] =
+{
+#define PROFILE_TAG(id, name) name,
+   PROFILE_TAGS
+#undef PROFILE_TAG
+};
 
-/* The time when the profiler initializes */
-clock_t g_init_time ;
-/* Entries */
-entry_t g_tag [NUM_TAGS] ;
-/* "high-water-mark" */
-int g_i_hwm = 0 ;
-/* Is ProfileInit called? */
-int g_init = 0 ;
-
-/* Looks up given tag and returns the name,
- of 0 if not found. */
-static entry_t* LookupTag (char* str_tag) {
-  int i ;
-  for (i = 0; i < g_i_hwm; ++i) {
-    if (strcmp (g_tag [i].str_name, str_tag) == 0) {
-      return &g_tag [i] ;
-    }
-  }
-  return 0 ;
-}
-
-/* Checks whether the given tag is already started (nesting).
-   This is true when an entry with the given name is found,
-   for which the start_time_t is not 0. */
-static int Nested (char* str_tag) {
-  int i ;
-  for (i = 0; i < g_i_hwm; ++i) {
-    if (strcmp (g_tag [i].str_name, str_tag) == 0 && g_tag [i].start_time > -1) {
-      /* Already 'running': nested*/
-      return 1 ;
-    }
-  }
-  /* Not running: not nested */
-  return 0 ;
-}
-
-/* Adds the given tag and return the entry it is stored into */
-static entry_t* AddTag (char* str_tag) {
-  size_t str_tag_len = strlen(str_tag);
-
-  if (str_tag_len >= 100)
-     return 0;//error
-
-  if (g_i_hwm + 1 == NUM_TAGS) {
-    /* Full */
-    return 0 ;
-  }
-  /* Copy the name */
-  strcpy (g_tag [g_i_hwm].str_name, str_tag) ;
-  g_tag [g_i_hwm].start_time = -1 ;
-  /* Increase the high-water-mark but return the current index */
-  return &g_tag [g_i_hwm++] ;
-}
-
-/* Compare function for 'qsort' */
-static int CompareEntries (const void* p_1, const void* p_2) {
-  entry_t* p_entry1, *p_entry2 ;
-  /* Cast elements to entry_t type */
-  p_entry1 = (entry_t*) p_1 ;
-  p_entry2 = (entry_t*) p_2 ;
-  /* Compare */
-  return p_entry2->l_total_ms - p_entry1->l_total_ms ; 
-}
-
-/* Called on the first start-call. It receives the start-time */
-static void Init (void) {
-  memset (g_tag, 0, sizeof (g_tag)) ;
-  /* Retreive the time */
-  g_init_time = clock () ;
-  /* Flag that this function has been called */
-  g_init = 1 ;
-  g_i_hwm = 0 ;
-}
-
-/* Prints profiling statistice to stdout, 
-sorted by percentage (descending) */
-void ProfilePrint (void) {
-  int i ;
-  long l_prof_time ;
-  if (g_i_hwm == 0) {
-    fprintf (stdout, "ProfilePrint: nothing to print.\n") ;
-    return ;
-  }
-  /* Retreive the time */
-  l_prof_time = clock () - g_init_time ;
-  if (l_prof_time == 0) {
-    /* Avoid division by 0 */
-    fprintf (stdout, "Warning: nothing to show because timer ran for less than 1 clock-tick.") ;
-  }
-  /* Print warnings for tags which are not stopped. */
-  for (i = 0; i < g_i_hwm; ++i) {
-    if (g_tag [i].i_stopped == 0) {
-      g_tag [i].l_total_ms += clock () - g_tag [i].start_time ;
-      fprintf (stdout, "Warning: \"%s\" started but not stopped. (Done now, but result may be over-expensive!)\n", g_tag [i].str_name) ;
-    }
-  }
-  /* Sort the array desending */
-  qsort (&g_tag, g_i_hwm, sizeof (entry_t), CompareEntries) ;
-  fprintf (stdout, "Profiler results (descending by percentage):\n\n") ;
-  for (i = 0; i < g_i_hwm; ++i) {
-    /* Print statistics */
-    fprintf (stdout, "< calls: %2d, total ms: %3d, percentage: %3.1f%% > - \"%s\"\n",
-      g_tag [i].i_calls, 
-      (int) ((double) g_tag [i].l_total_ms / CLOCKS_PER_SEC * 1000),
-      (double) g_tag [i].l_total_ms / l_prof_time * 100,
-      g_tag [i].str_name) ;
-  }
-}
-
-/* Starts timer for given tag. If it does not exist yet,
- it is added.
-
-  Note: 1. The tag may not be nested with the same name
-        2. The tag may not equal "" */
-void ProfileStart (char* str_tag) {
-  entry_t* p_entry ;
-  /* One the first call, we must initialize the profiler. */
-  if (!g_init) {
-    Init () ;
-  }
-  /* Test for "" */
-  if (*str_tag == '\0') {
-    fprintf (stdout, "ERROR in ProfileStart: a tag may not be \"\". Call is denied.") ; 
-    return ;
-  }
-  /* Search the entry with the given name */
-  p_entry = LookupTag (str_tag) ;
-  if (!p_entry) {
-    /* New tag, add it*/
-    p_entry = AddTag (str_tag) ;
-    if (!p_entry) {
-      fprintf (stdout, "WARNING in ProfileStart: no more space to store the tag (\"%s\"). Increase NUM_TAGS in \"profile.h\". Call is denied.\n", str_tag) ;
-      return ;
-    }    
-  }
-  /* Check for nesting of equal tag.*/
-  if (Nested (str_tag)) {
-    fprintf (stdout, "ERROR in ProfileStart: nesting of equal tags not allowed (\"%s\"). Call is denied.\n", str_tag) ;
-    return ;
-  }
-  /* Increase the number of hits */
-  ++p_entry->i_calls ;
-  /* Set the start time */
-  p_entry->start_time = clock () ;
-  p_entry->i_stopped = 0 ;
-}
-
-/* Stops timer for given tag. Checks for existence.
- Adds the time between now and the Start call to the
- total time.*/
-void ProfileStop (char* str_tag) {
-  clock_t end_time ;
-  entry_t* p_entry ;
-  /* Test for "" */
-  if (*str_tag == '\0') {
-    fprintf (stdout, "ERROR in ProfileStop: a tag may not be \"\". Call is denied.") ; 
-    return ;
-  }
-  /* Check for a existing name */
-  p_entry = LookupTag (str_tag) ;
-  if (!p_entry) {
-    fprintf (stdout, "WARNING in ProfileStop: tag \"%s\" was never started. Call is denied.\n", str_tag) ;
-    return ;
-  }    
-  /* Get the time */
-  end_time = clock () ;
-  p_entry->l_total_ms += end_time - p_entry->start_time ;
-  /* Reset */
-  p_entry->start_time = -1 ;
-  p_entry->i_stopped = 1 ;
-}
-
-/* Resets the profiler. */
-void ProfileReset (void) {
-  Init () ;
+volatile int ProfileEnabled = 0;
+
+static ProfileRing *profile_rings[PROFILE_MAX_THREADS];
+static volatile long profile_num_rings = 0;
+static volatile u32 profile_generation = 0;
+static volatile u32 profile_epoch = 0;
+static int profile_started = 0;
+static u64 profile_reset_time;
+static u64 profile_anchor_time;
+static u64 profile_anchor_clock;
+static PROFILE_TLS ProfileRing *profile_ring = NULL;
+// Epoch profile_ring was taken in, rings from before ProfileDeInit are gone
+static PROFILE_TLS u32 profile_ring_epoch = 0;
+static PROFILE_TLS const char *profile_thread_name = NULL;
+
+//////////////////////////////////////////////////////////////////////////////
+
+static u64 ProfileClock(void)
+{
+#if defined(WIN32)
+   LARGE_INTEGER counter;
+   QueryPerformanceCounter(&counter);
+   return (u64)counter.QuadPart;
+#elif defined(CLOCK_MONOTONIC_RAW)
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+   return (u64)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#elif defined(CLOCK_MONOTONIC)
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (u64)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#else
+   return YabauseGetTicks();
+#endif
 }
 
-#endif /* !SYS_PROFILE_H && !DONT_PROFILE */
+//////////////////////////////////////////////////////////////////////////////
+
+static u64 ProfileClockFrequency(void)
+{
+#if defined(WIN32)
+   LARGE_INTEGER freq;
+   QueryPerformanceFrequency(&freq);
+   return (u64)freq.QuadPart;
+#elif defined(CLOCK_MONOTONIC_RAW) || defined(CLOCK_MONOTONIC)
+   return 1000000000;
+#else
+   return yabsys.tickfreq;
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+// The TSC is the cheapest timestamp on x86, it is calibrated against the
+// OS clock over the whole time profiling has been enabled
+static INLINE u64 ProfileNow(void)
+{
+#ifdef PROFILE_USE_TSC
+   return __rdtsc();
+#else
+   return ProfileClock();
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static double ProfileFrequency(void)
+{
+#ifdef PROFILE_USE_TSC
+   u64 clock = ProfileClock() - profile_anchor_clock;
+   u64 time = ProfileNow() - profile_anchor_time;
+
+   if (clock == 0)
+      return (double)ProfileClockFrequency();
+   return (double)time * (double)ProfileClockFrequency() / (double)clock;
+#else
+   return (double)ProfileClockFrequency();
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void ProfileClearRing(ProfileRing *ring)
+{
+   ring->head = 0;
+   memset(ring->start, 0, sizeof(ring->start));
+   memset(ring->total, 0, sizeof(ring->total));
+   memset(ring->calls, 0, sizeof(ring->calls));
+   ring->generation = profile_generation;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void ProfileTakeRing(ProfileRing *ring)
+{
+   if (profile_thread_name != NULL)
+      snprintf(ring->name, sizeof(ring->name), "%s", profile_thread_name);
+   else
+      snprintf(ring->name, sizeof(ring->name), "Thread %u", ring->id);
+   ProfileClearRing(ring);
+   profile_ring = ring;
+   profile_ring_epoch = profile_epoch;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static ProfileRing *ProfileGetRing(void)
+{
+   ProfileRing *ring = profile_ring;
+   long id;
+
+   if (ring != NULL && profile_ring_epoch == profile_epoch)
+   {
+      if (ring->generation != profile_generation)
+         ProfileClearRing(ring);
+      return ring;
+   }
+
+   // Rings of threads that have exited are reused before adding new ones
+   for (id = 0; id < profile_num_rings && id < PROFILE_MAX_THREADS; id++)
+   {
+      ring = PROFILE_READ(&profile_rings[id]);
+      if (ring != NULL && ring->unused && PROFILE_CAS(&ring->unused, 1, 0))
+      {
+         ProfileTakeRing(ring);
+         return ring;
+      }
+   }
+
+   // Threads past the limit simply don't get traced
+   if (profile_num_rings >= PROFILE_MAX_THREADS)
+      return NULL;
+   if ((ring = (ProfileRing *)calloc(1, sizeof(ProfileRing))) == NULL)
+      return NULL;
+   if ((id = PROFILE_ADD(&profile_num_rings, 1)) >= PROFILE_MAX_THREADS)
+   {
+      free(ring);
+      return NULL;
+   }
+
+   ring->id = (u32)id;
+   ProfileTakeRing(ring);
+   PROFILE_PUBLISH(&profile_rings[id], ring);
+   return ring;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static INLINE void ProfilePush(ProfileRing *ring, u64 time, int tag, int begin)
+{
+   ProfileEvent *event = &ring->events[ring->head & PROFILE_RING_MASK];
+
+   event->time = time;
+   event->tag = tag;
+   event->begin = begin;
+   PROFILE_PUBLISH(&ring->head, ring->head + 1);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void ProfileEnable(int enable)
+{
+   if (enable && !profile_started)
+   {
+      profile_anchor_clock = ProfileClock();
+      profile_anchor_time = profile_reset_time = ProfileNow();
+      profile_started = 1;
+   }
+   ProfileEnabled = enable;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void ProfileBegin(int tag)
+{
+   ProfileRing *ring = ProfileGetRing();
+   u64 now;
+
+   if (ring == NULL)
+      return;
+
+   now = ProfileNow();
+   ring->start[tag] = now;
+   ProfilePush(ring, now, tag, 1);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void ProfileEnd(int tag)
+{
+   ProfileRing *ring = ProfileGetRing();
+   u64 now;
+
+   if (ring == NULL)
+      return;
+
+   now = ProfileNow();
+   // A begin from before the last reset or enable doesn't count
+   if (ring->start[tag] != 0)
+   {
+      ring->total[tag] += now - ring->start[tag];
+      ring->calls[tag]++;
+      ring->start[tag] = 0;
+   }
+   ProfilePush(ring, now, tag, 0);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void ProfileSetThreadName(const char *name)
+{
+   profile_thread_name = name;
+   if (profile_ring != NULL)
+      snprintf(profile_ring->name, sizeof(profile_ring->name), "%s", name);
+}
+
+//////////////////////////////////////////////////////////////////////////////
 
+// The ring keeps its events, they stay in the trace until the next thread
+// taking it clears them
+void ProfileThreadExit(void)
+{
+   if (profile_ring != NULL && profile_ring_epoch == profile_epoch)
+      PROFILE_PUBLISH(&profile_ring->unused, 1);
+   profile_ring = NULL;
+   profile_thread_name = NULL;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void ProfileDeInit(void)
+{
+   int i;
+
+   ProfileEnabled = 0;
+   profile_started = 0;
+
+   for (i = 0; i < PROFILE_MAX_THREADS; i++)
+   {
+      free(profile_rings[i]);
+      profile_rings[i] = NULL;
+   }
+
+   profile_num_rings = 0;
+   profile_ring = NULL;
+   PROFILE_ADD(&profile_epoch, 1);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void ProfileReset(void)
+{
+   profile_reset_time = ProfileNow();
+   PROFILE_ADD(&profile_generation, 1);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static ProfileRing *ProfileLiveRing(int i)
+{
+   ProfileRing *ring;
+
+   if (i >= PROFILE_MAX_THREADS)
+      return NULL;
+   ring = PROFILE_READ(&profile_rings[i]);
+   if (ring == NULL || ring->generation != profile_generation)
+      return NULL;
+   return ring;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+const char *ProfileTagName(int tag)
+{
+   if (tag < 0 || tag >= PROFILE_NUM_TAGS)
+      return "";
+   return profile_tag_names[tag];
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+double ProfileTotalMs(int tag)
+{
+   u64 total = 0;
+   int i;
+
+   if (!profile_started)
+      return 0.0;
+
+   for (i = 0; i < profile_num_rings; i++)
+   {
+      ProfileRing *ring = ProfileLiveRing(i);
+      if (ring != NULL)
+         total += ring->total[tag];
+   }
+
+   return (double)total * 1000.0 / ProfileFrequency();
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+u32 ProfileCalls(int tag)
+{
+   u32 calls = 0;
+   int i;
+
+   for (i = 0; i < profile_num_rings; i++)
+   {
+      ProfileRing *ring = ProfileLiveRing(i);
+      if (ring != NULL)
+         calls += ring->calls[tag];
+   }
+
+   return calls;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void ProfilePrint(void)
+{
+   int order[PROFILE_NUM_TAGS];
+   double elapsed;
+   int i, j;
+
+   if (!profile_started)
+   {
+      fprintf(stdout, "ProfilePrint: nothing to print.\n");
+      return;
+   }
+
+   elapsed = (double)(ProfileNow() - profile_reset_time) * 1000.0 / ProfileFrequency();
+
+   for (i = 0; i < PROFILE_NUM_TAGS; i++)
+      order[i] = i;
+
+   // Insertion sort, descending by time
+   for (i = 1; i < PROFILE_NUM_TAGS; i++)
+   {
+      int tag = order[i];
+      double ms = ProfileTotalMs(tag);
+
+      for (j = i; j > 0 && ProfileTotalMs(order[j - 1]) < ms; j--)
+         order[j] = order[j - 1];
+      order[j] = tag;
+   }
+
+   fprintf(stdout, "Profiler results (descending by percentage):\n\n");
+   for (i = 0; i < PROFILE_NUM_TAGS; i++)
+   {
+      int tag = order[i];
+      double ms = ProfileTotalMs(tag);
+
+      if (ProfileCalls(tag) == 0)
+         continue;
+
+      fprintf(stdout, "< calls: %8u, total ms: %9.3f, percentage: %5.1f%% > - \"%s\"\n",
+              ProfileCalls(tag), ms, elapsed > 0.0 ? ms / elapsed * 100.0 : 0.0,
+              profile_tag_names[tag]);
+   }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+int ProfileWriteTrace(const char *filename)
+{
+   FILE *fp;
+   double freq = ProfileFrequency();
+   int i, first = 1;
+
+   if ((fp = fopen(filename, "w")) == NULL)
+      return -1;
+
+   fprintf(fp, "{\"traceEvents\":[\n");
+
+   for (i = 0; i < profile_num_rings; i++)
+   {
+      ProfileRing *ring = ProfileLiveRing(i);
+      u32 head, pos, depth = 0;
+
+      if (ring == NULL)
+         continue;
+
+      fprintf(fp, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+              first ? "" : ",\n", ring->id, ring->name);
+      first = 0;
+
+      head = PROFILE_READ(&ring->head);
+      pos = (head > PROFILE_RING_SIZE) ? head - PROFILE_RING_SIZE : 0;
+
+      for (; pos != head; pos++)
+      {
+         const ProfileEvent *event = &ring->events[pos & PROFILE_RING_MASK];
+         double us = (double)(event->time - profile_reset_time) * 1000000.0 / freq;
+
+         // The ring may have wrapped in the middle of a region
+         if (event->begin)
+            depth++;
+         else if (depth == 0)
+            continue;
+         else
+            depth--;
+
+         fprintf(fp, ",\n{\"name\":\"%s\",\"ph\":\"%s\",\"ts\":%.3f,\"pid\":1,\"tid\":%u}",
+                 profile_tag_names[event->tag], event->begin ? "B" : "E", us, ring->id);
+      }
+   }
+
+   fprintf(fp, "\n]}\n");
+   fclose(fp);
+   return 0;
+}
+
+#endif /* !SYS_PROFILE_H && !DONT_PROFILE */
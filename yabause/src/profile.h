@@ -1,65 +1,116 @@
-/* copyright Patrick Kooman, 2002
+/*  Copyright 2026 Yabause team
 
-  Lightweight C & C++ profiler. Works both in
-  debug- and release mode. For more info, read:
+    This file is part of Yabause.
 
-  http://www.2dgame-tutorial.com/sdl/profile.htm
+    Yabause is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
 
-  You are free to use / modify / re-distribute this code.
+    Yabause is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Yabause; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+*/
+
+/*! \file profile.h
+    \brief Tracing profiler for the frame loop and the video threads.
+
+    Tags are fixed at compile time, PROFILE_START(MSH2) records a begin
+    event for PROFILE_MSH2 into a ring buffer owned by the calling thread.
+    Nothing is recorded until ProfileEnable(1), so the macros can stay in
+    release builds. Define DONT_PROFILE to compile them out entirely.
+*/
 
-  */
 #ifndef _PROFILE_H_
 #define _PROFILE_H_
 
-#include <stdio.h>
-#include <stdlib.h>
-#include <time.h>
-#include <string.h>
-#include <assert.h>
+#include "core.h"
+
+#define PROFILE_TAGS \
+   PROFILE_TAG(FRAME,       "Frame") \
+   PROFILE_TAG(TOTAL,       "Total Emulation") \
+   PROFILE_TAG(MSH2,        "MSH2") \
+   PROFILE_TAG(SSH2,        "SSH2") \
+   PROFILE_TAG(SCSP,        "SCSP") \
+   PROFILE_TAG(SCU,         "SCU") \
+   PROFILE_TAG(M68K,        "68K") \
+   PROFILE_TAG(SCSPWAIT,    "SCSP wait") \
+   PROFILE_TAG(HBLANKIN,    "hblankin") \
+   PROFILE_TAG(HBLANKOUT,   "hblankout") \
+   PROFILE_TAG(VBLANKIN,    "vblankin") \
+   PROFILE_TAG(VDP,         "VDP1/VDP2") \
+   PROFILE_TAG(SMPC,        "SMPC") \
+   PROFILE_TAG(CDB,         "CDB") \
+   PROFILE_TAG(VDP1DRAW,    "VDP1 draw") \
+   PROFILE_TAG(VDP1TILE,    "VDP1 tile") \
+   PROFILE_TAG(VDP2LAYER,   "VDP2 layer") \
+   PROFILE_TAG(SPRITE,      "Sprite layer") \
+   PROFILE_TAG(TITAN,       "Titan") \
+   PROFILE_TAG(TITANLINES,  "Titan lines") \
+   PROFILE_TAG(REWIND,      "Rewind")
+
+enum
+{
+#define PROFILE_TAG(id, name) PROFILE_##id,
+   PROFILE_TAGS
+#undef PROFILE_TAG
+   PROFILE_NUM_TAGS
+};
 
 #ifdef DONT_PROFILE
 /* Profiling disabled: compiler won't generate machine instructions now. */
 #define PROFILE_START(t)
 #define PROFILE_STOP(t)
-#define PROFILE_PRINT()     
+#define PROFILE_THREAD_NAME(n)
+#define PROFILE_THREAD_EXIT()
+#define PROFILE_DEINIT()
+#define PROFILE_PRINT()
 #define PROFILE_RESET()
 #else
-/* Profiling enabled */
-#define MAX_TAG_LEN       100
-#define NUM_TAGS          100
-
-typedef struct {
-  char str_name [MAX_TAG_LEN] ;
-  int i_calls ;
-  clock_t start_time ;
-  int i_stopped ;
-  long l_total_ms ;
-} entry_t ;
-
-/* Compiler calls functions now. */
-#define PROFILE_START(t)    ProfileStart (t)
-#define PROFILE_STOP(t)     ProfileStop (t)
-#define PROFILE_PRINT()     ProfilePrint ()
-#define PROFILE_RESET()     ProfileReset ()
+#define PROFILE_START(t)       do { if (ProfileEnabled) ProfileBegin(PROFILE_##t); } while (0)
+#define PROFILE_STOP(t)        do { if (ProfileEnabled) ProfileEnd(PROFILE_##t); } while (0)
+#define PROFILE_THREAD_NAME(n) ProfileSetThreadName(n)
+#define PROFILE_THREAD_EXIT()  ProfileThreadExit()
+#define PROFILE_DEINIT()       ProfileDeInit()
+#define PROFILE_PRINT()        ProfilePrint()
+#define PROFILE_RESET()        ProfileReset()
+#endif
 
 #ifdef __cplusplus
 extern "C" {
 #endif /* __cplusplus */
 
-/* Start timer for given tag */
-void ProfileStart (char* str_tag) ;
-/* Stops timer for given tag and add time to total time for this tag */
-void ProfileStop (char* str_tag) ;
-/* Prints result to stdout */
-void ProfilePrint (void) ;
-/* Resets the profiler. */
-void ProfileReset (void) ;
+extern volatile int ProfileEnabled;
+
+void ProfileEnable(int enable);
+void ProfileBegin(int tag);
+void ProfileEnd(int tag);
+/* Names the calling thread in the trace output */
+void ProfileSetThreadName(const char *name);
+/* Hands the calling thread's ring to the next thread that needs one, call
+   it on the way out of any thread that records events */
+void ProfileThreadExit(void);
+/* Frees every ring, the other threads must not be recording */
+void ProfileDeInit(void);
+/* Prints the time spent in each tag since the last reset to stdout */
+void ProfilePrint(void);
+/* Drops everything recorded so far, threads pick it up on their next event */
+void ProfileReset(void);
+/* Writes the recorded events as Chrome trace event JSON (chrome://tracing) */
+int ProfileWriteTrace(const char *filename);
+
+const char *ProfileTagName(int tag);
+/* Time and calls summed over all threads since the last reset */
+double ProfileTotalMs(int tag);
+u32 ProfileCalls(int tag);
 
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
 
-#endif /* NO_PROFILE */
-
 #endif /* _PROFILE_H_ */
-
@@ -236,6 +236,17 @@ struct Q68State_ {
     /* Buffer for tracking translated code blocks */
     uint8_t jit_pages[1<<(24-(Q68_JIT_PAGE_BITS+3))];
 
+    /**** Direct read region (see q68_set_read_ram()) ****/
+
+    /* Kept after everything the JIT assembly knows the offset of */
+    const uint8_t *read_ram;
+    uint32_t read_ram_end;
+    uint32_t read_ram_mask;
+
+    /**** Translation event callback (see q68_set_jit_notify_func()) ****/
+
+    Q68JitNotifyFunc *jit_notify;
+
 };
 
 /*-----------------------------------------------------------------------*/
@@ -411,6 +422,38 @@ typedef int OpcodeFunc(Q68State *state, uint32_t opcode);
 /******************* Memory access functions (inline) ********************/
 /*************************************************************************/
 
+/**
+ * RAW_READ{8,16}:  Read a byte or word from memory, taking it straight
+ * from the direct read region if the address is in it.
+ *
+ * [Parameters]
+ *     state: Processor state block
+ *      addr: Address to read (must already be masked to 24 bits)
+ * [Return value]
+ *     Value read (only the low 8 or 16 bits are valid)
+ */
+
+static inline uint32_t RAW_READ8(Q68State *state, uint32_t addr) {
+    if (addr < state->read_ram_end) {
+#ifdef WORDS_BIGENDIAN
+        return state->read_ram[addr & state->read_ram_mask];
+#else
+        return state->read_ram[(addr & state->read_ram_mask) ^ 1];
+#endif
+    }
+    return state->readb_func(addr);
+}
+
+static inline uint32_t RAW_READ16(Q68State *state, uint32_t addr) {
+    if (addr < state->read_ram_end) {
+        return *(const uint16_t *)(state->read_ram
+                                   + (addr & state->read_ram_mask));
+    }
+    return state->readw_func(addr);
+}
+
+/*-----------------------------------------------------------------------*/
+
 /**
  * READ[SU]{8,16,32}:  Read a value from memory.
  *
@@ -422,33 +465,33 @@ typedef int OpcodeFunc(Q68State *state, uint32_t opcode);
  */
 
 static inline int32_t READS8(Q68State *state, uint32_t addr) {
-    return (int8_t) state->readb_func(addr & 0xFFFFFF);
+    return (int8_t) RAW_READ8(state, addr & 0xFFFFFF);
 }
 static inline uint32_t READU8(Q68State *state, uint32_t addr) {
-    return state->readb_func(addr & 0xFFFFFF);
+    return RAW_READ8(state, addr & 0xFFFFFF);
 }
 
 static inline int32_t READS16(Q68State *state, uint32_t addr) {
-    return (int16_t) state->readw_func(addr & 0xFFFFFF);
+    return (int16_t) RAW_READ16(state, addr & 0xFFFFFF);
 }
 static inline uint32_t READU16(Q68State *state, uint32_t addr) {
-    return state->readw_func(addr & 0xFFFFFF);
+    return RAW_READ16(state, addr & 0xFFFFFF);
 }
 
 static inline int32_t READS32(Q68State *state, uint32_t addr) {
     addr &= 0xFFFFFF;
-    int32_t value = (int32_t) state->readw_func(addr) << 16;
+    int32_t value = (int32_t) RAW_READ16(state, addr) << 16;
     addr += 2;
     addr &= 0xFFFFFF;
-    value |= state->readw_func(addr);
+    value |= RAW_READ16(state, addr);
     return value;
 }
 static inline uint32_t READU32(Q68State *state, uint32_t addr) {
     addr &= 0xFFFFFF;
-    uint32_t value = state->readw_func(addr) << 16;
+    uint32_t value = RAW_READ16(state, addr) << 16;
     addr += 2;
     addr &= 0xFFFFFF;
-    value |= state->readw_func(addr);
+    value |= RAW_READ16(state, addr);
     return value;
 }
 
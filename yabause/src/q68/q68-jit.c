@@ -560,6 +560,10 @@ Q68JitEntry *q68_jit_translate(Q68State *state, uint32_t address)
         }
     }
 
+    if (state->jit_notify) {
+        state->jit_notify(Q68_JIT_NOTIFY_TRANSLATE_START, address, NULL, 0);
+    }
+
     /* Clear out any existing translation, then search for an empty slot in
      * the hash table.  If we've reached the data size limit, first evict
      * old entries until we're back under the limit. */
@@ -670,6 +674,11 @@ Q68JitEntry *q68_jit_translate(Q68State *state, uint32_t address)
         current_entry->native_size = current_entry->native_length;
     }
     state->jit_total_data += current_entry->native_size;
+    if (state->jit_notify) {
+        state->jit_notify(Q68_JIT_NOTIFY_TRANSLATE_END,
+                          current_entry->m68k_start, current_entry->native_code,
+                          current_entry->native_length);
+    }
     /* Prepare the block for execution so it can be immediately passed to
      * q68_jit_run() (see q68_jit_find() for why we do it here) */
     current_entry->exec_address = current_entry->native_code;
@@ -851,6 +860,9 @@ void q68_jit_clear_page(Q68State *state, uint32_t address)
     }
 
     JIT_PAGE_CLEAR(state, page);
+    if (state->jit_notify) {
+        state->jit_notify(Q68_JIT_NOTIFY_CLEAR, address, NULL, 0);
+    }
 }
 
 /*-----------------------------------------------------------------------*/
@@ -922,6 +934,9 @@ void q68_jit_clear_write(Q68State *state, uint32_t address, uint32_t size)
             JIT_PAGE_SET(state, page);
         }
     }
+    if (found && state->jit_notify) {
+        state->jit_notify(Q68_JIT_NOTIFY_CLEAR, address, NULL, 0);
+    }
     if (!found || start < (address & ~1) - 8) {
         start = (address & ~1) - 8;
     }
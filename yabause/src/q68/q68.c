@@ -89,6 +89,9 @@ Q68State *q68_create_ex(void *(*malloc_func)(size_t size),
     state->malloc_func  = malloc_func;
     state->realloc_func = realloc_func;
     state->free_func    = free_func;
+    state->read_ram     = NULL;
+    state->read_ram_end = 0;
+    state->jit_notify   = NULL;
 
 #ifdef Q68_USE_JIT
     if (!q68_jit_init(state)) {
@@ -180,6 +183,32 @@ void q68_set_writew_func(Q68State *state, Q68WriteFunc func)
 
 /*-----------------------------------------------------------------------*/
 
+/**
+ * q68_set_read_ram:  Set a region of memory which the virtual processor
+ * reads directly instead of calling the read callbacks.  Reads from
+ * addresses below end are taken from ram[address & mask], which holds
+ * 16-bit words in native byte order.  Writes always go through the write
+ * callbacks.  The JIT's native code still reads through the callbacks,
+ * so these must handle the region as well.
+ *
+ * [Parameters]
+ *     state: Processor state block
+ *       ram: Pointer to the memory region (NULL to disable)
+ *       end: First address past the region
+ *      mask: Mask applied to addresses within the region
+ * [Return value]
+ *     None
+ */
+void q68_set_read_ram(Q68State *state, const void *ram, uint32_t end,
+                      uint32_t mask)
+{
+    state->read_ram      = (const uint8_t *)ram;
+    state->read_ram_end  = ram ? end : 0;
+    state->read_ram_mask = mask;
+}
+
+/*-----------------------------------------------------------------------*/
+
 /**
  * q68_set_jit_flush_func:  Set a function to be used to flush the native
  * CPU's caches after a block of 68k code has been translated into native
@@ -197,6 +226,25 @@ void q68_set_jit_flush_func(Q68State *state, void (*flush_func)(void))
     state->jit_flush   = flush_func;
 }
 
+/*-----------------------------------------------------------------------*/
+
+/**
+ * q68_set_jit_notify_func:  Set a function to be called when blocks are
+ * translated or cleared, for profiling the translated code.  If not set,
+ * no notifications are made.  This function has no effect if dynamic
+ * translation is not enabled.
+ *
+ * [Parameters]
+ *           state: Processor state block
+ *     notify_func: Notification function (NULL if none)
+ * [Return value]
+ *     None
+ */
+void q68_set_jit_notify_func(Q68State *state, Q68JitNotifyFunc *notify_func)
+{
+    state->jit_notify = notify_func;
+}
+
 /*************************************************************************/
 
 /**
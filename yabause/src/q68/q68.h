@@ -53,6 +53,27 @@ typedef uint32_t Q68ReadFunc(uint32_t address);
  */
 typedef void Q68WriteFunc(uint32_t address, uint32_t data);
 
+/* Events reported to the JIT notification function */
+enum {
+    Q68_JIT_NOTIFY_TRANSLATE_START = 0, // About to translate a block
+    Q68_JIT_NOTIFY_TRANSLATE_END,       // Block translated into native code
+    Q68_JIT_NOTIFY_CLEAR,               // Translations cleared by a write
+};
+
+/**
+ * Q68JitNotifyFunc:  Receive notification of dynamic translation events.
+ *
+ * [Parameters]
+ *           event: Event type (Q68_JIT_NOTIFY_*)
+ *         address: Block start address (TRANSLATE_*) or address written (CLEAR)
+ *     native_code: Translated native code (TRANSLATE_END only, else NULL)
+ *   native_length: Length of native code in bytes (TRANSLATE_END only)
+ * [Return value]
+ *     None
+ */
+typedef void Q68JitNotifyFunc(int event, uint32_t address,
+                              const void *native_code, uint32_t native_length);
+
 /*************************************************************************/
 
 /* Virtual processor state (opaque) */
@@ -139,6 +160,25 @@ extern void q68_set_readw_func(Q68State *state, Q68ReadFunc func);
 extern void q68_set_writeb_func(Q68State *state, Q68WriteFunc func);
 extern void q68_set_writew_func(Q68State *state, Q68WriteFunc func);
 
+/**
+ * q68_set_read_ram:  Set a region of memory which the virtual processor
+ * reads directly instead of calling the read callbacks.  Reads from
+ * addresses below end are taken from ram[address & mask], which holds
+ * 16-bit words in native byte order.  Writes always go through the write
+ * callbacks.  The JIT's native code still reads through the callbacks,
+ * so these must handle the region as well.
+ *
+ * [Parameters]
+ *     state: Processor state block
+ *       ram: Pointer to the memory region (NULL to disable)
+ *       end: First address past the region
+ *      mask: Mask applied to addresses within the region
+ * [Return value]
+ *     None
+ */
+extern void q68_set_read_ram(Q68State *state, const void *ram, uint32_t end,
+                             uint32_t mask);
+
 /**
  * q68_set_jit_flush_func:  Set a function to be used to flush the native
  * CPU's caches after a block of 68k code has been translated into native
@@ -153,6 +193,21 @@ extern void q68_set_writew_func(Q68State *state, Q68WriteFunc func);
  */
 extern void q68_set_jit_flush_func(Q68State *state, void (*flush_func)(void));
 
+/**
+ * q68_set_jit_notify_func:  Set a function to be called when blocks are
+ * translated or cleared, for profiling the translated code.  If not set,
+ * no notifications are made.  This function has no effect if dynamic
+ * translation is not enabled.
+ *
+ * [Parameters]
+ *           state: Processor state block
+ *     notify_func: Notification function (NULL if none)
+ * [Return value]
+ *     None
+ */
+extern void q68_set_jit_notify_func(Q68State *state,
+                                    Q68JitNotifyFunc *notify_func);
+
 /*----------------------------------*/
 
 /**
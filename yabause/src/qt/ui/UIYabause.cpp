@@ -790,12 +790,14 @@ void UIYabause::on_aFileSettings_triggered()
 				int num = newhash["General/NumThreads"].toInt() < 1 ? 1 : newhash["General/NumThreads"].toInt();
 				VIDSoftSetVdp1ThreadEnable(num == 1 ? 0 : 1);
 				VIDSoftSetNumLayerThreads(num);
+				VIDSoftSetNumVdp1Threads(num);
 				VIDSoftSetNumPriorityThreads(num);
 			}
 			else
 			{
 				VIDSoftSetVdp1ThreadEnable(0);
 				VIDSoftSetNumLayerThreads(1);
+				VIDSoftSetNumVdp1Threads(1);
 				VIDSoftSetNumPriorityThreads(1);
 			}
 		}
@@ -0,0 +1,552 @@
+/*  Copyright 2026 Yabause team
+
+    This file is part of Yabause.
+
+    Yabause is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Yabause is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Yabause; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+*/
+
+/*! \file rewind.c
+    \brief Rewind buffer built from save state deltas.
+
+    Only the latest snapshot is kept as a full save state. Every older one
+    is stored as the XOR of itself and the snapshot that followed it, packed
+    as runs of zero bytes and literal bytes. Stepping back applies the deltas
+    newest first. RAM pages nobody wrote since the last snapshot are known to
+    XOR to zero and are not even compared.
+*/
+
+#include <stddef.h>
+#include "rewind.h"
+#include "memory.h"
+#include "sh2core.h"
+#include "sh2int.h"
+#include "vdp1.h"
+#include "vdp2.h"
+
+#define REWIND_PAGE_SIZE (1 << RAM_DIRTY_PAGE_SHIFT)
+#define REWIND_MAX_REGIONS 5
+
+typedef struct
+{
+   u32 statesize;   // size of the older state this delta rebuilds
+   u32 size;
+   u8 data[1];
+} RewindDelta;
+
+typedef struct
+{
+   u32 offset;
+   u32 size;
+   const u8 *dirty;
+} RewindRegion;
+
+typedef struct
+{
+   u8 *out;
+   u32 pos;
+   u32 zeros;
+   u32 litstart;
+   u32 litlen;
+   const u8 *older;
+   const u8 *newer;
+   u32 newersize;
+} RewindEncoder;
+
+static struct
+{
+   int init;
+   int valid;
+   u32 budget;
+   u32 used;
+   ystream_struct latest;
+   ystream_struct scratch;
+   u8 *encbuf;
+   u32 encsize;
+   RewindDelta **deltas;
+   u32 first;
+   u32 count;
+   u32 capacity;
+} rewindbuf;
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void RewindAddRegion(RewindRegion *regions, int *count, u32 chunk,
+                            u32 chunksize, u32 start, u32 size, const u8 *dirty)
+{
+   if (start + size > chunksize)
+      return;
+
+   regions[*count].offset = chunk + start;
+   regions[*count].size = size;
+   regions[*count].dirty = dirty;
+   (*count)++;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+// Finds the tracked RAM blocks by walking the chunk headers. They come out
+// in the order they are stored in.
+static int RewindFindRegions(const u8 *state, u32 size, RewindRegion *regions,
+                             int wram)
+{
+   u32 pos = 0x14;
+   int count = 0;
+
+   while (pos + 12 <= size)
+   {
+      const u8 *name = state + pos;
+      u32 chunksize;
+
+      memcpy(&chunksize, state + pos + 8, sizeof(chunksize));
+      pos += 12;
+      if (chunksize > size - pos)
+         break;
+
+      if (memcmp(name, "VDP1", 4) == 0)
+         RewindAddRegion(regions, &count, pos, chunksize, sizeof(Vdp1), 0x80000, Vdp1RamDirtyPages);
+      else if (memcmp(name, "VDP2", 4) == 0)
+         RewindAddRegion(regions, &count, pos, chunksize, sizeof(Vdp2), 0x80000, Vdp2RamDirtyPages);
+      else if (memcmp(name, "OTHR", 4) == 0)
+      {
+         RewindAddRegion(regions, &count, pos, chunksize, 0, 0x10000, BupRamDirtyPages);
+         if (wram)
+         {
+            RewindAddRegion(regions, &count, pos, chunksize, 0x10000, 0x100000, WramDirtyPages + 0x100);
+            RewindAddRegion(regions, &count, pos, chunksize, 0x110000, 0x100000, WramDirtyPages);
+         }
+      }
+
+      pos += chunksize;
+   }
+
+   return count;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+// The recompilers write WRAM from generated code without going through the
+// handlers that keep WramDirtyPages up to date
+static int RewindWramTracked(void)
+{
+   if (SH2Core == NULL)
+      return 0;
+
+   switch (SH2Core->id)
+   {
+      case SH2CORE_INTERPRETER:
+      case SH2CORE_DEBUGINTERPRETER:
+      case SH2CORE_BLOCKINTERPRETER:
+      case SH2CORE_JIT:
+         return 1;
+      default:
+         return 0;
+   }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void RewindPutVarint(RewindEncoder *enc, u32 val)
+{
+   while (val >= 0x80)
+   {
+      enc->out[enc->pos++] = (u8)(val | 0x80);
+      val >>= 7;
+   }
+   enc->out[enc->pos++] = (u8)val;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static u32 RewindGetVarint(const u8 **in)
+{
+   u32 val = 0;
+   int shift = 0;
+   u8 c;
+
+   do
+   {
+      c = *(*in)++;
+      val |= (u32)(c & 0x7F) << shift;
+      shift += 7;
+   } while (c & 0x80);
+
+   return val;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void RewindFlush(RewindEncoder *enc)
+{
+   u32 i;
+
+   if (enc->litlen == 0)
+      return;
+
+   RewindPutVarint(enc, enc->zeros);
+   RewindPutVarint(enc, enc->litlen);
+   for (i = enc->litstart; i < enc->litstart + enc->litlen; i++)
+      enc->out[enc->pos++] = enc->older[i] ^ (i < enc->newersize ? enc->newer[i] : 0);
+
+   enc->zeros = 0;
+   enc->litlen = 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void RewindScan(RewindEncoder *enc, u32 start, u32 end)
+{
+   u32 i = start;
+
+   // Compare a word at a time, short zero runs are cheaper as literals
+   while (i < end)
+   {
+      u32 n = (end - i < 4) ? end - i : 4;
+      int same;
+
+      if (n == 4 && i + 4 <= enc->newersize)
+      {
+         u32 a, b;
+         memcpy(&a, enc->older + i, 4);
+         memcpy(&b, enc->newer + i, 4);
+         same = (a == b);
+      }
+      else
+      {
+         u32 j;
+         same = 1;
+         for (j = i; j < i + n; j++)
+            if (enc->older[j] != (j < enc->newersize ? enc->newer[j] : 0))
+               same = 0;
+      }
+
+      if (same)
+      {
+         RewindFlush(enc);
+         enc->zeros += n;
+      }
+      else
+      {
+         if (enc->litlen == 0)
+            enc->litstart = i;
+         enc->litlen += n;
+      }
+
+      i += n;
+   }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static RewindDelta * RewindEncode(const u8 *older, u32 oldersize,
+                                  const u8 *newer, u32 newersize)
+{
+   RewindRegion oldregions[REWIND_MAX_REGIONS], newregions[REWIND_MAX_REGIONS];
+   int oldcount, newcount, wram, i;
+   RewindEncoder enc;
+   RewindDelta *delta;
+   u32 pos = 0;
+
+   // Zero runs between literals are at least a word long and never cost more
+   // than they save, so only the first pair can grow the output
+   if (rewindbuf.encsize < oldersize + 16)
+   {
+      u8 *buf = (u8 *)realloc(rewindbuf.encbuf, oldersize + 16);
+      if (buf == NULL)
+         return NULL;
+      rewindbuf.encbuf = buf;
+      rewindbuf.encsize = oldersize + 16;
+   }
+
+   memset(&enc, 0, sizeof(enc));
+   enc.out = rewindbuf.encbuf;
+   enc.older = older;
+   enc.newer = newer;
+   enc.newersize = newersize;
+
+   wram = RewindWramTracked();
+   oldcount = RewindFindRegions(older, oldersize, oldregions, wram);
+   newcount = RewindFindRegions(newer, newersize, newregions, wram);
+
+   if (oldcount == newcount)
+   {
+      for (i = 0; i < oldcount; i++)
+      {
+         const RewindRegion *region = &oldregions[i];
+         u32 page;
+
+         if (region->offset != newregions[i].offset ||
+             region->size != newregions[i].size)
+            continue;
+
+         for (page = 0; page < region->size / REWIND_PAGE_SIZE; page++)
+         {
+            u32 offset = region->offset + page * REWIND_PAGE_SIZE;
+
+            if (region->dirty[page])
+               continue;
+
+            RewindScan(&enc, pos, offset);
+            RewindFlush(&enc);
+            enc.zeros += REWIND_PAGE_SIZE;
+            pos = offset + REWIND_PAGE_SIZE;
+         }
+      }
+   }
+
+   RewindScan(&enc, pos, oldersize);
+   RewindFlush(&enc);
+
+   if ((delta = (RewindDelta *)malloc(offsetof(RewindDelta, data) + enc.pos)) == NULL)
+      return NULL;
+
+   delta->statesize = oldersize;
+   delta->size = enc.pos;
+   memcpy(delta->data, enc.out, enc.pos);
+   return delta;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static int RewindApply(ystream_struct *state, const RewindDelta *delta)
+{
+   const u8 *in = delta->data;
+   const u8 *end = delta->data + delta->size;
+   u32 pos = 0;
+
+   if (delta->statesize > state->capacity)
+   {
+      u8 *data = (u8 *)realloc(state->data, delta->statesize);
+      if (data == NULL)
+         return -1;
+      state->data = data;
+      state->capacity = delta->statesize;
+   }
+
+   if (delta->statesize > state->size)
+      memset(state->data + state->size, 0, delta->statesize - state->size);
+
+   while (in < end)
+   {
+      u32 len;
+
+      pos += RewindGetVarint(&in);
+      len = RewindGetVarint(&in);
+      while (len--)
+         state->data[pos++] ^= *in++;
+   }
+
+   state->size = delta->statesize;
+   state->pos = 0;
+   return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void RewindDropOldest(void)
+{
+   RewindDelta *delta = rewindbuf.deltas[rewindbuf.first];
+
+   rewindbuf.used -= (u32)offsetof(RewindDelta, data) + delta->size;
+   free(delta);
+   rewindbuf.first = (rewindbuf.first + 1) % rewindbuf.capacity;
+   rewindbuf.count--;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void RewindDropNewest(void)
+{
+   u32 index = (rewindbuf.first + rewindbuf.count - 1) % rewindbuf.capacity;
+   RewindDelta *delta = rewindbuf.deltas[index];
+
+   rewindbuf.used -= (u32)offsetof(RewindDelta, data) + delta->size;
+   free(delta);
+   rewindbuf.count--;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static int RewindPush(RewindDelta *delta)
+{
+   if (rewindbuf.count == rewindbuf.capacity)
+   {
+      u32 capacity = rewindbuf.capacity ? rewindbuf.capacity * 2 : 256;
+      RewindDelta **deltas;
+      u32 i;
+
+      if ((deltas = (RewindDelta **)malloc(capacity * sizeof(RewindDelta *))) == NULL)
+         return -1;
+      for (i = 0; i < rewindbuf.count; i++)
+         deltas[i] = rewindbuf.deltas[(rewindbuf.first + i) % rewindbuf.capacity];
+      free(rewindbuf.deltas);
+      rewindbuf.deltas = deltas;
+      rewindbuf.first = 0;
+      rewindbuf.capacity = capacity;
+   }
+
+   rewindbuf.deltas[(rewindbuf.first + rewindbuf.count) % rewindbuf.capacity] = delta;
+   rewindbuf.count++;
+   rewindbuf.used += (u32)offsetof(RewindDelta, data) + delta->size;
+
+   while (rewindbuf.used > rewindbuf.budget && rewindbuf.count > 0)
+      RewindDropOldest();
+
+   return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+// ystream_put doubles its buffer, give the slack back since every snapshot
+// is about the same size
+static void RewindShrink(ystream_struct *stream)
+{
+   u8 *data;
+
+   if (stream->capacity <= stream->size + (stream->size >> 4))
+      return;
+   if ((data = (u8 *)realloc(stream->data, stream->size)) == NULL)
+      return;
+   stream->data = data;
+   stream->capacity = stream->size;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+int RewindInit(u32 budget)
+{
+   RewindDeInit();
+   rewindbuf.budget = budget ? budget : REWIND_DEFAULT_BUDGET;
+   rewindbuf.init = 1;
+   return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void RewindDeInit(void)
+{
+   RewindReset();
+   ystream_free(&rewindbuf.latest);
+   ystream_free(&rewindbuf.scratch);
+   free(rewindbuf.encbuf);
+   free(rewindbuf.deltas);
+   memset(&rewindbuf, 0, sizeof(rewindbuf));
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void RewindReset(void)
+{
+   while (rewindbuf.count > 0)
+      RewindDropOldest();
+   rewindbuf.valid = 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void RewindSetBudget(u32 budget)
+{
+   rewindbuf.budget = budget ? budget : REWIND_DEFAULT_BUDGET;
+   while (rewindbuf.used > rewindbuf.budget && rewindbuf.count > 0)
+      RewindDropOldest();
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+int RewindSnapshot(void)
+{
+   ystream_struct swap;
+
+   if (!rewindbuf.init)
+      return -1;
+
+   if (YabSaveStateMemory(&rewindbuf.scratch) != 0)
+      return -1;
+   RewindShrink(&rewindbuf.scratch);
+
+   if (rewindbuf.valid)
+   {
+      RewindDelta *delta = RewindEncode(rewindbuf.latest.data, (u32)rewindbuf.latest.size,
+                                        rewindbuf.scratch.data, (u32)rewindbuf.scratch.size);
+
+      if (delta == NULL)
+         return -1;
+      if (RewindPush(delta) != 0)
+      {
+         free(delta);
+         return -1;
+      }
+   }
+
+   swap = rewindbuf.latest;
+   rewindbuf.latest = rewindbuf.scratch;
+   rewindbuf.scratch = swap;
+   rewindbuf.valid = 1;
+
+   MemoryClearDirty();
+   return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+int RewindStepBack(int count)
+{
+   int i;
+
+   if (!rewindbuf.valid)
+      return -1;
+
+   if (count < 0)
+      count = 0;
+   if ((u32)count > rewindbuf.count)
+      count = (int)rewindbuf.count;
+
+   for (i = 0; i < count; i++)
+   {
+      u32 index = (rewindbuf.first + rewindbuf.count - 1) % rewindbuf.capacity;
+
+      if (RewindApply(&rewindbuf.latest, rewindbuf.deltas[index]) != 0)
+      {
+         RewindReset();
+         return -1;
+      }
+      RewindDropNewest();
+   }
+
+   if (YabLoadStateBuffer(rewindbuf.latest.data, rewindbuf.latest.size) != 0)
+   {
+      RewindReset();
+      return -1;
+   }
+
+   // The emulator now matches the latest snapshot again
+   MemoryClearDirty();
+   return count;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+int RewindCount(void)
+{
+   return (int)rewindbuf.count;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+u32 RewindMemoryUsage(void)
+{
+   return rewindbuf.used + (u32)rewindbuf.latest.capacity +
+          (u32)rewindbuf.scratch.capacity + rewindbuf.encsize +
+          rewindbuf.capacity * (u32)sizeof(RewindDelta *);
+}
@@ -0,0 +1,48 @@
+/*  Copyright 2026 Yabause team
+
+    This file is part of Yabause.
+
+    Yabause is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Yabause is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Yabause; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+*/
+
+/*! \file rewind.h
+    \brief Rewind buffer built from save state deltas.
+*/
+
+#ifndef REWIND_H
+#define REWIND_H
+
+#include "core.h"
+
+#define REWIND_DEFAULT_BUDGET (32 * 1024 * 1024)
+
+// budget is the memory allowed for the deltas, the latest snapshot and a
+// scratch state are kept on top of it. Older snapshots are dropped first.
+int RewindInit(u32 budget);
+void RewindDeInit(void);
+void RewindReset(void);
+void RewindSetBudget(u32 budget);
+
+// Takes a snapshot of the running emulator, usually once per frame
+int RewindSnapshot(void);
+
+// Loads the snapshot count steps before the latest one and makes it the
+// latest. Returns the number of steps taken or -1 if there is nothing to load.
+int RewindStepBack(int count);
+
+int RewindCount(void);
+u32 RewindMemoryUsage(void);
+
+#endif
@@ -29,6 +29,10 @@ extern "C"
 #include "../vidsoft.h"
 #include "../vdp2.h"
 #include "../titan/titan.h"
+#include "../profile.h"
+#include "../jitprof.h"
+#include "../sh2idle.h"
+#include "../rewind.h"
 #ifdef _MSC_VER
 #include <Windows.h>
 #endif
@@ -57,6 +61,7 @@ extern "C"
 {
    SH2Interface_struct *SH2CoreList[] = {
       &SH2Interpreter,
+      &SH2BlockInterpreter,
       NULL
    };
 
@@ -400,7 +405,7 @@ std::string int_to_string(const int input)
 
 int string_to_int(const std::string input)
 {
-   int i;
+   int i = 0;
    std::stringstream s(input);
    s >> i;
    return i;
@@ -984,12 +989,405 @@ namespace yabauseut
    }
 }
 
+namespace savestate_bench
+{
+   double ticks_to_seconds(u64 ticks)
+   {
+      return (double)ticks / (double)yabsys.tickfreq;
+   }
+
+   int start(std::string exec_filename, int count)
+   {
+      yabauseinit_struct yinit = { 0 };
+      ystream_struct stream = { 0 };
+
+      yinit.percoretype = PERCORE_DUMMY;
+      yinit.sh2coretype = SH2CORE_INTERPRETER;
+      yinit.vidcoretype = VIDCORE_DUMMY;
+      yinit.m68kcoretype = M68KCORE_DUMMY;
+      yinit.sndcoretype = SNDCORE_DUMMY;
+      yinit.cdcoretype = CDCORE_DUMMY;
+      yinit.carttype = CART_NONE;
+      yinit.regionid = REGION_AUTODETECT;
+      yinit.biospath = emulate_bios ? NULL : bios;
+      yinit.frameskip = 0;
+      yinit.videoformattype = VIDEOFORMATTYPE_NTSC;
+      yinit.skip_load = 1;
+
+      if (YabauseInit(&yinit) != 0)
+         return -1;
+
+      MappedMemoryLoadExec(exec_filename.c_str(), 0);
+
+      //get past the program's setup before measuring
+      for (int i = 0; i < 60; i++)
+         PERCore->HandleEvents();
+
+      u64 start_time = YabauseGetTicks();
+
+      for (int i = 0; i < count; i++)
+      {
+         if (YabSaveStateMemory(&stream) != 0)
+         {
+            std::cout << "Save state failed." << std::endl;
+            ystream_free(&stream);
+            return -1;
+         }
+      }
+
+      double save_seconds = ticks_to_seconds(YabauseGetTicks() - start_time);
+
+      start_time = YabauseGetTicks();
+
+      for (int i = 0; i < count; i++)
+      {
+         if (YabLoadStateBuffer(stream.data, stream.size) != 0)
+         {
+            std::cout << "Load state failed." << std::endl;
+            ystream_free(&stream);
+            return -1;
+         }
+      }
+
+      double load_seconds = ticks_to_seconds(YabauseGetTicks() - start_time);
+
+      printf("state_size=%u saves=%d saves_per_sec=%.1f loads_per_sec=%.1f\n",
+         (unsigned int)stream.size, count, count / save_seconds, count / load_seconds);
+
+      ystream_free(&stream);
+      YabauseDeInit();
+
+      return 0;
+   }
+}
+
+namespace bench
+{
+   const char * tag_ids[] = {
+#define PROFILE_TAG(id, name) #id,
+      PROFILE_TAGS
+#undef PROFILE_TAG
+   };
+
+   u64 hash(u64 h, const u8 * data, size_t size)
+   {
+      //fnv-1a
+      for (size_t i = 0; i < size; i++)
+      {
+         h ^= data[i];
+         h *= 0x100000001B3ULL;
+      }
+      return h;
+   }
+
+   bool is_exec(std::string filename)
+   {
+      size_t pos = filename.rfind('.');
+
+      if (pos == std::string::npos)
+         return false;
+
+      std::string ext = filename.substr(pos);
+
+      for (size_t i = 0; i < ext.size(); i++)
+         ext[i] = toupper(ext[i]);
+
+      return ext == ".ELF" || ext == ".COF" || ext == ".COFF";
+   }
+
+   int start(std::string filename, int frames, std::string video, std::string trace_filename)
+   {
+      yabauseinit_struct yinit = { 0 };
+      bool exec = is_exec(filename);
+
+      yinit.percoretype = PERCORE_DUMMY;
+      yinit.sh2coretype = SH2CORE_INTERPRETER;
+      yinit.vidcoretype = video == "dummy" ? VIDCORE_DUMMY : VIDCORE_SOFT;
+      yinit.m68kcoretype = M68KCORE_DUMMY;
+      yinit.sndcoretype = SNDCORE_DUMMY;
+      yinit.cdcoretype = exec ? CDCORE_DUMMY : CDCORE_ISO;
+      yinit.carttype = CART_NONE;
+      yinit.regionid = REGION_AUTODETECT;
+      yinit.biospath = emulate_bios ? NULL : bios;
+      yinit.cdpath = exec ? NULL : filename.c_str();
+      yinit.frameskip = 0;
+      yinit.videoformattype = VIDEOFORMATTYPE_NTSC;
+      yinit.clocksync = 0;
+      yinit.basetime = 0;
+      yinit.skip_load = exec ? 1 : 0;
+      yinit.numthreads = 0;
+      yinit.usethreads = 0;
+
+      if (YabauseInit(&yinit) != 0)
+         return -1;
+
+      if (exec)
+         MappedMemoryLoadExec(filename.c_str(), 0);
+
+      //frame limiting is off with frameskip 0, so this runs flat out
+      ProfileEnable(1);
+      ProfileReset();
+      JitProfEnable(JITPROF_STATS);
+      JitProfReset();
+      SH2idleResetStats(MSH2);
+      SH2idleResetStats(SSH2);
+
+      u64 start_time = YabauseGetTicks();
+
+      for (int i = 0; i < frames; i++)
+         PERCore->HandleEvents();
+
+      double seconds = (double)(YabauseGetTicks() - start_time) / (double)yabsys.tickfreq;
+
+      int width = 0, height = 0;
+      u64 framebuffer_hash = 0;
+
+      if (yinit.vidcoretype == VIDCORE_SOFT)
+      {
+         TitanGetResolution(&width, &height);
+         framebuffer_hash = hash(0xCBF29CE484222325ULL, (u8 *)VIDCore->getFramebuffer(), width * height * sizeof(pixel_t));
+      }
+
+      u64 wram_hash = hash(0xCBF29CE484222325ULL, LowWram, 0x100000);
+      wram_hash = hash(wram_hash, HighWram, 0x100000);
+
+      printf("bench=%s frames=%d video=%s seconds=%.3f fps=%.2f framebuffer=%dx%d framebuffer_hash=%016llx wram_hash=%016llx",
+         filename.c_str(), frames, yinit.vidcoretype == VIDCORE_SOFT ? "soft" : "dummy", seconds,
+         seconds > 0 ? frames / seconds : 0.0, width, height,
+         (unsigned long long)framebuffer_hash, (unsigned long long)wram_hash);
+
+      for (int tag = 0; tag < PROFILE_NUM_TAGS; tag++)
+      {
+         if (ProfileCalls(tag))
+            printf(" ms_%s=%.3f", tag_ids[tag], ProfileTotalMs(tag));
+      }
+
+      for (int cpu = 0; cpu < JITPROF_NUM_CPUS; cpu++)
+      {
+         JitProfStats stats;
+
+         JitProfGetStats(cpu, &stats);
+         if (stats.blocks)
+            printf(" jit_%s_blocks=%u jit_%s_bytes=%llu jit_%s_invalidations=%u jit_%s_compile_ms=%.3f",
+               JitProfCpuName(cpu), stats.blocks, JitProfCpuName(cpu), (unsigned long long)stats.bytes,
+               JitProfCpuName(cpu), stats.invalidations, JitProfCpuName(cpu), stats.compile_ms);
+      }
+
+      for (int cpu = 0; cpu < 2; cpu++)
+      {
+         const char *name = cpu ? "SSH2" : "MSH2";
+         sh2idlestats_struct stats;
+
+         SH2idleGetStats(cpu ? SSH2 : MSH2, &stats);
+         if (stats.loops)
+            printf(" idle_%s_loops=%u idle_%s_hits=%u idle_%s_exits=%u idle_%s_skipped=%llu",
+               name, stats.loops, name, stats.hits, name, stats.exits, name, (unsigned long long)stats.skipped);
+      }
+
+      printf("\n");
+
+      if (trace_filename != "" && ProfileWriteTrace(trace_filename.c_str()) != 0)
+         std::cout << "Couldn't write " << trace_filename << std::endl;
+
+      ProfileEnable(0);
+      JitProfEnable(0);
+      YabauseDeInit();
+
+      return 0;
+   }
+}
+
+namespace rewind_bench
+{
+   u64 wram_hash()
+   {
+      u64 h = bench::hash(0xCBF29CE484222325ULL, LowWram, 0x100000);
+      return bench::hash(h, HighWram, 0x100000);
+   }
+
+   int start(std::string exec_filename, int frames)
+   {
+      yabauseinit_struct yinit = { 0 };
+      ystream_struct stream = { 0 };
+      std::vector<u64> hashes;
+
+      yinit.percoretype = PERCORE_DUMMY;
+      yinit.sh2coretype = SH2CORE_INTERPRETER;
+      yinit.vidcoretype = VIDCORE_DUMMY;
+      yinit.m68kcoretype = M68KCORE_DUMMY;
+      yinit.sndcoretype = SNDCORE_DUMMY;
+      yinit.cdcoretype = CDCORE_DUMMY;
+      yinit.carttype = CART_NONE;
+      yinit.regionid = REGION_AUTODETECT;
+      yinit.biospath = emulate_bios ? NULL : bios;
+      yinit.frameskip = 0;
+      yinit.videoformattype = VIDEOFORMATTYPE_NTSC;
+      yinit.skip_load = 1;
+      yinit.use_rewind = 1;
+
+      if (frames < 2)
+      {
+         std::cout << "Rewind benchmark needs at least 2 frames." << std::endl;
+         return 1;
+      }
+
+      if (YabauseInit(&yinit) != 0)
+         return -1;
+
+      MappedMemoryLoadExec(exec_filename.c_str(), 0);
+
+      u64 start_time = YabauseGetTicks();
+
+      //a snapshot is taken at the end of every frame
+      for (int i = 0; i < frames; i++)
+      {
+         PERCore->HandleEvents();
+         hashes.push_back(wram_hash());
+      }
+
+      double run_seconds = savestate_bench::ticks_to_seconds(YabauseGetTicks() - start_time);
+
+      if (YabSaveStateMemory(&stream) != 0)
+      {
+         std::cout << "Save state failed." << std::endl;
+         YabauseDeInit();
+         return -1;
+      }
+
+      int snapshots = RewindCount() + 1;
+      u64 full_bytes = (u64)snapshots * stream.size;
+      u32 rewind_bytes = RewindMemoryUsage();
+      ystream_free(&stream);
+
+      //go back half way, wram has to match what it was at the end of that frame
+      start_time = YabauseGetTicks();
+      int steps = RewindStepBack(RewindCount() / 2);
+      double step_seconds = savestate_bench::ticks_to_seconds(YabauseGetTicks() - start_time);
+
+      bool pass = steps >= 0 && wram_hash() == hashes[frames - 1 - steps];
+
+      printf("rewind_bench frames=%d snapshots=%d state_size=%u full_state_bytes=%llu rewind_bytes=%u ratio=%.3f "
+         "ms_per_frame=%.3f step_back=%d step_back_ms=%.3f result=%s\n",
+         frames, snapshots, (unsigned int)(full_bytes / snapshots), (unsigned long long)full_bytes, rewind_bytes,
+         (double)rewind_bytes / (double)full_bytes, run_seconds * 1000.0 / frames, steps, step_seconds * 1000.0,
+         pass ? "pass" : "fail");
+
+      YabauseDeInit();
+
+      return pass ? 0 : 1;
+   }
+}
+
+namespace soundthread_check
+{
+   //one hash of work ram and sound ram per frame
+   int run(std::string exec_filename, int frames, int m68kcoretype, bool threaded, std::vector<u64> & hashes)
+   {
+      yabauseinit_struct yinit = { 0 };
+
+      yinit.percoretype = PERCORE_DUMMY;
+      yinit.sh2coretype = SH2CORE_INTERPRETER;
+      yinit.vidcoretype = VIDCORE_DUMMY;
+      yinit.m68kcoretype = m68kcoretype;
+      yinit.sndcoretype = SNDCORE_DUMMY;
+      yinit.cdcoretype = CDCORE_DUMMY;
+      yinit.carttype = CART_NONE;
+      yinit.regionid = REGION_AUTODETECT;
+      yinit.biospath = emulate_bios ? NULL : bios;
+      yinit.frameskip = 0;
+      yinit.videoformattype = VIDEOFORMATTYPE_NTSC;
+      yinit.skip_load = 1;
+      yinit.numthreads = 0;
+      yinit.usethreads = 0;
+
+      if (YabauseInit(&yinit) != 0)
+         return -1;
+
+      //skip_load leaves the threads alone, so the sound thread is started here.
+      //inline, the requests have to reach the scu as late as they do with the thread
+      if (threaded)
+         ScspSetSoundThread(1);
+      else
+         ScspSetSoundRequestDelay(SCSP_THREAD_DELAY);
+
+      MappedMemoryLoadExec(exec_filename.c_str(), 0);
+
+      for (int i = 0; i < frames; i++)
+      {
+         PERCore->HandleEvents();
+
+         //waits for the sound thread to catch up before sound ram is read
+         SoundRamReadLong(0);
+
+         u64 h = bench::hash(0xCBF29CE484222325ULL, LowWram, 0x100000);
+         h = bench::hash(h, HighWram, 0x100000);
+         h = bench::hash(h, SoundRam, 0x80000);
+         hashes.push_back(h);
+      }
+
+      YabauseDeInit();
+
+      return 0;
+   }
+
+   //runs the program inline and on the sound thread, both have to go through the same states
+   int start(std::string exec_filename, int frames)
+   {
+      std::vector<u64> inline_hashes, threaded_hashes;
+      int m68kcoretype = M68KCoreList[1] ? M68KCoreList[1]->id : M68KCORE_DUMMY;
+
+      if (m68kcoretype == M68KCORE_DUMMY)
+      {
+         std::cout << "No 68K core to run the sound program on." << std::endl;
+         return 1;
+      }
+
+      if (run(exec_filename, frames, m68kcoretype, false, inline_hashes) != 0 ||
+         run(exec_filename, frames, m68kcoretype, true, threaded_hashes) != 0)
+      {
+         std::cout << "Couldn't start emulation." << std::endl;
+         return 1;
+      }
+
+      for (int i = 0; i < frames; i++)
+      {
+         if (inline_hashes[i] != threaded_hashes[i])
+         {
+            printf("soundthread_check frames=%d result=fail first_mismatch=%d\n", frames, i);
+            return 1;
+         }
+      }
+
+      printf("soundthread_check frames=%d result=pass hash=%016llx\n", frames,
+         frames > 0 ? (unsigned long long)inline_hashes[frames - 1] : 0ULL);
+
+      return 0;
+   }
+}
+
 //usage
 //no spaces in paths allowed, include final / on directories
 //yabause game check game_data_file path_file screenshot_path fail_path
 //yabause game dump game_data_file path_file output_path
 //yabause yabauseut check yabause_ut_binary_path screenshot_path framebuffer_path
 //yabause yabauseut dump yabause_ut_binary_path output_path
+//yabause savestate bench program_path count
+//yabause rewind bench program_path frames
+//yabause soundthread check program_path frames
+//yabause --bench iso_or_elf_or_coff_path frames [soft|dummy] [trace_json_path]
+void print_usage()
+{
+   std::cout << "Usage:" << std::endl;
+   std::cout << "   yabause game check game_data_file path_file screenshot_path fail_path" << std::endl;
+   std::cout << "   yabause game dump game_data_file path_file output_path" << std::endl;
+   std::cout << "   yabause yabauseut check yabause_ut_binary_path screenshot_path framebuffer_path" << std::endl;
+   std::cout << "   yabause yabauseut dump yabause_ut_binary_path output_path" << std::endl;
+   std::cout << "   yabause savestate bench program_path count" << std::endl;
+   std::cout << "   yabause rewind bench program_path frames" << std::endl;
+   std::cout << "   yabause soundthread check program_path frames" << std::endl;
+   std::cout << "   yabause --bench iso_or_elf_or_coff_path frames [soft|dummy] [trace_json_path]" << std::endl;
+}
+
 int main(int argc, char *argv[])
 {
    int i = 0;
@@ -1001,17 +1399,19 @@ int main(int argc, char *argv[])
       args.push_back(argv[i++]);
    }
 
+   //every mode takes at least two more arguments, each checks its own count
    if (args.size() < 4)
    {
       std::cout << "Not enough command line arguments." << std::endl;
-      return false;
+      print_usage();
+      return 1;
    }
 
    if (args.size() > 7)
    {
       std::cout << "Too many command line arguments." << std::endl;
       std::cout << "Paths cannot have spaces." << std::endl;
-      return false;
+      return 1;
    }
 
    if (args.at(1) == "game")
@@ -1023,7 +1423,8 @@ int main(int argc, char *argv[])
          if (args.size() < 7)
          {
             std::cout << "Not enough arguments for game checking mode." << std::endl;
-            return false;
+            print_usage();
+            return 1;
          }
 
          std::string game_data_path = args.at(3);
@@ -1045,7 +1446,8 @@ int main(int argc, char *argv[])
          if (args.size() < 6)
          {
             std::cout << "Not enough arguments for game dumping mode." << std::endl;
-            return false;
+            print_usage();
+            return 1;
          }
 
          std::string game_data_path = args.at(3);
@@ -1064,7 +1466,7 @@ int main(int argc, char *argv[])
       else
       {
          std::cout << "Unknown check/dump argment." << std::endl;
-         return false;
+         return 1;
       }
    }
    else if (args.at(1) == "yabauseut")
@@ -1076,7 +1478,8 @@ int main(int argc, char *argv[])
          if (args.size() < 6)
          {
             std::cout << "Not enough arguments for yabauseut checking mode." << std::endl;
-            return false;
+            print_usage();
+            return 1;
          }
 
          std::string yabause_ut_filename = args.at(3);
@@ -1091,7 +1494,8 @@ int main(int argc, char *argv[])
          if (args.size() < 5)
          {
             std::cout << "Not enough arguments for yabauseut dumping mode." << std::endl;
-            return false;
+            print_usage();
+            return 1;
          }
 
          std::string yabause_ut_filename = args.at(3);
@@ -1104,12 +1508,63 @@ int main(int argc, char *argv[])
       else
       {
          std::cout << "Unknown check/dump argment." << std::endl;
-         return false;
+         return 1;
+      }
+   }
+   else if (args.at(1) == "savestate")
+   {
+      //memory save state throughput
+      if (args.size() < 5 || args.at(2) != "bench")
+      {
+         std::cout << "Not enough arguments for save state benchmark mode." << std::endl;
+         print_usage();
+         return 1;
+      }
+
+      return savestate_bench::start(args.at(3), string_to_int(args.at(4)));
+   }
+   else if (args.at(1) == "rewind")
+   {
+      //rewind buffer size against full save states
+      if (args.size() < 5 || args.at(2) != "bench")
+      {
+         std::cout << "Not enough arguments for rewind benchmark mode." << std::endl;
+         print_usage();
+         return 1;
       }
+
+      return rewind_bench::start(args.at(3), string_to_int(args.at(4)));
+   }
+   else if (args.at(1) == "soundthread")
+   {
+      //threaded against inline sound emulation
+      if (args.size() < 5 || args.at(2) != "check")
+      {
+         std::cout << "Not enough arguments for sound thread checking mode." << std::endl;
+         print_usage();
+         return 1;
+      }
+
+      return soundthread_check::start(args.at(3), string_to_int(args.at(4)));
+   }
+   else if (args.at(1) == "--bench")
+   {
+      //headless unthrottled run, one line of key=value results
+      std::string video = args.size() > 4 ? args.at(4) : "soft";
+      std::string trace_filename = args.size() > 5 ? args.at(5) : "";
+
+      if (video != "soft" && video != "dummy")
+      {
+         std::cout << "Unknown video core for benchmark mode." << std::endl;
+         return 1;
+      }
+
+      return bench::start(args.at(2), string_to_int(args.at(3)), video, trace_filename);
    }
    else
    {
       std::cout << "Unknown mode argument." << std::endl;
-      return false;
+      print_usage();
+      return 1;
    }
 }
\ No newline at end of file
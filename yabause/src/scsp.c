@@ -94,7 +94,9 @@
 #include "error.h"
 #include "memory.h"
 #include "m68kcore.h"
+#include "profile.h"
 #include "scu.h"
+#include "threads.h"
 #include "yabause.h"
 #include "scsp.h"
 #include "scspdsp.h"
@@ -117,6 +119,8 @@
 # define FLUSH_SCSP()  /*nothing*/
 #endif
 
+static void scsp_thread_drain (void);
+
 int use_new_scsp = 0;
 int new_scsp_outbuf_pos = 0;
 s32 new_scsp_outbuf_l[900] = { 0 };
@@ -819,6 +823,7 @@ void scsp_debug_add_instrument(u32 sa)
 void scsp_debug_instrument_set_mute(u32 sa, int mute)
 {
    int found = 0, offset = 0;
+   scsp_thread_drain();
    scsp_debug_search_instruments(sa, &found, &offset);
 
    if (offset >= NUM_DEBUG_INSTRUMENTS)
@@ -844,6 +849,8 @@ int scsp_debug_instrument_check_is_muted(u32 sa)
 
 void scsp_debug_instrument_get_data(int i, u32 * sa, int * is_muted)
 {
+   scsp_thread_drain();
+
    if(i >= NUM_DEBUG_INSTRUMENTS)
       return;
 
@@ -853,17 +860,20 @@ void scsp_debug_instrument_get_data(int i, u32 * sa, int * is_muted)
 
 void scsp_debug_set_mode(int mode)
 {
+   scsp_thread_drain();
    new_scsp.debug_mode = mode;
 }
 
 void scsp_debug_instrument_clear()
 {
+   scsp_thread_drain();
    debug_instrument_pos = 0;
    memset(debug_instruments, 0, sizeof(struct DebugInstrument) * NUM_DEBUG_INSTRUMENTS);
 }
 
 void scsp_debug_get_envelope(int chan, int * env, int * state)
 {
+   scsp_thread_drain();
    *env = new_scsp.slots[chan].state.attenuation;
    *state = new_scsp.slots[chan].state.envelope;
 }
@@ -1316,15 +1326,113 @@ int get_sdl_shift(int sdl)
    else return (7 - sdl);
 }
 
+//direct and effect send of a slot, done right after its sound stack write
+static INLINE void mix_slot(struct Slot * slot, s32 * out_l, s32 * out_r, u32 * mixs)
+{
+   int disdl = get_sdl_shift(slot->regs.disdl);
+
+   s16 disdl_applied = (slot->state.output >> disdl);
+
+   s16 mixs_input = slot->state.output >>
+      get_sdl_shift(slot->regs.imxl);
+
+   int pan_val_l = 0, pan_val_r = 0;
+
+   get_panning(slot->regs.dipan, &pan_val_l, &pan_val_r);
+
+   *out_l += ((disdl_applied >> pan_val_l) >> 2);
+   *out_r += ((disdl_applied >> pan_val_r) >> 2);
+
+   mixs[slot->regs.isel] += mixs_input;
+}
+
+static INLINE void run_slot_ops(struct Scsp * s, struct Slot * slot, int first, int last, s32 * out_l, s32 * out_r, u32 * mixs)
+{
+   int op;
+
+   for (op = first; op <= last; op++)
+   {
+      switch (op)
+      {
+      case 1: op1(slot); break;
+      case 2: op2(slot, s); break;
+      case 3: op3(slot); break;
+      case 4: op4(slot); break;
+      case 5: op5(slot); break;
+      case 6: op6(slot); break;
+      case 7: op7(slot, s); mix_slot(slot, out_l, out_r, mixs); break;
+      }
+   }
+}
+
+//a slot past the end of its envelope whose output already dropped to 0
+//only pushes silence onto the sound stack until it is keyed on again
+static INLINE int slot_is_silent(struct Slot * slot)
+{
+   return slot->state.attenuation > 0x3bf && slot->state.output == 0;
+}
+
+//Slots only see each other through the sound stack, which is read back
+//by modulation alone, and through the sums sent to the outputs and the
+//dsp. Without modulation each slot can run its 7 ops back to back, in
+//the order the steps below would have reached them: ops 33 - num and up
+//still belong to the previous sample and come before the rest.
+static int generate_slots(struct Scsp * s, s16 * out_l, s16 * out_r)
+{
+   s32 sum_l = 0, sum_r = 0;
+   u32 mixs[16] = { 0 };
+   int num, i;
+
+   for (num = 0; num < 32; num++)
+   {
+      if (s->slots[num].regs.mdl && !slot_is_silent(&s->slots[num]))
+         return 0;
+   }
+
+   for (num = 0; num < 32; num++)
+   {
+      struct Slot * slot = &s->slots[num];
+      int tail = 33 - num;
+
+      if (slot_is_silent(slot))
+      {
+         op7(slot, s);
+         continue;
+      }
+
+      if (tail <= 7)
+      {
+         run_slot_ops(s, slot, tail, 7, &sum_l, &sum_r, mixs);
+         run_slot_ops(s, slot, 1, tail - 1, &sum_l, &sum_r, mixs);
+      }
+      else
+         run_slot_ops(s, slot, 1, 7, &sum_l, &sum_r, mixs);
+   }
+
+   *out_l = *out_l + sum_l;
+   *out_r = *out_r + sum_r;
+
+   for (i = 0; i < 16; i++)
+   {
+      if (mixs[i])
+         dsp_inf.set_mixs(i, mixs[i]);
+   }
+
+   return 1;
+}
+
 void generate_sample(struct Scsp * s, int rbp, int rbl, s16 * out_l, s16* out_r, int mvol, s16 cd_in_l, s16 cd_in_r)
 {
    int step_num = 0;
    int i = 0;
    int mvol_shift = 0;
 
+   if (!s->debug_mode && generate_slots(s, out_l, out_r))
+      step_num = 32;
+
    //run 32 steps to generate 1 full sample (512 clock cycles at 22579200hz)
    //7 operations happen simultaneously on different channels due to pipelining
-   for (step_num = 0; step_num < 32; step_num++)
+   for (; step_num < 32; step_num++)
    {
       int last_step = (step_num - 6) & 0x1f;
       int debug_muted = 0;
@@ -1423,6 +1531,8 @@ void new_scsp_reset(struct Scsp* s)
 
 void scsp_set_use_new(int which)
 {
+   scsp_thread_drain();
+
    if (which && !use_new_scsp)
       new_scsp_reset(&new_scsp);
 
@@ -4475,6 +4585,469 @@ static u8 IsM68KRunning;
 static s32 FASTCALL (*m68kexecptr)(s32 cycles);  // M68K->Exec or M68KExecBP
 static s32 savedcycles;  // Cycles left over from the last M68KExec() call
 
+//////////////////////////////////////////////////////////////////////////////
+// 68K idle loop skipping
+//
+// Sound drivers spend most of their time going around a short loop that
+// polls a flag in sound RAM or an SCSP register, waiting for the SH2 or a
+// timer interrupt to give them something to do. When a step makes no writes
+// and ends close to where the previous one did, the next step is run one
+// instruction at a time. If the 68K comes back to an earlier PC with exactly
+// the same registers, and nothing was written or read with a side effect on
+// the way, it is in a loop that can't end by itself. The steps after that
+// only walk through the recorded states and cycle counts of the loop, until
+// something the loop may be looking at changes: an interrupt, an SH2 write to
+// sound RAM or the SCSP, or for loops that read SCSP registers, the next SCSP
+// update. The 68K is then put in the state it would have reached, so it
+// carries on exactly as if it had been running all along.
+
+#define M68K_IDLE_MAX_INSNS     32      // longest loop looked for
+#define M68K_IDLE_MAX_BYTES     64      // PC drift per step that starts a probe
+
+typedef struct
+{
+  u32 pc, sr;
+  u32 d[8], a[8];
+} m68k_idle_state;
+
+static struct
+{
+  u32 writes;           // 68K writes so far
+  u32 regreads;         // 68K reads of SCSP registers so far
+  u32 sidefx;           // 68K reads that change SCSP state (MIBUF)
+  u32 lastpc;           // PC at the end of the last step
+  u32 rejectlo;         // PC range of the last loop that didn't settle
+  u32 rejecthi;
+  u8 probe;             // run the next step one instruction at a time
+  u8 active;            // in an idle loop, walk it instead of running it
+  u8 regs;              // the idle loop reads SCSP registers
+  int len;              // instructions in the loop
+  int pos;              // instruction the 68K would be at now
+  s32 period;           // cycles per time around the loop
+  s32 cost[M68K_IDLE_MAX_INSNS];
+  m68k_idle_state state[M68K_IDLE_MAX_INSNS];
+} m68k_idle;
+
+static void
+m68k_idle_reset (void)
+{
+  m68k_idle.lastpc = 0;
+  m68k_idle.rejectlo = 1;
+  m68k_idle.rejecthi = 0;
+  m68k_idle.probe = 0;
+  m68k_idle.active = 0;
+  m68k_idle.regs = 0;
+}
+
+// Leaves the idle loop, putting the 68K where it would be by now
+static void
+m68k_idle_wake (void)
+{
+  m68k_idle_state *st;
+  int i;
+
+  if (LIKELY(!m68k_idle.active))
+    return;
+
+  m68k_idle.active = 0;
+  if (m68k_idle.pos == 0)
+    return;
+
+  st = &m68k_idle.state[m68k_idle.pos];
+  for (i = 0; i < 8; i++)
+    {
+      M68K->SetDReg (i, st->d[i]);
+      M68K->SetAReg (i, st->a[i]);
+    }
+  M68K->SetSR (st->sr);
+  M68K->SetPC (st->pc);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// Sound thread
+//
+// With the sound thread running, the SH2 side no longer touches the SCSP,
+// the 68K or sound RAM itself. Register and sound RAM writes and the exec
+// steps from YabauseEmulate go into a single producer, single consumer ring
+// that the thread works through in order, so the sound side goes through
+// exactly the same states as when it is run inline. Anything that needs to
+// look at the sound side (reads, save states, the debugger) first waits for
+// the ring to drain.
+//
+// Sound requests to the SCU are the one thing going the other way. Each 68K
+// step (one M68KExec call) is numbered, requests are counted against the
+// step that raised them and handed to the SCU scsp_irq_delay steps later.
+// This happens the same way with or without the thread, which lets the
+// thread trail the SH2s by that many steps without changing when the SCU
+// sees a request. Inline the delay is 0 unless ScspSetSoundRequestDelay
+// asks for one, the thread needs at least 1 and uses SCSP_THREAD_DELAY.
+// An inline run with the thread's delay goes through the same states.
+//////////////////////////////////////////////////////////////////////////////
+
+#define SCSP_THREAD_RING_SIZE 8192
+#define SCSP_THREAD_RING_MASK (SCSP_THREAD_RING_SIZE - 1)
+#define SCSP_THREAD_SPIN      64    // busy waits before yielding
+#define SCSP_THREAD_YIELD     1024  // yields before going to sleep
+#define SCSP_STEP_LOG_SIZE    16  // must be above the largest delay
+#define SCSP_STEP_LOG_MASK    (SCSP_STEP_LOG_SIZE - 1)
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#define SCSP_THREAD_CAS(p, o, n) (_InterlockedCompareExchange((volatile long *)(p), (long)(n), (long)(o)) == (long)(o))
+#define SCSP_THREAD_PUBLISH(p, v) _InterlockedExchange((volatile long *)(p), (long)(v))
+#define SCSP_THREAD_READ(p) (*(p))
+#define SCSP_THREAD_PAUSE() _mm_pause()
+#else
+#define SCSP_THREAD_CAS(p, o, n) __sync_bool_compare_and_swap((p), (o), (n))
+#define SCSP_THREAD_PUBLISH(p, v) __atomic_store_n((p), (v), __ATOMIC_SEQ_CST)
+#define SCSP_THREAD_READ(p) __atomic_load_n((p), __ATOMIC_SEQ_CST)
+#if defined(__i386__) || defined(__x86_64__)
+#define SCSP_THREAD_PAUSE() __builtin_ia32_pause()
+#else
+#define SCSP_THREAD_PAUSE()
+#endif
+#endif
+
+enum
+{
+  SCSP_CMD_WRITE_B,
+  SCSP_CMD_WRITE_W,
+  SCSP_CMD_WRITE_D,
+  SCSP_CMD_RAM_WRITE_B,
+  SCSP_CMD_RAM_WRITE_W,
+  SCSP_CMD_RAM_WRITE_D,
+  SCSP_CMD_M68K_EXEC,
+  SCSP_CMD_NEW_SCSP_EXEC,
+  SCSP_CMD_LINE,
+  SCSP_CMD_QUIT
+};
+
+typedef struct
+{
+  u32 type;
+  u32 addr;
+  u32 data;
+} scsp_thread_cmd;
+
+// One side sleeping until a position of the other side reaches target
+typedef struct
+{
+  volatile u32 waiting;
+  u32 target;
+  YabSem *sem;
+} scsp_thread_waiter;
+
+static struct
+{
+  scsp_thread_cmd ring[SCSP_THREAD_RING_SIZE];
+  volatile u32 write_pos;  // published by the SH2 side
+  volatile u32 read_pos;   // published by the sound thread
+  u32 queued;              // pushed so far, published or not
+  scsp_thread_waiter producer;
+  scsp_thread_waiter consumer;
+  int running;
+
+  u32 issued;                           // 68K steps issued by the SH2 side
+  u32 step;                             // 68K step the sound side is in
+  u32 step_pos[SCSP_STEP_LOG_SIZE];     // ring position after each step
+  u32 requests[SCSP_STEP_LOG_SIZE];     // sound requests raised per step
+} scsp_thread;
+
+static int scsp_irq_delay;       // delay in effect
+static int scsp_irq_delay_set;   // delay asked for, 0 leaves it to the thread
+
+static void sound_ram_w_b (u32 addr, u8 val);
+static void sound_ram_w_w (u32 addr, u16 val);
+static void sound_ram_w_d (u32 addr, u32 val);
+static void m68k_exec_step (s32 cycles);
+static void new_scsp_step (s32 cycles);
+static void scsp_line_exec (void);
+
+//////////////////////////////////////////////////////////////////////////////
+
+// Returns once *pos has reached target. Spins and yields first, since the
+// other side is usually only a few microseconds away and a wake up through
+// the semaphore costs about as much.
+static void
+scsp_thread_wait (scsp_thread_waiter *w, volatile u32 *pos, u32 target)
+{
+  int i;
+
+  for (i = 0; i < SCSP_THREAD_SPIN + SCSP_THREAD_YIELD; i++)
+    {
+      if ((s32)(SCSP_THREAD_READ (pos) - target) >= 0)
+        return;
+      if (i < SCSP_THREAD_SPIN)
+        SCSP_THREAD_PAUSE ();
+      else
+        YabThreadYield ();
+    }
+
+  w->target = target;
+  SCSP_THREAD_PUBLISH (&w->waiting, 1);
+
+  // whoever clears waiting owns the wake up
+  if ((s32)(SCSP_THREAD_READ (pos) - target) >= 0 &&
+      SCSP_THREAD_CAS (&w->waiting, 1, 0))
+    return;
+
+  YabSemWait (w->sem);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+// Called after publishing pos
+static void
+scsp_thread_signal (scsp_thread_waiter *w, u32 pos)
+{
+  if (SCSP_THREAD_READ (&w->waiting) && (s32)(pos - w->target) >= 0 &&
+      SCSP_THREAD_CAS (&w->waiting, 1, 0))
+    YabSemPost (w->sem);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void
+scsp_thread_flush (void)
+{
+  SCSP_THREAD_PUBLISH (&scsp_thread.write_pos, scsp_thread.queued);
+  scsp_thread_signal (&scsp_thread.consumer, scsp_thread.queued);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void
+scsp_thread_push (u32 type, u32 addr, u32 data)
+{
+  scsp_thread_cmd *cmd;
+
+  if (scsp_thread.queued - SCSP_THREAD_READ (&scsp_thread.read_pos) >= SCSP_THREAD_RING_SIZE)
+    {
+      PROFILE_START(SCSPWAIT);
+      scsp_thread_flush ();
+      scsp_thread_wait (&scsp_thread.producer, &scsp_thread.read_pos,
+                        scsp_thread.queued - SCSP_THREAD_RING_SIZE + 1);
+      PROFILE_STOP(SCSPWAIT);
+    }
+
+  cmd = &scsp_thread.ring[scsp_thread.queued & SCSP_THREAD_RING_MASK];
+  cmd->type = type;
+  cmd->addr = addr;
+  cmd->data = data;
+  scsp_thread.queued++;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+// Waits until the sound thread is done with everything queued so far, after
+// which the sound side can be used directly until the next push.
+static void
+scsp_thread_drain (void)
+{
+  if (!scsp_thread.running ||
+      SCSP_THREAD_READ (&scsp_thread.read_pos) == scsp_thread.queued)
+    return;
+
+  PROFILE_START(SCSPWAIT);
+  scsp_thread_flush ();
+  scsp_thread_wait (&scsp_thread.producer, &scsp_thread.read_pos,
+                    scsp_thread.queued);
+  PROFILE_STOP(SCSPWAIT);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void
+scsp_thread_main (void *data)
+{
+  PROFILE_THREAD_NAME("ScspSoundThread");
+
+  for (;;)
+    {
+      u32 pos = scsp_thread.read_pos;
+      scsp_thread_cmd *cmd = &scsp_thread.ring[pos & SCSP_THREAD_RING_MASK];
+
+      scsp_thread_wait (&scsp_thread.consumer, &scsp_thread.write_pos, pos + 1);
+
+      switch (cmd->type)
+        {
+        case SCSP_CMD_WRITE_B:
+          m68k_idle_wake ();
+          scsp_w_b (cmd->addr, cmd->data);
+          break;
+        case SCSP_CMD_WRITE_W:
+          m68k_idle_wake ();
+          scsp_w_w (cmd->addr, cmd->data);
+          break;
+        case SCSP_CMD_WRITE_D:
+          m68k_idle_wake ();
+          scsp_w_d (cmd->addr, cmd->data);
+          break;
+        case SCSP_CMD_RAM_WRITE_B:
+          sound_ram_w_b (cmd->addr, cmd->data);
+          break;
+        case SCSP_CMD_RAM_WRITE_W:
+          sound_ram_w_w (cmd->addr, cmd->data);
+          break;
+        case SCSP_CMD_RAM_WRITE_D:
+          sound_ram_w_d (cmd->addr, cmd->data);
+          break;
+        case SCSP_CMD_M68K_EXEC:
+          PROFILE_START(M68K);
+          m68k_exec_step (cmd->data);
+          PROFILE_STOP(M68K);
+          break;
+        case SCSP_CMD_NEW_SCSP_EXEC:
+          PROFILE_START(SCSP);
+          new_scsp_step (cmd->data);
+          PROFILE_STOP(SCSP);
+          break;
+        case SCSP_CMD_LINE:
+          PROFILE_START(SCSP);
+          scsp_line_exec ();
+          PROFILE_STOP(SCSP);
+          break;
+        }
+
+      SCSP_THREAD_PUBLISH (&scsp_thread.read_pos, pos + 1);
+      scsp_thread_signal (&scsp_thread.producer, pos + 1);
+
+      if (cmd->type == SCSP_CMD_QUIT)
+        break;
+    }
+
+  PROFILE_THREAD_EXIT();
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+// Hands the SCU the sound requests that are scsp_irq_delay steps old
+static void
+scsp_deliver_requests (void)
+{
+  u32 index = (scsp_thread.issued - scsp_irq_delay) & SCSP_STEP_LOG_MASK;
+  u32 count;
+
+  // With no delay this only hands over requests from a loaded state
+  if (scsp_thread.running &&
+      (s32)(SCSP_THREAD_READ (&scsp_thread.read_pos) - scsp_thread.step_pos[index]) < 0)
+    {
+      PROFILE_START(SCSPWAIT);
+      scsp_thread_flush ();
+      scsp_thread_wait (&scsp_thread.producer, &scsp_thread.read_pos,
+                        scsp_thread.step_pos[index]);
+      PROFILE_STOP(SCSPWAIT);
+    }
+
+  count = scsp_thread.requests[index];
+  scsp_thread.requests[index] = 0;
+
+  while (count--)
+    ScuSendSoundRequest ();
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+// Hands over every pending request at once, used when the delay changes
+static void
+scsp_deliver_all_requests (void)
+{
+  int i;
+
+  scsp_thread_drain ();
+
+  for (i = SCSP_STEP_LOG_SIZE - 1; i >= 0; i--)
+    {
+      u32 index = (scsp_thread.step - i) & SCSP_STEP_LOG_MASK;
+
+      while (scsp_thread.requests[index])
+        {
+          scsp_thread.requests[index]--;
+          ScuSendSoundRequest ();
+        }
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+// Switches to the delay asked for, the thread has to be at least one step
+// behind
+static void
+scsp_update_request_delay (int threaded)
+{
+  int steps = scsp_irq_delay_set;
+
+  if (threaded && steps == 0)
+    steps = SCSP_THREAD_DELAY;
+
+  if (steps != scsp_irq_delay)
+    {
+      scsp_deliver_all_requests ();
+      scsp_irq_delay = steps;
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void
+ScspSetSoundRequestDelay (int steps)
+{
+  if (steps < 0)
+    steps = 0;
+  else if (steps > SCSP_STEP_LOG_SIZE - 1)
+    steps = SCSP_STEP_LOG_SIZE - 1;
+
+  scsp_irq_delay_set = steps;
+  scsp_update_request_delay (scsp_thread.running);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void
+ScspSetSoundThread (int enable)
+{
+  if (enable == scsp_thread.running)
+    return;
+
+  if (enable)
+    {
+      if ((scsp_thread.producer.sem = YabSemInit (0)) == NULL)
+        return;
+
+      if ((scsp_thread.consumer.sem = YabSemInit (0)) == NULL)
+        {
+          YabSemDeInit (scsp_thread.producer.sem);
+          return;
+        }
+
+      scsp_thread.producer.waiting = scsp_thread.consumer.waiting = 0;
+      scsp_thread.write_pos = scsp_thread.read_pos = scsp_thread.queued = 0;
+      memset (scsp_thread.step_pos, 0, sizeof (scsp_thread.step_pos));
+
+      if (YabThreadStart (YAB_THREAD_SCSP, scsp_thread_main, NULL) != 0)
+        {
+          YabSemDeInit (scsp_thread.consumer.sem);
+          YabSemDeInit (scsp_thread.producer.sem);
+          return;
+        }
+
+      scsp_update_request_delay (1);
+      scsp_thread.running = 1;
+    }
+  else
+    {
+      scsp_thread_push (SCSP_CMD_QUIT, 0, 0);
+      scsp_thread_flush ();
+      YabThreadWait (YAB_THREAD_SCSP);
+
+      YabSemDeInit (scsp_thread.consumer.sem);
+      YabSemDeInit (scsp_thread.producer.sem);
+      scsp_thread.running = 0;
+
+      scsp_update_request_delay (0);
+    }
+}
+
 //////////////////////////////////////////////////////////////////////////////
 
 u32 FASTCALL
@@ -4482,8 +5055,11 @@ c68k_byte_read (const u32 adr)
 {
   if (adr < 0x100000)
     return T2ReadByte(SoundRam, adr & 0x7FFFF);
-  else
-    return scsp_r_b(adr);
+
+  m68k_idle.regreads++;
+  if ((adr & 0xFFF) == 0x405)
+    m68k_idle.sidefx++;
+  return scsp_r_b(adr);
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -4491,6 +5067,7 @@ c68k_byte_read (const u32 adr)
 static void FASTCALL
 c68k_byte_write (const u32 adr, u32 data)
 {
+  m68k_idle.writes++;
   if (adr < 0x100000)
     T2WriteByte(SoundRam, adr & 0x7FFFF, data);
   else
@@ -4505,8 +5082,11 @@ c68k_word_read (const u32 adr)
 {
   if (adr < 0x100000)
     return T2ReadWord(SoundRam, adr & 0x7FFFF);
-  else
-    return scsp_r_w(adr);
+
+  m68k_idle.regreads++;
+  if ((adr & 0xFFE) == 0x404)
+    m68k_idle.sidefx++;
+  return scsp_r_w(adr);
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -4514,6 +5094,7 @@ c68k_word_read (const u32 adr)
 static void FASTCALL
 c68k_word_write (const u32 adr, u32 data)
 {
+  m68k_idle.writes++;
   if (adr < 0x100000)
     T2WriteWord (SoundRam, adr & 0x7FFFF, data);
   else
@@ -4526,6 +5107,7 @@ static void
 c68k_interrupt_handler (u32 level)
 {
   // send interrupt to 68k
+  m68k_idle_wake ();
   M68K->SetIRQ ((s32)level);
 }
 
@@ -4534,8 +5116,11 @@ c68k_interrupt_handler (u32 level)
 static void
 scu_interrupt_handler (void)
 {
-  // send interrupt to scu
-  ScuSendSoundRequest ();
+  // send interrupt to scu, or leave it for scsp_deliver_requests
+  if (scsp_irq_delay)
+    scsp_thread.requests[scsp_thread.step & SCSP_STEP_LOG_MASK]++;
+  else
+    ScuSendSoundRequest ();
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -4543,6 +5128,7 @@ scu_interrupt_handler (void)
 u8 FASTCALL
 ScspReadByte (u32 addr)
 {
+   scsp_thread_drain();
    return scsp_r_b(addr);
 }
 
@@ -4551,7 +5137,13 @@ ScspReadByte (u32 addr)
 void FASTCALL
 ScspWriteByte (u32 addr, u8 val)
 {
-   scsp_w_b(addr, val);
+   if (scsp_thread.running)
+      scsp_thread_push(SCSP_CMD_WRITE_B, addr, val);
+   else
+   {
+      m68k_idle_wake ();
+      scsp_w_b(addr, val);
+   }
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -4559,6 +5151,7 @@ ScspWriteByte (u32 addr, u8 val)
 u16 FASTCALL
 ScspReadWord (u32 addr)
 {
+   scsp_thread_drain();
    return scsp_r_w(addr);
 }
 
@@ -4567,7 +5160,13 @@ ScspReadWord (u32 addr)
 void FASTCALL
 ScspWriteWord (u32 addr, u16 val)
 {
-   scsp_w_w(addr, val);
+   if (scsp_thread.running)
+      scsp_thread_push(SCSP_CMD_WRITE_W, addr, val);
+   else
+   {
+      m68k_idle_wake ();
+      scsp_w_w(addr, val);
+   }
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -4575,6 +5174,7 @@ ScspWriteWord (u32 addr, u16 val)
 u32 FASTCALL
 ScspReadLong (u32 addr)
 {
+   scsp_thread_drain();
    return scsp_r_d(addr);
 }
 
@@ -4583,7 +5183,13 @@ ScspReadLong (u32 addr)
 void FASTCALL
 ScspWriteLong (u32 addr, u32 val)
 {
-   scsp_w_d(addr, val);
+   if (scsp_thread.running)
+      scsp_thread_push(SCSP_CMD_WRITE_D, addr, val);
+   else
+   {
+      m68k_idle_wake ();
+      scsp_w_d(addr, val);
+   }
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -4593,6 +5199,8 @@ SoundRamReadByte (u32 addr)
 {
   addr &= 0xFFFFF;
 
+  scsp_thread_drain ();
+
   // If mem4b is set, mirror ram every 256k
   if (scsp.mem4b == 0)
     addr &= 0x3FFFF;
@@ -4604,8 +5212,8 @@ SoundRamReadByte (u32 addr)
 
 //////////////////////////////////////////////////////////////////////////////
 
-void FASTCALL
-SoundRamWriteByte (u32 addr, u8 val)
+static void
+sound_ram_w_b (u32 addr, u8 val)
 {
   addr &= 0xFFFFF;
 
@@ -4616,16 +5224,30 @@ SoundRamWriteByte (u32 addr, u8 val)
     return;
 
   T2WriteByte (SoundRam, addr, val);
+  m68k_idle_wake ();
   M68K->WriteNotify (addr, 1);
 }
 
 //////////////////////////////////////////////////////////////////////////////
 
+void FASTCALL
+SoundRamWriteByte (u32 addr, u8 val)
+{
+  if (scsp_thread.running)
+    scsp_thread_push (SCSP_CMD_RAM_WRITE_B, addr, val);
+  else
+    sound_ram_w_b (addr, val);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
 u16 FASTCALL
 SoundRamReadWord (u32 addr)
 {
   addr &= 0xFFFFF;
 
+  scsp_thread_drain ();
+
   if (scsp.mem4b == 0)
     addr &= 0x3FFFF;
   else if (addr > 0x7FFFF)
@@ -4636,8 +5258,8 @@ SoundRamReadWord (u32 addr)
 
 //////////////////////////////////////////////////////////////////////////////
 
-void FASTCALL
-SoundRamWriteWord (u32 addr, u16 val)
+static void
+sound_ram_w_w (u32 addr, u16 val)
 {
   addr &= 0xFFFFF;
 
@@ -4648,16 +5270,30 @@ SoundRamWriteWord (u32 addr, u16 val)
     return;
 
   T2WriteWord (SoundRam, addr, val);
+  m68k_idle_wake ();
   M68K->WriteNotify (addr, 2);
 }
 
 //////////////////////////////////////////////////////////////////////////////
 
+void FASTCALL
+SoundRamWriteWord (u32 addr, u16 val)
+{
+  if (scsp_thread.running)
+    scsp_thread_push (SCSP_CMD_RAM_WRITE_W, addr, val);
+  else
+    sound_ram_w_w (addr, val);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
 u32 FASTCALL
 SoundRamReadLong (u32 addr)
 {
   addr &= 0xFFFFF;
 
+  scsp_thread_drain ();
+
   // If mem4b is set, mirror ram every 256k
   if (scsp.mem4b == 0)
     addr &= 0x3FFFF;
@@ -4669,8 +5305,8 @@ SoundRamReadLong (u32 addr)
 
 //////////////////////////////////////////////////////////////////////////////
 
-void FASTCALL
-SoundRamWriteLong (u32 addr, u32 val)
+static void
+sound_ram_w_d (u32 addr, u32 val)
 {
   addr &= 0xFFFFF;
 
@@ -4681,11 +5317,23 @@ SoundRamWriteLong (u32 addr, u32 val)
     return;
 
   T2WriteLong (SoundRam, addr, val);
+  m68k_idle_wake ();
   M68K->WriteNotify (addr, 4);
 }
 
 //////////////////////////////////////////////////////////////////////////////
 
+void FASTCALL
+SoundRamWriteLong (u32 addr, u32 val)
+{
+  if (scsp_thread.running)
+    scsp_thread_push (SCSP_CMD_RAM_WRITE_D, addr, val);
+  else
+    sound_ram_w_d (addr, val);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
 u8 FASTCALL
 Sh2ScspReadByte(SH2_struct *sh, u32 addr)
 {
@@ -4805,9 +5453,14 @@ ScspInit (int coreid)
   M68K->SetFetch (0x040000, 0x080000, (pointer)SoundRam);
   M68K->SetFetch (0x080000, 0x0C0000, (pointer)SoundRam);
   M68K->SetFetch (0x0C0000, 0x100000, (pointer)SoundRam);
+  // Sound RAM data reads don't need c68k_byte_read/c68k_word_read either
+  M68K->SetReadRam (0x100000, 0x7FFFF, (pointer)SoundRam);
 
   IsM68KRunning = 0;
 
+  scsp_thread.issued = scsp_thread.step = 0;
+  memset (scsp_thread.requests, 0, sizeof (scsp_thread.requests));
+
   scsp_init (SoundRam, &c68k_interrupt_handler, &scu_interrupt_handler);
   ScspInternalVars->scsptiming1 = 0;
   ScspInternalVars->scsptiming2 = 0;
@@ -4819,6 +5472,7 @@ ScspInit (int coreid)
   ScspInternalVars->inbreakpoint = 0;
 
   m68kexecptr = M68K->Exec;
+  m68k_idle_reset ();
 
   // Allocate enough memory for each channel buffer(may have to change)
   scspsoundlen = 44100 / 60; // assume it's NTSC timing
@@ -4842,6 +5496,8 @@ ScspChangeSoundCore (int coreid)
 {
   int i;
 
+  scsp_thread_drain ();
+
   // Make sure the old core is freed
   if (SNDCore)
     SNDCore->DeInit();
@@ -4893,6 +5549,9 @@ ScspChangeSoundCore (int coreid)
 void
 ScspDeInit (void)
 {
+  ScspSetSoundThread (0);
+  scsp_irq_delay = scsp_irq_delay_set = 0;
+
   if (scspchannel[0].data32)
     free(scspchannel[0].data32);
   scspchannel[0].data32 = NULL;
@@ -4917,7 +5576,9 @@ ScspDeInit (void)
 void
 M68KStart (void)
 {
+  scsp_thread_drain ();
   M68K->Reset ();
+  m68k_idle_reset ();
   savedcycles = 0;
   IsM68KRunning = 1;
 }
@@ -4927,6 +5588,7 @@ M68KStart (void)
 void
 M68KStop (void)
 {
+  scsp_thread_drain ();
   IsM68KRunning = 0;
 }
 
@@ -4935,6 +5597,7 @@ M68KStop (void)
 void
 ScspReset (void)
 {
+  scsp_thread_drain ();
   scsp_reset();
 }
 
@@ -4943,6 +5606,8 @@ ScspReset (void)
 int
 ScspChangeVideoFormat (int type)
 {
+  scsp_thread_drain ();
+
   scspsoundlen = 44100 / (type ? 50 : 60);
   scsplines = type ? 313 : 263;
   scspsoundbufsize = scspsoundlen * scspsoundbufs;
@@ -4964,8 +5629,118 @@ __attribute__((noinline))
 #endif
 static s32 FASTCALL M68KExecBP (s32 cycles);
 
-void
-M68KExec (s32 cycles)
+static void
+m68k_idle_get_state (m68k_idle_state *st)
+{
+  int i;
+
+  st->pc = M68K->GetPC ();
+  st->sr = M68K->GetSR ();
+  for (i = 0; i < 8; i++)
+    {
+      st->d[i] = M68K->GetDReg (i);
+      st->a[i] = M68K->GetAReg (i);
+    }
+}
+
+// Works through cycles worth of the idle loop the way Exec would
+static s32
+m68k_idle_skip (s32 cycles, s32 done)
+{
+  if (cycles - done > m68k_idle.period)
+    done += (cycles - done - 1) / m68k_idle.period * m68k_idle.period;
+
+  while (done < cycles)
+    {
+      done += m68k_idle.cost[m68k_idle.pos];
+      if (++m68k_idle.pos == m68k_idle.len)
+        m68k_idle.pos = 0;
+    }
+
+  return done;
+}
+
+// Runs a step one instruction at a time, looking for the 68K to come back to
+// a state it was in earlier in the step. Returns the cycles executed.
+static s32
+m68k_idle_probe (s32 cycles)
+{
+  m68k_idle_state st[M68K_IDLE_MAX_INSNS + 1];
+  s32 cost[M68K_IDLE_MAX_INSNS];
+  u32 writes = m68k_idle.writes;
+  u32 regreads = m68k_idle.regreads;
+  u32 sidefx = m68k_idle.sidefx;
+  u32 lo, hi;
+  s32 done = 0;
+  int n, i;
+
+  m68k_idle.probe = 0;
+  m68k_idle_get_state (&st[0]);
+  lo = hi = st[0].pc;
+
+  for (n = 1; n <= M68K_IDLE_MAX_INSNS && done < cycles; n++)
+    {
+      cost[n - 1] = M68K->Exec (1);
+      done += cost[n - 1];
+      if (m68k_idle.writes != writes || m68k_idle.sidefx != sidefx)
+        break;
+
+      m68k_idle_get_state (&st[n]);
+      if (st[n].pc < lo)
+        lo = st[n].pc;
+      if (st[n].pc > hi)
+        hi = st[n].pc;
+
+      for (i = 0; i < n; i++)
+        {
+          if (memcmp (&st[i], &st[n], sizeof (m68k_idle_state)) == 0)
+            {
+              // The 68K is at st[i] again, which becomes the loop's start
+              m68k_idle.len = n - i;
+              m68k_idle.pos = 0;
+              m68k_idle.period = 0;
+              memcpy (m68k_idle.state, &st[i], m68k_idle.len * sizeof (m68k_idle_state));
+              memcpy (m68k_idle.cost, &cost[i], m68k_idle.len * sizeof (s32));
+              for (i = 0; i < m68k_idle.len; i++)
+                m68k_idle.period += m68k_idle.cost[i];
+              if (m68k_idle.period <= 0)
+                break;
+
+              m68k_idle.active = 1;
+              m68k_idle.regs = (m68k_idle.regreads != regreads);
+              return m68k_idle_skip (cycles, done);
+            }
+        }
+    }
+
+  // Don't try again until the 68K has left this bit of code
+  m68k_idle.rejectlo = lo;
+  m68k_idle.rejecthi = hi;
+
+  if (done < cycles)
+    done += M68K->Exec (cycles - done);
+  return done;
+}
+
+// Decides after a normal step whether the next one is worth probing
+static void
+m68k_idle_check (u32 writes)
+{
+  u32 pc = M68K->GetPC ();
+  u32 lastpc = m68k_idle.lastpc;
+
+  m68k_idle.lastpc = pc;
+  if (pc >= m68k_idle.rejectlo && pc <= m68k_idle.rejecthi)
+    return;
+
+  m68k_idle.rejectlo = 1;
+  m68k_idle.rejecthi = 0;
+  m68k_idle.probe = (m68k_idle.writes == writes &&
+                     pc - lastpc + M68K_IDLE_MAX_BYTES <= 2 * M68K_IDLE_MAX_BYTES);
+}
+
+static void
+m68k_exec_step (s32 cycles)
 {
   s32 newcycles = savedcycles - cycles;
   if (LIKELY(IsM68KRunning))
@@ -4973,10 +5748,49 @@ M68KExec (s32 cycles)
       if (LIKELY(newcycles < 0))
         {
           s32 cyclestoexec = -newcycles;
-          newcycles += (*m68kexecptr)(cyclestoexec);
+
+          if (UNLIKELY(m68kexecptr != M68K->Exec))
+            {
+              m68k_idle_wake ();
+              m68k_idle.probe = 0;
+              newcycles += (*m68kexecptr)(cyclestoexec);
+            }
+          else if (m68k_idle.active)
+            newcycles += m68k_idle_skip (cyclestoexec, 0);
+          else if (m68k_idle.probe)
+            newcycles += m68k_idle_probe (cyclestoexec);
+          else
+            {
+              u32 writes = m68k_idle.writes;
+              newcycles += M68K->Exec (cyclestoexec);
+              m68k_idle_check (writes);
+            }
         }
       savedcycles = newcycles;
     }
+
+  scsp_thread.step++;
+}
+
+void
+M68KExec (s32 cycles)
+{
+  scsp_deliver_requests ();
+
+  // breakpoint callbacks expect to be on the emulation thread
+  if (scsp_thread.running && m68kexecptr != M68KExecBP)
+    {
+      scsp_thread_push (SCSP_CMD_M68K_EXEC, 0, cycles);
+      scsp_thread_flush ();
+    }
+  else
+    {
+      scsp_thread_drain ();
+      m68k_exec_step (cycles);
+    }
+
+  scsp_thread.step_pos[scsp_thread.issued & SCSP_STEP_LOG_MASK] = scsp_thread.queued;
+  scsp_thread.issued++;
 }
 
 void new_scsp_run_sample()
@@ -4999,6 +5813,9 @@ void new_scsp_run_sample()
       cdda_out_left -= 4;
    }
 
+   if (m68k_idle.regs)
+      m68k_idle_wake ();
+
    scsp_update_timer(1);
    generate_sample(&new_scsp, scsp.rbp, scsp.rbl, &out_l, &out_r, scsp.mvol, cd_in_l, cd_in_r);
 
@@ -5016,7 +5833,7 @@ void new_scsp_run_sample()
    new_scsp_outbuf_pos++;
 }
 
-void new_scsp_exec(s32 cycles)
+static void new_scsp_step(s32 cycles)
 {
    s32 cycles_temp = new_scsp_cycles - cycles;
    if (cycles_temp < 0)
@@ -5027,6 +5844,14 @@ void new_scsp_exec(s32 cycles)
    new_scsp_cycles = cycles_temp;
 }
 
+void new_scsp_exec(s32 cycles)
+{
+   if (scsp_thread.running)
+      scsp_thread_push(SCSP_CMD_NEW_SCSP_EXEC, 0, cycles);
+   else
+      new_scsp_step(cycles);
+}
+
 //----------------------------------------------------------------------------
 
 static s32 FASTCALL
@@ -5063,16 +5888,19 @@ M68KExecBP (s32 cycles)
 void
 M68KStep (void)
 {
+  scsp_thread_drain ();
   M68K->Exec(1);
 }
 
 //////////////////////////////////////////////////////////////////////////////
 
-// Wait for background execution to finish (used on PSP)
+// Wait for background execution to finish (used on PSP). The sound thread
+// stands in for that when it is running.
 void
 M68KSync (void)
 {
-  M68K->Sync();
+  if (!scsp_thread.running)
+    M68K->Sync();
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -5113,6 +5941,9 @@ ScspConvert32uto16s (s32 *srcL, s32 *srcR, s16 *dst, u32 len)
 void
 ScspReceiveCDDA (const u8 *sector)
 {	
+   // the CD timing below depends on how far the sound side has played
+   scsp_thread_drain();
+
    // If buffer is half empty or less, boost timing for a bit until we've buffered a few sectors
    if (cdda_out_left < (sizeof(cddabuf.data) / 2))
    {
@@ -5147,6 +5978,8 @@ ScspReceiveCDDA (const u8 *sector)
 
 void ScspReceiveMpeg (const u8 *samples, int len)
 {
+  scsp_thread_drain();
+
   memcpy(cddabuf.data+cdda_next_in, samples, len);
 
   if (sizeof(cddabuf.data)-cdda_next_in <= len)
@@ -5180,11 +6013,14 @@ void new_scsp_update_samples(s32 *bufL, s32 *bufR, int scspsoundlen)
    new_scsp_outbuf_pos = 0;
 }
 
-void
-ScspExec ()
+static void
+scsp_line_exec (void)
 {
   u32 audiosize;
 
+  if (m68k_idle.regs)
+     m68k_idle_wake ();
+
   ScspInternalVars->scsptiming2 +=
     ((scspsoundlen << 16) + scsplines / 2) / scsplines;
   if (!use_new_scsp)
@@ -5275,9 +6111,22 @@ ScspExec ()
 
 //////////////////////////////////////////////////////////////////////////////
 
+void
+ScspExec ()
+{
+  if (scsp_thread.running)
+    scsp_thread_push (SCSP_CMD_LINE, 0, 0);
+  else
+    scsp_line_exec ();
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
 void
 M68KWriteNotify (u32 address, u32 size)
 {
+  scsp_thread_drain ();
+  m68k_idle_wake ();
   M68K->WriteNotify (address, size);
 }
 
@@ -5288,6 +6137,9 @@ M68KGetRegisters (m68kregs_struct *regs)
 {
   int i;
 
+  scsp_thread_drain ();
+  m68k_idle_wake ();
+
   if (regs != NULL)
     {
       for (i = 0; i < 8; i++)
@@ -5308,6 +6160,8 @@ M68KSetRegisters (m68kregs_struct *regs)
 {
   int i;
 
+  scsp_thread_drain ();
+
   if (regs != NULL)
     {
       for (i = 0; i < 8; i++)
@@ -5318,6 +6172,7 @@ M68KSetRegisters (m68kregs_struct *regs)
 
       M68K->SetSR (regs->SR);
       M68K->SetPC (regs->PC);
+      m68k_idle_reset ();
     }
 }
 
@@ -5326,6 +6181,7 @@ M68KSetRegisters (m68kregs_struct *regs)
 void
 ScspMuteAudio (int flags)
 {
+  scsp_thread_drain ();
   scsp_mute_flags |= flags;
   if (SNDCore && scsp_mute_flags)
     SNDCore->MuteAudio ();
@@ -5336,6 +6192,7 @@ ScspMuteAudio (int flags)
 void
 ScspUnMuteAudio (int flags)
 {
+  scsp_thread_drain ();
   scsp_mute_flags &= ~flags;
   if (SNDCore && (scsp_mute_flags == 0))
     SNDCore->UnMuteAudio ();
@@ -5346,6 +6203,7 @@ ScspUnMuteAudio (int flags)
 void
 ScspSetVolume (int volume)
 {
+  scsp_thread_drain ();
   scsp_volume = volume;
   if (SNDCore)
     SNDCore->SetVolume (volume);
@@ -5366,6 +6224,8 @@ M68KAddCodeBreakpoint (u32 addr)
 {
   int i;
 
+  scsp_thread_drain ();
+
   if (ScspInternalVars->numcodebreakpoints < MAX_BREAKPOINTS)
     {
       // Make sure it isn't already on the list
@@ -5415,6 +6275,9 @@ int
 M68KDelCodeBreakpoint (u32 addr)
 {
   int i;
+
+  scsp_thread_drain ();
+
   if (ScspInternalVars->numcodebreakpoints > 0)
     {
       for (i = 0; i < ScspInternalVars->numcodebreakpoints; i++)
@@ -5448,6 +6311,8 @@ void
 M68KClearCodeBreakpoints ()
 {
   int i;
+
+  scsp_thread_drain ();
   for (i = 0; i < MAX_BREAKPOINTS; i++)
     ScspInternalVars->codebreakpoint[i].addr = 0xFFFFFFFF;
 
@@ -5457,7 +6322,7 @@ M68KClearCodeBreakpoints ()
 //////////////////////////////////////////////////////////////////////////////
 
 int
-SoundSaveState (FILE *fp)
+SoundSaveState (ystream_struct *fp)
 {
   int i;
   u32 temp;
@@ -5465,7 +6330,10 @@ SoundSaveState (FILE *fp)
   u8 nextphase;
   IOCheck_struct check = { 0, 0 };
 
-  offset = StateWriteHeader (fp, "SCSP", 2);
+  scsp_thread_drain ();
+  m68k_idle_wake ();
+
+  offset = StateWriteHeader (fp, "SCSP", 3);
 
   // Save 68k registers first
   ywrite (&check, (void *)&IsM68KRunning, 1, 1, fp);
@@ -5636,21 +6504,31 @@ SoundSaveState (FILE *fp)
 
   ywrite (&check, (void *)scsp.stack, 4, 32 * 2, fp);
 
+  // Sound requests not yet handed to the SCU, newest step first
+  for (i = 0; i < SCSP_STEP_LOG_SIZE; i++)
+    {
+      temp = scsp_thread.requests[(scsp_thread.step - i) & SCSP_STEP_LOG_MASK];
+      ywrite (&check, (void *)&temp, 4, 1, fp);
+    }
+
   return StateFinishHeader (fp, offset);
 }
 
 //////////////////////////////////////////////////////////////////////////////
 
 int
-SoundLoadState (FILE *fp, int version, int size)
+SoundLoadState (ystream_struct *fp, int version, int size)
 {
   int i, i2;
   u32 temp;
   u8 nextphase;
   IOCheck_struct check = { 0, 0 };
 
+  scsp_thread_drain ();
+
   // Read 68k registers first
   yread (&check, (void *)&IsM68KRunning, 1, 1, fp);
+  m68k_idle_reset ();
 
 #ifdef IMPROVED_SAVESTATES
   M68K->LoadState(fp);
@@ -5866,6 +6744,22 @@ SoundLoadState (FILE *fp, int version, int size)
       yread (&check, (void *)scsp.stack, 4, 32 * 2, fp);
     }
 
+  memset (scsp_thread.requests, 0, sizeof (scsp_thread.requests));
+
+  if (version > 2)
+    {
+      for (i = 0; i < SCSP_STEP_LOG_SIZE; i++)
+        {
+          yread (&check, (void *)&temp, 4, 1, fp);
+
+          // A state saved with a longer delay can hold requests that are
+          // already due here. They go out with the next M68KExec, since the
+          // SCU state isn't loaded yet.
+          i2 = i < scsp_irq_delay ? i : scsp_irq_delay;
+          scsp_thread.requests[(scsp_thread.step - i2) & SCSP_STEP_LOG_MASK] += temp;
+        }
+    }
+
   return size;
 }
 
@@ -5941,6 +6835,8 @@ ScspSlotDebugStats (u8 slotnum, char *outstring)
 {
   u32 slotoffset = slotnum * 0x20;
 
+  scsp_thread_drain ();
+
   AddString (outstring, "Sound Source = ");
   switch (scsp.slot[slotnum].ssctl)
     {
@@ -6068,6 +6964,8 @@ ScspSlotDebugStats (u8 slotnum, char *outstring)
 void
 ScspCommonControlRegisterDebugStats (char *outstring)
 {
+   scsp_thread_drain ();
+
    AddString (outstring, "Memory: %s\r\n", scsp.mem4b ? "4 Mbit" : "2 Mbit");
    AddString (outstring, "Master volume: %ld\r\n", (unsigned long)scsp.mvol);
    AddString (outstring, "Ring buffer length: %ld\r\n", (unsigned long)scsp.rbl);
@@ -6118,16 +7016,18 @@ ScspSlotDebugSaveRegisters (u8 slotnum, const char *filename)
   int i;
   IOCheck_struct check = { 0, 0 };
 
+  scsp_thread_drain ();
+
   if ((fp = fopen (filename, "wb")) == NULL)
     return -1;
 
   for (i = (slotnum * 0x20); i < ((slotnum+1) * 0x20); i += 2)
     {
 #ifdef WORDS_BIGENDIAN
-      ywrite (&check, (void *)&scsp_isr[i ^ 2], 1, 2, fp);
+      yfwrite (&check, (void *)&scsp_isr[i ^ 2], 1, 2, fp);
 #else
-      ywrite (&check, (void *)&scsp_isr[(i + 1) ^ 2], 1, 1, fp);
-      ywrite (&check, (void *)&scsp_isr[i ^ 2], 1, 1, fp);
+      yfwrite (&check, (void *)&scsp_isr[(i + 1) ^ 2], 1, 1, fp);
+      yfwrite (&check, (void *)&scsp_isr[i ^ 2], 1, 1, fp);
 #endif
     }
 
@@ -6144,6 +7044,8 @@ ScspSlotDebugAudio (u32 *workbuf, s16 *buf, u32 len)
 {
   u32 *bufL, *bufR;
 
+  scsp_thread_drain ();
+
   bufL = workbuf;
   bufR = workbuf+len;
   scsp_bufL = (s32 *)bufL;
@@ -6214,6 +7116,8 @@ typedef struct
 void 
 ScspSlotResetDebug(u8 slotnum)
 {
+  scsp_thread_drain ();
+
   memcpy (&debugslot, &scsp.slot[slotnum], sizeof(slot_t));
 
   // Clear out the phase counter, etc.
@@ -6250,7 +7154,7 @@ ScspSlotDebugAudioSaveWav (u8 slotnum, const char *filename)
   memcpy (waveheader.riff.id, "RIFF", 4);
   waveheader.riff.size = 0; // we'll fix this after the file is closed
   memcpy (waveheader.rifftype, "WAVE", 4);
-  ywrite (&check, (void *)&waveheader, 1, sizeof(waveheader_struct), fp);
+  yfwrite (&check, (void *)&waveheader, 1, sizeof(waveheader_struct), fp);
 
   // fmt chunk
   memcpy (fmt.chunk.id, "fmt ", 4);
@@ -6261,12 +7165,12 @@ ScspSlotDebugAudioSaveWav (u8 slotnum, const char *filename)
   fmt.bitspersample = 16;
   fmt.blockalign = fmt.bitspersample / 8 * fmt.numchan;
   fmt.bytespersec = fmt.rate * fmt.blockalign;
-  ywrite (&check, (void *)&fmt, 1, sizeof(fmt_struct), fp);
+  yfwrite (&check, (void *)&fmt, 1, sizeof(fmt_struct), fp);
 
   // data chunk
   memcpy (data.id, "data", 4);
   data.size = 0; // we'll fix this at the end
-  ywrite (&check, (void *)&data, 1, sizeof(chunk_struct), fp);
+  yfwrite (&check, (void *)&data, 1, sizeof(chunk_struct), fp);
 
   ScspSlotResetDebug(slotnum);
 
@@ -6277,7 +7181,7 @@ ScspSlotDebugAudioSaveWav (u8 slotnum, const char *filename)
         break;
 
       counter += 512;
-      ywrite (&check, (void *)buf, 2, 512 * 2, fp);
+      yfwrite (&check, (void *)buf, 2, 512 * 2, fp);
       if (debugslot.lpctl != 0 && counter >= (44100 * 2 * 5))
         break;
     }
@@ -6287,11 +7191,11 @@ ScspSlotDebugAudioSaveWav (u8 slotnum, const char *filename)
   // Let's fix the riff chunk size and the data chunk size
   fseek (fp, sizeof(waveheader_struct)-0x8, SEEK_SET);
   length -= 0x4;
-  ywrite (&check, (void *)&length, 1, 4, fp);
+  yfwrite (&check, (void *)&length, 1, 4, fp);
 
   fseek (fp, sizeof(waveheader_struct) + sizeof(fmt_struct) + 0x4, SEEK_SET);
   length -= sizeof(waveheader_struct) + sizeof(fmt_struct);
-  ywrite (&check, (void *)&length, 1, 4, fp);
+  yfwrite (&check, (void *)&length, 1, 4, fp);
   fclose (fp);
 
   return 0;
@@ -36,6 +36,8 @@
 #define SCSP_MUTE_SYSTEM    1
 #define SCSP_MUTE_USER      2
 
+#define SCSP_THREAD_DELAY   2
+
 typedef struct
 {
    int id;
@@ -110,11 +112,17 @@ void ScspReset(void);
 int ScspChangeVideoFormat(int type);
 void M68KExec(s32 cycles);
 void ScspExec(void);
+// Runs the SCSP and 68K on their own thread, see scsp.c
+void ScspSetSoundThread(int enable);
+// Steps of 68K execution (M68KExec calls) before a sound request reaches the
+// SCU. 0 by default, the sound thread needs at least 1 and turns
+// SCSP_THREAD_DELAY on when none is set.
+void ScspSetSoundRequestDelay(int steps);
 void ScspConvert32uto16s(s32 *srcL, s32 *srcR, s16 *dst, u32 len);
 void ScspReceiveCDDA(const u8 *sector);
 void ScspReceiveMpeg (const u8 *samples, int len);
-int SoundSaveState(FILE *fp);
-int SoundLoadState(FILE *fp, int version, int size);
+int SoundSaveState(ystream_struct *fp);
+int SoundLoadState(ystream_struct *fp, int version, int size);
 void ScspSlotDebugStats(u8 slotnum, char *outstring);
 void ScspCommonControlRegisterDebugStats(char *outstring);
 int ScspSlotDebugSaveRegisters(u8 slotnum, const char *filename);
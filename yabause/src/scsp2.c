@@ -1673,7 +1673,7 @@ void ScspReceiveCDDA(const u8 *sector)
 
 // SoundSaveState:  Save the current SCSP state to the given file.
 
-int SoundSaveState(FILE *fp)
+int SoundSaveState(ystream_struct *fp)
 {
    int i;
    u32 temp;
@@ -1805,7 +1805,7 @@ int SoundSaveState(FILE *fp)
 
 // SoundLoadState:  Load the current SCSP state from the given file.
 
-int SoundLoadState(FILE *fp, int version, int size)
+int SoundLoadState(ystream_struct *fp, int version, int size)
 {
    int i, i2;
    u32 temp;
@@ -2237,10 +2237,10 @@ int ScspSlotDebugSaveRegisters(u8 slotnum, const char *filename)
    for (i = (slotnum * 0x20); i < ((slotnum+1) * 0x20); i += 2)
    {
 #ifdef WORDS_BIGENDIAN
-      ywrite(&check, (void *)&scsp_regcache[i], 1, 2, fp);
+      yfwrite(&check, (void *)&scsp_regcache[i], 1, 2, fp);
 #else
-      ywrite(&check, (void *)&scsp_regcache[i+1], 1, 1, fp);
-      ywrite(&check, (void *)&scsp_regcache[i], 1, 1, fp);
+      yfwrite(&check, (void *)&scsp_regcache[i+1], 1, 1, fp);
+      yfwrite(&check, (void *)&scsp_regcache[i], 1, 1, fp);
 #endif
    }
 
@@ -2299,7 +2299,7 @@ int ScspSlotDebugAudioSaveWav(u8 slotnum, const char *filename)
    memcpy(waveheader.riff.id, "RIFF", 4);
    waveheader.riff.size = 0; // we'll fix this after the file is closed
    memcpy(waveheader.rifftype, "WAVE", 4);
-   ywrite(&check, (void *)&waveheader, 1, sizeof(waveheader_struct), fp);
+   yfwrite(&check, (void *)&waveheader, 1, sizeof(waveheader_struct), fp);
 
    // fmt chunk
    memcpy(fmt.chunk.id, "fmt ", 4);
@@ -2310,12 +2310,12 @@ int ScspSlotDebugAudioSaveWav(u8 slotnum, const char *filename)
    fmt.bitspersample = 16;
    fmt.blockalign = fmt.bitspersample / 8 * fmt.numchan;
    fmt.bytespersec = fmt.rate * fmt.blockalign;
-   ywrite(&check, (void *)&fmt, 1, sizeof(fmt_struct), fp);
+   yfwrite(&check, (void *)&fmt, 1, sizeof(fmt_struct), fp);
 
    // data chunk
    memcpy(data.id, "data", 4);
    data.size = 0; // we'll fix this at the end
-   ywrite(&check, (void *)&data, 1, sizeof(chunk_struct), fp);
+   yfwrite(&check, (void *)&data, 1, sizeof(chunk_struct), fp);
 
    memcpy(&slot, &scsp.slot[slotnum], sizeof(slot));
 
@@ -2333,7 +2333,7 @@ int ScspSlotDebugAudioSaveWav(u8 slotnum, const char *filename)
          break;
 
       counter += 512;
-      ywrite(&check, (void *)buf, 2, 512 * 2, fp);
+      yfwrite(&check, (void *)buf, 2, 512 * 2, fp);
       if (slot.lpctl != 0 && counter >= (44100 * 2 * 5))
          break;
    }
@@ -2343,11 +2343,11 @@ int ScspSlotDebugAudioSaveWav(u8 slotnum, const char *filename)
    // Let's fix the riff chunk size and the data chunk size
    fseek(fp, sizeof(waveheader_struct)-0x8, SEEK_SET);
    length -= 0x4;
-   ywrite(&check, (void *)&length, 1, 4, fp);
+   yfwrite(&check, (void *)&length, 1, 4, fp);
 
    fseek(fp, sizeof(waveheader_struct)+sizeof(fmt_struct)+0x4, SEEK_SET);
    length -= sizeof(waveheader_struct)+sizeof(fmt_struct);
-   ywrite(&check, (void *)&length, 1, 4, fp);
+   yfwrite(&check, (void *)&length, 1, 4, fp);
    fclose(fp);
    return 0;
 }
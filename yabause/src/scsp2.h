@@ -103,8 +103,8 @@ extern void FASTCALL ScspWriteWord(u32 address, u16 data);
 extern void FASTCALL ScspWriteLong(u32 address, u32 data);
 extern void ScspReceiveCDDA(const u8 *sector);
 
-extern int SoundSaveState(FILE *fp);
-extern int SoundLoadState(FILE *fp, int version, int size);
+extern int SoundSaveState(ystream_struct *fp);
+extern int SoundLoadState(ystream_struct *fp, int version, int size);
 extern void ScspSlotDebugStats(u8 slotnum, char *outstring);
 extern void ScspCommonControlRegisterDebugStats(char *outstring);
 extern int ScspSlotDebugSaveRegisters(u8 slotnum, const char *filename);
@@ -22,6 +22,7 @@ extern "C"
 #include "scsp.h"
 #include "scspdsp.h"
 #include "scsp_dsp_jit.h"
+#include "jitprof.h"
 }
 
 #include "MemStream.h"
@@ -625,6 +626,7 @@ extern "C" void scsp_dsp_jit_exec()
          if (!blocks[block_num].dirty)//recompile not necessary for this block
             continue;
 
+         u64 compile_start = JitProfStart();
          Framework::CMemStream stream;
          stream.Seek(0, Framework::STREAM_SEEK_DIRECTION::STREAM_SEEK_SET);
          jit.SetStream(&stream);
@@ -647,6 +649,8 @@ extern "C" void scsp_dsp_jit_exec()
          jit.End();
          blocks[block_num].function = CMemoryFunction(stream.GetBuffer(), stream.GetSize());
          blocks[block_num].dirty = 0;
+         JitProfCode(JITPROF_SCSPDSP, compile_start, block_num * BLOCK_SIZE,
+            blocks[block_num].function.GetCode(), (u32)blocks[block_num].function.GetSize());
       }
       cxt.need_recompile = 0;
    }
@@ -703,8 +707,13 @@ extern "C" void scsp_dsp_jit_need_recompile()
 
 extern "C" void jit_set_mpro(u64 input, u32 addr)
 {
+   struct DspCodeBlock *block = &blocks[addr / BLOCK_SIZE];
+
+   if (!block->dirty && !block->function.IsEmpty())
+      JitProfInvalidate(JITPROF_SCSPDSP, addr);
+
    cxt.mpro[addr] = input;
-   blocks[addr / BLOCK_SIZE].dirty = 1;
+   block->dirty = 1;
 }
 
 extern "C" void jit_set_coef(u32 input, u32 addr)
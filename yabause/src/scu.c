@@ -40,6 +40,14 @@
 #include <stdarg.h>
 #include "scu_dsp_jit.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SCU_DMA_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define SCU_DMA_NEON
+#endif
+
 #ifdef OPTIMIZED_DMA
 # include "cs2.h"
 # include "scsp.h"
@@ -137,64 +145,160 @@ void ScuReset(void) {
 
 //////////////////////////////////////////////////////////////////////////////
 
-#ifdef OPTIMIZED_DMA
+// Memory a DMA can copy into or out of in one block. VDP1 and VDP2 RAM are
+// kept in Saturn byte order (T1), work RAM and color RAM as host 16-bit
+// words (T2). Sound RAM is left to the slow path since its mirroring depends
+// on the SCSP MEM4MB setting.
+#define DMA_SPAN_WRAM 0
+#define DMA_SPAN_VDP1 1
+#define DMA_SPAN_VDP2 2
+#define DMA_SPAN_CRAM 3
+
+typedef struct
+{
+   u8 * ptr;
+   int type;
+} DMASpan;
+
+static int DMAMemorySpan(u32 address, u32 size, DMASpan * span) {
+   u8 * base;
+   u32 mask;
+
+   address &= 0x1FFFFFFF;
+
+   if ((address & 0x1FF00000) == 0x00200000)
+   {
+      base = LowWram;
+      mask = 0xFFFFF;
+      span->type = DMA_SPAN_WRAM;
+   }
+   else if ((address & 0x1E000000) == 0x06000000)
+   {
+      base = HighWram;
+      mask = 0xFFFFF;
+      span->type = DMA_SPAN_WRAM;
+   }
+   else if ((address & 0x1FF80000) == 0x05C00000)
+   {
+      base = Vdp1Ram;
+      mask = 0x7FFFF;
+      span->type = DMA_SPAN_VDP1;
+   }
+   else if ((address & 0x1FF00000) == 0x05E00000)
+   {
+      base = Vdp2Ram;
+      mask = 0x7FFFF;
+      span->type = DMA_SPAN_VDP2;
+   }
+   else if ((address & 0x1FF80000) == 0x05F00000)
+   {
+      base = Vdp2ColorRam;
+      mask = 0xFFF;
+      span->type = DMA_SPAN_CRAM;
+   }
+   else
+      return 0;
+
+   // wrapping around a mirror is left to the slow path
+   if ((address & mask) + size > mask + 1)
+      return 0;
+
+   span->ptr = base + (address & mask);
+   return 1;
+}
+
+//////////////////////////////////////////////////////////////////////////////
 
-// Table of memory types for DMA optimization, in 512k (1<<19 byte) units:
-//    0x00 = no special handling
-//    0x12 = VDP1/2 RAM (8-bit organized, 16-bit copy unit)
-//    0x22 = M68K RAM (16-bit organized, 16-bit copy unit)
-//    0x23 = VDP2 color RAM (16-bit organized, 16-bit copy unit)
-//    0x24 = SH-2 RAM (16-bit organized, 32-bit copy unit)
-static const u8 DMAMemoryType[0x20000000>>19] = {
-   [0x00200000>>19] = 0x24,
-   [0x00280000>>19] = 0x24,
-   [0x05A00000>>19] = 0x22,
-   [0x05A80000>>19] = 0x22,
-   [0x05C00000>>19] = 0x12,
-   [0x05C00000>>19] = 0x12,
-   [0x05E00000>>19] = 0x12,
-   [0x05E80000>>19] = 0x12,
-   [0x05F00000>>19] = 0x23,
-   [0x06000000>>19] = 0x24, 0x24, 0x24, 0x24, 0x24, 0x24, 0x24, 0x24,
-                      0x24, 0x24, 0x24, 0x24, 0x24, 0x24, 0x24, 0x24,
-                      0x24, 0x24, 0x24, 0x24, 0x24, 0x24, 0x24, 0x24,
-                      0x24, 0x24, 0x24, 0x24, 0x24, 0x24, 0x24, 0x24,
-                      0x24, 0x24, 0x24, 0x24, 0x24, 0x24, 0x24, 0x24,
-                      0x24, 0x24, 0x24, 0x24, 0x24, 0x24, 0x24, 0x24,
-                      0x24, 0x24, 0x24, 0x24, 0x24, 0x24, 0x24, 0x24,
-                      0x24, 0x24, 0x24, 0x24, 0x24, 0x24, 0x24, 0x24,
-};
-
-// Function to return the native pointer for an optimized address
-#ifdef __GNUC__
-__attribute__((always_inline))  // Force it inline for better performance
+// Copies between T1 and T2 memory, which swaps the bytes of every word on
+// little endian hosts. size is a multiple of 2.
+static void DMACopySwap16(u8 * dst, const u8 * src, u32 size) {
+   u32 i = 0;
+
+#ifdef SCU_DMA_SSE2
+   for (; i + 16 <= size; i += 16)
+   {
+      __m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+      _mm_storeu_si128((__m128i *)(dst + i), _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8)));
+   }
+#elif defined(SCU_DMA_NEON)
+   for (; i + 16 <= size; i += 16)
+      vst1q_u8(dst + i, vrev16q_u8(vld1q_u8(src + i)));
 #endif
-static INLINE void *DMAMemoryPointer(u32 address) {
-   u32 page = (address & 0x1FF80000) >> 19;
-   switch (DMAMemoryType[page]) {
-      case 0x12:
-         switch (page) {
-            case 0x05C00000>>19: return &Vdp1Ram[address & 0x7FFFF];
-            case 0x05E00000>>19: // fall through
-            case 0x05E80000>>19: return &Vdp2Ram[address & 0x7FFFF];
-            default: return NULL;
-         }
-      case 0x22:
-         return &SoundRam[address & 0x7FFFF];
-      case 0x23:
-         return &Vdp2ColorRam[address & 0xFFF];
-      case 0x24:
-         if (page == 0x00200000>>19) {
-            return &LowWram[address & 0xFFFFF];
-         } else {
-            return &HighWram[address & 0xFFFFF];
-         }
-      default:
-         return NULL;
+
+   for (; i < size; i += 2)
+      *(u16 *)(dst + i) = BSWAP16L(*(const u16 *)(src + i));
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+// Flags every page of a direct write to work RAM for the rewind buffer and
+// the recompilers, then tells the SH2 cores about it
+static void DMAWramWritten(u32 WriteAddress, u32 size) {
+   u32 addr;
+
+   for (addr = WriteAddress & ~((1 << RAM_DIRTY_PAGE_SHIFT) - 1); addr < WriteAddress + size; addr += 1 << RAM_DIRTY_PAGE_SHIFT)
+      SH2WramWritten(addr);
+   SH2WriteNotify(WriteAddress, size);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+// Copies a DMA whose source and destination are both host memory in one go
+// and reports the written range once. Returns 0 when the transfer has to go
+// through the bus handlers one word at a time.
+static int DMABulkCopy(u32 ReadAddress, u32 WriteAddress,
+                       unsigned int WriteAdd, u32 TransferSize) {
+   DMASpan src, dst;
+   u32 unit, size;
+
+   // B-Bus destinations are written 16 bits at a time, the rest 32 bits
+   if ((WriteAddress & 0x1FFFFFFF) >= 0x5A00000
+       && (WriteAddress & 0x1FFFFFFF) < 0x5FF0000)
+      unit = 2;
+   else
+      unit = 4;
+   size = (TransferSize + unit - 1) & ~(unit - 1);
+
+   // only transfers that write every byte of the destination qualify
+   if (WriteAdd != unit || size == 0 || ((ReadAddress | WriteAddress) & 1))
+      return 0;
+
+   if (!DMAMemorySpan(ReadAddress, size, &src) || !DMAMemorySpan(WriteAddress, size, &dst))
+      return 0;
+
+   // an overlapping copy depends on the order words are moved in
+   if (dst.ptr < src.ptr + size && src.ptr < dst.ptr + size)
+      return 0;
+
+#ifndef WORDS_BIGENDIAN
+   if ((src.type == DMA_SPAN_VDP1 || src.type == DMA_SPAN_VDP2) !=
+       (dst.type == DMA_SPAN_VDP1 || dst.type == DMA_SPAN_VDP2))
+      DMACopySwap16(dst.ptr, src.ptr, size);
+   else
+#endif
+      memcpy(dst.ptr, src.ptr, size);
+
+   switch (dst.type)
+   {
+      case DMA_SPAN_WRAM:
+         DMAWramWritten(WriteAddress, size);
+         break;
+      case DMA_SPAN_VDP1:
+         Vdp1RamMarkDirty(WriteAddress, size);
+         break;
+      case DMA_SPAN_VDP2:
+         Vdp2RamMarkDirty(WriteAddress, size);
+         break;
+      case DMA_SPAN_CRAM:
+         Vdp2ColorRamSerial = Vdp2WriteSerial;
+         Vdp2ColorRamUpdateColors();
+         break;
    }
+
+   return 1;
 }
 
-#endif  // OPTIMIZED_DMA
+//////////////////////////////////////////////////////////////////////////////
 
 static void DoDMA(u32 ReadAddress, unsigned int ReadAdd,
                   u32 WriteAddress, unsigned int WriteAdd,
@@ -209,12 +313,12 @@ static void DoDMA(u32 ReadAddress, unsigned int ReadAdd,
          // Reading from the CD buffer, so optimize if possible.
          if ((WriteAddress & 0x1E000000) == 0x06000000) {
             Cs2RapidCopyT2(&HighWram[WriteAddress & 0xFFFFF], TransferSize/4);
-            SH2WriteNotify(WriteAddress, TransferSize);
+            DMAWramWritten(WriteAddress, TransferSize);
             return;
          }
          else if ((WriteAddress & 0x1FF00000) == 0x00200000) {
             Cs2RapidCopyT2(&LowWram[WriteAddress & 0xFFFFF], TransferSize/4);
-            SH2WriteNotify(WriteAddress, TransferSize);
+            DMAWramWritten(WriteAddress, TransferSize);
             return;
          }
       }
@@ -292,91 +396,8 @@ static void DoDMA(u32 ReadAddress, unsigned int ReadAdd,
    else {
       // DMA copy
 
-#ifdef OPTIMIZED_DMA
-      int source_type = DMAMemoryType[(ReadAddress  & 0x1FF80000) >> 19];
-      int dest_type   = DMAMemoryType[(WriteAddress & 0x1FF80000) >> 19];
-      if (WriteAdd == ((dest_type & 0x2) ? 2 : 4)) {
-         // Writes don't skip any bytes, so use an optimized copy algorithm
-         // if possible.
-         const u8 *source_ptr = DMAMemoryPointer(ReadAddress);
-         u8 *dest_ptr = DMAMemoryPointer(WriteAddress);
-# ifdef WORDS_BIGENDIAN
-         if ((source_type & 0x30) && (dest_type & 0x30)) {
-            // Source and destination are both directly accessible.
-            memcpy(dest_ptr, source_ptr, TransferSize);
-            if (dest_type == 0x24) {
-               SH2WriteNotify(WriteAddress, TransferSize);
-            } else if (dest_type == 0x22) {
-               M68KWriteNotify(WriteAddress & 0x7FFFF, TransferSize);
-            }
-            return;
-         }
-# else  // !WORDS_BIGENDIAN
-         if (source_type & dest_type & 0x10) {
-            // Source and destination are both 8-bit organized.
-            memcpy(dest_ptr, source_ptr, TransferSize);
-            return;
-         }
-         else if (source_type & dest_type & 0x20) {
-            // Source and destination are both 16-bit organized.
-            memcpy(dest_ptr, source_ptr, TransferSize);
-            if (dest_type == 0x24) {
-               SH2WriteNotify(WriteAddress, TransferSize);
-            } else if (dest_type == 0x22) {
-               M68KWriteNotify(WriteAddress & 0x7FFFF, TransferSize);
-            }
-            return;
-         }
-         else if ((source_type | dest_type) >> 4 == 0x3) {
-            // Need to convert between 8-bit and 16-bit organization.
-            if ((ReadAddress | WriteAddress) & 2) {  // Avoid misaligned access
-               const u16 *source_16 = (u16 *)source_ptr;
-               u16 *dest_16 = (u16 *)dest_ptr;
-               u32 counter;
-               for (counter = 0; counter < TransferSize-6;
-                     counter += 8, source_16 += 4, dest_16 += 4) {
-                  // Use "unsigned int" rather than "u16" because some
-                  // compilers try too hard to keep the high bits zero,
-                  // thus wasting cycles on every iteration.
-                  unsigned int val0 = BSWAP16(source_16[0]);
-                  unsigned int val1 = BSWAP16(source_16[1]);
-                  unsigned int val2 = BSWAP16(source_16[2]);
-                  unsigned int val3 = BSWAP16(source_16[3]);
-                  dest_16[0] = val0;
-                  dest_16[1] = val1;
-                  dest_16[2] = val2;
-                  dest_16[3] = val3;
-               }
-               for (; counter < TransferSize;
-                     counter += 2, source_16++, dest_16++) {
-                  *dest_16 = BSWAP16(*source_16);
-               }
-            }
-            else {  // 32-bit aligned accesses possible
-               const u32 *source_32 = (u32 *)source_ptr;
-               u32 *dest_32 = (u32 *)dest_ptr;
-               u32 counter;
-               for (counter = 0; counter < TransferSize-12;
-                     counter += 16, source_32 += 4, dest_32 += 4) {
-                  u32 val0 = BSWAP16(source_32[0]);
-                  u32 val1 = BSWAP16(source_32[1]);
-                  u32 val2 = BSWAP16(source_32[2]);
-                  u32 val3 = BSWAP16(source_32[3]);
-                  dest_32[0] = val0;
-                  dest_32[1] = val1;
-                  dest_32[2] = val2;
-                  dest_32[3] = val3;
-               }
-               for (; counter < TransferSize;
-                     counter += 4, source_32++, dest_32++) {
-                  *dest_32 = BSWAP16(*source_32);
-               }
-            }
-            return;
-         }
-# endif  // WORDS_BIGENDIAN
-      }
-#endif  // OPTIMIZED_DMA
+      if (DMABulkCopy(ReadAddress, WriteAddress, WriteAdd, TransferSize))
+         return;
 
       if ((WriteAddress & 0x1FFFFFFF) >= 0x5A00000
           && (WriteAddress & 0x1FFFFFFF) < 0x5FF0000) {
@@ -4124,7 +4145,7 @@ void ScuSendExternalInterrupt15(void) {
 
 //////////////////////////////////////////////////////////////////////////////
 
-int ScuSaveState(FILE *fp)
+int ScuSaveState(ystream_struct *fp)
 {
    int offset;
    IOCheck_struct check = { 0, 0 };
@@ -4142,7 +4163,7 @@ int ScuSaveState(FILE *fp)
 
 //////////////////////////////////////////////////////////////////////////////
 
-int ScuLoadState(FILE *fp, UNUSED int version, int size)
+int ScuLoadState(ystream_struct *fp, UNUSED int version, int size)
 {
    IOCheck_struct check = { 0, 0 };
 
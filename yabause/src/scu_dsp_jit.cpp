@@ -22,6 +22,7 @@ extern "C"
 #include "scu.h"
 #include "scu_dsp_jit.h"
 #include "sh2core.h"
+#include "jitprof.h"
 }
 
 #include "MemStream.h"
@@ -1381,6 +1382,7 @@ void scu_dsp_jit_exec(u32 cycles)
          if (!scu_blocks[i].dirty)
             continue;
 
+         u64 compile_start = JitProfStart();
          Framework::CMemStream stream;
          stream.Seek(0, Framework::STREAM_SEEK_DIRECTION::STREAM_SEEK_SET);
          jit.SetStream(&stream);
@@ -1390,6 +1392,8 @@ void scu_dsp_jit_exec(u32 cycles)
 
          scu_blocks[i].function = CMemoryFunction(stream.GetBuffer(), stream.GetSize());
          scu_blocks[i].dirty = 0;
+         JitProfCode(JITPROF_SCUDSP, compile_start, i,
+            scu_blocks[i].function.GetCode(), (u32)scu_blocks[i].function.GetSize());
       }
       cxt.need_recompile = 0;
    }
@@ -1406,6 +1410,9 @@ void scu_dsp_jit_exec(u32 cycles)
 
 extern "C" void scu_dsp_jit_set_program(u32 val)
 {
+   if (!scu_blocks[cxt.pc].dirty && !scu_blocks[cxt.pc].function.IsEmpty())
+      JitProfInvalidate(JITPROF_SCUDSP, cxt.pc);
+
    cxt.need_recompile = 1;
    scu_blocks[cxt.pc].dirty = 1;
 
@@ -59,6 +59,7 @@
 #include "../vdp2.h"
 #include "../cdbase.h"
 #include "../peripheral.h"
+#include "../jitprof.h"
 
 #define WINDOW_WIDTH 600
 #define WINDOW_HEIGHT 600
@@ -81,6 +82,7 @@ NULL
 SH2Interface_struct *SH2CoreList[] = {
 &SH2Interpreter,
 &SH2DebugInterpreter,
+&SH2BlockInterpreter,
 #ifdef TEST_PSP_SH2
 &SH2PSP,
 #endif
@@ -151,6 +153,7 @@ int fbo_buf_height = -1;
 
 static int resizeFilter = GL_NEAREST;
 static int fullscreen = 0;
+static int jitprofflags = 0;
 
 static char biospath[256] = "\0";
 static char cdpath[256] = "\0";
@@ -625,6 +628,13 @@ int main(int argc, char *argv[]) {
          else if (strstr(argv[i], "--vsyncoff")) {
               frameskip = 0;
          }
+         // Name recompiled code for perf
+         else if (strcmp(argv[i], "--jit-perf-map") == 0) {
+            jitprofflags |= JITPROF_STATS | JITPROF_PERF_MAP;
+         }
+         else if (strcmp(argv[i], "--jit-dump") == 0) {
+            jitprofflags |= JITPROF_STATS | JITPROF_JITDUMP;
+         }
 	 // Binary
 	 else if (strstr(argv[i], "--binary=")) {
 	    char binname[1024];
@@ -653,6 +663,9 @@ int main(int argc, char *argv[]) {
 
 	YabauseDeInit();
 
+        if (jitprofflags && JitProfEnable(jitprofflags) != 0)
+            fprintf(stderr, "Couldn't open the recompiler symbol files\n");
+
         if (YabauseInit(&yinit) != 0) printf("YabauseInit error \n\r");
 
 
@@ -674,6 +687,9 @@ int main(int argc, char *argv[]) {
 	        PERCore->HandleEvents();
 	}
 
+	if (JitProfFlags)
+		JitProfPrint();
+
 	YabauseDeInit();
 	LogStop();
 	SDL_Quit();
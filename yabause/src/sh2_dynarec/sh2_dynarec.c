@@ -29,6 +29,7 @@
 #include "../memory.h"
 #include "../sh2core.h"
 #include "../yabause.h"
+#include "../jitprof.h"
 #include "sh2_dynarec.h"
 
 #ifdef __i386__
@@ -940,6 +941,8 @@ void invalidate_blocks(u32 firstblock,u32 lastblock)
   #endif
   
   for(block=firstblock;block<=lastblock;block++) {
+    // Compiled code is shared by both SH2s, count it against the master
+    if((cached_code[block>>3]>>(block&7))&1) JitProfInvalidate(JITPROF_MSH2,block<<12);
     // Don't trap writes
     cached_code[block>>3]&=~(1<<(block&7));
     cached_code[(block^0x20000)>>3]&=~(1<<(block&7));
@@ -5335,6 +5338,7 @@ int sh2_recompile_block(int addr)
   u32 p_constmap[SH2_REGS];
   u32 p_isconst=0;
   int cached_addr;
+  u64 compile_start=JitProfStart();
 
   //if(Count==365117028) tracedebug=1;
   assem_debug("NOTCOMPILED: addr = %x -> %x\n", (int)addr, (int)out);
@@ -8083,6 +8087,8 @@ int sh2_recompile_block(int addr)
   __clear_cache((void *)beginning,out);
   #endif
   
+  JitProfCode(slave?JITPROF_SSH2:JITPROF_MSH2,compile_start,start,(void *)beginning,(pointer)out-beginning);
+  
   // If we're within 256K of the end of the buffer,
   // start over from the beginning. (Is 256K enough?)
   if((int)out>BASE_ADDR+(1<<TARGET_SIZE_2)-MAX_OUTPUT_BLOCK_SIZE-JUMP_TABLE_SIZE) out=(u8 *)BASE_ADDR;
@@ -35,6 +35,7 @@ extern "C"
 #include "sh2_jit.h"
 #include "assert.h"
 #include "sh2int.h"
+#include "jitprof.h"
 
 #ifdef SH2_TRACE
 #include "sh2trace.h"
@@ -43,9 +44,9 @@ extern "C"
       SH2CORE_JIT,
       "SH Jit",
 
-      SH2InterpreterInit,
-      SH2InterpreterDeInit,
-      SH2InterpreterReset,
+      SH2JitInit,
+      SH2JitDeInit,
+      SH2JitReset,
       SH2JitExec,
 
       SH2JitGetRegisters,
@@ -72,7 +73,7 @@ extern "C"
       SH2InterpreterGetInterrupts,
       SH2InterpreterSetInterrupts,
 
-      NULL  // SH2WriteNotify not used
+      SH2JitWriteNotify
    };
 }
 
@@ -81,8 +82,10 @@ extern "C"
 #define SR_Q 0x00000100
 #define SR_M 0x00000200
 
-#define SH1_ROM_SIZE 0x10000
-#define MAX_SH1_BLOCKS (SH1_ROM_SIZE / 2)
+// Longest run of instructions compiled into a single block. Keeping blocks
+// short means a block can only ever spill over into the next page.
+#define MAX_BLOCK_INSTRUCTIONS 64
+#define JIT_BLOCKS_PER_PAGE ((1 << SH2_CODE_PAGE_SHIFT) / 2)
 
 #include "MemStream.h"
 #include "MemoryFunction.h"
@@ -96,7 +99,22 @@ struct ShCodeBlock
    CMemoryFunction function;
    u32 start_pc;
    u32 end_pc;
-}code_blocks[MAX_SH1_BLOCKS];
+   // PC the code was compiled at. The PCs it sets are absolute, so entering
+   // through a mirror or the other cache area needs a recompile.
+   u32 entry_pc;
+   // Most recently seen successors, keyed on the PC the block exited with
+   u32 link_pc[2];
+   ShCodeBlock *link[2];
+};
+
+struct ShCodePage
+{
+   ShCodeBlock blocks[JIT_BLOCKS_PER_PAGE];
+};
+
+// Sparse block map, one for the SH-1 and one shared by the master and slave
+// SH-2. Pages are only allocated once code is compiled in them.
+static ShCodePage *code_pages[2][SH2_CODE_NUM_PAGES];
 
 static Jitter::CJitter jit(Jitter::CreateCodeGen());
 
@@ -105,10 +123,7 @@ u32 basic_block = 0;
 typedef void (FASTCALL *jit_opcode_func)(u16 instruction, u32 recompile_addr);
 static jit_opcode_func decode(enum SHMODELTYPE model, u16 instruction);
 
-static void FASTCALL SH2undecoded(u16 instruction, u32 recompile_addr)
-{
-   assert(0);
-}
+SH2_struct *current;
 
 static void add_cycles(u32 cycles_to_add)
 {
@@ -117,8 +132,11 @@ static void add_cycles(u32 cycles_to_add)
    jit.Add();
    jit.PullRel(offsetof(Sh2JitContext, cycles));
 
-   jit.PushCst(cycles_to_add);
-   jit.Call(reinterpret_cast<void*>(&sh1_dma_exec), 1, Jitter::CJitter::RETURN_VALUE_NONE);
+   if (current->model == SHMT_SH1)
+   {
+      jit.PushCst(cycles_to_add);
+      jit.Call(reinterpret_cast<void*>(&sh1_dma_exec), 1, Jitter::CJitter::RETURN_VALUE_NONE);
+   }
 }
 
 static void increment_pc()
@@ -129,43 +147,79 @@ static void increment_pc()
    jit.PullRel(offsetof(Sh2JitContext, pc));
 }
 
-SH2_struct *current;
-
 void mapped_memory_write_byte(u32 addr, u32 data)
 {
-   current->MappedMemoryWriteByte(current, addr, data);
+   SH2MappedMemoryWriteByte(current, addr, data);
 }
 
 void mapped_memory_write_word(u32 addr, u32 data)
 {
-   current->MappedMemoryWriteWord(current, addr, data);
+   SH2MappedMemoryWriteWord(current, addr, data);
 }
 
 void mapped_memory_write_long(u32 addr, u32 data)
 {
-   current->MappedMemoryWriteLong(current, addr, data);
+   SH2MappedMemoryWriteLong(current, addr, data);
 }
 
 u32 mapped_memory_read_byte(u32 addr)
 {
-   u8 val = current->MappedMemoryReadByte(current, addr);
+   u8 val = SH2MappedMemoryReadByte(current, addr);
    return val;
 }
 
 u32 mapped_memory_read_word(u32 addr)
 {
-   u16 val = current->MappedMemoryReadWord(current, addr);
+   u16 val = SH2MappedMemoryReadWord(current, addr);
    return val;
 }
 
 u32 mapped_memory_read_long(u32 addr)
 {
-   u32 val = current->MappedMemoryReadLong(current, addr);
+   u32 val = SH2MappedMemoryReadLong(current, addr);
    return val;
 }
 
 //////////////////////////////////////////////////////////////////////////////
 
+// Runs a single instruction through the interpreter's opcode table. Used for
+// the instructions that aren't recompiled yet and for the BIOS hooks.
+void interpret_instruction(u32 instruction)
+{
+   SH2_struct *context = current;
+   u32 cycles_before = context->cycles;
+   u32 cycles_spent;
+
+   SH2JitGetRegisters(context, &context->regs);
+   context->instruction = instruction;
+   ((opcodefunc *)context->opcodes)[instruction](context);
+   SH2JitSetRegisters(context, &context->regs);
+
+   cycles_spent = context->cycles - cycles_before;
+   context->cycles = cycles_before;
+   context->jit.cycles += cycles_spent;
+
+   if (context->model == SHMT_SH1)
+      sh1_dma_exec(cycles_spent);
+}
+
+static void interpret_fallback(u16 instruction)
+{
+   jit.PushCst(instruction);
+   jit.Call(reinterpret_cast<void*>(&interpret_instruction), 1, Jitter::CJitter::RETURN_VALUE_NONE);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void FASTCALL SH2undecoded(u16 instruction, u32 recompile_addr)
+{
+   // The BIOS emulation hooks live here and are free to change the PC
+   interpret_fallback(instruction);
+   basic_block = 1;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
 //0 format
 //div0u, rts, clrt, clrmac, nop, rte, sett, sleep
 static void FASTCALL SH2div0u(u16 instruction, u32 recompile_addr)
@@ -182,7 +236,7 @@ void recompile_sh2_instruction(u32 recompile_addr)
 {
    u16 instruction = ((fetchfunc *)current->fetchlist)[(recompile_addr >> 20) & 0x0FF](current, recompile_addr);
 
-   jit_opcode_func func = decode(SHMT_SH1, instruction);
+   jit_opcode_func func = decode(current->model, instruction);
 
    func(instruction, recompile_addr);
 }
@@ -289,10 +343,12 @@ static void FASTCALL SH2sett(u16 instruction, u32 recompile_addr)
    add_cycles(1);
 }
 
-//needs special handling probably
 static void FASTCALL SH2sleep(u16 instruction, u32 recompile_addr)
 {
    add_cycles(3);
+
+   // PC doesn't advance, so return to the dispatcher to let interrupts in
+   basic_block = 1;
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -1587,22 +1643,22 @@ static void FASTCALL SH2cmpstr(u16 instruction, u32 recompile_addr)
 
 static void FASTCALL SH2div1(u16 instruction, u32 recompile_addr)
 {
-   assert(0);
+   interpret_fallback(instruction);
 }
 
 static void FASTCALL SH2div0s(u16 instruction, u32 recompile_addr)
 {
-   assert(0);
+   interpret_fallback(instruction);
 }
 
 static void FASTCALL SH2dmuls(u16 instruction, u32 recompile_addr)
 {
-   assert(0);
+   interpret_fallback(instruction);
 }
 
 static void FASTCALL SH2dmulu(u16 instruction, u32 recompile_addr)
 {
-   assert(0);
+   interpret_fallback(instruction);
 }
 
 static void FASTCALL SH2ext(u16 instruction, u32 is_unsigned, u32 is_word)
@@ -1657,22 +1713,22 @@ static void FASTCALL SH2extuw(u16 instruction, u32 recompile_addr)
 
 static void FASTCALL SH2macw(u16 instruction, u32 recompile_addr)
 {
-   assert(0);
+   interpret_fallback(instruction);
 }
 
 static void FASTCALL SH2macl(u16 instruction, u32 recompile_addr)
 {
-   assert(0);
+   interpret_fallback(instruction);
 }
 
 static void FASTCALL SH2mull(u16 instruction, u32 recompile_addr)
 {
-   assert(0);
+   interpret_fallback(instruction);
 }
 
 static void FASTCALL SH2muls(u16 instruction, u32 recompile_addr)
 {
-   assert(0);
+   interpret_fallback(instruction);
 }
 
 static void FASTCALL SH2mulu(u16 instruction, u32 recompile_addr)
@@ -2734,53 +2790,280 @@ static INLINE void SH2HandleInterrupts(SH2_struct *context)
    }
 }
 
-void recompile_and_exec(SH2_struct *context)
+//////////////////////////////////////////////////////////////////////////////
+
+// SH-1 code is only compiled from ROM, everything else is interpreted
+static u32 jit_block_address(SH2_struct *context, u32 pc)
+{
+   if (context->model == SHMT_SH1)
+      return (pc & 0xFFF00000) == 0 ? pc : 0xFFFFFFFF;
+
+   return SH2FoldCodeAddress(pc);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static ShCodeBlock *get_code_block(SH2_struct *context, u32 addr)
+{
+   ShCodePage **page = &code_pages[context->model == SHMT_SH1][addr >> SH2_CODE_PAGE_SHIFT];
+
+   if (*page == NULL)
+      *page = new ShCodePage();
+
+   return &(*page)->blocks[(addr & ((1 << SH2_CODE_PAGE_SHIFT) - 1)) >> 1];
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void recompile_block(SH2_struct *context, ShCodeBlock *block, u32 addr)
 {
-   assert((context->jit.pc & 0xfff00000) == 0);
+   Framework::CMemStream stream;
+   u32 current_pc = context->jit.pc;
+   int count = 0;
+   Jitter::CJitter::LABEL block_start;
+   u64 compile_start = JitProfStart();
+
+   stream.Seek(0, Framework::STREAM_SEEK_DIRECTION::STREAM_SEEK_SET);
+   jit.SetStream(&stream);
+   jit.Begin();
+   block_start = jit.CreateLabel();
+   jit.MarkLabel(block_start);
+   basic_block = 0;
 
-   if (code_blocks[context->jit.pc / 2].function.IsEmpty())
+   for (;;)
    {
-      Framework::CMemStream stream;
-      stream.Seek(0, Framework::STREAM_SEEK_DIRECTION::STREAM_SEEK_SET);
-      jit.SetStream(&stream);
-      jit.Begin();
-      basic_block = 0;
-      u32 current_pc = context->jit.pc;
-      code_blocks[context->jit.pc / 2].start_pc = current_pc;
-      for (;;)
+      u16 instr = context->instruction = ((fetchfunc *)context->fetchlist)[(current_pc >> 20) & 0x0FF](context, current_pc);
+      jit_opcode_func func = decode(context->model, instr);
+
+      func(instr, current_pc);
+
+      count++;
+
+      if (basic_block)
+         break;
+
+      // Blocks never run past the end of a page (other than a delay slot),
+      // the handler has already moved the PC on to the next instruction
+      if (count >= MAX_BLOCK_INSTRUCTIONS || ((current_pc + 2) & ((1 << SH2_CODE_PAGE_SHIFT) - 1)) == 0)
+         break;
+
+      current_pc += 2;
+   }
+
+   // Polling loops branch straight back to the start of their own block,
+   // keep going without returning to the dispatcher while cycles remain
+   jit.PushRel(offsetof(Sh2JitContext, pc));
+   jit.PushCst(context->jit.pc);
+   jit.BeginIf(Jitter::CONDITION_EQ);
+   {
+      jit.PushRel(offsetof(Sh2JitContext, cycles));
+      jit.PushRel(offsetof(Sh2JitContext, cycle_budget));
+      jit.BeginIf(Jitter::CONDITION_LT);
       {
-         u16 instr = context->instruction = ((fetchfunc *)context->fetchlist)[(current_pc >> 20) & 0x0FF](context, current_pc);
-         jit_opcode_func func = decode(SHMT_SH1, instr);
+         jit.Goto(block_start);
+      }
+      jit.EndIf();
+   }
+   jit.EndIf();
+
+   jit.End();
 
-         func(instr, current_pc);
+   block->function = CMemoryFunction(stream.GetBuffer(), stream.GetSize());
+   block->start_pc = addr;
+   block->entry_pc = context->jit.pc;
+   // Covers a possible delay slot
+   block->end_pc = addr + (current_pc - context->jit.pc) + 4;
+   block->dirty = 0;
+   block->link[0] = block->link[1] = NULL;
 
-         if (basic_block)
-            break;
+   JitProfCode(context->model == SHMT_SH1 ? JITPROF_SH1 : context == SSH2 ? JITPROF_SSH2 : JITPROF_MSH2,
+      compile_start, addr, block->function.GetCode(), (u32)block->function.GetSize());
+
+   if (context->model != SHMT_SH1)
+   {
+      SH2CodePages[block->start_pc >> SH2_CODE_PAGE_SHIFT] = 1;
+      SH2CodePages[(block->end_pc - 1) >> SH2_CODE_PAGE_SHIFT] = 1;
+   }
+}
+
+//////////////////////////////////////////////////////////////////////////////
 
-         current_pc += 2;
+static INLINE ShCodeBlock *find_link(ShCodeBlock *prev, u32 pc)
+{
+   int i;
+
+   if (prev == NULL)
+      return NULL;
+
+   // A link to a dirty block is treated as unlinked until it is recompiled,
+   // and so is one that has since been compiled for another alias of pc
+   for (i = 0; i < 2; i++)
+   {
+      if (prev->link[i] && prev->link_pc[i] == pc && !prev->link[i]->dirty &&
+          prev->link[i]->entry_pc == pc)
+         return prev->link[i];
+   }
+
+   return NULL;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+ShCodeBlock *recompile_and_exec(SH2_struct *context, ShCodeBlock *prev)
+{
+   u32 pc = context->jit.pc;
+   ShCodeBlock *block = find_link(prev, pc);
+
+   if (block == NULL)
+   {
+      u32 addr = jit_block_address(context, pc);
+
+      if (addr == 0xFFFFFFFF)
+      {
+         interpret_instruction(((fetchfunc *)context->fetchlist)[(pc >> 20) & 0x0FF](context, pc));
+         return NULL;
       }
 
-      jit.End();
+      block = get_code_block(context, addr);
 
-      code_blocks[context->jit.pc / 2].function = CMemoryFunction(stream.GetBuffer(), stream.GetSize());
-      code_blocks[context->jit.pc / 2].end_pc = current_pc;
+      if (block->function.IsEmpty() || block->dirty || block->entry_pc != pc)
+         recompile_block(context, block, addr);
 
+      if (prev)
+      {
+         prev->link_pc[1] = prev->link_pc[0];
+         prev->link[1] = prev->link[0];
+         prev->link_pc[0] = pc;
+         prev->link[0] = block;
+      }
    }
 
-   code_blocks[context->jit.pc / 2].function(&context->jit);
+   block->function(&context->jit);
+
+   return block;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void invalidate_blocks(ShCodePage *page, u32 start, u32 end)
+{
+   if (page == NULL)
+      return;
+
+   for (int i = 0; i < JIT_BLOCKS_PER_PAGE; i++)
+   {
+      ShCodeBlock *block = &page->blocks[i];
+
+      // Compiled code is freed on the next dispatch, the block writing to
+      // itself may still be running
+      if (!block->function.IsEmpty() && block->start_pc < end && block->end_pc > start)
+         block->dirty = 1;
+   }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void invalidate_page(u32 page)
+{
+   u32 start = page << SH2_CODE_PAGE_SHIFT;
+   u32 end = start + (1 << SH2_CODE_PAGE_SHIFT);
+
+   invalidate_blocks(code_pages[0][page], start, end);
+
+   // A block at the end of the previous page can spill into this one
+   if (page > 0)
+      invalidate_blocks(code_pages[0][page - 1], start, end);
+
+   // Both SH2s share the block map, its churn is counted against the master
+   JitProfInvalidate(JITPROF_MSH2, start);
+
+   SH2CodePages[page] = 0;
 }
 
 extern "C"
 {
+   int SH2JitInit(enum SHMODELTYPE model, SH2_struct *msh, SH2_struct *ssh)
+   {
+      int ret = SH2InterpreterInit(model, msh, ssh);
+
+      if (model != SHMT_SH1)
+         memset(SH2CodePages, 0, sizeof(SH2CodePages));
+
+      return ret;
+   }
+
+   //////////////////////////////////////////////////////////////////////////////
+
+   void SH2JitDeInit(void)
+   {
+      for (int model = 0; model < 2; model++)
+      {
+         for (u32 i = 0; i < SH2_CODE_NUM_PAGES; i++)
+         {
+            delete code_pages[model][i];
+            code_pages[model][i] = NULL;
+         }
+      }
+
+      memset(SH2CodePages, 0, sizeof(SH2CodePages));
+      SH2InterpreterDeInit();
+   }
+
+   //////////////////////////////////////////////////////////////////////////////
+
+   void SH2JitReset(SH2_struct *context)
+   {
+      int model = context->model == SHMT_SH1;
+
+      // A reset can come from an SMPC command in the middle of a block, so
+      // only flag the code here
+      for (u32 i = 0; i < SH2_CODE_NUM_PAGES; i++)
+      {
+         if (code_pages[model][i])
+            invalidate_blocks(code_pages[model][i], 0, 0xFFFFFFFF);
+      }
+
+      if (!model)
+         memset(SH2CodePages, 0, sizeof(SH2CodePages));
+
+      SH2InterpreterReset(context);
+   }
+
+   //////////////////////////////////////////////////////////////////////////////
+
+   void SH2JitWriteNotify(u32 start, u32 length)
+   {
+      u32 addr;
+
+      if (length == 0)
+         return;
+
+      // Comes from the WRAM write handlers for flagged pages, and from DMA
+      // and loaders for any range
+      for (addr = start & ~((1 << SH2_CODE_PAGE_SHIFT) - 1); addr < start + length; addr += 1 << SH2_CODE_PAGE_SHIFT)
+      {
+         u32 folded = SH2FoldCodeAddress(addr);
+
+         if (folded != 0xFFFFFFFF && SH2CodePages[folded >> SH2_CODE_PAGE_SHIFT])
+            invalidate_page(folded >> SH2_CODE_PAGE_SHIFT);
+      }
+   }
+
+   //////////////////////////////////////////////////////////////////////////////
+
    FASTCALL void SH2JitExec(SH2_struct *context, u32 cycles)
    {
-      SH2HandleInterrupts(context);
+      ShCodeBlock *block = NULL;
 
       current = context;
 
+      SH2HandleInterrupts(context);
+
+      context->jit.cycle_budget = cycles;
+
       while (context->jit.cycles < cycles)
       {
-         recompile_and_exec(context);
+         block = recompile_and_exec(context, block);
       }
 
       if (UNLIKELY(context->jit.cycles < cycles))
@@ -33,6 +33,8 @@ struct Sh2JitContext
    u32 pr;
    u32 pc;
    s32 cycles;
+   // Blocks that loop on themselves keep running until this is reached
+   s32 cycle_budget;
 
    u32 tmp0, tmp1;
 
@@ -69,6 +71,8 @@ int SH2JitGetInterrupts(SH2_struct *context,
 void SH2JitSetInterrupts(SH2_struct *context, int num_interrupts,
                                  const interrupt_struct interrupts[MAX_INTERRUPTS]);
 
+void SH2JitWriteNotify(u32 start, u32 length);
+
 extern SH2Interface_struct SH2Jit;
 
 #endif
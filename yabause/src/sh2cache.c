@@ -27,6 +27,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
 #endif
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/stat.h>
 #include <ctype.h>
 
@@ -70,13 +71,13 @@ void cache_clear(cache_enty * ca){
       for (way = 0; way < 4; way++)
       {
          int i = 0;
-         ca->way[way][entry].tag = 0;
-         
+         ca->tag[entry][way] = 0;
+
          for (i = 0; i < 16; i++)
-            ca->way[way][entry].data[i] = 0;
-         ca->way[way][entry].v = 0;
+            ca->data[entry][way][i] = 0;
       }
 	}
+   cache_invalidate_last_hit(ca);
 	return;
 }
 
@@ -89,6 +90,30 @@ void cache_disable(cache_enty * ca){
 	ca->enable = 0;
 }
 
+//must be called whenever tags or lru are changed outside of a lookup
+void cache_invalidate_last_hit(cache_enty * ca){
+   ca->last_line = 0;
+   ca->last_way = 0;
+}
+
+void cache_load_v1(cache_enty * ca, const cache_enty_v1 * old){
+   int entry = 0;
+   ca->enable = old->enable;
+
+   for (entry = 0; entry < 64; entry++){
+      int way = 0;
+      ca->lru[entry] = old->lru[entry];
+
+      for (way = 0; way < 4; way++)
+      {
+         ca->tag[entry][way] = (old->way[way][entry].tag & TAG_MASK) |
+            (old->way[way][entry].v ? CACHE_TAG_VALID : 0);
+         memcpy(ca->data[entry][way], old->way[way][entry].data, 16);
+      }
+   }
+   cache_invalidate_last_hit(ca);
+}
+
 //lru is updated
 //when cache hit occurs during a read
 //when cache hit occurs during a write
@@ -151,6 +176,68 @@ static INLINE int select_way_to_replace(SH2_struct *sh, u32 lru)
 //delay 0 if the measured cycles are 7 or less, otherwise subtract 7
 #define ADJUST_CYCLES(n) (n <= 7 ? 0 : (n - 7))
 
+void sh2_refill_cache(SH2_struct *sh, cache_enty * ca, int lruway, u32 entry, u32 addr);
+
+//first way set in a 4 bit hit mask, lowest way wins like the sequential checks did
+static const s8 first_hit_way[16] = { -1, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0 };
+
+//returns the way addr hits in or -1 on a miss, lru is updated on a hit
+static INLINE int cache_lookup(cache_enty * ca, u32 addr, u32 entry)
+{
+   const u32 line = (addr & (TAG_MASK | ENTRY_MASK)) | CACHE_TAG_VALID;
+   const u32 key = (addr & TAG_MASK) | CACHE_TAG_VALID;
+   const u32 *tag = ca->tag[entry];
+   int way;
+
+   //repeated hits on the same line leave lru as it is
+   if (ca->last_line == line)
+      return ca->last_way;
+
+   way = first_hit_way[(tag[0] == key) | ((tag[1] == key) << 1) |
+                       ((tag[2] == key) << 2) | ((tag[3] == key) << 3)];
+   if (way >= 0)
+   {
+      update_lru(way, &ca->lru[entry]);
+      ca->last_line = line;
+      ca->last_way = way;
+   }
+   return way;
+}
+
+//cache miss, replaces a way with the line holding addr
+static INLINE u8 *cache_fill(SH2_struct *sh, cache_enty * ca, u32 addr, u32 entry)
+{
+   int lruway = select_way_to_replace(sh, ca->lru[entry]);
+   update_lru(lruway, &ca->lru[entry]);
+   ca->tag[entry][lruway] = addr & TAG_MASK;
+
+   sh2_refill_cache(sh, ca, lruway, entry, addr);
+
+   ca->tag[entry][lruway] |= CACHE_TAG_VALID; //becomes valid
+   ca->last_line = (addr & (TAG_MASK | ENTRY_MASK)) | CACHE_TAG_VALID;
+   ca->last_way = lruway;
+   return ca->data[entry][lruway];
+}
+
+static INLINE u8 *cache_read_line(SH2_struct *sh, cache_enty * ca, u32 addr)
+{
+   u32 entry = (addr & ENTRY_MASK) >> ENTRY_SHIFT;
+   int way = cache_lookup(ca, addr, entry);
+
+   if (way >= 0)
+      return ca->data[entry][way];
+   return cache_fill(sh, ca, addr, entry);
+}
+
+//writes don't allocate, NULL on a miss
+static INLINE u8 *cache_write_line(cache_enty * ca, u32 addr)
+{
+   u32 entry = (addr & ENTRY_MASK) >> ENTRY_SHIFT;
+   int way = cache_lookup(ca, addr, entry);
+
+   return way >= 0 ? ca->data[entry][way] : NULL;
+}
+
 int get_cache_through_timing_read_byte_word(u32 addr)
 {
    addr = (addr >> 16) & 0xFFF;
@@ -327,29 +414,14 @@ void cache_memory_write_b(SH2_struct *sh, cache_enty * ca, u32 addr, u8 val){
 	switch (addr & AREA_MASK){
 	case CACHE_USE:
 	{
-      u32 tagaddr = 0;
-      u32 entry = 0;
+      u8 *line;
 		if (ca->enable == 0){
 			MappedMemoryWriteByteNocache(sh, addr, val);
 			return;
 		}
-		tagaddr = (addr & TAG_MASK);
-		entry = (addr & ENTRY_MASK) >> ENTRY_SHIFT;
-		if (ca->way[0][entry].v && ca->way[0][entry].tag == tagaddr){
-			ca->way[0][entry].data[addr&LINE_MASK] = val;
-         update_lru(0, &ca->lru[entry]);
-		}
-		else if (ca->way[1][entry].v && ca->way[1][entry].tag == tagaddr){
-			ca->way[1][entry].data[addr&LINE_MASK] = val;
-         update_lru(1, &ca->lru[entry]);
-		}
-		else if (ca->way[2][entry].v && ca->way[2][entry].tag == tagaddr){
-			ca->way[2][entry].data[addr&LINE_MASK] = val;
-         update_lru(2, &ca->lru[entry]);
-		}
-		else if (ca->way[3][entry].v && ca->way[3][entry].tag == tagaddr){
-			ca->way[3][entry].data[addr&LINE_MASK] = val;
-         update_lru(3, &ca->lru[entry]);
+		line = cache_write_line(ca, addr);
+		if (line){
+			line[addr&LINE_MASK] = val;
 		}
 		MappedMemoryWriteByteNocache(sh, addr, val);
 	}
@@ -369,34 +441,16 @@ void cache_memory_write_w(SH2_struct *sh, cache_enty * ca, u32 addr, u16 val){
 	switch (addr & AREA_MASK){
 	case CACHE_USE:
 	{
-      u32 tagaddr = 0;
-      u32 entry = 0;
+      u8 *line;
 		if (ca->enable == 0){
 			MappedMemoryWriteWordNocache(sh, addr, val);
 			return;
 		}
 
-		tagaddr = (addr & TAG_MASK);
-		entry = (addr & ENTRY_MASK) >> ENTRY_SHIFT;
-		if (ca->way[0][entry].v && ca->way[0][entry].tag == tagaddr){
-			ca->way[0][entry].data[addr&LINE_MASK] = val >> 8;
-			ca->way[0][entry].data[(addr&LINE_MASK) + 1] = val;
-         update_lru(0, &ca->lru[entry]);
-		}
-		else if (ca->way[1][entry].v && ca->way[1][entry].tag == tagaddr){
-			ca->way[1][entry].data[addr&LINE_MASK] = val >> 8;
-			ca->way[1][entry].data[(addr&LINE_MASK) + 1] = val;
-         update_lru(1, &ca->lru[entry]);
-		}
-		else if (ca->way[2][entry].v && ca->way[2][entry].tag == tagaddr){
-			ca->way[2][entry].data[addr&LINE_MASK] = val >> 8;
-			ca->way[2][entry].data[(addr&LINE_MASK) + 1] = val;
-         update_lru(2, &ca->lru[entry]);
-		}
-		else if (ca->way[3][entry].v && ca->way[3][entry].tag == tagaddr){
-			ca->way[3][entry].data[addr&LINE_MASK] = val >> 8;
-			ca->way[3][entry].data[(addr&LINE_MASK) + 1] = val;
-         update_lru(3, &ca->lru[entry]);
+		line = cache_write_line(ca, addr);
+		if (line){
+			line[addr&LINE_MASK] = val >> 8;
+			line[(addr&LINE_MASK) + 1] = val;
 		}
 
 		// write through
@@ -423,54 +477,30 @@ void cache_memory_write_l(SH2_struct *sh, cache_enty * ca, u32 addr, u32 val){
       u32 entry = (addr & ENTRY_MASK) >> ENTRY_SHIFT;
       for (i = 0; i < 3; i++)
       {
-         if (ca->way[i][entry].tag == tagaddr)
+         if ((ca->tag[entry][i] & TAG_MASK) == tagaddr)
          {
             //only v bit is changed, the rest of the data remains
-            ca->way[i][entry].v = 0;
+            ca->tag[entry][i] &= ~CACHE_TAG_VALID;
             break;
          }
       }
+      cache_invalidate_last_hit(ca);
    }
    break;
 	case CACHE_USE:
 	{
-      u32 tagaddr = 0;
-      u32 entry = 0;
+      u8 *line;
 		if (ca->enable == 0){
 			MappedMemoryWriteLongNocache(sh, addr, val);
 			return;
 		}
 
-		tagaddr = (addr & TAG_MASK);
-		entry = (addr & ENTRY_MASK) >> ENTRY_SHIFT;
-		if (ca->way[0][entry].v && ca->way[0][entry].tag == tagaddr){
-			ca->way[0][entry].data[(addr&LINE_MASK)] = ((val >> 24) & 0xFF);
-			ca->way[0][entry].data[(addr&LINE_MASK) + 1] = ((val >> 16) & 0xFF);
-			ca->way[0][entry].data[(addr&LINE_MASK) + 2] = ((val >> 8) & 0xFF);
-			ca->way[0][entry].data[(addr&LINE_MASK) + 3] = ((val >> 0) & 0xFF);
-         update_lru(0, &ca->lru[entry]);
-		}
-		else if (ca->way[1][entry].v && ca->way[1][entry].tag == tagaddr){
-			ca->way[1][entry].data[(addr&LINE_MASK)] = ((val >> 24) & 0xFF);
-			ca->way[1][entry].data[(addr&LINE_MASK) + 1] = ((val >> 16) & 0xFF);
-			ca->way[1][entry].data[(addr&LINE_MASK) + 2] = ((val >> 8) & 0xFF);
-			ca->way[1][entry].data[(addr&LINE_MASK) + 3] = ((val >> 0) & 0xFF);
-         update_lru(1, &ca->lru[entry]);
-		}
-		else if (ca->way[2][entry].v && ca->way[2][entry].tag == tagaddr){
-			ca->way[2][entry].data[(addr&LINE_MASK)] = ((val >> 24) & 0xFF);
-			ca->way[2][entry].data[(addr&LINE_MASK) + 1] = ((val >> 16) & 0xFF);
-			ca->way[2][entry].data[(addr&LINE_MASK) + 2] = ((val >> 8) & 0xFF);
-			ca->way[2][entry].data[(addr&LINE_MASK) + 3] = ((val >> 0) & 0xFF);
-         update_lru(2, &ca->lru[entry]);
-
-		}
-		else if (ca->way[3][entry].v && ca->way[3][entry].tag == tagaddr){
-			ca->way[3][entry].data[(addr&LINE_MASK)] = ((val >> 24) & 0xFF);
-			ca->way[3][entry].data[(addr&LINE_MASK) + 1] = ((val >> 16) & 0xFF);
-			ca->way[3][entry].data[(addr&LINE_MASK) + 2] = ((val >> 8) & 0xFF);
-			ca->way[3][entry].data[(addr&LINE_MASK) + 3] = ((val >> 0) & 0xFF);
-         update_lru(3, &ca->lru[entry]);
+		line = cache_write_line(ca, addr);
+		if (line){
+			line[(addr&LINE_MASK)] = ((val >> 24) & 0xFF);
+			line[(addr&LINE_MASK) + 1] = ((val >> 16) & 0xFF);
+			line[(addr&LINE_MASK) + 2] = ((val >> 8) & 0xFF);
+			line[(addr&LINE_MASK) + 3] = ((val >> 0) & 0xFF);
 		}
 
 		// write through
@@ -602,16 +632,32 @@ u32 sh2_cache_refill_read(SH2_struct *sh, u32 addr)
 
 void sh2_refill_cache(SH2_struct *sh, cache_enty * ca, int lruway, u32 entry, u32 addr)
 {
+   u8 *line = ca->data[entry][lruway];
+   u8 *page = SH2ReadPage(sh, addr, 0x1);
    int i;
 
    sh->cycles += 4;
+   addr &= 0xFFFFFFF0;
+
+   if (page != NULL)
+   {
+      //ram and rom lines come straight from the host page
+      for (i = 0; i < 16; i += 4) {
+         u32 val = T2ReadLong(page, (addr + i) & 0xFFFF);
+         line[i + 0] = (val >> 24) & 0xff;
+         line[i + 1] = (val >> 16) & 0xff;
+         line[i + 2] = (val >> 8) & 0xff;
+         line[i + 3] = (val >> 0) & 0xff;
+      }
+      return;
+   }
 
    for (i = 0; i < 16; i += 4) {
-      u32 val = sh2_cache_refill_read(sh, (addr & 0xFFFFFFF0) + i);
-      ca->way[lruway][entry].data[i + 0] = (val >> 24) & 0xff;
-      ca->way[lruway][entry].data[i + 1] = (val >> 16) & 0xff;
-      ca->way[lruway][entry].data[i + 2] = (val >> 8) & 0xff;
-      ca->way[lruway][entry].data[i + 3] = (val >> 0) & 0xff;
+      u32 val = sh2_cache_refill_read(sh, addr + i);
+      line[i + 0] = (val >> 24) & 0xff;
+      line[i + 1] = (val >> 16) & 0xff;
+      line[i + 2] = (val >> 8) & 0xff;
+      line[i + 3] = (val >> 0) & 0xff;
    }
 }
 
@@ -619,40 +665,12 @@ u8 cache_memory_read_b(SH2_struct *sh, cache_enty * ca, u32 addr){
 	switch (addr & AREA_MASK){
 	case CACHE_USE:
 	{
-      u32 tagaddr = 0;
-      u32 entry = 0;
-      int i = 0;
-      int lruway = 0;
+      u8 *line;
 		if (ca->enable == 0){
 			return MappedMemoryReadByteNocache(sh, addr);
 		}
-		tagaddr = (addr & TAG_MASK);
-		entry = (addr & ENTRY_MASK) >> ENTRY_SHIFT;
-		if (ca->way[0][entry].v && ca->way[0][entry].tag == tagaddr){
-         update_lru(0, &ca->lru[entry]);
-			return ca->way[0][entry].data[addr&LINE_MASK];
-		}
-		else if (ca->way[1][entry].v && ca->way[1][entry].tag == tagaddr){
-         update_lru(1, &ca->lru[entry]);
-			return ca->way[1][entry].data[addr&LINE_MASK];
-		}
-		else if (ca->way[2][entry].v && ca->way[2][entry].tag == tagaddr){
-         update_lru(2, &ca->lru[entry]);
-			return ca->way[2][entry].data[addr&LINE_MASK];
-		}
-		else if (ca->way[3][entry].v && ca->way[3][entry].tag == tagaddr){
-         update_lru(3, &ca->lru[entry]);
-			return ca->way[3][entry].data[addr&LINE_MASK];
-		}
-		// cache miss
-      lruway = select_way_to_replace(sh, ca->lru[entry]);
-      update_lru(lruway, &ca->lru[entry]);
-		ca->way[lruway][entry].tag = tagaddr;
-
-      sh2_refill_cache(sh, ca, lruway, entry, addr);
-
-      ca->way[lruway][entry].v = 1; //becomes valid
-		return ca->way[lruway][entry].data[addr&LINE_MASK];
+		line = cache_read_line(sh, ca, addr);
+		return line[addr&LINE_MASK];
 	}
 	break;
 	case CACHE_THROUGH:
@@ -671,41 +689,12 @@ u16 cache_memory_read_w(SH2_struct *sh, cache_enty * ca, u32 addr){
 	switch (addr & AREA_MASK){
 	case CACHE_USE:
 	{
-      u32 tagaddr = 0;
-      u32 entry = 0;
-      int i = 0;
-      int lruway = 0;
+      u8 *line;
 		if (ca->enable == 0){
 			return MappedMemoryReadWordNocache(sh, addr);
 		}
-	   tagaddr = (addr & TAG_MASK);
-		entry = (addr & ENTRY_MASK) >> ENTRY_SHIFT;
-		if (ca->way[0][entry].v && ca->way[0][entry].tag == tagaddr){
-         update_lru(0, &ca->lru[entry]);
-			return ((u16)(ca->way[0][entry].data[addr&LINE_MASK]) << 8) | ca->way[0][entry].data[(addr&LINE_MASK) + 1];
-		}
-		else if (ca->way[1][entry].v && ca->way[1][entry].tag == tagaddr){
-         update_lru(1, &ca->lru[entry]);
-			return ((u16)(ca->way[1][entry].data[addr&LINE_MASK]) << 8) | ca->way[1][entry].data[(addr&LINE_MASK) + 1];
-		}
-		else if (ca->way[2][entry].v && ca->way[2][entry].tag == tagaddr){
-         update_lru(2, &ca->lru[entry]);
-			return ((u16)(ca->way[2][entry].data[addr&LINE_MASK]) << 8) | ca->way[2][entry].data[(addr&LINE_MASK) + 1];
-		}
-		else if (ca->way[3][entry].v && ca->way[3][entry].tag == tagaddr){
-         update_lru(3, &ca->lru[entry]);
-			return ((u16)(ca->way[3][entry].data[addr&LINE_MASK]) << 8) | ca->way[3][entry].data[(addr&LINE_MASK) + 1];
-		}
-
-		// cache miss
-		lruway = select_way_to_replace(sh, ca->lru[entry]);
-      update_lru(lruway, &ca->lru[entry]);
-		ca->way[lruway][entry].tag = tagaddr;
-
-      sh2_refill_cache(sh, ca, lruway, entry, addr);
-
-      ca->way[lruway][entry].v = 1; //becomes valid
-		return ((u16)(ca->way[lruway][entry].data[addr&LINE_MASK]) << 8) | ca->way[lruway][entry].data[(addr&LINE_MASK) + 1];
+		line = cache_read_line(sh, ca, addr);
+		return ((u16)(line[addr&LINE_MASK]) << 8) | line[(addr&LINE_MASK) + 1];
 	}
 	break;
 	case CACHE_THROUGH:
@@ -723,56 +712,15 @@ u32 cache_memory_read_l(SH2_struct *sh, cache_enty * ca, u32 addr){
 	switch (addr & AREA_MASK){
 	case CACHE_USE:
 	{
-      u32 tagaddr = 0;
-      u32 entry = 0;
-      int i = 0;
-      int lruway = 0;
+      u8 *line;
 		if (ca->enable == 0){
 			return MappedMemoryReadLongNocache(sh, addr);
 		}
-		tagaddr = (addr & TAG_MASK);
-	   entry = (addr & ENTRY_MASK) >> ENTRY_SHIFT;
-
-		if (ca->way[0][entry].v && ca->way[0][entry].tag == tagaddr){
-         update_lru(0, &ca->lru[entry]);
-			return ((u32)(ca->way[0][entry].data[addr&LINE_MASK]) << 24) |
-				((u32)(ca->way[0][entry].data[(addr&LINE_MASK) + 1]) << 16) |
-				((u32)(ca->way[0][entry].data[(addr&LINE_MASK) + 2]) << 8) |
-				((u32)(ca->way[0][entry].data[(addr&LINE_MASK) + 3]) << 0);
-		}
-		else if (ca->way[1][entry].v && ca->way[1][entry].tag == tagaddr){
-         update_lru(1, &ca->lru[entry]);
-			return ((u32)(ca->way[1][entry].data[addr&LINE_MASK]) << 24) |
-				((u32)(ca->way[1][entry].data[(addr&LINE_MASK) + 1]) << 16) |
-				((u32)(ca->way[1][entry].data[(addr&LINE_MASK) + 2]) << 8) |
-				((u32)(ca->way[1][entry].data[(addr&LINE_MASK) + 3]) << 0);
-		}
-		else if (ca->way[2][entry].v && ca->way[2][entry].tag == tagaddr){
-         update_lru(2, &ca->lru[entry]);
-			return ((u32)(ca->way[2][entry].data[addr&LINE_MASK]) << 24) |
-				((u32)(ca->way[2][entry].data[(addr&LINE_MASK) + 1]) << 16) |
-				((u32)(ca->way[2][entry].data[(addr&LINE_MASK) + 2]) << 8) |
-				((u32)(ca->way[2][entry].data[(addr&LINE_MASK) + 3]) << 0);
-		}
-		else if (ca->way[3][entry].v && ca->way[3][entry].tag == tagaddr){
-         update_lru(3, &ca->lru[entry]);
-			return ((u32)(ca->way[3][entry].data[addr&LINE_MASK]) << 24) |
-				((u32)(ca->way[3][entry].data[(addr&LINE_MASK) + 1]) << 16) |
-				((u32)(ca->way[3][entry].data[(addr&LINE_MASK) + 2]) << 8) |
-				((u32)(ca->way[3][entry].data[(addr&LINE_MASK) + 3]) << 0);
-			}
-		// cache miss
-		lruway = select_way_to_replace(sh, ca->lru[entry]);
-      update_lru(lruway, &ca->lru[entry]);
-		ca->way[lruway][entry].tag = tagaddr;
-
-      sh2_refill_cache(sh, ca, lruway, entry, addr);
-
-      ca->way[lruway][entry].v = 1; //becomes valid
-		return ((u32)(ca->way[lruway][entry].data[addr&LINE_MASK]) << 24) |
-			((u32)(ca->way[lruway][entry].data[(addr&LINE_MASK) + 1]) << 16) |
-			((u32)(ca->way[lruway][entry].data[(addr&LINE_MASK) + 2]) << 8) |
-			((u32)(ca->way[lruway][entry].data[(addr&LINE_MASK) + 3]) << 0);
+		line = cache_read_line(sh, ca, addr);
+		return ((u32)(line[addr&LINE_MASK]) << 24) |
+			((u32)(line[(addr&LINE_MASK) + 1]) << 16) |
+			((u32)(line[(addr&LINE_MASK) + 2]) << 8) |
+			((u32)(line[(addr&LINE_MASK) + 3]) << 0);
 	}
 	break;
 	case CACHE_THROUGH:
@@ -785,4 +733,3 @@ u32 cache_memory_read_l(SH2_struct *sh, cache_enty * ca, u32 addr){
 	}
 	return 0;
 }
-
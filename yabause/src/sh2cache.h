@@ -1,17 +1,32 @@
 #ifndef _SH2_CACHE_H_
 #define _SH2_CACHE_H_
 
-typedef struct _cache_line{
+//tag[] holds the 0x1FFFFC00 tag bits with the valid bit packed into bit 0,
+//so a hit is a single compare per way against (tag | CACHE_TAG_VALID)
+#define CACHE_TAG_VALID (1)
+
+typedef struct _cache_enty{
+	u32 enable;
+	u32 lru[64];
+	u32 tag[64][4];
+	u8 data[64][4][16];
+	//entry/tag of the most recent hit and the way it hit in
+	u32 last_line;
+	u32 last_way;
+} cache_enty;
+
+//layout used by save states older than version 2
+typedef struct _cache_line_v1{
 	u32 tag;
    int v;
 	u8 data[16];
-} cache_line;
+} cache_line_v1;
 
-typedef struct _cache_enty{
+typedef struct _cache_enty_v1{
 	u32 enable;
 	u32 lru[64];
-	cache_line way[4][64];
-} cache_enty;
+	cache_line_v1 way[4][64];
+} cache_enty_v1;
 
 #ifdef __cplusplus
 extern "C"{
@@ -20,6 +35,8 @@ extern "C"{
 void cache_clear(cache_enty * ca);
 void cache_enable(cache_enty * ca);
 void cache_disable(cache_enty * ca);
+void cache_invalidate_last_hit(cache_enty * ca);
+void cache_load_v1(cache_enty * ca, const cache_enty_v1 * old);
 void cache_memory_write_b(SH2_struct *sh, cache_enty * ca, u32 addr, u8 val);
 void cache_memory_write_w(SH2_struct *sh, cache_enty * ca, u32 addr, u16 val);
 void cache_memory_write_l(SH2_struct *sh, cache_enty * ca, u32 addr, u32 val);
@@ -32,4 +49,4 @@ u32 cache_memory_read_l(SH2_struct *sh, cache_enty * ca, u32 addr);
 }
 #endif
 
-#endif
\ No newline at end of file
+#endif
@@ -23,7 +23,9 @@
 */
 
 #include <stdlib.h>
+#include <stddef.h>
 #include "sh2core.h"
+#include "sh2idle.h"
 #include "debug.h"
 #include "memory.h"
 #include "yabause.h"
@@ -123,6 +125,8 @@ void sh2_set_read_write_funcs(SH2_struct * sh)
       sh->MappedMemoryWriteByte = MappedMemoryWriteByteCacheEnabled;
       sh->MappedMemoryWriteWord = MappedMemoryWriteWordCacheEnabled;
       sh->MappedMemoryWriteLong = MappedMemoryWriteLongCacheEnabled;
+      // Every access has to go through the cache
+      sh->DirectAreas = 0;
    }
    else
    {
@@ -132,6 +136,12 @@ void sh2_set_read_write_funcs(SH2_struct * sh)
       sh->MappedMemoryWriteByte = MappedMemoryWriteByteNocache;
       sh->MappedMemoryWriteWord = MappedMemoryWriteWordNocache;
       sh->MappedMemoryWriteLong = MappedMemoryWriteLongNocache;
+#ifdef SH2_TRACE
+      // Writes are traced in MappedMemoryWrite*Nocache
+      sh->DirectAreas = 0;
+#else
+      sh->DirectAreas = SH2_DIRECT_AREAS;
+#endif
    }
 }
 
@@ -252,6 +262,7 @@ void SH2Reset(SH2_struct *context)
    context->delay = 0x00000000;
    context->cycles = 0;
    context->isIdle = 0;
+   SH2idleReset(context);
 
    context->frc.leftover = 0;
    context->frc.shift = 3;
@@ -289,7 +300,10 @@ void SH2PowerOn(SH2_struct *context) {
 
 void FASTCALL SH2Exec(SH2_struct *context, u32 cycles)
 {
-   context->core->Exec(context, cycles);
+   if(context->model == SHMT_SH1)
+      context->core->Exec(context, cycles);
+   else
+      SH2idleExec(context, cycles);
 
    if(context->model == SHMT_SH1)
       sh1_onchip_run_cycles(cycles);
@@ -458,6 +472,40 @@ void SH2WriteNotify(u32 start, u32 length) {
 
 //////////////////////////////////////////////////////////////////////////////
 
+u8 SH2CodePages[SH2_CODE_NUM_PAGES];
+
+// Folds mirrors and the cache-through area onto the single address that
+// translated code is keyed on. Areas that don't have write tracking return
+// 0xFFFFFFFF and have to be run through the interpreter.
+u32 SH2FoldCodeAddress(u32 addr)
+{
+   if ((addr >> 29) > 1)
+      return 0xFFFFFFFF;
+
+   addr &= 0x1FFFFFFF;
+
+   if (addr < 0x00100000)
+      return addr & 0x7FFFF;
+   if ((addr & 0x1FF00000) == 0x00200000)
+      return 0x00200000 | (addr & 0xFFFFF);
+   if ((addr & 0x1E000000) == 0x06000000)
+      return 0x06000000 | (addr & 0xFFFFF);
+   if ((addr & 0x1E000000) == 0x02000000 && CartridgeArea->carttype == CART_ROM16MBIT)
+      return addr;
+
+   return 0xFFFFFFFF;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void SH2CodePageWritten(u32 page)
+{
+   // The core clears the page flag once its code there is invalidated
+   SH2WriteNotify(page << SH2_CODE_PAGE_SHIFT, 1 << SH2_CODE_PAGE_SHIFT);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
 void SH2SetBreakpointCallBack(SH2_struct *context, void (*func)(void *, u32, void *), void *userdata) {
    context->bp.BreakpointCallBack = func;
    context->bp.BreakpointUserData = userdata;
@@ -800,6 +848,22 @@ int SH2AddMemoryBreakpoint(SH2_struct *context, u32 addr, u32 flags) {
       context->bp.memorybreakpoint[context->bp.nummemorybreakpoints].oldwritebyte = context->WriteByteList[(addr >> 16) & 0xFFF];
       context->bp.memorybreakpoint[context->bp.nummemorybreakpoints].oldwriteword = context->WriteWordList[(addr >> 16) & 0xFFF];
       context->bp.memorybreakpoint[context->bp.nummemorybreakpoints].oldwritelong = context->WriteLongList[(addr >> 16) & 0xFFF];
+      context->bp.memorybreakpoint[context->bp.nummemorybreakpoints].oldreadpage = context->ReadPages[(addr >> 16) & 0xFFF];
+      context->bp.memorybreakpoint[context->bp.nummemorybreakpoints].oldwritepage = context->WritePages[(addr >> 16) & 0xFFF];
+
+      // Another breakpoint in the same page already took it off the page table
+      for (i = 0; i < context->bp.nummemorybreakpoints; i++)
+      {
+         if (((context->bp.memorybreakpoint[i].addr >> 16) & 0xFFF) == ((addr >> 16) & 0xFFF))
+         {
+            context->bp.memorybreakpoint[context->bp.nummemorybreakpoints].oldreadpage = context->bp.memorybreakpoint[i].oldreadpage;
+            context->bp.memorybreakpoint[context->bp.nummemorybreakpoints].oldwritepage = context->bp.memorybreakpoint[i].oldwritepage;
+         }
+      }
+
+      // Accesses to the page have to go through the breakpoint handlers
+      context->ReadPages[(addr >> 16) & 0xFFF] = NULL;
+      context->WritePages[(addr >> 16) & 0xFFF] = NULL;
 
       if (flags & BREAK_BYTEREAD)
       {
@@ -894,6 +958,7 @@ static void SH2SortMemoryBreakpoints(SH2_struct *context) {
 
 int SH2DelMemoryBreakpoint(SH2_struct *context, u32 addr) {
    int i, i2;
+   int pageshared;
 
    if (context->bp.nummemorybreakpoints > 0) {
       for (i = 0; i < context->bp.nummemorybreakpoints; i++) {
@@ -902,6 +967,7 @@ int SH2DelMemoryBreakpoint(SH2_struct *context, u32 addr) {
             // Remove memory access piggyback function to memory access function table
 
             // Make sure no other breakpoints need the breakpoint functions first
+            pageshared = 0;
             for (i2 = 0; i2 < context->bp.nummemorybreakpoints; i2++)
             {
                if (((context->bp.memorybreakpoint[i].addr >> 16) & 0xFFF) ==
@@ -910,8 +976,15 @@ int SH2DelMemoryBreakpoint(SH2_struct *context, u32 addr) {
                {
                   // Clear the flags
                   context->bp.memorybreakpoint[i].flags &= ~context->bp.memorybreakpoint[i2].flags;
+                  pageshared = 1;
                }                
             }
+
+            if (!pageshared)
+            {
+               context->ReadPages[(addr >> 16) & 0xFFF] = context->bp.memorybreakpoint[i].oldreadpage;
+               context->WritePages[(addr >> 16) & 0xFFF] = context->bp.memorybreakpoint[i].oldwritepage;
+            }
             
             if (context->bp.memorybreakpoint[i].flags & BREAK_BYTEREAD)
                context->ReadByteList[(addr >> 16) & 0xFFF] = context->bp.memorybreakpoint[i].oldreadbyte;
@@ -1864,9 +1937,10 @@ u32 FASTCALL AddressArrayReadLong(SH2_struct *sh, u32 addr) {
    {
       int way = (sh->onchip.CCR >> 6) & 3;
       int entry = (addr & 0x3FC) >> 4;
-      u32 data = sh->onchip.cache.way[way][entry].tag;
+      u32 tag = sh->onchip.cache.tag[entry][way];
+      u32 data = tag & 0x1FFFFC00;
       data |= sh->onchip.cache.lru[entry] << 4;
-      data |= sh->onchip.cache.way[way][entry].v << 2;
+      data |= (tag & CACHE_TAG_VALID) << 2;
       return data;
    }
    else
@@ -1880,9 +1954,9 @@ void FASTCALL AddressArrayWriteLong(SH2_struct *sh, u32 addr, u32 val)  {
    {
       int way = (sh->onchip.CCR >> 6) & 3;
       int entry = (addr & 0x3FC) >> 4;
-      sh->onchip.cache.way[way][entry].tag = addr & 0x1FFFFC00;
-      sh->onchip.cache.way[way][entry].v = (addr >> 2) & 1;
+      sh->onchip.cache.tag[entry][way] = (addr & 0x1FFFFC00) | ((addr >> 2) & 1);
       sh->onchip.cache.lru[entry] = (val >> 4) & 0x3f;
+      cache_invalidate_last_hit(&sh->onchip.cache);
    }
    else
       sh->AddressArray[(addr & 0x3FC) >> 2] = val;
@@ -1895,7 +1969,7 @@ u8 FASTCALL DataArrayReadByte(SH2_struct *sh, u32 addr) {
    {
       int way = (addr >> 10) & 3;
       int entry = (addr >> 4) & 0x3f;
-      return sh->onchip.cache.way[way][entry].data[addr & 0xf];
+      return sh->onchip.cache.data[entry][way][addr & 0xf];
    }
    else
       return T2ReadByte(sh->DataArray, addr & 0xFFF);
@@ -1908,7 +1982,7 @@ u16 FASTCALL DataArrayReadWord(SH2_struct *sh, u32 addr) {
    {
       int way = (addr >> 10) & 3;
       int entry = (addr >> 4) & 0x3f;
-      return ((u16)(sh->onchip.cache.way[way][entry].data[addr & 0xf]) << 8) | sh->onchip.cache.way[way][entry].data[(addr & 0xf) + 1];
+      return ((u16)(sh->onchip.cache.data[entry][way][addr & 0xf]) << 8) | sh->onchip.cache.data[entry][way][(addr & 0xf) + 1];
    }
    else
       return T2ReadWord(sh->DataArray, addr & 0xFFF);
@@ -1921,10 +1995,10 @@ u32 FASTCALL DataArrayReadLong(SH2_struct *sh, u32 addr) {
    {
       int way = (addr >> 10) & 3;
       int entry = (addr >> 4) & 0x3f;
-      u32 data = ((u32)(sh->onchip.cache.way[way][entry].data[addr & 0xf]) << 24) |
-         ((u32)(sh->onchip.cache.way[way][entry].data[(addr & 0xf) + 1]) << 16) |
-         ((u32)(sh->onchip.cache.way[way][entry].data[(addr & 0xf) + 2]) << 8) |
-         ((u32)(sh->onchip.cache.way[way][entry].data[(addr & 0xf) + 3]) << 0);
+      u32 data = ((u32)(sh->onchip.cache.data[entry][way][addr & 0xf]) << 24) |
+         ((u32)(sh->onchip.cache.data[entry][way][(addr & 0xf) + 1]) << 16) |
+         ((u32)(sh->onchip.cache.data[entry][way][(addr & 0xf) + 2]) << 8) |
+         ((u32)(sh->onchip.cache.data[entry][way][(addr & 0xf) + 3]) << 0);
       return data;
    }
    else
@@ -1938,7 +2012,7 @@ void FASTCALL DataArrayWriteByte(SH2_struct *sh, u32 addr, u8 val)  {
    {
       int way = (addr >> 10) & 3;
       int entry = (addr >> 4) & 0x3f;
-      sh->onchip.cache.way[way][entry].data[addr & 0xf] = val;
+      sh->onchip.cache.data[entry][way][addr & 0xf] = val;
    }
    else
       T2WriteByte(sh->DataArray, addr & 0xFFF, val);
@@ -1951,8 +2025,8 @@ void FASTCALL DataArrayWriteWord(SH2_struct *sh, u32 addr, u16 val)  {
    {
       int way = (addr >> 10) & 3;
       int entry = (addr >> 4) & 0x3f;
-      sh->onchip.cache.way[way][entry].data[addr & 0xf] = val >> 8;
-      sh->onchip.cache.way[way][entry].data[(addr & 0xf) + 1] = val;
+      sh->onchip.cache.data[entry][way][addr & 0xf] = val >> 8;
+      sh->onchip.cache.data[entry][way][(addr & 0xf) + 1] = val;
    }
    else
       T2WriteWord(sh->DataArray, addr & 0xFFF, val);
@@ -1965,10 +2039,10 @@ void FASTCALL DataArrayWriteLong(SH2_struct *sh, u32 addr, u32 val)  {
    {
       int way = (addr >> 10) & 3;
       int entry = (addr >> 4) & 0x3f;
-      sh->onchip.cache.way[way][entry].data[(addr & 0xf)] = ((val >> 24) & 0xFF);
-      sh->onchip.cache.way[way][entry].data[(addr & 0xf) + 1] = ((val >> 16) & 0xFF);
-      sh->onchip.cache.way[way][entry].data[(addr & 0xf) + 2] = ((val >> 8) & 0xFF);
-      sh->onchip.cache.way[way][entry].data[(addr & 0xf) + 3] = ((val >> 0) & 0xFF);
+      sh->onchip.cache.data[entry][way][(addr & 0xf)] = ((val >> 24) & 0xFF);
+      sh->onchip.cache.data[entry][way][(addr & 0xf) + 1] = ((val >> 16) & 0xFF);
+      sh->onchip.cache.data[entry][way][(addr & 0xf) + 2] = ((val >> 8) & 0xFF);
+      sh->onchip.cache.data[entry][way][(addr & 0xf) + 3] = ((val >> 0) & 0xFF);
    }
    else
       T2WriteLong(sh->DataArray, addr & 0xFFF, val);
@@ -2596,9 +2670,9 @@ void dma_tick(SH2_struct *sh, u32 *CHCR, u32 *SAR, u32 *DAR, u32 *TCR, u32 *VCRD
    }
 
    if(dst_increment > 0)
-      SH2WriteNotify(*DAR, *DAR + dst_increment);
+      SH2WriteNotify(*DAR, dst_increment);
    else
-      SH2WriteNotify(*DAR + dst_increment, *DAR);
+      SH2WriteNotify(*DAR + dst_increment, -dst_increment);
 
    *TCR = *TCR - 1;
    *SAR = *SAR + src_increment;
@@ -2855,7 +2929,7 @@ void SCITransmitByte(UNUSED u8 val) {
 
 //////////////////////////////////////////////////////////////////////////////
 
-int SH2SaveState(SH2_struct *context, FILE *fp)
+int SH2SaveState(SH2_struct *context, ystream_struct *fp)
 {
    int offset;
    IOCheck_struct check = { 0, 0 };
@@ -2863,16 +2937,16 @@ int SH2SaveState(SH2_struct *context, FILE *fp)
 
 	if (context->model == SHMT_SH1)
 	{
-		offset = StateWriteHeader(fp, "SH1 ", 1);
+		offset = StateWriteHeader(fp, "SH1 ", 2);
 	}
 	else if (context->model == SHMT_SH2)
 	{
 		// Write header
 		if (context->isslave == 0)
-			offset = StateWriteHeader(fp, "MSH2", 1);
+			offset = StateWriteHeader(fp, "MSH2", 2);
 		else
 		{
-			offset = StateWriteHeader(fp, "SSH2", 1);
+			offset = StateWriteHeader(fp, "SSH2", 2);
 			ywrite(&check, (void *)&yabsys.IsSSH2Running, 1, 1, fp);
 		}
 	}
@@ -2912,7 +2986,29 @@ int SH2SaveState(SH2_struct *context, FILE *fp)
 
 //////////////////////////////////////////////////////////////////////////////
 
-int SH2LoadState(SH2_struct *context, FILE *fp, UNUSED int version, int size)
+// Version 1 states stored the cache as an array of lines
+static void SH2LoadOnchipV1(SH2_struct *context, ystream_struct *fp, IOCheck_struct *check)
+{
+   cache_enty_v1 *cache = (cache_enty_v1 *)malloc(sizeof(cache_enty_v1));
+
+   yread(check, (void *)&context->onchip, offsetof(Onchip_struct, cache), 1, fp);
+   if (cache != NULL)
+   {
+      yread(check, (void *)cache, sizeof(cache_enty_v1), 1, fp);
+      cache_load_v1(&context->onchip.cache, cache);
+      free(cache);
+   }
+   else
+   {
+      yseek(fp, sizeof(cache_enty_v1), SEEK_CUR);
+      cache_clear(&context->onchip.cache);
+   }
+   yread(check, (void *)&context->onchip.dma0_active, sizeof(Onchip_struct) - offsetof(Onchip_struct, dma0_active), 1, fp);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+int SH2LoadState(SH2_struct *context, ystream_struct *fp, int version, int size)
 {
    IOCheck_struct check = { 0, 0 };
    sh2regs_struct regs;
@@ -2925,7 +3021,10 @@ int SH2LoadState(SH2_struct *context, FILE *fp, UNUSED int version, int size)
    SH2SetRegisters(context, &regs);
 
    // Read onchip registers
-   yread(&check, (void *)&context->onchip, sizeof(Onchip_struct), 1, fp);
+   if (version < 2)
+      SH2LoadOnchipV1(context, fp, &check);
+   else
+      yread(&check, (void *)&context->onchip, sizeof(Onchip_struct), 1, fp);
 
    // Read internal variables
    yread(&check, (void *)&context->frc, sizeof(context->frc), 1, fp);
@@ -2944,6 +3043,7 @@ int SH2LoadState(SH2_struct *context, FILE *fp, UNUSED int version, int size)
    yread(&check, (void *)&context->cycles, sizeof(u32), 1, fp);
    yread(&check, (void *)&context->isslave, sizeof(u8), 1, fp);
    yread(&check, (void *)&context->isIdle, sizeof(u8), 1, fp);
+   SH2idleReset(context);
    yread(&check, (void *)&context->instruction, sizeof(u16), 1, fp);
 
    #if defined(SH2_DYNAREC)
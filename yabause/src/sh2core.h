@@ -306,6 +306,8 @@ typedef struct
   writebytefunc oldwritebyte;
   writewordfunc oldwriteword;
   writelongfunc oldwritelong;
+  u8 *oldreadpage;
+  u8 *oldwritepage;
 } memorybreakpoint_struct;
 
 #define MAX_BREAKPOINTS 10
@@ -354,6 +356,14 @@ typedef struct
    u64 count;
 } tilInfo_struct;
 
+typedef struct
+{
+   u32 loops;     // polling loops recognized
+   u32 hits;      // slices fast-forwarded
+   u32 exits;     // checks that found the CPU had left the loop
+   u64 skipped;   // cycles that were never executed
+} sh2idlestats_struct;
+
 typedef struct SH2Interface_struct SH2Interface_struct;
 
 #include "sh2_jit.h"
@@ -374,6 +384,13 @@ struct SH2_struct
    readwordfunc ReadWordList[0x1000];
    readlongfunc ReadLongList[0x1000];
 
+   // Host pointers for plain RAM/ROM, indexed like the lists above. NULL
+   // pages (I/O, breakpoints) go through the lists. Only WRAM is writable.
+   u8 *ReadPages[0x1000];
+   u8 *WritePages[0x1000];
+   // Areas (addr >> 29) the inline accessors may serve from the pages
+   u8 DirectAreas;
+
    writebytefunc MappedMemoryWriteByte;
    writewordfunc MappedMemoryWriteWord;
    writelongfunc MappedMemoryWriteLong;
@@ -434,6 +451,18 @@ struct SH2_struct
       int maxNum;
    } trackInfLoop;
 
+   // Core independent idle loop fast-forward, see SH2idleExec()
+   struct
+   {
+      u32 begin;       // polling loop the CPU is spinning in
+      u32 end;         // last instruction of the loop, delay slot included
+      u32 probe;       // cycles to run each slice to see if it's still there
+      u32 lastpc;      // PC at the end of the previous slice
+      u32 rejectbegin; // last code found not to be an idle loop
+      u32 rejectend;
+      u8 active;
+      sh2idlestats_struct stats;
+   } idle;
 };
 
 struct SH2Interface_struct
@@ -503,6 +532,122 @@ void SH2GetRegisters(SH2_struct *context, sh2regs_struct * r);
 void SH2SetRegisters(SH2_struct *context, sh2regs_struct * r);
 void SH2WriteNotify(u32 start, u32 length);
 
+// Cores that keep translated code around (SH2Jit, SH2BlockInterpreter) flag
+// every 4KB page of the folded address space they hold code for. The WRAM
+// write handlers only call into the core's WriteNotify for flagged pages.
+#define SH2_CODE_PAGE_SHIFT     12
+#define SH2_CODE_NUM_PAGES      (0x20000000 >> SH2_CODE_PAGE_SHIFT)
+
+extern u8 SH2CodePages[SH2_CODE_NUM_PAGES];
+
+u32 SH2FoldCodeAddress(u32 addr);
+void SH2CodePageWritten(u32 page);
+
+static INLINE void SH2CheckCodeWrite(u32 addr)
+{
+   u32 page = addr >> SH2_CODE_PAGE_SHIFT;
+
+   if (UNLIKELY(SH2CodePages[page]))
+      SH2CodePageWritten(page);
+}
+
+// Cached, cache-through and the 0xA0000000 mirror all map through the lists
+#define SH2_DIRECT_AREAS        0x23
+
+static INLINE u8 *SH2ReadPage(SH2_struct *sh, u32 addr, u32 areas)
+{
+   return ((areas >> (addr >> 29)) & 1) ? sh->ReadPages[(addr >> 16) & 0xFFF] : NULL;
+}
+
+static INLINE u8 *SH2WritePage(SH2_struct *sh, u32 addr, u32 areas)
+{
+   return ((areas >> (addr >> 29)) & 1) ? sh->WritePages[(addr >> 16) & 0xFFF] : NULL;
+}
+
+// Writable pages are all WRAM, this gives the address code tracking uses
+static INLINE u32 SH2WramCodeAddress(u32 addr)
+{
+   return ((addr & 0x04000000) ? 0x06000000 : 0x00200000) | (addr & 0xFFFFF);
+}
+
+// Direct writes skip the memory.c handlers, so flag the page here
+static INLINE void SH2WramWritten(u32 addr)
+{
+   WramMarkDirty(addr);
+   SH2CheckCodeWrite(SH2WramCodeAddress(addr));
+}
+
+// Inline accessors for the cores. RAM/ROM is accessed directly unless the
+// cache is emulated, everything else goes through MappedMemory*.
+static INLINE u8 SH2MappedMemoryReadByte(SH2_struct *sh, u32 addr)
+{
+   u8 *page = SH2ReadPage(sh, addr, sh->DirectAreas);
+
+   if (LIKELY(page != NULL))
+      return T2ReadByte(page, addr & 0xFFFF);
+
+   return sh->MappedMemoryReadByte(sh, addr);
+}
+
+static INLINE u16 SH2MappedMemoryReadWord(SH2_struct *sh, u32 addr)
+{
+   u8 *page = SH2ReadPage(sh, addr, sh->DirectAreas);
+
+   if (LIKELY(page != NULL))
+      return T2ReadWord(page, addr & 0xFFFF);
+
+   return sh->MappedMemoryReadWord(sh, addr);
+}
+
+static INLINE u32 SH2MappedMemoryReadLong(SH2_struct *sh, u32 addr)
+{
+   u8 *page = SH2ReadPage(sh, addr, sh->DirectAreas);
+
+   if (LIKELY(page != NULL))
+      return T2ReadLong(page, addr & 0xFFFF);
+
+   return sh->MappedMemoryReadLong(sh, addr);
+}
+
+static INLINE void SH2MappedMemoryWriteByte(SH2_struct *sh, u32 addr, u8 val)
+{
+   u8 *page = SH2WritePage(sh, addr, sh->DirectAreas);
+
+   if (LIKELY(page != NULL))
+   {
+      T2WriteByte(page, addr & 0xFFFF, val);
+      SH2WramWritten(addr);
+   }
+   else
+      sh->MappedMemoryWriteByte(sh, addr, val);
+}
+
+static INLINE void SH2MappedMemoryWriteWord(SH2_struct *sh, u32 addr, u16 val)
+{
+   u8 *page = SH2WritePage(sh, addr, sh->DirectAreas);
+
+   if (LIKELY(page != NULL))
+   {
+      T2WriteWord(page, addr & 0xFFFF, val);
+      SH2WramWritten(addr);
+   }
+   else
+      sh->MappedMemoryWriteWord(sh, addr, val);
+}
+
+static INLINE void SH2MappedMemoryWriteLong(SH2_struct *sh, u32 addr, u32 val)
+{
+   u8 *page = SH2WritePage(sh, addr, sh->DirectAreas);
+
+   if (LIKELY(page != NULL))
+   {
+      T2WriteLong(page, addr & 0xFFFF, val);
+      SH2WramWritten(addr);
+   }
+   else
+      sh->MappedMemoryWriteLong(sh, addr, val);
+}
+
 void SH2SetBreakpointCallBack(SH2_struct *context, void (*func)(void *, u32, void *), void *userdata);
 int SH2AddCodeBreakpoint(SH2_struct *context, u32 addr);
 int SH2DelCodeBreakpoint(SH2_struct *context, u32 addr);
@@ -567,8 +712,8 @@ void FASTCALL DataArrayWriteLong(SH2_struct *sh, u32 addr, u32 val);
 void FASTCALL MSH2InputCaptureWriteWord(SH2_struct *sh, u32 addr, u16 data);
 void FASTCALL SSH2InputCaptureWriteWord(SH2_struct *sh, u32 addr, u16 data);
 
-int SH2SaveState(SH2_struct *context, FILE *fp);
-int SH2LoadState(SH2_struct *context, FILE *fp, int version, int size);
+int SH2SaveState(SH2_struct *context, ystream_struct *fp);
+int SH2LoadState(SH2_struct *context, ystream_struct *fp, int version, int size);
 
 u32 sh2_dma_access(u32 addr, u32 data, int is_read, int size);
 
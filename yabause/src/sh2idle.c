@@ -21,6 +21,7 @@
     \brief SH2 interpreter interface with idle detection.
 */
 
+#include <string.h>
 #include "sh2core.h"
 #include "sh2idle.h"
 #include "sh2int.h"
@@ -436,6 +437,10 @@ static int FASTCALL SH2idleCheckIterate(SH2_struct *context, u16 instruction, u3
   return 1;
 }
 
+#define COUNT_IDLE if ( cycles > context->cycles ) {\
+    context->idle.stats.hits++; \
+    context->idle.stats.skipped += cycles - context->cycles; }
+
 #ifdef IDLE_DETECT_VERBOSE
 static u32 idleCheckCount = 0;
 static u32 sh2cycleCount = 0;
@@ -443,6 +448,7 @@ static u32 sh2oldCycleCount = 0;
 static u32 oldCheckCount = 0;
 
 #define DROP_IDLE {\
+    COUNT_IDLE; \
     idleCheckCount += cycles - context->cycles; \
     context->cycles = cycles;}
 #define IDLE_VERBOSE_SH2_COUNT {\
@@ -455,7 +461,9 @@ static u32 oldCheckCount = 0;
       sh2oldCycleCount = sh2cycleCount; \
     }}
 #else
-#define DROP_IDLE context->cycles = cycles;
+#define DROP_IDLE {\
+    COUNT_IDLE; \
+    context->cycles = cycles;}
 #define IDLE_VERBOSE_SH2_COUNT
 #endif
 
@@ -620,6 +628,182 @@ void FASTCALL SH2idleParse( SH2_struct *context, u32 cycles ) {
   }
 }
 
+/* ------------------------------------------------------ */
+/* Core independent fast-forward                          */
+
+/* SH2idleCheck and SH2idleParse single step the interpreter, so they can't
+   help the jit or the interpreter with the cache on. SH2idleExec sits in
+   SH2Exec and only uses the core's Exec and GetPC: when two slices in a row
+   end within a few instructions of each other, the code around the PC is
+   run through the same register analysis, statically. Once it is known to
+   be a store-free deterministic loop, each following slice only runs long
+   enough to go around it twice, and if the CPU is still in there the rest
+   of the slice is skipped. Nothing else runs during the slice, so whatever
+   it polls can't change before the next one, where interrupts are taken. */
+
+#define IDLE_MAX_BYTES (MAX_CYCLE_CHECK * 2)
+
+static INLINE u16 SH2idleFetch(SH2_struct *context, u32 PC) {
+  return ((fetchfunc *)context->fetchlist)[(PC >> 20) & 0x0FF](context, PC);
+}
+
+static int SH2idleIsBranch(u16 instruction) {
+  switch (INSTRUCTION_A(instruction))
+    {
+    case 0:
+      switch (INSTRUCTION_CD(instruction))
+	{
+	case 0x03: //bsrf
+	case 0x23: //braf
+	case 0x0B: //rts
+	case 0x1B: //sleep
+	case 0x2B: return 1; //rte
+	}
+      return 0;
+    case 4: return INSTRUCTION_CD(instruction) == 0x0B || INSTRUCTION_CD(instruction) == 0x2B; //jsr, jmp
+    case 8: return INSTRUCTION_B(instruction) >= 9 && (INSTRUCTION_B(instruction) & 1); //bt, bf, bts, bfs
+    case 10:  //bra
+    case 11: return 1; //bsr
+    case 12: return INSTRUCTION_B(instruction) == 3; //trapa
+    }
+  return 0;
+}
+
+static int SH2idleCheckPass(SH2_struct *context, u32 begin, u32 end, int isDelayed) {
+  // one pass of SH2idleCheckIterate over a straight loop body
+  u32 PC;
+
+  for (PC = begin; PC < end; PC += 2) {
+    u16 instruction = SH2idleFetch(context, PC);
+    if ( SH2idleIsBranch(instruction) || !SH2idleCheckIterate(context, instruction, PC) ) return 0;
+  }
+
+  if ( isDelayed ) {
+    u16 instruction = SH2idleFetch(context, end+2);
+    if ( SH2idleIsBranch(instruction) || !SH2idleCheckIterate(context, instruction, end+2) ) return 0;
+  }
+
+  return 1;
+}
+
+static int SH2idleFindLoop(SH2_struct *context, u32 PC, u32 *loopBegin, u32 *loopEnd) {
+  // look for a loop around <PC> that can't make any progress by itself
+
+  u16 instruction = 0;
+  u32 begin, end;
+  int isDelayed;
+
+  *loopBegin = *loopEnd = PC;
+
+  // code in the cache data array or in on-chip space isn't worth the trouble
+  if ( (PC & 0xC0000000) == 0xC0000000 ) return 0;
+
+  for (end = PC; end < PC + IDLE_MAX_BYTES; end += 2) {
+    instruction = SH2idleFetch(context, end);
+    if ( SH2idleIsBranch(instruction) ) break;
+  }
+  if ( end >= PC + IDLE_MAX_BYTES ) return 0;
+
+  switch (INSTRUCTION_A(instruction))
+    {
+    case 8: //bt, bf, bts, bfs
+      begin = end + ((s32)(s8)INSTRUCTION_CD(instruction) << 1) + 4;
+      isDelayed = INSTRUCTION_B(instruction) >= 13;
+      break;
+    case 10: //bra
+      begin = end + ((s32)((u32)instruction << 20) >> 19) + 4;
+      isDelayed = 1;
+      break;
+    default: return 0;
+    }
+
+  if ( begin > PC || end - begin >= IDLE_MAX_BYTES ) return 0;
+
+  *loopBegin = begin;
+  *loopEnd = isDelayed ? end + 2 : end;
+
+  bDet = bChg = 0;
+  if ( !SH2idleCheckPass(context, begin, end, isDelayed) ) return 0;
+
+  bDet = ~bChg;
+  bDet |= destCONST;
+  if ( !SH2idleCheckPass(context, begin, end, isDelayed) ) return 0;
+
+  return !~bDet;
+}
+
+static void SH2idleDetect(SH2_struct *context) {
+  u32 PC = context->core->GetPC(context);
+  u32 lastPC = context->idle.lastpc;
+  u32 begin, end;
+
+  context->idle.lastpc = PC;
+
+  // code that gets work done hardly ever ends two slices this close together
+  if ( PC - lastPC + IDLE_MAX_BYTES > 2 * IDLE_MAX_BYTES ) return;
+  if ( PC >= context->idle.rejectbegin && PC <= context->idle.rejectend ) return;
+
+  if ( SH2idleFindLoop(context, PC, &begin, &end) ) {
+    context->idle.begin = begin;
+    context->idle.end = end;
+    // twice around the loop, counting the taken branch
+    context->idle.probe = ((end - begin) / 2 + 3) * 2;
+    context->idle.active = 1;
+    context->idle.stats.loops++;
+  } else {
+    context->idle.rejectbegin = begin;
+    context->idle.rejectend = end;
+  }
+}
+
+void FASTCALL SH2idleExec(SH2_struct *context, u32 cycles) {
+  // runs a slice for SH2Exec, skipping what's left of it while idle
+
+  SH2Interface_struct *core = context->core;
+  u32 probe = context->idle.probe;
+  u32 PC;
+
+  if ( !context->idle.active || probe >= cycles ) {
+    core->Exec(context, cycles);
+    if ( !context->isIdle ) SH2idleDetect(context);
+    return;
+  }
+
+  core->Exec(context, probe);
+
+  PC = core->GetPC(context);
+  if ( PC >= context->idle.begin && PC <= context->idle.end ) {
+    // cores that keep their own count are left with the probe's overshoot,
+    // SH2Exec sets context->cycles back to 0 for them
+    context->cycles += cycles - probe;
+    context->idle.stats.hits++;
+    context->idle.stats.skipped += cycles - probe;
+    return;
+  }
+
+  // it got out (or took an interrupt), run the rest of the slice
+  context->idle.active = 0;
+  context->idle.stats.exits++;
+  context->cycles -= probe;
+  core->Exec(context, cycles - probe);
+  context->cycles += probe;
+}
+
+void SH2idleReset(SH2_struct *context) {
+  context->idle.active = 0;
+  context->idle.lastpc = 0xFFFFFFFF;
+  context->idle.rejectbegin = 0xFFFFFFFF;
+  context->idle.rejectend = 0;
+}
+
+void SH2idleGetStats(SH2_struct *context, sh2idlestats_struct *stats) {
+  *stats = context->idle.stats;
+}
+
+void SH2idleResetStats(SH2_struct *context) {
+  memset(&context->idle.stats, 0, sizeof(context->idle.stats));
+}
+
 /* ------------------------------------------------------ */
 /* Code markers                                           */
 /*
@@ -23,4 +23,9 @@
 void FASTCALL SH2idleCheck(SH2_struct *context, u32 cycles);
 void FASTCALL SH2idleParse(SH2_struct *context, u32 cycles);
 
+void FASTCALL SH2idleExec(SH2_struct *context, u32 cycles);
+void SH2idleReset(SH2_struct *context);
+void SH2idleGetStats(SH2_struct *context, sh2idlestats_struct *stats);
+void SH2idleResetStats(SH2_struct *context);
+
 #endif
@@ -111,6 +111,42 @@ SH2Interface_struct SH2DebugInterpreter = {
    NULL  // SH2WriteNotify not used
 };
 
+SH2Interface_struct SH2BlockInterpreter = {
+   SH2CORE_BLOCKINTERPRETER,
+   "SH2 Block Interpreter",
+
+   SH2BlockInterpreterInit,
+   SH2BlockInterpreterDeInit,
+   SH2BlockInterpreterReset,
+   SH2BlockInterpreterExec,
+
+   SH2InterpreterGetRegisters,
+   SH2InterpreterGetGPR,
+   SH2InterpreterGetSR,
+   SH2InterpreterGetGBR,
+   SH2InterpreterGetVBR,
+   SH2InterpreterGetMACH,
+   SH2InterpreterGetMACL,
+   SH2InterpreterGetPR,
+   SH2InterpreterGetPC,
+
+   SH2InterpreterSetRegisters,
+   SH2InterpreterSetGPR,
+   SH2InterpreterSetSR,
+   SH2InterpreterSetGBR,
+   SH2InterpreterSetVBR,
+   SH2InterpreterSetMACH,
+   SH2InterpreterSetMACL,
+   SH2InterpreterSetPR,
+   SH2InterpreterSetPC,
+
+   SH2InterpreterSendInterrupt,
+   SH2InterpreterGetInterrupts,
+   SH2InterpreterSetInterrupts,
+
+   SH2BlockInterpreterWriteNotify
+};
+
 //////////////////////////////////////////////////////////////////////////////
 
 int sh2_check_wait(SH2_struct * sh, u32 addr, int size)
@@ -242,18 +278,18 @@ static void FASTCALL SH2undecoded(SH2_struct * sh)
 
    // Save regs.SR on stack
    sh->regs.R[15]-=4;
-   sh->MappedMemoryWriteLong(sh, sh->regs.R[15],sh->regs.SR.all);
+   SH2MappedMemoryWriteLong(sh, sh->regs.R[15],sh->regs.SR.all);
 
    // Save regs.PC on stack
    sh->regs.R[15]-=4;
-   sh->MappedMemoryWriteLong(sh, sh->regs.R[15],sh->regs.PC + 2);
+   SH2MappedMemoryWriteLong(sh, sh->regs.R[15],sh->regs.PC + 2);
 
    // What caused the exception? The delay slot or a general instruction?
    // 4 for General Instructions, 6 for delay slot
    vectnum = 4; //  Fix me
 
    // Jump to Exception service routine
-   sh->regs.PC = sh->MappedMemoryReadLong(sh, sh->regs.VBR+(vectnum<<2));
+   sh->regs.PC = SH2MappedMemoryReadLong(sh, sh->regs.VBR+(vectnum<<2));
    sh->cycles++;
 }
 
@@ -365,9 +401,9 @@ static void FASTCALL SH2andm(SH2_struct * sh)
    s32 temp;
    s32 source = INSTRUCTION_CD(sh->instruction);
 
-   temp = (s32)sh->MappedMemoryReadByte(sh, sh->regs.GBR + sh->regs.R[0]);
+   temp = (s32)SH2MappedMemoryReadByte(sh, sh->regs.GBR + sh->regs.R[0]);
    temp &= source;
-   sh->MappedMemoryWriteByte(sh, (sh->regs.GBR + sh->regs.R[0]),temp);
+   SH2MappedMemoryWriteByte(sh, (sh->regs.GBR + sh->regs.R[0]),temp);
    sh->regs.PC += 2;
    sh->cycles += 3;
 }
@@ -969,7 +1005,7 @@ static void FASTCALL SH2ldcmgbr(SH2_struct * sh)
 {
    s32 m = INSTRUCTION_B(sh->instruction);
 
-   sh->regs.GBR = sh->MappedMemoryReadLong(sh, sh->regs.R[m]);
+   sh->regs.GBR = SH2MappedMemoryReadLong(sh, sh->regs.R[m]);
    sh->regs.R[m] += 4;
    sh->regs.PC += 2;
    sh->cycles += 3;
@@ -981,7 +1017,7 @@ static void FASTCALL SH2ldcmsr(SH2_struct * sh)
 {
    s32 m = INSTRUCTION_B(sh->instruction);
 
-   sh->regs.SR.all = sh->MappedMemoryReadLong(sh, sh->regs.R[m]) & 0x000003F3;
+   sh->regs.SR.all = SH2MappedMemoryReadLong(sh, sh->regs.R[m]) & 0x000003F3;
    sh->regs.R[m] += 4;
    sh->regs.PC += 2;
    sh->cycles += 3;
@@ -993,7 +1029,7 @@ static void FASTCALL SH2ldcmvbr(SH2_struct * sh)
 {
    s32 m = INSTRUCTION_B(sh->instruction);
 
-   sh->regs.VBR = sh->MappedMemoryReadLong(sh, sh->regs.R[m]);
+   sh->regs.VBR = SH2MappedMemoryReadLong(sh, sh->regs.R[m]);
    sh->regs.R[m] += 4;
    sh->regs.PC += 2;
    sh->cycles += 3;
@@ -1042,7 +1078,7 @@ static void FASTCALL SH2ldsmacl(SH2_struct * sh)
 static void FASTCALL SH2ldsmmach(SH2_struct * sh)
 {
    s32 m = INSTRUCTION_B(sh->instruction);
-   sh->regs.MACH = sh->MappedMemoryReadLong(sh, sh->regs.R[m]);
+   sh->regs.MACH = SH2MappedMemoryReadLong(sh, sh->regs.R[m]);
    sh->regs.R[m] += 4;
    sh->regs.PC += 2;
    sh->cycles++;
@@ -1053,7 +1089,7 @@ static void FASTCALL SH2ldsmmach(SH2_struct * sh)
 static void FASTCALL SH2ldsmmacl(SH2_struct * sh)
 {
    s32 m = INSTRUCTION_B(sh->instruction);
-   sh->regs.MACL = sh->MappedMemoryReadLong(sh, sh->regs.R[m]);
+   sh->regs.MACL = SH2MappedMemoryReadLong(sh, sh->regs.R[m]);
    sh->regs.R[m] += 4;
    sh->regs.PC += 2;
    sh->cycles++;
@@ -1064,7 +1100,7 @@ static void FASTCALL SH2ldsmmacl(SH2_struct * sh)
 static void FASTCALL SH2ldsmpr(SH2_struct * sh)
 {
    s32 m = INSTRUCTION_B(sh->instruction);
-   sh->regs.PR = sh->MappedMemoryReadLong(sh, sh->regs.R[m]);
+   sh->regs.PR = SH2MappedMemoryReadLong(sh, sh->regs.R[m]);
    sh->regs.R[m] += 4;
    sh->regs.PC += 2;
    sh->cycles++;
@@ -1089,9 +1125,9 @@ static void FASTCALL SH2macl(SH2_struct * sh)
    s32 m = INSTRUCTION_C(sh->instruction);
    s32 n = INSTRUCTION_B(sh->instruction);
 
-   tempn = (s32)sh->MappedMemoryReadLong(sh, sh->regs.R[n]);
+   tempn = (s32)SH2MappedMemoryReadLong(sh, sh->regs.R[n]);
    sh->regs.R[n] += 4;
-   tempm = (s32)sh->MappedMemoryReadLong(sh, sh->regs.R[m]);
+   tempm = (s32)SH2MappedMemoryReadLong(sh, sh->regs.R[m]);
    sh->regs.R[m] += 4;
 
    if ((s32) (tempn^tempm) < 0)
@@ -1182,9 +1218,9 @@ static void FASTCALL SH2macw(SH2_struct * sh)
    s32 m = INSTRUCTION_C(sh->instruction);
    s32 n = INSTRUCTION_B(sh->instruction);
 
-   tempn=(s32)sh->MappedMemoryReadWord(sh, sh->regs.R[n]);
+   tempn=(s32)SH2MappedMemoryReadWord(sh, sh->regs.R[n]);
    sh->regs.R[n]+=2;
-   tempm=(s32)sh->MappedMemoryReadWord(sh, sh->regs.R[m]);
+   tempm=(s32)SH2MappedMemoryReadWord(sh, sh->regs.R[m]);
    sh->regs.R[m]+=2;
    templ=sh->regs.MACL;
    tempm=((s32)(s16)tempn*(s32)(s16)tempm);
@@ -1257,7 +1293,7 @@ static void FASTCALL SH2movbl(SH2_struct * sh)
    s32 m = INSTRUCTION_C(sh->instruction);
    s32 n = INSTRUCTION_B(sh->instruction);
 
-   sh->regs.R[n] = (s32)(s8)sh->MappedMemoryReadByte(sh, sh->regs.R[m]);
+   sh->regs.R[n] = (s32)(s8)SH2MappedMemoryReadByte(sh, sh->regs.R[m]);
    sh->regs.PC += 2;
    sh->cycles++;
 }
@@ -1269,7 +1305,7 @@ static void FASTCALL SH2movbl0(SH2_struct * sh)
    s32 m = INSTRUCTION_C(sh->instruction);
    s32 n = INSTRUCTION_B(sh->instruction);
 
-   sh->regs.R[n] = (s32)(s8)sh->MappedMemoryReadByte(sh, sh->regs.R[m] + sh->regs.R[0]);
+   sh->regs.R[n] = (s32)(s8)SH2MappedMemoryReadByte(sh, sh->regs.R[m] + sh->regs.R[0]);
    sh->regs.PC += 2;
    sh->cycles++;
 }
@@ -1281,7 +1317,7 @@ static void FASTCALL SH2movbl4(SH2_struct * sh)
    s32 m = INSTRUCTION_C(sh->instruction);
    s32 disp = INSTRUCTION_D(sh->instruction);
 
-   sh->regs.R[0] = (s32)(s8)sh->MappedMemoryReadByte(sh, sh->regs.R[m] + disp);
+   sh->regs.R[0] = (s32)(s8)SH2MappedMemoryReadByte(sh, sh->regs.R[m] + disp);
    sh->regs.PC+=2;
    sh->cycles++;
 }
@@ -1292,7 +1328,7 @@ static void FASTCALL SH2movblg(SH2_struct * sh)
 {
    s32 disp = INSTRUCTION_CD(sh->instruction);
   
-   sh->regs.R[0] = (s32)(s8)sh->MappedMemoryReadByte(sh, sh->regs.GBR + disp);
+   sh->regs.R[0] = (s32)(s8)SH2MappedMemoryReadByte(sh, sh->regs.GBR + disp);
    sh->regs.PC+=2;
    sh->cycles++;
 }
@@ -1304,7 +1340,7 @@ static void FASTCALL SH2movbm(SH2_struct * sh)
    s32 m = INSTRUCTION_C(sh->instruction);
    s32 n = INSTRUCTION_B(sh->instruction);
 
-   sh->MappedMemoryWriteByte(sh, (sh->regs.R[n] - 1),sh->regs.R[m]);
+   SH2MappedMemoryWriteByte(sh, (sh->regs.R[n] - 1),sh->regs.R[m]);
    sh->regs.R[n] -= 1;
    sh->regs.PC += 2;
    sh->cycles++;
@@ -1317,7 +1353,7 @@ static void FASTCALL SH2movbp(SH2_struct * sh)
    s32 m = INSTRUCTION_C(sh->instruction);
    s32 n = INSTRUCTION_B(sh->instruction);
 
-   sh->regs.R[n] = (s32)(s8)sh->MappedMemoryReadByte(sh, sh->regs.R[m]);
+   sh->regs.R[n] = (s32)(s8)SH2MappedMemoryReadByte(sh, sh->regs.R[m]);
    if (n != m)
      sh->regs.R[m] += 1;
    sh->regs.PC += 2;
@@ -1331,7 +1367,7 @@ static void FASTCALL SH2movbs(SH2_struct * sh)
    int b = INSTRUCTION_B(sh->instruction);
    int c = INSTRUCTION_C(sh->instruction);
 
-   sh->MappedMemoryWriteByte(sh, sh->regs.R[b], sh->regs.R[c]);
+   SH2MappedMemoryWriteByte(sh, sh->regs.R[b], sh->regs.R[c]);
    sh->regs.PC += 2;
    sh->cycles++;
 }
@@ -1340,7 +1376,7 @@ static void FASTCALL SH2movbs(SH2_struct * sh)
 
 static void FASTCALL SH2movbs0(SH2_struct * sh)
 {
-   sh->MappedMemoryWriteByte(sh, sh->regs.R[INSTRUCTION_B(sh->instruction)] + sh->regs.R[0],
+   SH2MappedMemoryWriteByte(sh, sh->regs.R[INSTRUCTION_B(sh->instruction)] + sh->regs.R[0],
                          sh->regs.R[INSTRUCTION_C(sh->instruction)]);
    sh->regs.PC += 2;
    sh->cycles++;
@@ -1353,7 +1389,7 @@ static void FASTCALL SH2movbs4(SH2_struct * sh)
    s32 disp = INSTRUCTION_D(sh->instruction);
    s32 n = INSTRUCTION_C(sh->instruction);
 
-   sh->MappedMemoryWriteByte(sh, sh->regs.R[n]+disp,sh->regs.R[0]);
+   SH2MappedMemoryWriteByte(sh, sh->regs.R[n]+disp,sh->regs.R[0]);
    sh->regs.PC+=2;
    sh->cycles++;
 }
@@ -1364,7 +1400,7 @@ static void FASTCALL SH2movbsg(SH2_struct * sh)
 {
    s32 disp = INSTRUCTION_CD(sh->instruction);
 
-   sh->MappedMemoryWriteByte(sh, sh->regs.GBR + disp,sh->regs.R[0]);
+   SH2MappedMemoryWriteByte(sh, sh->regs.GBR + disp,sh->regs.R[0]);
    sh->regs.PC += 2;
    sh->cycles++;
 }
@@ -1388,7 +1424,7 @@ static void FASTCALL SH2movli(SH2_struct * sh)
    s32 disp = INSTRUCTION_CD(sh->instruction);
    s32 n = INSTRUCTION_B(sh->instruction);
 
-   sh->regs.R[n] = sh->MappedMemoryReadLong(sh, ((sh->regs.PC + 4) & 0xFFFFFFFC) + (disp << 2));
+   sh->regs.R[n] = SH2MappedMemoryReadLong(sh, ((sh->regs.PC + 4) & 0xFFFFFFFC) + (disp << 2));
    sh->regs.PC += 2;
    sh->cycles++;
 }
@@ -1405,7 +1441,7 @@ static void FASTCALL SH2movll(SH2_struct * sh)
       return;
    }
 
-   sh->regs.R[INSTRUCTION_B(sh->instruction)] = sh->MappedMemoryReadLong(sh, addr);
+   sh->regs.R[INSTRUCTION_B(sh->instruction)] = SH2MappedMemoryReadLong(sh, addr);
    sh->regs.PC += 2;
    sh->cycles++;
 }
@@ -1414,7 +1450,7 @@ static void FASTCALL SH2movll(SH2_struct * sh)
 
 static void FASTCALL SH2movll0(SH2_struct * sh)
 {
-   sh->regs.R[INSTRUCTION_B(sh->instruction)] = sh->MappedMemoryReadLong(sh, sh->regs.R[INSTRUCTION_C(sh->instruction)] + sh->regs.R[0]);
+   sh->regs.R[INSTRUCTION_B(sh->instruction)] = SH2MappedMemoryReadLong(sh, sh->regs.R[INSTRUCTION_C(sh->instruction)] + sh->regs.R[0]);
    sh->regs.PC += 2;
    sh->cycles++;
 }
@@ -1427,7 +1463,7 @@ static void FASTCALL SH2movll4(SH2_struct * sh)
    s32 disp = INSTRUCTION_D(sh->instruction);
    s32 n = INSTRUCTION_B(sh->instruction);
 
-   sh->regs.R[n] = sh->MappedMemoryReadLong(sh, sh->regs.R[m] + (disp << 2));
+   sh->regs.R[n] = SH2MappedMemoryReadLong(sh, sh->regs.R[m] + (disp << 2));
    sh->regs.PC += 2;
    sh->cycles++;
 }
@@ -1438,7 +1474,7 @@ static void FASTCALL SH2movllg(SH2_struct * sh)
 {
    s32 disp = INSTRUCTION_CD(sh->instruction);
 
-   sh->regs.R[0] = sh->MappedMemoryReadLong(sh, sh->regs.GBR + (disp << 2));
+   sh->regs.R[0] = SH2MappedMemoryReadLong(sh, sh->regs.GBR + (disp << 2));
    sh->regs.PC+=2;
    sh->cycles++;
 }
@@ -1450,7 +1486,7 @@ static void FASTCALL SH2movlm(SH2_struct * sh)
    s32 m = INSTRUCTION_C(sh->instruction);
    s32 n = INSTRUCTION_B(sh->instruction);
 
-   sh->MappedMemoryWriteLong(sh, sh->regs.R[n] - 4,sh->regs.R[m]);
+   SH2MappedMemoryWriteLong(sh, sh->regs.R[n] - 4,sh->regs.R[m]);
    sh->regs.R[n] -= 4;
    sh->regs.PC += 2;
    sh->cycles++;
@@ -1463,7 +1499,7 @@ static void FASTCALL SH2movlp(SH2_struct * sh)
    s32 m = INSTRUCTION_C(sh->instruction);
    s32 n = INSTRUCTION_B(sh->instruction);
 
-   sh->regs.R[n] = sh->MappedMemoryReadLong(sh, sh->regs.R[m]);
+   sh->regs.R[n] = SH2MappedMemoryReadLong(sh, sh->regs.R[m]);
    if (n != m) sh->regs.R[m] += 4;
    sh->regs.PC += 2;
    sh->cycles++;
@@ -1476,7 +1512,7 @@ static void FASTCALL SH2movls(SH2_struct * sh)
    int b = INSTRUCTION_B(sh->instruction);
    int c = INSTRUCTION_C(sh->instruction);
 
-   sh->MappedMemoryWriteLong(sh, sh->regs.R[b], sh->regs.R[c]);
+   SH2MappedMemoryWriteLong(sh, sh->regs.R[b], sh->regs.R[c]);
    sh->regs.PC += 2;
    sh->cycles++;
 }
@@ -1485,7 +1521,7 @@ static void FASTCALL SH2movls(SH2_struct * sh)
 
 static void FASTCALL SH2movls0(SH2_struct * sh)
 {
-   sh->MappedMemoryWriteLong(sh, sh->regs.R[INSTRUCTION_B(sh->instruction)] + sh->regs.R[0],
+   SH2MappedMemoryWriteLong(sh, sh->regs.R[INSTRUCTION_B(sh->instruction)] + sh->regs.R[0],
                          sh->regs.R[INSTRUCTION_C(sh->instruction)]);
    sh->regs.PC += 2;
    sh->cycles++;
@@ -1499,7 +1535,7 @@ static void FASTCALL SH2movls4(SH2_struct * sh)
    s32 disp = INSTRUCTION_D(sh->instruction);
    s32 n = INSTRUCTION_B(sh->instruction);
 
-   sh->MappedMemoryWriteLong(sh, sh->regs.R[n]+(disp<<2),sh->regs.R[m]);
+   SH2MappedMemoryWriteLong(sh, sh->regs.R[n]+(disp<<2),sh->regs.R[m]);
    sh->regs.PC += 2;
    sh->cycles++;
 }
@@ -1510,7 +1546,7 @@ static void FASTCALL SH2movlsg(SH2_struct * sh)
 {
    s32 disp = INSTRUCTION_CD(sh->instruction);
 
-   sh->MappedMemoryWriteLong(sh, sh->regs.GBR+(disp<<2),sh->regs.R[0]);
+   SH2MappedMemoryWriteLong(sh, sh->regs.GBR+(disp<<2),sh->regs.R[0]);
    sh->regs.PC+=2;
    sh->cycles++;
 }
@@ -1531,7 +1567,7 @@ static void FASTCALL SH2movwi(SH2_struct * sh)
    s32 disp = INSTRUCTION_CD(sh->instruction);
    s32 n = INSTRUCTION_B(sh->instruction);
 
-   sh->regs.R[n] = (s32)(s16)sh->MappedMemoryReadWord(sh, sh->regs.PC + (disp<<1) + 4);
+   sh->regs.R[n] = (s32)(s16)SH2MappedMemoryReadWord(sh, sh->regs.PC + (disp<<1) + 4);
    sh->regs.PC+=2;
    sh->cycles++;
 }
@@ -1550,7 +1586,7 @@ static void FASTCALL SH2movwl(SH2_struct * sh)
       return;
    }
 
-   sh->regs.R[n] = (s32)(s16)sh->MappedMemoryReadWord(sh, addr);
+   sh->regs.R[n] = (s32)(s16)SH2MappedMemoryReadWord(sh, addr);
    sh->regs.PC += 2;
    sh->cycles++;
 }
@@ -1562,7 +1598,7 @@ static void FASTCALL SH2movwl0(SH2_struct * sh)
    s32 m = INSTRUCTION_C(sh->instruction);
    s32 n = INSTRUCTION_B(sh->instruction);
 
-   sh->regs.R[n] = (s32)(s16)sh->MappedMemoryReadWord(sh, sh->regs.R[m]+sh->regs.R[0]);
+   sh->regs.R[n] = (s32)(s16)SH2MappedMemoryReadWord(sh, sh->regs.R[m]+sh->regs.R[0]);
    sh->regs.PC+=2;
    sh->cycles++;
 }
@@ -1574,7 +1610,7 @@ static void FASTCALL SH2movwl4(SH2_struct * sh)
    s32 m = INSTRUCTION_C(sh->instruction);
    s32 disp = INSTRUCTION_D(sh->instruction);
 
-   sh->regs.R[0] = (s32)(s16)sh->MappedMemoryReadWord(sh, sh->regs.R[m]+(disp<<1));
+   sh->regs.R[0] = (s32)(s16)SH2MappedMemoryReadWord(sh, sh->regs.R[m]+(disp<<1));
    sh->regs.PC+=2;
    sh->cycles++;
 }
@@ -1585,7 +1621,7 @@ static void FASTCALL SH2movwlg(SH2_struct * sh)
 {
    s32 disp = INSTRUCTION_CD(sh->instruction);
 
-   sh->regs.R[0] = (s32)(s16)sh->MappedMemoryReadWord(sh, sh->regs.GBR+(disp<<1));
+   sh->regs.R[0] = (s32)(s16)SH2MappedMemoryReadWord(sh, sh->regs.GBR+(disp<<1));
    sh->regs.PC += 2;
    sh->cycles++;
 }
@@ -1597,7 +1633,7 @@ static void FASTCALL SH2movwm(SH2_struct * sh)
    s32 m = INSTRUCTION_C(sh->instruction);
    s32 n = INSTRUCTION_B(sh->instruction);
 
-   sh->MappedMemoryWriteWord(sh, sh->regs.R[n] - 2,sh->regs.R[m]);
+   SH2MappedMemoryWriteWord(sh, sh->regs.R[n] - 2,sh->regs.R[m]);
    sh->regs.R[n] -= 2;
    sh->regs.PC += 2;
    sh->cycles++;
@@ -1610,7 +1646,7 @@ static void FASTCALL SH2movwp(SH2_struct * sh)
    s32 m = INSTRUCTION_C(sh->instruction);
    s32 n = INSTRUCTION_B(sh->instruction);
 
-   sh->regs.R[n] = (s32)(s16)sh->MappedMemoryReadWord(sh, sh->regs.R[m]);
+   sh->regs.R[n] = (s32)(s16)SH2MappedMemoryReadWord(sh, sh->regs.R[m]);
    if (n != m)
       sh->regs.R[m] += 2;
    sh->regs.PC += 2;
@@ -1624,7 +1660,7 @@ static void FASTCALL SH2movws(SH2_struct * sh)
    s32 m = INSTRUCTION_C(sh->instruction);
    s32 n = INSTRUCTION_B(sh->instruction);
 
-   sh->MappedMemoryWriteWord(sh, sh->regs.R[n],sh->regs.R[m]);
+   SH2MappedMemoryWriteWord(sh, sh->regs.R[n],sh->regs.R[m]);
    sh->regs.PC += 2;
    sh->cycles++;
 }
@@ -1633,7 +1669,7 @@ static void FASTCALL SH2movws(SH2_struct * sh)
 
 static void FASTCALL SH2movws0(SH2_struct * sh)
 {
-   sh->MappedMemoryWriteWord(sh, sh->regs.R[INSTRUCTION_B(sh->instruction)] + sh->regs.R[0],
+   SH2MappedMemoryWriteWord(sh, sh->regs.R[INSTRUCTION_B(sh->instruction)] + sh->regs.R[0],
                          sh->regs.R[INSTRUCTION_C(sh->instruction)]);
    sh->regs.PC+=2;
    sh->cycles++;
@@ -1646,7 +1682,7 @@ static void FASTCALL SH2movws4(SH2_struct * sh)
    s32 disp = INSTRUCTION_D(sh->instruction);
    s32 n = INSTRUCTION_C(sh->instruction);
 
-   sh->MappedMemoryWriteWord(sh, sh->regs.R[n]+(disp<<1),sh->regs.R[0]);
+   SH2MappedMemoryWriteWord(sh, sh->regs.R[n]+(disp<<1),sh->regs.R[0]);
    sh->regs.PC+=2;
    sh->cycles++;
 }
@@ -1657,7 +1693,7 @@ static void FASTCALL SH2movwsg(SH2_struct * sh)
 {
    s32 disp = INSTRUCTION_CD(sh->instruction);
 
-   sh->MappedMemoryWriteWord(sh, sh->regs.GBR+(disp<<1),sh->regs.R[0]);
+   SH2MappedMemoryWriteWord(sh, sh->regs.GBR+(disp<<1),sh->regs.R[0]);
    sh->regs.PC+=2;
    sh->cycles++;
 }
@@ -1769,9 +1805,9 @@ static void FASTCALL SH2orm(SH2_struct * sh)
    s32 temp;
    s32 source = INSTRUCTION_CD(sh->instruction);
 
-   temp = (s32)sh->MappedMemoryReadByte(sh, sh->regs.GBR + sh->regs.R[0]);
+   temp = (s32)SH2MappedMemoryReadByte(sh, sh->regs.GBR + sh->regs.R[0]);
    temp |= source;
-   sh->MappedMemoryWriteByte(sh, sh->regs.GBR + sh->regs.R[0],temp);
+   SH2MappedMemoryWriteByte(sh, sh->regs.GBR + sh->regs.R[0],temp);
    sh->regs.PC += 2;
    sh->cycles += 3;
 }
@@ -1882,9 +1918,9 @@ static void FASTCALL SH2rte(SH2_struct * sh)
 {
    u32 temp;
    temp=sh->regs.PC;
-   sh->regs.PC = sh->MappedMemoryReadLong(sh, sh->regs.R[15]);
+   sh->regs.PC = SH2MappedMemoryReadLong(sh, sh->regs.R[15]);
    sh->regs.R[15] += 4;
-   sh->regs.SR.all = sh->MappedMemoryReadLong(sh, sh->regs.R[15]) & 0x000003F3;
+   sh->regs.SR.all = SH2MappedMemoryReadLong(sh, sh->regs.R[15]) & 0x000003F3;
    sh->regs.R[15] += 4;
    sh->cycles += 4;
    SH2delay(sh, temp + 2);
@@ -2059,7 +2095,7 @@ static void FASTCALL SH2stcmgbr(SH2_struct * sh)
 {
    s32 n = INSTRUCTION_B(sh->instruction);
    sh->regs.R[n]-=4;
-   sh->MappedMemoryWriteLong(sh, sh->regs.R[n],sh->regs.GBR);
+   SH2MappedMemoryWriteLong(sh, sh->regs.R[n],sh->regs.GBR);
    sh->regs.PC+=2;
    sh->cycles += 2;
 }
@@ -2070,7 +2106,7 @@ static void FASTCALL SH2stcmsr(SH2_struct * sh)
 {
    s32 n = INSTRUCTION_B(sh->instruction);
    sh->regs.R[n]-=4;
-   sh->MappedMemoryWriteLong(sh, sh->regs.R[n],sh->regs.SR.all);
+   SH2MappedMemoryWriteLong(sh, sh->regs.R[n],sh->regs.SR.all);
    sh->regs.PC+=2;
    sh->cycles += 2;
 }
@@ -2081,7 +2117,7 @@ static void FASTCALL SH2stcmvbr(SH2_struct * sh)
 {
    s32 n = INSTRUCTION_B(sh->instruction);
    sh->regs.R[n]-=4;
-   sh->MappedMemoryWriteLong(sh,sh->regs.R[n],sh->regs.VBR);
+   SH2MappedMemoryWriteLong(sh,sh->regs.R[n],sh->regs.VBR);
    sh->regs.PC+=2;
    sh->cycles += 2;
 }
@@ -2132,7 +2168,7 @@ static void FASTCALL SH2stsmmach(SH2_struct * sh)
 {
    s32 n = INSTRUCTION_B(sh->instruction);
    sh->regs.R[n] -= 4;
-   sh->MappedMemoryWriteLong(sh, sh->regs.R[n],sh->regs.MACH);
+   SH2MappedMemoryWriteLong(sh, sh->regs.R[n],sh->regs.MACH);
    sh->regs.PC+=2;
    sh->cycles++;
 }
@@ -2143,7 +2179,7 @@ static void FASTCALL SH2stsmmacl(SH2_struct * sh)
 {
    s32 n = INSTRUCTION_B(sh->instruction);
    sh->regs.R[n] -= 4;
-   sh->MappedMemoryWriteLong(sh, sh->regs.R[n],sh->regs.MACL);
+   SH2MappedMemoryWriteLong(sh, sh->regs.R[n],sh->regs.MACL);
    sh->regs.PC+=2;
    sh->cycles++;
 }
@@ -2154,7 +2190,7 @@ static void FASTCALL SH2stsmpr(SH2_struct * sh)
 {
    s32 n = INSTRUCTION_B(sh->instruction);
    sh->regs.R[n] -= 4;
-   sh->MappedMemoryWriteLong(sh, sh->regs.R[n],sh->regs.PR);
+   SH2MappedMemoryWriteLong(sh, sh->regs.R[n],sh->regs.PR);
    sh->regs.PC+=2;
    sh->cycles++;
 }
@@ -2283,7 +2319,7 @@ static void FASTCALL SH2tas(SH2_struct * sh)
    s32 temp;
    s32 n = INSTRUCTION_B(sh->instruction);
 
-   temp=(s32)sh->MappedMemoryReadByte(sh, sh->regs.R[n]);
+   temp=(s32)SH2MappedMemoryReadByte(sh, sh->regs.R[n]);
 
    if (temp==0)
       sh->regs.SR.part.T=1;
@@ -2291,7 +2327,7 @@ static void FASTCALL SH2tas(SH2_struct * sh)
       sh->regs.SR.part.T=0;
 
    temp|=0x00000080;
-   sh->MappedMemoryWriteByte(sh, sh->regs.R[n],temp);
+   SH2MappedMemoryWriteByte(sh, sh->regs.R[n],temp);
    sh->regs.PC+=2;
    sh->cycles += 4;
 }
@@ -2303,10 +2339,10 @@ static void FASTCALL SH2trapa(SH2_struct * sh)
    s32 imm = INSTRUCTION_CD(sh->instruction);
 
    sh->regs.R[15]-=4;
-   sh->MappedMemoryWriteLong(sh, sh->regs.R[15],sh->regs.SR.all);
+   SH2MappedMemoryWriteLong(sh, sh->regs.R[15],sh->regs.SR.all);
    sh->regs.R[15]-=4;
-   sh->MappedMemoryWriteLong(sh, sh->regs.R[15],sh->regs.PC + 2);
-   sh->regs.PC = sh->MappedMemoryReadLong(sh, sh->regs.VBR+(imm<<2));
+   SH2MappedMemoryWriteLong(sh, sh->regs.R[15],sh->regs.PC + 2);
+   sh->regs.PC = SH2MappedMemoryReadLong(sh, sh->regs.VBR+(imm<<2));
    sh->cycles += 8;
 }
 
@@ -2351,7 +2387,7 @@ static void FASTCALL SH2tstm(SH2_struct * sh)
    s32 temp;
    s32 i = INSTRUCTION_CD(sh->instruction);
 
-   temp=(s32)sh->MappedMemoryReadByte(sh, sh->regs.GBR+sh->regs.R[0]);
+   temp=(s32)SH2MappedMemoryReadByte(sh, sh->regs.GBR+sh->regs.R[0]);
    temp&=i;
 
    if (temp==0)
@@ -2392,9 +2428,9 @@ static void FASTCALL SH2xorm(SH2_struct * sh)
    s32 source = INSTRUCTION_CD(sh->instruction);
    s32 temp;
 
-   temp = (s32)sh->MappedMemoryReadByte(sh, sh->regs.GBR + sh->regs.R[0]);
+   temp = (s32)SH2MappedMemoryReadByte(sh, sh->regs.GBR + sh->regs.R[0]);
    temp ^= source;
-   sh->MappedMemoryWriteByte(sh, sh->regs.GBR + sh->regs.R[0],temp);
+   SH2MappedMemoryWriteByte(sh, sh->regs.GBR + sh->regs.R[0],temp);
    sh->regs.PC += 2;
    sh->cycles += 3;
 }
@@ -2853,11 +2889,11 @@ static INLINE void SH2UBCInterrupt(SH2_struct *context, u32 flag)
    if (15 > context->regs.SR.part.I) // Since UBC's interrupt are always level 15
    {
       context->regs.R[15] -= 4;
-      context->MappedMemoryWriteLong(context, context->regs.R[15], context->regs.SR.all);
+      SH2MappedMemoryWriteLong(context, context->regs.R[15], context->regs.SR.all);
       context->regs.R[15] -= 4;
-      context->MappedMemoryWriteLong(context, context->regs.R[15], context->regs.PC);
+      SH2MappedMemoryWriteLong(context, context->regs.R[15], context->regs.PC);
       context->regs.SR.part.I = 15;
-      context->regs.PC = context->MappedMemoryReadLong(context, context->regs.VBR + (12 << 2));
+      context->regs.PC = SH2MappedMemoryReadLong(context, context->regs.VBR + (12 << 2));
       LOG("interrupt successfully handled\n");
    }
    context->onchip.BRCR |= flag;
@@ -2872,11 +2908,11 @@ static INLINE void SH2HandleInterrupts(SH2_struct *context)
       if (context->interrupts[context->NumberOfInterrupts-1].level > context->regs.SR.part.I)
       {
          context->regs.R[15] -= 4;
-         context->MappedMemoryWriteLong(context, context->regs.R[15], context->regs.SR.all);
+         SH2MappedMemoryWriteLong(context, context->regs.R[15], context->regs.SR.all);
          context->regs.R[15] -= 4;
-         context->MappedMemoryWriteLong(context, context->regs.R[15], context->regs.PC);
+         SH2MappedMemoryWriteLong(context, context->regs.R[15], context->regs.PC);
          context->regs.SR.part.I = context->interrupts[context->NumberOfInterrupts-1].level;
-         context->regs.PC = context->MappedMemoryReadLong(context, context->regs.VBR + (context->interrupts[context->NumberOfInterrupts-1].vector << 2));
+         context->regs.PC = SH2MappedMemoryReadLong(context, context->regs.VBR + (context->interrupts[context->NumberOfInterrupts-1].vector << 2));
          context->NumberOfInterrupts--;
          context->isIdle = 0;
          context->isSleeping = 0;
@@ -2989,6 +3025,35 @@ FASTCALL void SH2DebugInterpreterExec(SH2_struct *context, u32 cycles)
 
 //////////////////////////////////////////////////////////////////////////////
 
+static INLINE void SH2InterpreterStep(SH2_struct *context)
+{
+   int cycles_before = context->cycles;
+   int cycles_diff = 0;
+   // Fetch Instruction
+
+   if (yabsys.sh2_cache_enabled)
+   {
+      if ((context->regs.PC & 0xC0000000) == 0xC0000000)
+         context->instruction = DataArrayReadWord(context, context->regs.PC);
+      else
+         context->instruction = ((fetchfunc *)context->fetchlist)[(context->regs.PC >> 20) & 0x0FF](context, context->regs.PC);
+   }
+   else
+   {
+      context->instruction = ((fetchfunc *)context->fetchlist)[(context->regs.PC >> 20) & 0x0FF](context, context->regs.PC);
+   }
+
+   // Execute it
+   ((opcodefunc *)context->opcodes)[context->instruction](context);
+
+   cycles_diff = context->cycles - cycles_before;
+
+   if (context->model == SHMT_SH1)
+      sh1_dma_exec(cycles_diff);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
 FASTCALL void SH2InterpreterExec(SH2_struct *context, u32 cycles)
 {
    SH2HandleInterrupts(context);
@@ -3002,30 +3067,519 @@ FASTCALL void SH2InterpreterExec(SH2_struct *context, u32 cycles)
    }
 
    while(context->cycles < cycles)
+      SH2InterpreterStep(context);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+// Block interpreter: runs of instructions are decoded once into a list of
+// handlers and replayed without going through fetchlist/opcodes again.
+// Blocks are invalidated through the same per-page write tracking as the jit.
+
+#define BLOCK_MAX_INSTRUCTIONS  64
+#define BLOCKS_PER_PAGE         ((1 << SH2_CODE_PAGE_SHIFT) / 2)
+
+typedef struct decodedop_s decodedop_struct;
+typedef void (FASTCALL *decodedfunc)(SH2_struct *, const decodedop_struct *);
+
+// Simple register ops get a handler that works off the operands decoded
+// here, the executor then steps PC and adds the fixed cycle count. Anything
+// that touches memory, branches or has a variable cost has exec left NULL
+// and goes through the regular handler.
+struct decodedop_s
+{
+   opcodefunc func;
+   decodedfunc exec;
+   u16 instruction;
+   u8 n;
+   u8 m;
+   u8 cycles;
+   s32 imm;
+};
+
+typedef struct
+{
+   u32 start_pc;
+   u32 end_pc;
+   int dirty;
+   int count;
+   decodedop_struct ops[1];
+} decodedblock_struct;
+
+typedef struct
+{
+   decodedblock_struct *blocks[BLOCKS_PER_PAGE];
+} decodedpage_struct;
+
+// One map for the SH1, one shared by the master and slave SH2
+static decodedpage_struct *decoded_pages[2][SH2_CODE_NUM_PAGES];
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void FASTCALL SH2Decodedmov(SH2_struct * sh, const decodedop_struct * op)
+{
+   sh->regs.R[op->n] = sh->regs.R[op->m];
+}
+
+static void FASTCALL SH2Decodedmovi(SH2_struct * sh, const decodedop_struct * op)
+{
+   sh->regs.R[op->n] = (u32)op->imm;
+}
+
+static void FASTCALL SH2Decodedadd(SH2_struct * sh, const decodedop_struct * op)
+{
+   sh->regs.R[op->n] += sh->regs.R[op->m];
+}
+
+static void FASTCALL SH2Decodedaddi(SH2_struct * sh, const decodedop_struct * op)
+{
+   sh->regs.R[op->n] += (u32)op->imm;
+}
+
+static void FASTCALL SH2Decodedsub(SH2_struct * sh, const decodedop_struct * op)
+{
+   sh->regs.R[op->n] -= sh->regs.R[op->m];
+}
+
+static void FASTCALL SH2Decodedand(SH2_struct * sh, const decodedop_struct * op)
+{
+   sh->regs.R[op->n] &= sh->regs.R[op->m];
+}
+
+static void FASTCALL SH2Decodedor(SH2_struct * sh, const decodedop_struct * op)
+{
+   sh->regs.R[op->n] |= sh->regs.R[op->m];
+}
+
+static void FASTCALL SH2Decodedxor(SH2_struct * sh, const decodedop_struct * op)
+{
+   sh->regs.R[op->n] ^= sh->regs.R[op->m];
+}
+
+static void FASTCALL SH2Decodednot(SH2_struct * sh, const decodedop_struct * op)
+{
+   sh->regs.R[op->n] = ~sh->regs.R[op->m];
+}
+
+static void FASTCALL SH2Decodedtst(SH2_struct * sh, const decodedop_struct * op)
+{
+   sh->regs.SR.part.T = (sh->regs.R[op->n] & sh->regs.R[op->m]) == 0;
+}
+
+static void FASTCALL SH2Decodedcmpeq(SH2_struct * sh, const decodedop_struct * op)
+{
+   sh->regs.SR.part.T = sh->regs.R[op->n] == sh->regs.R[op->m];
+}
+
+static void FASTCALL SH2Decodedcmpim(SH2_struct * sh, const decodedop_struct * op)
+{
+   sh->regs.SR.part.T = sh->regs.R[0] == (u32)op->imm;
+}
+
+static void FASTCALL SH2Decodeddt(SH2_struct * sh, const decodedop_struct * op)
+{
+   sh->regs.SR.part.T = --sh->regs.R[op->n] == 0;
+}
+
+static void FASTCALL SH2Decodedshll(SH2_struct * sh, const decodedop_struct * op)
+{
+   sh->regs.SR.part.T = sh->regs.R[op->n] >> 31;
+   sh->regs.R[op->n] <<= 1;
+}
+
+static void FASTCALL SH2Decodedshlr(SH2_struct * sh, const decodedop_struct * op)
+{
+   sh->regs.SR.part.T = sh->regs.R[op->n] & 1;
+   sh->regs.R[op->n] >>= 1;
+}
+
+static void FASTCALL SH2Decodedshll2(SH2_struct * sh, const decodedop_struct * op)
+{
+   sh->regs.R[op->n] <<= 2;
+}
+
+static void FASTCALL SH2Decodedshlr2(SH2_struct * sh, const decodedop_struct * op)
+{
+   sh->regs.R[op->n] >>= 2;
+}
+
+static void FASTCALL SH2Decodedshll8(SH2_struct * sh, const decodedop_struct * op)
+{
+   sh->regs.R[op->n] <<= 8;
+}
+
+static void FASTCALL SH2Decodedshlr8(SH2_struct * sh, const decodedop_struct * op)
+{
+   sh->regs.R[op->n] >>= 8;
+}
+
+static void FASTCALL SH2Decodedshll16(SH2_struct * sh, const decodedop_struct * op)
+{
+   sh->regs.R[op->n] <<= 16;
+}
+
+static void FASTCALL SH2Decodedshlr16(SH2_struct * sh, const decodedop_struct * op)
+{
+   sh->regs.R[op->n] >>= 16;
+}
+
+static void FASTCALL SH2Decodedextub(SH2_struct * sh, const decodedop_struct * op)
+{
+   sh->regs.R[op->n] = (u32)(u8)sh->regs.R[op->m];
+}
+
+static void FASTCALL SH2Decodedextuw(SH2_struct * sh, const decodedop_struct * op)
+{
+   sh->regs.R[op->n] = (u32)(u16)sh->regs.R[op->m];
+}
+
+static void FASTCALL SH2Decodedextsb(SH2_struct * sh, const decodedop_struct * op)
+{
+   sh->regs.R[op->n] = (u32)(s8)sh->regs.R[op->m];
+}
+
+static void FASTCALL SH2Decodedextsw(SH2_struct * sh, const decodedop_struct * op)
+{
+   sh->regs.R[op->n] = (u32)(s16)sh->regs.R[op->m];
+}
+
+static void FASTCALL SH2Decodednop(SH2_struct * sh, const decodedop_struct * op)
+{
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static const struct
+{
+   opcodefunc func;
+   decodedfunc exec;
+} decodedops[] =
+{
+   { SH2mov, SH2Decodedmov },
+   { SH2movi, SH2Decodedmovi },
+   { SH2add, SH2Decodedadd },
+   { SH2addi, SH2Decodedaddi },
+   { SH2sub, SH2Decodedsub },
+   { SH2y_and, SH2Decodedand },
+   { SH2y_or, SH2Decodedor },
+   { SH2y_xor, SH2Decodedxor },
+   { SH2y_not, SH2Decodednot },
+   { SH2tst, SH2Decodedtst },
+   { SH2cmpeq, SH2Decodedcmpeq },
+   { SH2cmpim, SH2Decodedcmpim },
+   { SH2dt, SH2Decodeddt },
+   { SH2shll, SH2Decodedshll },
+   { SH2shlr, SH2Decodedshlr },
+   { SH2shll2, SH2Decodedshll2 },
+   { SH2shlr2, SH2Decodedshlr2 },
+   { SH2shll8, SH2Decodedshll8 },
+   { SH2shlr8, SH2Decodedshlr8 },
+   { SH2shll16, SH2Decodedshll16 },
+   { SH2shlr16, SH2Decodedshlr16 },
+   { SH2extub, SH2Decodedextub },
+   { SH2extuw, SH2Decodedextuw },
+   { SH2extsb, SH2Decodedextsb },
+   { SH2extsw, SH2Decodedextsw },
+   { SH2nop, SH2Decodednop }
+};
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void SH2DecodeOperands(decodedop_struct *op)
+{
+   int i;
+
+   op->n = INSTRUCTION_B(op->instruction);
+   op->m = INSTRUCTION_C(op->instruction);
+   op->imm = (s32)(s8)INSTRUCTION_CD(op->instruction);
+   op->cycles = 1;
+   op->exec = NULL;
+
+   for (i = 0; i < sizeof(decodedops) / sizeof(decodedops[0]); i++)
+   {
+      if (decodedops[i].func == op->func)
+      {
+         op->exec = decodedops[i].exec;
+         break;
+      }
+   }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static int SH2IsBlockEnd(opcodefunc func)
+{
+   return func == SH2bf || func == SH2bfs || func == SH2bra || func == SH2braf ||
+          func == SH2bsr || func == SH2bsrf || func == SH2bt || func == SH2bts ||
+          func == SH2jmp || func == SH2jsr || func == SH2rte || func == SH2rts ||
+          func == SH2trapa || func == SH2sleep || func == SH2undecoded;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static u32 SH2BlockAddress(SH2_struct *context, u32 pc)
+{
+   // SH1 code is only cached from ROM
+   if (context->model == SHMT_SH1)
+      return (pc & 0xFFF00000) == 0 ? pc : 0xFFFFFFFF;
+
+   return SH2FoldCodeAddress(pc);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static decodedblock_struct *SH2DecodeBlock(SH2_struct *context, u32 addr)
+{
+   decodedop_struct ops[BLOCK_MAX_INSTRUCTIONS];
+   decodedblock_struct *block;
+   u32 pc = context->regs.PC;
+   int count = 0;
+
+   for (;;)
+   {
+      u16 instruction;
+
+      // With the cache on, fetching would update it. The instruction is
+      // checked against the real fetch when the block runs instead.
+      if (yabsys.sh2_cache_enabled && context->model != SHMT_SH1)
+         instruction = MappedMemoryReadWordNocache(context, pc);
+      else
+         instruction = ((fetchfunc *)context->fetchlist)[(pc >> 20) & 0x0FF](context, pc);
+
+      ops[count].instruction = instruction;
+      ops[count].func = ((opcodefunc *)context->opcodes)[instruction];
+      SH2DecodeOperands(&ops[count]);
+      count++;
+
+      if (SH2IsBlockEnd(ops[count - 1].func) || count == BLOCK_MAX_INSTRUCTIONS)
+         break;
+
+      // Only a delay slot may cross into the next page
+      pc += 2;
+      if ((pc & ((1 << SH2_CODE_PAGE_SHIFT) - 1)) == 0)
+         break;
+   }
+
+   if ((block = (decodedblock_struct *)malloc(sizeof(decodedblock_struct) + (count - 1) * sizeof(decodedop_struct))) == NULL)
+      return NULL;
+
+   memcpy(block->ops, ops, count * sizeof(decodedop_struct));
+   block->count = count;
+   block->dirty = 0;
+   block->start_pc = addr;
+   // Covers the delay slot of a branch ending the block
+   block->end_pc = addr + count * 2 + 2;
+
+   if (context->model != SHMT_SH1)
+   {
+      SH2CodePages[block->start_pc >> SH2_CODE_PAGE_SHIFT] = 1;
+      SH2CodePages[(block->end_pc - 1) >> SH2_CODE_PAGE_SHIFT] = 1;
+   }
+
+   return block;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static decodedblock_struct *SH2GetDecodedBlock(SH2_struct *context)
+{
+   u32 addr = SH2BlockAddress(context, context->regs.PC);
+   decodedpage_struct **page;
+   decodedblock_struct **block;
+
+   if (addr == 0xFFFFFFFF)
+      return NULL;
+
+   page = &decoded_pages[context->model == SHMT_SH1][addr >> SH2_CODE_PAGE_SHIFT];
+
+   if (*page == NULL && (*page = (decodedpage_struct *)calloc(1, sizeof(decodedpage_struct))) == NULL)
+      return NULL;
+
+   block = &(*page)->blocks[(addr & ((1 << SH2_CODE_PAGE_SHIFT) - 1)) >> 1];
+
+   // Invalidated blocks are only freed here, never while they're running
+   if (*block && (*block)->dirty)
+   {
+      free(*block);
+      *block = NULL;
+   }
+
+   if (*block == NULL)
+      *block = SH2DecodeBlock(context, addr);
+
+   return *block;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static INLINE void SH2RunDecodedBlock(SH2_struct *context, decodedblock_struct *block, u32 cycles)
+{
+   u32 pc = context->regs.PC;
+   int i;
+
+   for (i = 0; i < block->count; i++)
    {
+      const decodedop_struct *op = &block->ops[i];
       int cycles_before = context->cycles;
-      int cycles_diff = 0;
-      // Fetch Instruction
 
       if (yabsys.sh2_cache_enabled)
       {
-         if ((context->regs.PC & 0xC0000000) == 0xC0000000)
-            context->instruction = DataArrayReadWord(context, context->regs.PC);
+         // Keep the cache state exact and pick up anything the cache holds
+         // that differs from memory
+         context->instruction = ((fetchfunc *)context->fetchlist)[(pc >> 20) & 0x0FF](context, pc);
+
+         if (context->instruction == op->instruction)
+            op->func(context);
          else
-            context->instruction = ((fetchfunc *)context->fetchlist)[(context->regs.PC >> 20) & 0x0FF](context, context->regs.PC);
+            ((opcodefunc *)context->opcodes)[context->instruction](context);
+      }
+      else if (op->exec)
+      {
+         op->exec(context, op);
+         context->regs.PC += 2;
+         context->cycles += op->cycles;
       }
       else
       {
-         context->instruction = ((fetchfunc *)context->fetchlist)[(context->regs.PC >> 20) & 0x0FF](context, context->regs.PC);
+         context->instruction = op->instruction;
+         op->func(context);
       }
 
-      // Execute it
-      ((opcodefunc *)context->opcodes)[context->instruction](context);
+      if (context->model == SHMT_SH1)
+         sh1_dma_exec(context->cycles - cycles_before);
 
-      cycles_diff = context->cycles - cycles_before;
+      // Leave on anything that didn't just step to the next instruction,
+      // or when the block got overwritten
+      pc += 2;
+      if (context->regs.PC != pc || block->dirty || context->cycles >= cycles)
+         break;
+   }
+}
 
-      if (context->model == SHMT_SH1)
-         sh1_dma_exec(cycles_diff);
+//////////////////////////////////////////////////////////////////////////////
+
+static void SH2InvalidateDecodedBlocks(decodedpage_struct *page, u32 start, u32 end)
+{
+   int i;
+
+   if (page == NULL)
+      return;
+
+   for (i = 0; i < BLOCKS_PER_PAGE; i++)
+   {
+      decodedblock_struct *block = page->blocks[i];
+
+      if (block && block->start_pc < end && block->end_pc > start)
+         block->dirty = 1;
+   }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+int SH2BlockInterpreterInit(enum SHMODELTYPE model, SH2_struct *msh, SH2_struct *ssh)
+{
+   if (model != SHMT_SH1)
+      memset(SH2CodePages, 0, sizeof(SH2CodePages));
+
+   return SH2InterpreterInit(model, msh, ssh);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void SH2BlockInterpreterDeInit()
+{
+   int model, i, j;
+
+   for (model = 0; model < 2; model++)
+   {
+      for (i = 0; i < SH2_CODE_NUM_PAGES; i++)
+      {
+         if (decoded_pages[model][i] == NULL)
+            continue;
+
+         for (j = 0; j < BLOCKS_PER_PAGE; j++)
+            free(decoded_pages[model][i]->blocks[j]);
+
+         free(decoded_pages[model][i]);
+         decoded_pages[model][i] = NULL;
+      }
+   }
+
+   memset(SH2CodePages, 0, sizeof(SH2CodePages));
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void SH2BlockInterpreterReset(SH2_struct *context)
+{
+   int model = context->model == SHMT_SH1;
+   int i;
+
+   // Can be called from inside a block (SMPC), so only flag them
+   for (i = 0; i < SH2_CODE_NUM_PAGES; i++)
+      SH2InvalidateDecodedBlocks(decoded_pages[model][i], 0, 0xFFFFFFFF);
+
+   if (!model)
+      memset(SH2CodePages, 0, sizeof(SH2CodePages));
+
+   SH2InterpreterReset(context);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void SH2BlockInterpreterWriteNotify(u32 start, u32 length)
+{
+   u32 addr;
+
+   if (length == 0)
+      return;
+
+   for (addr = start & ~((1 << SH2_CODE_PAGE_SHIFT) - 1); addr < start + length; addr += 1 << SH2_CODE_PAGE_SHIFT)
+   {
+      u32 page = SH2FoldCodeAddress(addr);
+      u32 page_start;
+
+      if (page == 0xFFFFFFFF)
+         continue;
+
+      page >>= SH2_CODE_PAGE_SHIFT;
+
+      if (!SH2CodePages[page])
+         continue;
+
+      page_start = page << SH2_CODE_PAGE_SHIFT;
+      SH2InvalidateDecodedBlocks(decoded_pages[0][page], page_start, page_start + (1 << SH2_CODE_PAGE_SHIFT));
+
+      // A block at the end of the previous page can spill into this one
+      if (page > 0)
+         SH2InvalidateDecodedBlocks(decoded_pages[0][page - 1], page_start, page_start + (1 << SH2_CODE_PAGE_SHIFT));
+
+      SH2CodePages[page] = 0;
+   }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+FASTCALL void SH2BlockInterpreterExec(SH2_struct *context, u32 cycles)
+{
+   SH2HandleInterrupts(context);
+
+   if ((!yabsys.sh2_cache_enabled) && (context->model != SHMT_SH1))
+   {
+      if (context->isIdle)
+         SH2idleParse(context, cycles);
+      else
+         SH2idleCheck(context, cycles);
+   }
+
+   while(context->cycles < cycles)
+   {
+      decodedblock_struct *block = SH2GetDecodedBlock(context);
+
+      if (block)
+         SH2RunDecodedBlock(context, block, cycles);
+      else
+         SH2InterpreterStep(context);
    }
 }
 
@@ -873,7 +873,7 @@ void FASTCALL SmpcWriteLong(SH2_struct *sh, USED_IF_SMPC_DEBUG u32 addr, UNUSED
 
 //////////////////////////////////////////////////////////////////////////////
 
-int SmpcSaveState(FILE *fp)
+int SmpcSaveState(ystream_struct *fp)
 {
    int offset;
    IOCheck_struct check = { 0, 0 };
@@ -901,7 +901,7 @@ int SmpcSaveState(FILE *fp)
 
 //////////////////////////////////////////////////////////////////////////////
 
-int SmpcLoadState(FILE *fp, int version, int size)
+int SmpcLoadState(ystream_struct *fp, int version, int size)
 {
    IOCheck_struct check = { 0, 0 };
    int internalsizev2 = sizeof(SmpcInternal) - 8;
@@ -927,7 +927,7 @@ int SmpcLoadState(FILE *fp, int version, int size)
       else if ((size - 48) == 24)
          yread(&check, (void *)SmpcInternalVars, 24, 1, fp);
       else
-         fseek(fp, size - 48, SEEK_CUR);
+         yseek(fp, size - 48, SEEK_CUR);
    }
    else if (version == 2)
       yread(&check, (void *)SmpcInternalVars, internalsizev2, 1, fp);
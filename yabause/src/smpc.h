@@ -98,6 +98,6 @@ void FASTCALL	SmpcWriteByte(SH2_struct *, u32, u8);
 void FASTCALL	SmpcWriteWord(SH2_struct *, u32, u16);
 void FASTCALL	SmpcWriteLong(SH2_struct *, u32, u32);
 
-int SmpcSaveState(FILE *fp);
-int SmpcLoadState(FILE *fp, int version, int size);
+int SmpcSaveState(ystream_struct *fp);
+int SmpcLoadState(ystream_struct *fp, int version, int size);
 #endif
@@ -108,7 +108,7 @@ static int SNDWavInit(void)
    memcpy(waveheader.riff.id, "RIFF", 4);
    waveheader.riff.size = 0; // we'll fix this after the file is closed
    memcpy(waveheader.rifftype, "WAVE", 4);
-   ywrite(&check, (void *)&waveheader, 1, sizeof(waveheader_struct), wavefp);
+   yfwrite(&check, (void *)&waveheader, 1, sizeof(waveheader_struct), wavefp);
 
    // fmt chunk
    memcpy(fmt.chunk.id, "fmt ", 4);
@@ -119,12 +119,12 @@ static int SNDWavInit(void)
    fmt.bitspersample = 16;
    fmt.blockalign = fmt.bitspersample / 8 * fmt.numchan;
    fmt.bytespersec = fmt.rate * fmt.blockalign;
-   ywrite(&check, (void *)&fmt, 1, sizeof(fmt_struct), wavefp);
+   yfwrite(&check, (void *)&fmt, 1, sizeof(fmt_struct), wavefp);
 
    // data chunk
    memcpy(data.id, "data", 4);
    data.size = 0; // we'll fix this at the end
-   ywrite(&check, (void *)&data, 1, sizeof(chunk_struct), wavefp);
+   yfwrite(&check, (void *)&data, 1, sizeof(chunk_struct), wavefp);
 
    return 0;
 }
@@ -141,11 +141,11 @@ static void SNDWavDeInit(void)
       // Let's fix the riff chunk size and the data chunk size
       fseek(wavefp, sizeof(waveheader_struct)-0x8, SEEK_SET);
       length -= 0x4;
-      ywrite(&check, (void *)&length, 1, 4, wavefp);
+      yfwrite(&check, (void *)&length, 1, 4, wavefp);
 
       fseek(wavefp, sizeof(waveheader_struct)+sizeof(fmt_struct)+0x4, SEEK_SET);
       length -= sizeof(waveheader_struct)+sizeof(fmt_struct);
-      ywrite(&check, (void *)&length, 1, 4, wavefp);
+      yfwrite(&check, (void *)&length, 1, 4, wavefp);
       fclose(wavefp);
    }
 }
@@ -35,4 +35,12 @@ void YabThreadRemoteSleep(unsigned int id) {}
 
 void YabThreadWake(unsigned int id) {}
 
+YabSem * YabSemInit(int count) { return NULL; }
+
+void YabSemDeInit(YabSem * sem) {}
+
+void YabSemPost(YabSem * sem) {}
+
+void YabSemWait(YabSem * sem) {}
+
 //////////////////////////////////////////////////////////////////////////////
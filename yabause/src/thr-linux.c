@@ -122,3 +122,71 @@ void YabThreadWake(unsigned int id)
 }
 
 //////////////////////////////////////////////////////////////////////////////
+
+struct YabSem_struct
+{
+   pthread_mutex_t mutex;
+   pthread_cond_t cond;
+   int count;
+};
+
+//////////////////////////////////////////////////////////////////////////////
+
+YabSem * YabSemInit(int count)
+{
+   YabSem *sem;
+
+   if ((sem = (YabSem *)malloc(sizeof(YabSem))) == NULL)
+      return NULL;
+
+   if (pthread_mutex_init(&sem->mutex, NULL) != 0)
+   {
+      free(sem);
+      return NULL;
+   }
+
+   if (pthread_cond_init(&sem->cond, NULL) != 0)
+   {
+      pthread_mutex_destroy(&sem->mutex);
+      free(sem);
+      return NULL;
+   }
+
+   sem->count = count;
+   return sem;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void YabSemDeInit(YabSem * sem)
+{
+   if (sem == NULL)
+      return;
+
+   pthread_cond_destroy(&sem->cond);
+   pthread_mutex_destroy(&sem->mutex);
+   free(sem);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void YabSemPost(YabSem * sem)
+{
+   pthread_mutex_lock(&sem->mutex);
+   sem->count++;
+   pthread_cond_signal(&sem->cond);
+   pthread_mutex_unlock(&sem->mutex);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void YabSemWait(YabSem * sem)
+{
+   pthread_mutex_lock(&sem->mutex);
+   while (sem->count == 0)
+      pthread_cond_wait(&sem->cond, &sem->mutex);
+   sem->count--;
+   pthread_mutex_unlock(&sem->mutex);
+}
+
+//////////////////////////////////////////////////////////////////////////////
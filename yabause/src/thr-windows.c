@@ -133,3 +133,45 @@ void YabThreadWake(unsigned int id)
 }
 
 //////////////////////////////////////////////////////////////////////////////
+
+struct YabSem_struct
+{
+   HANDLE sem;
+};
+
+YabSem * YabSemInit(int count)
+{
+   YabSem *sem;
+
+   if ((sem = (YabSem *)malloc(sizeof(YabSem))) == NULL)
+      return NULL;
+
+   if ((sem->sem = CreateSemaphore(NULL, count, 0x7FFFFFFF, NULL)) == NULL)
+   {
+      free(sem);
+      return NULL;
+   }
+
+   return sem;
+}
+
+void YabSemDeInit(YabSem * sem)
+{
+   if (sem == NULL)
+      return;
+
+   CloseHandle(sem->sem);
+   free(sem);
+}
+
+void YabSemPost(YabSem * sem)
+{
+   ReleaseSemaphore(sem->sem, 1, NULL);
+}
+
+void YabSemWait(YabSem * sem)
+{
+   WaitForSingleObject(sem->sem, INFINITE);
+}
+
+//////////////////////////////////////////////////////////////////////////////
@@ -46,6 +46,10 @@ enum {
    YAB_THREAD_VIDSOFT_PRIORITY_3,
    YAB_THREAD_VIDSOFT_PRIORITY_4,
    YAB_THREAD_VIDSOFT_LAYER_SPRITE,
+   YAB_THREAD_VIDSOFT_WORKER_0,
+   YAB_THREAD_VIDSOFT_WORKER_LAST = YAB_THREAD_VIDSOFT_WORKER_0 + 7,
+   YAB_THREAD_VIDSOFT_VDP1_WORKER_0,
+   YAB_THREAD_VIDSOFT_VDP1_WORKER_LAST = YAB_THREAD_VIDSOFT_VDP1_WORKER_0 + 7,
    YAB_NUM_THREADS      // Total number of subthreads
 };
 
@@ -78,6 +82,25 @@ void YabThreadRemoteSleep(unsigned int id);
 // YabThreadWake:  Wake up the given thread if it is asleep.
 void YabThreadWake(unsigned int id);
 
+///////////////////////////////////////////////////////////////////////////
+// Semaphores (implemented by the port along with the thread functions)
+///////////////////////////////////////////////////////////////////////////
+
+typedef struct YabSem_struct YabSem;
+
+// YabSemInit:  Create a counting semaphore with the given initial count.
+// Returns NULL on error.
+YabSem * YabSemInit(int count);
+
+// YabSemDeInit:  Destroy a semaphore created by YabSemInit.
+void YabSemDeInit(YabSem * sem);
+
+// YabSemPost:  Increment the count, waking up one waiting thread.
+void YabSemPost(YabSem * sem);
+
+// YabSemWait:  Wait until the count is above zero, then decrement it.
+void YabSemWait(YabSem * sem);
+
 ///////////////////////////////////////////////////////////////////////////
 
 #endif  // THREADS_H
@@ -23,9 +23,20 @@
 #include "../threads.h"
 
 #include "../profiler.h"
+#include "../profile.h"
 
 #include <stdlib.h>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TITAN_SIMD_SSE2
+#define TITAN_SIMD_WIDTH 16
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define TITAN_SIMD_NEON
+#define TITAN_SIMD_WIDTH 16
+#endif
+
 /* private */
 typedef u32 (*TitanBlendFunc)(u32 top, u32 bottom);
 typedef int FASTCALL (*TitanTransFunc)(u32 pixel);
@@ -248,12 +259,15 @@ void TitanRenderSimplifiedCheck(pixel_t * buf, int start, int end, int can_use_s
 #define DECLARE_PRIORITY_THREAD(FUNC_NAME, THREAD_NUMBER) \
 void FUNC_NAME(void* data) \
 { \
+   PROFILE_THREAD_NAME(#FUNC_NAME); \
    for (;;) \
    { \
       if (priority_thread_context.need_draw[THREAD_NUMBER]) \
       { \
          priority_thread_context.need_draw[THREAD_NUMBER] = 0; \
+         PROFILE_START(TITANLINES); \
          TitanRenderSimplifiedCheck(priority_thread_context.dispbuffer, priority_thread_context.lines[THREAD_NUMBER].start, priority_thread_context.lines[THREAD_NUMBER].end, priority_thread_context.use_simplified); \
+         PROFILE_STOP(TITANLINES); \
          priority_thread_context.draw_finished[THREAD_NUMBER] = 1; \
       } \
       YabThreadSleep(); \
@@ -330,41 +344,10 @@ static INLINE int FASTCALL TitanTransBit(u32 pixel)
    return pixel & 0x80000000;
 }
 
-static u32 TitanDigPixel(int pos, int y)
+// Applies line screen, shadow and color calculation to the two topmost
+// pixels of a dot
+static INLINE u32 TitanBlendStack(PixelData * pixel_stack, struct StencilData * stencil_stack, int y, int self_shadow)
 {
-   PixelData pixel_stack[2] = { 0 };
-   struct StencilData stencil_stack[2] = { 0 };
-   u8 prio_stack[2] = { 0 };
-
-   int pixel_stack_pos = 0;
-
-   int priority;
-
-   //sort the pixels from highest to lowest priority
-   for (priority = 7; priority > 0; priority--)
-   {
-      int which_layer;
-
-      for (which_layer = TITAN_SPRITE; which_layer >= 0; which_layer--)
-      {
-         if (tt_context.vdp2priority[which_layer][pos] == priority)
-         {
-            pixel_stack[pixel_stack_pos] = tt_context.vdp2framebuffer[which_layer][pos];
-            stencil_stack[pixel_stack_pos] = tt_context.vdp2stencil[which_layer][pos];
-	    prio_stack[pixel_stack_pos] = tt_context.vdp2priority[which_layer][pos];
-            pixel_stack_pos++;
-
-            if (pixel_stack_pos == 2)
-               goto finished;//backscreen is unnecessary in this case
-         }
-      }
-   }
-   pixel_stack[pixel_stack_pos] = tt_context.backscreen[y];
-   memset(&stencil_stack[pixel_stack_pos], 0, sizeof(struct StencilData));
-   memset(&prio_stack[pixel_stack_pos], 0, sizeof(u8));
-
-
-finished:
    if (stencil_stack[0].linescreen)
    {
       pixel_stack[0] = tt_context.blend(pixel_stack[0], tt_context.linescreen[stencil_stack[0].linescreen][y]);
@@ -391,7 +374,7 @@ finished:
       }
 
       //sprite self-shadowing, only if sprite window is not enabled
-      if (!(Vdp2Regs->SPCTL & 0x10))
+      if (self_shadow)
          pixel_stack[0] = TitanBlendPixelsTop(0x20000000, pixel_stack[0]);
    }
    else if (stencil_stack[0].shadow_type == TITAN_NORMAL_SHADOW)
@@ -417,6 +400,121 @@ finished:
    return pixel_stack[0];
 }
 
+static u32 TitanDigPixel(int pos, int y, int self_shadow)
+{
+   PixelData pixel_stack[2] = { 0 };
+   struct StencilData stencil_stack[2] = { 0 };
+
+   int pixel_stack_pos = 0;
+
+   int priority;
+
+   //sort the pixels from highest to lowest priority
+   for (priority = 7; priority > 0; priority--)
+   {
+      int which_layer;
+
+      for (which_layer = TITAN_SPRITE; which_layer >= 0; which_layer--)
+      {
+         if (tt_context.vdp2priority[which_layer][pos] == priority)
+         {
+            pixel_stack[pixel_stack_pos] = tt_context.vdp2framebuffer[which_layer][pos];
+            stencil_stack[pixel_stack_pos] = tt_context.vdp2stencil[which_layer][pos];
+            pixel_stack_pos++;
+
+            if (pixel_stack_pos == 2)
+               goto finished;//backscreen is unnecessary in this case
+         }
+      }
+   }
+   pixel_stack[pixel_stack_pos] = tt_context.backscreen[y];
+   memset(&stencil_stack[pixel_stack_pos], 0, sizeof(struct StencilData));
+
+finished:
+   return TitanBlendStack(pixel_stack, stencil_stack, y, self_shadow);
+}
+
+#ifdef TITAN_SIMD_WIDTH
+/*
+   Sorts TITAN_SIMD_WIDTH dots at once. Each layer gets the key
+   (priority << 3) | layer, or 0 when its priority is outside 1..7, so that
+   the largest key is the first pixel TitanDigPixel would find and the
+   largest of the remaining keys is the second one.
+*/
+static void TitanSortPixels(int pos, u8 * top, u8 * next)
+{
+   int which_layer;
+#ifdef TITAN_SIMD_SSE2
+   const __m128i zero = _mm_setzero_si128();
+   const __m128i seven = _mm_set1_epi8(7);
+   const __m128i shift_mask = _mm_set1_epi8((char)0xF8);
+   __m128i key[6];
+   __m128i first = zero, second = zero;
+
+   for (which_layer = 0; which_layer < 6; which_layer++)
+   {
+      __m128i prio = _mm_loadu_si128((const __m128i *)(tt_context.vdp2priority[which_layer] + pos));
+      __m128i valid = _mm_andnot_si128(_mm_cmpeq_epi8(prio, zero), _mm_cmpeq_epi8(_mm_min_epu8(prio, seven), prio));
+      __m128i k = _mm_or_si128(_mm_and_si128(_mm_slli_epi16(prio, 3), shift_mask), _mm_set1_epi8((char)which_layer));
+
+      key[which_layer] = _mm_and_si128(k, valid);
+      first = _mm_max_epu8(first, key[which_layer]);
+   }
+
+   for (which_layer = 0; which_layer < 6; which_layer++)
+      second = _mm_max_epu8(second, _mm_andnot_si128(_mm_cmpeq_epi8(key[which_layer], first), key[which_layer]));
+
+   _mm_storeu_si128((__m128i *)top, first);
+   _mm_storeu_si128((__m128i *)next, second);
+#else
+   const uint8x16_t zero = vdupq_n_u8(0);
+   const uint8x16_t seven = vdupq_n_u8(7);
+   uint8x16_t key[6];
+   uint8x16_t first = zero, second = zero;
+
+   for (which_layer = 0; which_layer < 6; which_layer++)
+   {
+      uint8x16_t prio = vld1q_u8(tt_context.vdp2priority[which_layer] + pos);
+      uint8x16_t valid = vandq_u8(vtstq_u8(prio, prio), vcleq_u8(prio, seven));
+      uint8x16_t k = vorrq_u8(vshlq_n_u8(prio, 3), vdupq_n_u8((u8)which_layer));
+
+      key[which_layer] = vandq_u8(k, valid);
+      first = vmaxq_u8(first, key[which_layer]);
+   }
+
+   for (which_layer = 0; which_layer < 6; which_layer++)
+      second = vmaxq_u8(second, vbicq_u8(key[which_layer], vceqq_u8(key[which_layer], first)));
+
+   vst1q_u8(top, first);
+   vst1q_u8(next, second);
+#endif
+}
+
+static INLINE u32 TitanStackPixels(u8 top, u8 next, int pos, int y, int self_shadow)
+{
+   PixelData pixel_stack[2] = { 0 };
+   struct StencilData stencil_stack[2] = { 0 };
+
+   if (top)
+   {
+      pixel_stack[0] = tt_context.vdp2framebuffer[top & 7][pos];
+      stencil_stack[0] = tt_context.vdp2stencil[top & 7][pos];
+
+      if (next)
+      {
+         pixel_stack[1] = tt_context.vdp2framebuffer[next & 7][pos];
+         stencil_stack[1] = tt_context.vdp2stencil[next & 7][pos];
+      }
+      else
+         pixel_stack[1] = tt_context.backscreen[y];
+   }
+   else
+      pixel_stack[0] = tt_context.backscreen[y];
+
+   return TitanBlendStack(pixel_stack, stencil_stack, y, self_shadow);
+}
+#endif
+
 /* public */
 int TitanInit()
 {
@@ -598,6 +696,7 @@ void TitanRenderLines(pixel_t * dispbuffer, int start_line, int end_line)
    int x, y, layer_y;
    u32 dot;
    int line_increment, interlace_line;
+   int self_shadow;
 
    if (!tt_context.inited || (!tt_context.trans))
    {
@@ -608,17 +707,37 @@ void TitanRenderLines(pixel_t * dispbuffer, int start_line, int end_line)
    Vdp2GetInterlaceInfo(&interlace_line, &line_increment);
 
    set_layer_y(start_line, &layer_y);
+
+   self_shadow = !(Vdp2Regs->SPCTL & 0x10);
    
    for (y = start_line + interlace_line; y < end_line; y += line_increment)
    {
-      for (x = 0; x < tt_context.vdp2width; x++)
+      x = 0;
+#ifdef TITAN_SIMD_WIDTH
+      for (; x + TITAN_SIMD_WIDTH <= tt_context.vdp2width; x += TITAN_SIMD_WIDTH)
+      {
+         u8 top[TITAN_SIMD_WIDTH], next[TITAN_SIMD_WIDTH];
+         int i = (y * tt_context.vdp2width) + x;
+         int layer_pos = (layer_y * tt_context.vdp2width) + x;
+         int j;
+
+         TitanSortPixels(layer_pos, top, next);
+
+         for (j = 0; j < TITAN_SIMD_WIDTH; j++)
+         {
+            dot = TitanStackPixels(top[j], next[j], layer_pos + j, y, self_shadow);
+            dispbuffer[i + j] = dot ? TitanFixAlpha(dot) : 0;
+         }
+      }
+#endif
+      for (; x < tt_context.vdp2width; x++)
       {
          int i = (y * tt_context.vdp2width) + x;
          int layer_pos = (layer_y * tt_context.vdp2width) + x;
 
          dispbuffer[i] = 0;
 
-         dot = TitanDigPixel(layer_pos, y);
+         dot = TitanDigPixel(layer_pos, y, self_shadow);
 
          if (dot)
          {
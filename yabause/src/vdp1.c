@@ -34,6 +34,8 @@
 #include "sh2core.h"
 
 u8 * Vdp1Ram;
+u8 Vdp1RamDirtyPages[0x80];
+u8 Vdp1RamSnapshotPages[0x80];
 u8 * Vdp1FrameBuffer;
 
 VideoInterface_struct *VIDCore=NULL;
@@ -65,6 +67,8 @@ u32 FASTCALL Vdp1RamReadLong(u32 addr) {
 void FASTCALL Vdp1RamWriteByte(u32 addr, u8 val) {
    addr &= 0x7FFFF;
    T1WriteByte(Vdp1Ram, addr, val);
+   Vdp1RamDirtyPages[addr >> RAM_DIRTY_PAGE_SHIFT] = 1;
+   Vdp1RamSnapshotPages[addr >> RAM_DIRTY_PAGE_SHIFT] = 1;
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -72,6 +76,8 @@ void FASTCALL Vdp1RamWriteByte(u32 addr, u8 val) {
 void FASTCALL Vdp1RamWriteWord(u32 addr, u16 val) {
    addr &= 0x7FFFF;
    T1WriteWord(Vdp1Ram, addr, val);
+   Vdp1RamDirtyPages[addr >> RAM_DIRTY_PAGE_SHIFT] = 1;
+   Vdp1RamSnapshotPages[addr >> RAM_DIRTY_PAGE_SHIFT] = 1;
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -79,6 +85,8 @@ void FASTCALL Vdp1RamWriteWord(u32 addr, u16 val) {
 void FASTCALL Vdp1RamWriteLong(u32 addr, u32 val) {
    addr &= 0x7FFFF;
    T1WriteLong(Vdp1Ram, addr, val);
+   Vdp1RamDirtyPages[addr >> RAM_DIRTY_PAGE_SHIFT] = 1;
+   Vdp1RamSnapshotPages[addr >> RAM_DIRTY_PAGE_SHIFT] = 1;
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -244,6 +252,7 @@ int Vdp1Init(void) {
 
    if ((Vdp1Ram = T1MemoryInit(0x80000)) == NULL)
       return -1;
+   memset(Vdp1RamSnapshotPages, 1, sizeof(Vdp1RamSnapshotPages));
 
    // Allocate enough memory for two frames
    if ((Vdp1FrameBuffer = T1MemoryInit(0x80000)) == NULL)
@@ -676,7 +685,7 @@ void FASTCALL Vdp1ReadCommand(vdp1cmd_struct *cmd, u32 addr, u8* ram) {
 
 //////////////////////////////////////////////////////////////////////////////
 
-int Vdp1SaveState(FILE *fp)
+int Vdp1SaveState(ystream_struct *fp)
 {
    int offset;
    IOCheck_struct check = { 0, 0 };
@@ -704,7 +713,7 @@ int Vdp1SaveState(FILE *fp)
 
 //////////////////////////////////////////////////////////////////////////////
 
-int Vdp1LoadState(FILE *fp, UNUSED int version, int size)
+int Vdp1LoadState(ystream_struct *fp, UNUSED int version, int size)
 {
    IOCheck_struct check = { 0, 0 };
 #ifdef IMPROVED_SAVESTATES
@@ -717,6 +726,7 @@ int Vdp1LoadState(FILE *fp, UNUSED int version, int size)
 
    // Read VDP1 ram
    yread(&check, (void *)Vdp1Ram, 0x80000, 1, fp);
+   memset(Vdp1RamSnapshotPages, 1, sizeof(Vdp1RamSnapshotPages));
 
 #ifdef IMPROVED_SAVESTATES
    yread(&check, (void *)back_framebuffer, 0x40000, 1, fp);
@@ -96,6 +96,22 @@ extern VideoInterface_struct *VIDCore;
 extern VideoInterface_struct VIDDummy;
 
 extern u8 * Vdp1Ram;
+extern u8 Vdp1RamDirtyPages[0x80];
+// 4KB pages written since the video core last copied Vdp1Ram for its render
+// thread. Kept apart from Vdp1RamDirtyPages, which the rewind buffer clears.
+extern u8 Vdp1RamSnapshotPages[0x80];
+
+// For writes that go straight to Vdp1Ram instead of through Vdp1RamWrite*
+static INLINE void Vdp1RamMarkDirty(u32 addr, u32 length)
+{
+   u32 page = (addr & 0x7FFFF) >> RAM_DIRTY_PAGE_SHIFT;
+   u32 end = ((addr & 0x7FFFF) + length + (1 << RAM_DIRTY_PAGE_SHIFT) - 1) >> RAM_DIRTY_PAGE_SHIFT;
+
+   if (end > 0x80)
+      end = 0x80;
+   for (; page < end; page++)
+      Vdp1RamDirtyPages[page] = Vdp1RamSnapshotPages[page] = 1;
+}
 
 u8 FASTCALL	Vdp1RamReadByte(u32);
 u16 FASTCALL	Vdp1RamReadWord(u32);
@@ -181,8 +197,8 @@ void Vdp1Draw(void);
 void Vdp1NoDraw(void);
 void FASTCALL Vdp1ReadCommand(vdp1cmd_struct *cmd, u32 addr, u8* ram);
 
-int Vdp1SaveState(FILE *fp);
-int Vdp1LoadState(FILE *fp, int version, int size);
+int Vdp1SaveState(ystream_struct *fp);
+int Vdp1LoadState(ystream_struct *fp, int version, int size);
 
 char *Vdp1DebugGetCommandNumberName(u32 number);
 void Vdp1DebugCommand(u32 number, char *outstring);
@@ -22,6 +22,7 @@
     \brief VDP2 emulation functions
 */
 
+#include <stddef.h>
 #include <stdlib.h>
 #include "vdp2.h"
 #include "debug.h"
@@ -35,13 +36,23 @@
 #include "osdcore.h"
 
 u8 * Vdp2Ram;
+u8 Vdp2RamDirtyPages[0x80];
 u8 * Vdp2ColorRam;
+u32 Vdp2WriteSerial;
+u32 Vdp2RamBlockSerial[0x80000 >> VDP2_RAM_BLOCK_SHIFT];
+u32 Vdp2ColorRamSerial;
+u32 Vdp2ColorRamColors[0x800];
 Vdp2 * Vdp2Regs;
 Vdp2Internal_struct Vdp2Internal;
 Vdp2External_struct Vdp2External;
 
 struct CellScrollData cell_scroll_data[270];
-Vdp2 Vdp2Lines[270];
+Vdp2LineLog Vdp2Lines;
+static int vdp2_line_log_line;
+static u16 vdp2_line_log_last[0x90];
+
+static int Vdp2RegsWriteWord(Vdp2 * regs, u32 addr, u16 val);
+static void Vdp2LineLogReset(void);
 
 static int autoframeskipenab=0;
 static int throttlespeed=0;
@@ -75,6 +86,8 @@ u32 FASTCALL Vdp2RamReadLong(u32 addr) {
 void FASTCALL Vdp2RamWriteByte(u32 addr, u8 val) {
    addr &= 0x7FFFF;
    T1WriteByte(Vdp2Ram, addr, val);
+   Vdp2RamDirtyPages[addr >> RAM_DIRTY_PAGE_SHIFT] = 1;
+   Vdp2RamBlockSerial[addr >> VDP2_RAM_BLOCK_SHIFT] = Vdp2WriteSerial;
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -82,6 +95,8 @@ void FASTCALL Vdp2RamWriteByte(u32 addr, u8 val) {
 void FASTCALL Vdp2RamWriteWord(u32 addr, u16 val) {
    addr &= 0x7FFFF;
    T1WriteWord(Vdp2Ram, addr, val);
+   Vdp2RamDirtyPages[addr >> RAM_DIRTY_PAGE_SHIFT] = 1;
+   Vdp2RamBlockSerial[addr >> VDP2_RAM_BLOCK_SHIFT] = Vdp2WriteSerial;
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -89,6 +104,8 @@ void FASTCALL Vdp2RamWriteWord(u32 addr, u16 val) {
 void FASTCALL Vdp2RamWriteLong(u32 addr, u32 val) {
    addr &= 0x7FFFF;
    T1WriteLong(Vdp2Ram, addr, val);
+   Vdp2RamDirtyPages[addr >> RAM_DIRTY_PAGE_SHIFT] = 1;
+   Vdp2RamBlockSerial[addr >> VDP2_RAM_BLOCK_SHIFT] = Vdp2WriteSerial;
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -114,9 +131,42 @@ u32 FASTCALL Vdp2ColorRamReadLong(u32 addr) {
 
 //////////////////////////////////////////////////////////////////////////////
 
+// Converts the entry holding byte addr of color RAM
+static INLINE void Vdp2ColorRamUpdateColor(u32 addr) {
+   switch (Vdp2Internal.ColorMode)
+   {
+      case 0:
+      case 1:
+      {
+         u32 tmp = T2ReadWord(Vdp2ColorRam, addr & 0xFFE);
+         /* we preserve MSB for special color calculation mode 3 (see Vdp2 user's manual 3.4 and 12.3) */
+         Vdp2ColorRamColors[(addr >> 1) & 0x7FF] = (((tmp & 0x1F) << 3) | ((tmp & 0x03E0) << 6) | ((tmp & 0x7C00) << 9)) | ((tmp & 0x8000) << 16);
+         break;
+      }
+      case 2:
+         Vdp2ColorRamColors[(addr >> 2) & 0x3FF] = Vdp2ColorRamColors[((addr >> 2) & 0x3FF) | 0x400] = T2ReadLong(Vdp2ColorRam, addr & 0xFFC);
+         break;
+      default: break;
+   }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void Vdp2ColorRamUpdateColors(void) {
+   u32 addr;
+
+   memset(Vdp2ColorRamColors, 0, sizeof(Vdp2ColorRamColors));
+   for (addr = 0; addr < 0x1000; addr += 2)
+      Vdp2ColorRamUpdateColor(addr);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
 void FASTCALL Vdp2ColorRamWriteByte(u32 addr, u8 val) {
    addr &= 0xFFF;
    T2WriteByte(Vdp2ColorRam, addr, val);
+   Vdp2ColorRamSerial = Vdp2WriteSerial;
+   Vdp2ColorRamUpdateColor(addr);
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -124,6 +174,8 @@ void FASTCALL Vdp2ColorRamWriteByte(u32 addr, u8 val) {
 void FASTCALL Vdp2ColorRamWriteWord(u32 addr, u16 val) {
    addr &= 0xFFF;
    T2WriteWord(Vdp2ColorRam, addr, val);
+   Vdp2ColorRamSerial = Vdp2WriteSerial;
+   Vdp2ColorRamUpdateColor(addr);
 //   if (Vdp2Internal.ColorMode == 0)
 //      T1WriteWord(Vdp2ColorRam, addr + 0x800, val);
 }
@@ -133,6 +185,9 @@ void FASTCALL Vdp2ColorRamWriteWord(u32 addr, u16 val) {
 void FASTCALL Vdp2ColorRamWriteLong(u32 addr, u32 val) {
    addr &= 0xFFF;
    T2WriteLong(Vdp2ColorRam, addr, val);
+   Vdp2ColorRamSerial = Vdp2WriteSerial;
+   Vdp2ColorRamUpdateColor(addr);
+   Vdp2ColorRamUpdateColor(addr + 2);
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -209,6 +264,16 @@ void FASTCALL Sh2Vdp2ColorRamWriteLong(SH2_struct *sh, u32 addr, u32 val) {
 
 //////////////////////////////////////////////////////////////////////////////
 
+void Vdp2MarkAllDirty(void) {
+   u32 i;
+
+   for (i = 0; i < (0x80000 >> VDP2_RAM_BLOCK_SHIFT); i++)
+      Vdp2RamBlockSerial[i] = Vdp2WriteSerial;
+   Vdp2ColorRamSerial = Vdp2WriteSerial;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
 int Vdp2Init(void) {
    if ((Vdp2Regs = (Vdp2 *) calloc(1, sizeof(Vdp2))) == NULL)
       return -1;
@@ -321,6 +386,8 @@ void Vdp2Reset(void) {
 
    yabsys.VBlankLineCount = 225;
    Vdp2Internal.ColorMode = 0;
+   Vdp2ColorRamUpdateColors();
+   Vdp2LineLogReset();
 
    Vdp2External.disptoggle = 0xFF;
 }
@@ -356,26 +423,97 @@ void Vdp2HBlankIN(void) {
 
 //////////////////////////////////////////////////////////////////////////////
 
+static void Vdp2LineLogReset(void) {
+   memcpy(&Vdp2Lines.regs, Vdp2Regs, sizeof(Vdp2));
+   Vdp2Lines.count = 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void Vdp2LineLogWrite(u32 addr, u16 val) {
+   Vdp2LineWrite * write;
+   u32 last = vdp2_line_log_last[addr >> 1];
+
+   if (vdp2_line_log_line >= 270)
+      return;
+
+   // only the last write to a register before a line is latched matters
+   if (last < Vdp2Lines.count && Vdp2Lines.writes[last].addr == addr &&
+       Vdp2Lines.writes[last].line == vdp2_line_log_line)
+      write = Vdp2Lines.writes + last;
+   else
+   {
+      vdp2_line_log_last[addr >> 1] = Vdp2Lines.count;
+      write = Vdp2Lines.writes + Vdp2Lines.count++;
+      write->line = vdp2_line_log_line;
+      write->addr = addr;
+   }
+
+   write->val = val;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
 void Vdp2HBlankOUT(void) {
    int i;
    Vdp2Regs->TVSTAT &= ~0x0004;
 
    if (yabsys.LineCount < 270)
    {
-      u32 cell_scroll_table_start_addr = (Vdp2Regs->VCSTA.all & 0x7FFFE) << 1;
-      memcpy(Vdp2Lines + yabsys.LineCount, Vdp2Regs, sizeof(Vdp2));
+      if (yabsys.LineCount == 0)
+         Vdp2LineLogReset();
 
-      for (i = 0; i < 88; i++)
+      // writes from now on are latched by the next line
+      vdp2_line_log_line = yabsys.LineCount + 1;
+
+      // the table is only used by NBG0/NBG1 vertical cell scroll
+      if (Vdp2Regs->SCRCTL & 0x101)
       {
-         cell_scroll_data[yabsys.LineCount].data[i] = T1ReadLong(Vdp2Ram, cell_scroll_table_start_addr + i * 4);
+         u32 cell_scroll_table_start_addr = (Vdp2Regs->VCSTA.all & 0x7FFFE) << 1;
+
+         for (i = 0; i < 88; i++)
+         {
+            cell_scroll_data[yabsys.LineCount].data[i] = T1ReadLong(Vdp2Ram, cell_scroll_table_start_addr + i * 4);
+         }
       }
    }
 }
 
 //////////////////////////////////////////////////////////////////////////////
 
-Vdp2 * Vdp2RestoreRegs(int line, Vdp2* lines) {
-   return line > 270 ? NULL : lines + line;
+void Vdp2LineLogCopy(Vdp2LineLog * dst, const Vdp2LineLog * src) {
+   memcpy(dst, src, offsetof(Vdp2LineLog, writes) + src->count * sizeof(Vdp2LineWrite));
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void Vdp2LineRegsInit(Vdp2LineRegs * lines, const Vdp2LineLog * log) {
+   lines->log = log;
+   lines->line = -1;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+Vdp2 * Vdp2RestoreRegs(int line, Vdp2LineRegs * lines) {
+   const Vdp2LineLog * log = lines->log;
+
+   if (line > 270)
+      return NULL;
+
+   if (line < lines->line || lines->line < 0)
+   {
+      memcpy(&lines->regs, &log->regs, sizeof(Vdp2));
+      lines->next = 0;
+   }
+
+   while (lines->next < log->count && log->writes[lines->next].line <= line)
+   {
+      Vdp2RegsWriteWord(&lines->regs, log->writes[lines->next].addr, log->writes[lines->next].val);
+      lines->next++;
+   }
+
+   lines->line = line;
+   return &lines->regs;
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -611,455 +749,474 @@ void FASTCALL Vdp2WriteByte(u32 addr, UNUSED u8 val) {
 
 //////////////////////////////////////////////////////////////////////////////
 
-void FASTCALL Vdp2WriteWord(u32 addr, u16 val) {
-   addr &= 0x1FF;
-
+static int Vdp2RegsWriteWord(Vdp2 * regs, u32 addr, u16 val) {
    switch (addr)
    {
       case 0x000:
-         Vdp2Regs->TVMD = val;
-         yabsys.VBlankLineCount = 225+(val & 0x30);
-         return;
+         regs->TVMD = val;
+         return 1;
       case 0x002:
-         Vdp2Regs->EXTEN = val;
-         return;
+         regs->EXTEN = val;
+         return 1;
       case 0x004:
          // TVSTAT is read-only
-         return;
+         return 0;
       case 0x006:
-         Vdp2Regs->VRSIZE = val;
-         return;
+         regs->VRSIZE = val;
+         return 1;
       case 0x008:
          // HCNT is read-only
-         return;
+         return 0;
       case 0x00A:
          // VCNT is read-only
-         return;
+         return 0;
       case 0x00C:
          // Reserved
-         return;
+         return 0;
       case 0x00E:
-         Vdp2Regs->RAMCTL = val;
-         Vdp2Internal.ColorMode = (val >> 12) & 0x3;
-         return;
+         regs->RAMCTL = val;
+         return 1;
       case 0x010:
-         Vdp2Regs->CYCA0L = val;
-         return;
+         regs->CYCA0L = val;
+         return 1;
       case 0x012:
-         Vdp2Regs->CYCA0U = val;
-         return;
+         regs->CYCA0U = val;
+         return 1;
       case 0x014:
-         Vdp2Regs->CYCA1L = val;
-         return;
+         regs->CYCA1L = val;
+         return 1;
       case 0x016:
-         Vdp2Regs->CYCA1U = val;
-         return;
+         regs->CYCA1U = val;
+         return 1;
       case 0x018:
-         Vdp2Regs->CYCB0L = val;
-         return;
+         regs->CYCB0L = val;
+         return 1;
       case 0x01A:
-         Vdp2Regs->CYCB0U = val;
-         return;
+         regs->CYCB0U = val;
+         return 1;
       case 0x01C:
-         Vdp2Regs->CYCB1L = val;
-         return;
+         regs->CYCB1L = val;
+         return 1;
       case 0x01E:
-         Vdp2Regs->CYCB1U = val;
-         return;
+         regs->CYCB1U = val;
+         return 1;
       case 0x020:
-         Vdp2Regs->BGON = val;
-         return;
+         regs->BGON = val;
+         return 1;
       case 0x022:
-         Vdp2Regs->MZCTL = val;
-         return;
+         regs->MZCTL = val;
+         return 1;
       case 0x024:
-         Vdp2Regs->SFSEL = val;
-         return;
+         regs->SFSEL = val;
+         return 1;
       case 0x026:
-         Vdp2Regs->SFCODE = val;
-         return;
+         regs->SFCODE = val;
+         return 1;
       case 0x028:
-         Vdp2Regs->CHCTLA = val;
-         return;
+         regs->CHCTLA = val;
+         return 1;
       case 0x02A:
-         Vdp2Regs->CHCTLB = val;
-         return;
+         regs->CHCTLB = val;
+         return 1;
       case 0x02C:
-         Vdp2Regs->BMPNA = val;
-         return;
+         regs->BMPNA = val;
+         return 1;
       case 0x02E:
-         Vdp2Regs->BMPNB = val;
-         return;
+         regs->BMPNB = val;
+         return 1;
       case 0x030:
-         Vdp2Regs->PNCN0 = val;
-         return;
+         regs->PNCN0 = val;
+         return 1;
       case 0x032:
-         Vdp2Regs->PNCN1 = val;
-         return;
+         regs->PNCN1 = val;
+         return 1;
       case 0x034:
-         Vdp2Regs->PNCN2 = val;
-         return;
+         regs->PNCN2 = val;
+         return 1;
       case 0x036:
-         Vdp2Regs->PNCN3 = val;
-         return;
+         regs->PNCN3 = val;
+         return 1;
       case 0x038:
-         Vdp2Regs->PNCR = val;
-         return;
+         regs->PNCR = val;
+         return 1;
       case 0x03A:
-         Vdp2Regs->PLSZ = val;
-         return;
+         regs->PLSZ = val;
+         return 1;
       case 0x03C:
-         Vdp2Regs->MPOFN = val;
-         return;
+         regs->MPOFN = val;
+         return 1;
       case 0x03E:
-         Vdp2Regs->MPOFR = val;
-         return;
+         regs->MPOFR = val;
+         return 1;
       case 0x040:
-         Vdp2Regs->MPABN0 = val;
-         return;
+         regs->MPABN0 = val;
+         return 1;
       case 0x042:
-         Vdp2Regs->MPCDN0 = val;
-         return;
+         regs->MPCDN0 = val;
+         return 1;
       case 0x044:
-         Vdp2Regs->MPABN1 = val;
-         return;
+         regs->MPABN1 = val;
+         return 1;
       case 0x046:
-         Vdp2Regs->MPCDN1 = val;
-         return;
+         regs->MPCDN1 = val;
+         return 1;
       case 0x048:
-         Vdp2Regs->MPABN2 = val;
-         return;
+         regs->MPABN2 = val;
+         return 1;
       case 0x04A:
-         Vdp2Regs->MPCDN2 = val;
-         return;
+         regs->MPCDN2 = val;
+         return 1;
       case 0x04C:
-         Vdp2Regs->MPABN3 = val;
-         return;
+         regs->MPABN3 = val;
+         return 1;
       case 0x04E:
-         Vdp2Regs->MPCDN3 = val;
-         return;
+         regs->MPCDN3 = val;
+         return 1;
       case 0x050:
-         Vdp2Regs->MPABRA = val;
-         return;
+         regs->MPABRA = val;
+         return 1;
       case 0x052:
-         Vdp2Regs->MPCDRA = val;
-         return;
+         regs->MPCDRA = val;
+         return 1;
       case 0x054:
-         Vdp2Regs->MPEFRA = val;
-         return;
+         regs->MPEFRA = val;
+         return 1;
       case 0x056:
-         Vdp2Regs->MPGHRA = val;
-         return;
+         regs->MPGHRA = val;
+         return 1;
       case 0x058:
-         Vdp2Regs->MPIJRA = val;
-         return;
+         regs->MPIJRA = val;
+         return 1;
       case 0x05A:
-         Vdp2Regs->MPKLRA = val;
-         return;
+         regs->MPKLRA = val;
+         return 1;
       case 0x05C:
-         Vdp2Regs->MPMNRA = val;
-         return;
+         regs->MPMNRA = val;
+         return 1;
       case 0x05E:
-         Vdp2Regs->MPOPRA = val;
-         return;
+         regs->MPOPRA = val;
+         return 1;
       case 0x060:
-         Vdp2Regs->MPABRB = val;
-         return;
+         regs->MPABRB = val;
+         return 1;
       case 0x062:
-         Vdp2Regs->MPCDRB = val;
-         return;
+         regs->MPCDRB = val;
+         return 1;
       case 0x064:
-         Vdp2Regs->MPEFRB = val;
-         return;
+         regs->MPEFRB = val;
+         return 1;
       case 0x066:
-         Vdp2Regs->MPGHRB = val;
-         return;
+         regs->MPGHRB = val;
+         return 1;
       case 0x068:
-         Vdp2Regs->MPIJRB = val;
-         return;
+         regs->MPIJRB = val;
+         return 1;
       case 0x06A:
-         Vdp2Regs->MPKLRB = val;
-         return;
+         regs->MPKLRB = val;
+         return 1;
       case 0x06C:
-         Vdp2Regs->MPMNRB = val;
-         return;
+         regs->MPMNRB = val;
+         return 1;
       case 0x06E:
-         Vdp2Regs->MPOPRB = val;
-         return;
+         regs->MPOPRB = val;
+         return 1;
       case 0x070:
-         Vdp2Regs->SCXIN0 = val;
-         return;
+         regs->SCXIN0 = val;
+         return 1;
       case 0x072:
-         Vdp2Regs->SCXDN0 = val;
-         return;
+         regs->SCXDN0 = val;
+         return 1;
       case 0x074:
-         Vdp2Regs->SCYIN0 = val;
-         return;
+         regs->SCYIN0 = val;
+         return 1;
       case 0x076:
-         Vdp2Regs->SCYDN0 = val;
-         return;
+         regs->SCYDN0 = val;
+         return 1;
       case 0x078:
-         Vdp2Regs->ZMXN0.part.I = val;
-         return;
+         regs->ZMXN0.part.I = val;
+         return 1;
       case 0x07A:
-         Vdp2Regs->ZMXN0.part.D = val;
-         return;
+         regs->ZMXN0.part.D = val;
+         return 1;
       case 0x07C:
-         Vdp2Regs->ZMYN0.part.I = val;
-         return;
+         regs->ZMYN0.part.I = val;
+         return 1;
       case 0x07E:
-         Vdp2Regs->ZMYN0.part.D = val;
-         return;
+         regs->ZMYN0.part.D = val;
+         return 1;
       case 0x080:
-         Vdp2Regs->SCXIN1 = val;
-         return;
+         regs->SCXIN1 = val;
+         return 1;
       case 0x082:
-         Vdp2Regs->SCXDN1 = val;
-         return;
+         regs->SCXDN1 = val;
+         return 1;
       case 0x084:
-         Vdp2Regs->SCYIN1 = val;
-         return;
+         regs->SCYIN1 = val;
+         return 1;
       case 0x086:
-         Vdp2Regs->SCYDN1 = val;
-         return;
+         regs->SCYDN1 = val;
+         return 1;
       case 0x088:
-         Vdp2Regs->ZMXN1.part.I = val;
-         return;
+         regs->ZMXN1.part.I = val;
+         return 1;
       case 0x08A:
-         Vdp2Regs->ZMXN1.part.D = val;
-         return;
+         regs->ZMXN1.part.D = val;
+         return 1;
       case 0x08C:
-         Vdp2Regs->ZMYN1.part.I = val;
-         return;
+         regs->ZMYN1.part.I = val;
+         return 1;
       case 0x08E:
-         Vdp2Regs->ZMYN1.part.D = val;
-         return;
+         regs->ZMYN1.part.D = val;
+         return 1;
       case 0x090:
-         Vdp2Regs->SCXN2 = val;
-         return;
+         regs->SCXN2 = val;
+         return 1;
       case 0x092:
-         Vdp2Regs->SCYN2 = val;
-         return;
+         regs->SCYN2 = val;
+         return 1;
       case 0x094:
-         Vdp2Regs->SCXN3 = val;
-         return;
+         regs->SCXN3 = val;
+         return 1;
       case 0x096:
-         Vdp2Regs->SCYN3 = val;
-         return;
+         regs->SCYN3 = val;
+         return 1;
       case 0x098:
-         Vdp2Regs->ZMCTL = val;
-         return;
+         regs->ZMCTL = val;
+         return 1;
       case 0x09A:
-         Vdp2Regs->SCRCTL = val;
-         return;
+         regs->SCRCTL = val;
+         return 1;
       case 0x09C:
-         Vdp2Regs->VCSTA.part.U = val;
-         return;
+         regs->VCSTA.part.U = val;
+         return 1;
       case 0x09E:
-         Vdp2Regs->VCSTA.part.L = val;
-         return;
+         regs->VCSTA.part.L = val;
+         return 1;
       case 0x0A0:
-         Vdp2Regs->LSTA0.part.U = val;
-         return;
+         regs->LSTA0.part.U = val;
+         return 1;
       case 0x0A2:
-         Vdp2Regs->LSTA0.part.L = val;
-         return;
+         regs->LSTA0.part.L = val;
+         return 1;
       case 0x0A4:
-         Vdp2Regs->LSTA1.part.U = val;
-         return;
+         regs->LSTA1.part.U = val;
+         return 1;
       case 0x0A6:
-         Vdp2Regs->LSTA1.part.L = val;
-         return;
+         regs->LSTA1.part.L = val;
+         return 1;
       case 0x0A8:
-         Vdp2Regs->LCTA.part.U = val;
-         return;
+         regs->LCTA.part.U = val;
+         return 1;
       case 0x0AA:
-         Vdp2Regs->LCTA.part.L = val;
-         return;
+         regs->LCTA.part.L = val;
+         return 1;
       case 0x0AC:
-         Vdp2Regs->BKTAU = val;
-         return;
+         regs->BKTAU = val;
+         return 1;
       case 0x0AE:
-         Vdp2Regs->BKTAL = val;
-         return;
+         regs->BKTAL = val;
+         return 1;
       case 0x0B0:
-         Vdp2Regs->RPMD = val;
-         return;
+         regs->RPMD = val;
+         return 1;
       case 0x0B2:
-         Vdp2Regs->RPRCTL = val;
-         return;
+         regs->RPRCTL = val;
+         return 1;
       case 0x0B4:
-         Vdp2Regs->KTCTL = val;
-         return;
+         regs->KTCTL = val;
+         return 1;
       case 0x0B6:
-         Vdp2Regs->KTAOF = val;
-         return;
+         regs->KTAOF = val;
+         return 1;
       case 0x0B8:
-         Vdp2Regs->OVPNRA = val;
-         return;
+         regs->OVPNRA = val;
+         return 1;
       case 0x0BA:
-         Vdp2Regs->OVPNRB = val;
-         return;
+         regs->OVPNRB = val;
+         return 1;
       case 0x0BC:
-         Vdp2Regs->RPTA.part.U = val;
-         return;
+         regs->RPTA.part.U = val;
+         return 1;
       case 0x0BE:
-         Vdp2Regs->RPTA.part.L = val;
-         return;
+         regs->RPTA.part.L = val;
+         return 1;
       case 0x0C0:
-         Vdp2Regs->WPSX0 = val;
-         return;
+         regs->WPSX0 = val;
+         return 1;
       case 0x0C2:
-         Vdp2Regs->WPSY0 = val;
-         return;
+         regs->WPSY0 = val;
+         return 1;
       case 0x0C4:
-         Vdp2Regs->WPEX0 = val;
-         return;
+         regs->WPEX0 = val;
+         return 1;
       case 0x0C6:
-         Vdp2Regs->WPEY0 = val;
-         return;
+         regs->WPEY0 = val;
+         return 1;
       case 0x0C8:
-         Vdp2Regs->WPSX1 = val;
-         return;
+         regs->WPSX1 = val;
+         return 1;
       case 0x0CA:
-         Vdp2Regs->WPSY1 = val;
-         return;
+         regs->WPSY1 = val;
+         return 1;
       case 0x0CC:
-         Vdp2Regs->WPEX1 = val;
-         return;
+         regs->WPEX1 = val;
+         return 1;
       case 0x0CE:
-         Vdp2Regs->WPEY1 = val;
-         return;
+         regs->WPEY1 = val;
+         return 1;
       case 0x0D0:
-         Vdp2Regs->WCTLA = val;
-         return;
+         regs->WCTLA = val;
+         return 1;
       case 0x0D2:
-         Vdp2Regs->WCTLB = val;
-         return;
+         regs->WCTLB = val;
+         return 1;
       case 0x0D4:
-         Vdp2Regs->WCTLC = val;
-         return;
+         regs->WCTLC = val;
+         return 1;
       case 0x0D6:
-         Vdp2Regs->WCTLD = val;
-         return;
+         regs->WCTLD = val;
+         return 1;
       case 0x0D8:
-         Vdp2Regs->LWTA0.part.U = val;
-         return;
+         regs->LWTA0.part.U = val;
+         return 1;
       case 0x0DA:
-         Vdp2Regs->LWTA0.part.L = val;
-         return;
+         regs->LWTA0.part.L = val;
+         return 1;
       case 0x0DC:
-         Vdp2Regs->LWTA1.part.U = val;
-         return;
+         regs->LWTA1.part.U = val;
+         return 1;
       case 0x0DE:
-         Vdp2Regs->LWTA1.part.L = val;
-         return;
+         regs->LWTA1.part.L = val;
+         return 1;
       case 0x0E0:
-         Vdp2Regs->SPCTL = val;
-         return;
+         regs->SPCTL = val;
+         return 1;
       case 0x0E2:
-         Vdp2Regs->SDCTL = val;
-         return;
+         regs->SDCTL = val;
+         return 1;
       case 0x0E4:
-         Vdp2Regs->CRAOFA = val;
-         return;
+         regs->CRAOFA = val;
+         return 1;
       case 0x0E6:
-         Vdp2Regs->CRAOFB = val;
-         return;     
+         regs->CRAOFB = val;
+         return 1;
       case 0x0E8:
-         Vdp2Regs->LNCLEN = val;
-         return;
+         regs->LNCLEN = val;
+         return 1;
       case 0x0EA:
-         Vdp2Regs->SFPRMD = val;
-         return;
+         regs->SFPRMD = val;
+         return 1;
       case 0x0EC:
-         Vdp2Regs->CCCTL = val;
-         return;     
+         regs->CCCTL = val;
+         return 1;
       case 0x0EE:
-         Vdp2Regs->SFCCMD = val;
-         return;
+         regs->SFCCMD = val;
+         return 1;
       case 0x0F0:
-         Vdp2Regs->PRISA = val;
-         return;
+         regs->PRISA = val;
+         return 1;
       case 0x0F2:
-         Vdp2Regs->PRISB = val;
-         return;
+         regs->PRISB = val;
+         return 1;
       case 0x0F4:
-         Vdp2Regs->PRISC = val;
-         return;
+         regs->PRISC = val;
+         return 1;
       case 0x0F6:
-         Vdp2Regs->PRISD = val;
-         return;
+         regs->PRISD = val;
+         return 1;
       case 0x0F8:
-         Vdp2Regs->PRINA = val;
-         return;
+         regs->PRINA = val;
+         return 1;
       case 0x0FA:
-         Vdp2Regs->PRINB = val;
-         return;
+         regs->PRINB = val;
+         return 1;
       case 0x0FC:
-         Vdp2Regs->PRIR = val;
-         return;
+         regs->PRIR = val;
+         return 1;
       case 0x0FE:
          // Reserved
-         return;
+         return 0;
       case 0x100:
-         Vdp2Regs->CCRSA = val;
-         return;
+         regs->CCRSA = val;
+         return 1;
       case 0x102:
-         Vdp2Regs->CCRSB = val;
-         return;
+         regs->CCRSB = val;
+         return 1;
       case 0x104:
-         Vdp2Regs->CCRSC = val;
-         return;
+         regs->CCRSC = val;
+         return 1;
       case 0x106:
-         Vdp2Regs->CCRSD = val;
-         return;
+         regs->CCRSD = val;
+         return 1;
       case 0x108:
-         Vdp2Regs->CCRNA = val;
-         return;
+         regs->CCRNA = val;
+         return 1;
       case 0x10A:
-         Vdp2Regs->CCRNB = val;
-         return;
+         regs->CCRNB = val;
+         return 1;
       case 0x10C:
-         Vdp2Regs->CCRR = val;
-         return;
+         regs->CCRR = val;
+         return 1;
       case 0x10E:
-         Vdp2Regs->CCRLB = val;
-         return;
+         regs->CCRLB = val;
+         return 1;
       case 0x110:
-         Vdp2Regs->CLOFEN = val;
-         return;
+         regs->CLOFEN = val;
+         return 1;
       case 0x112:
-         Vdp2Regs->CLOFSL = val;
-         return;
+         regs->CLOFSL = val;
+         return 1;
       case 0x114:
-         Vdp2Regs->COAR = val;
-         return;
+         regs->COAR = val;
+         return 1;
       case 0x116:
-         Vdp2Regs->COAG = val;
-         return;
+         regs->COAG = val;
+         return 1;
       case 0x118:
-         Vdp2Regs->COAB = val;
-         return;
+         regs->COAB = val;
+         return 1;
       case 0x11A:
-         Vdp2Regs->COBR = val;
-         return;
+         regs->COBR = val;
+         return 1;
       case 0x11C:
-         Vdp2Regs->COBG = val;
-         return;
+         regs->COBG = val;
+         return 1;
       case 0x11E:
-         Vdp2Regs->COBB = val;
-         return;
+         regs->COBB = val;
+         return 1;
       default:
       {
          LOG("Unhandled VDP2 word write: %08X\n", addr);
-         break;
+         return 0;
       }
    }
 }
 
 //////////////////////////////////////////////////////////////////////////////
 
+void FASTCALL Vdp2WriteWord(u32 addr, u16 val) {
+   addr &= 0x1FF;
+
+   switch (addr)
+   {
+      case 0x000:
+         yabsys.VBlankLineCount = 225+(val & 0x30);
+         break;
+      case 0x00E:
+         if (Vdp2Internal.ColorMode != ((val >> 12) & 0x3))
+         {
+            Vdp2Internal.ColorMode = (val >> 12) & 0x3;
+            Vdp2ColorRamUpdateColors();
+         }
+         break;
+   }
+
+   if (Vdp2RegsWriteWord(Vdp2Regs, addr, val))
+      Vdp2LineLogWrite(addr, val);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
 void FASTCALL Vdp2WriteLong(u32 addr, u32 val) {
    
    Vdp2WriteWord(addr,val>>16);
@@ -1105,7 +1262,7 @@ void FASTCALL Sh2Vdp2WriteLong(SH2_struct *sh, u32 addr, u32 val) {
 
 //////////////////////////////////////////////////////////////////////////////
 
-int Vdp2SaveState(FILE *fp)
+int Vdp2SaveState(ystream_struct *fp)
 {
    int offset;
    IOCheck_struct check = { 0, 0 };
@@ -1129,7 +1286,7 @@ int Vdp2SaveState(FILE *fp)
 
 //////////////////////////////////////////////////////////////////////////////
 
-int Vdp2LoadState(FILE *fp, UNUSED int version, int size)
+int Vdp2LoadState(ystream_struct *fp, UNUSED int version, int size)
 {
    IOCheck_struct check = { 0, 0 };
 
@@ -1145,6 +1302,10 @@ int Vdp2LoadState(FILE *fp, UNUSED int version, int size)
    // Read internal variables
    yread(&check, (void *)&Vdp2Internal, sizeof(Vdp2Internal_struct), 1, fp);
 
+   Vdp2MarkAllDirty();
+   Vdp2ColorRamUpdateColors();
+   Vdp2LineLogReset();
+
    return size;
 }
 
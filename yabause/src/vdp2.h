@@ -26,8 +26,43 @@
 #include "osdcore.h"
 
 extern u8 * Vdp2Ram;
+extern u8 Vdp2RamDirtyPages[0x80];
 extern u8 * Vdp2ColorRam;
 
+// Write stamps for caches of decoded VDP2 data. Writes record the current
+// Vdp2WriteSerial and the video core bumps it whenever it takes a snapshot,
+// so anything decoded at serial s is stale once one of its stamps reaches s.
+#define VDP2_RAM_BLOCK_SHIFT 5
+
+extern u32 Vdp2WriteSerial;
+extern u32 Vdp2RamBlockSerial[0x80000 >> VDP2_RAM_BLOCK_SHIFT];
+extern u32 Vdp2ColorRamSerial;
+
+// For writes that go straight to Vdp2Ram instead of through Vdp2RamWrite*
+static INLINE void Vdp2RamMarkDirty(u32 addr, u32 length)
+{
+   u32 i;
+
+   addr &= 0x7FFFF;
+   if (addr + length > 0x80000)
+      length = 0x80000 - addr;
+   for (i = addr >> VDP2_RAM_BLOCK_SHIFT; i < (addr + length + (1 << VDP2_RAM_BLOCK_SHIFT) - 1) >> VDP2_RAM_BLOCK_SHIFT; i++)
+      Vdp2RamBlockSerial[i] = Vdp2WriteSerial;
+   for (i = addr >> RAM_DIRTY_PAGE_SHIFT; i < (addr + length + (1 << RAM_DIRTY_PAGE_SHIFT) - 1) >> RAM_DIRTY_PAGE_SHIFT; i++)
+      Vdp2RamDirtyPages[i] = 1;
+}
+
+// Stamps all of VDP2 RAM and color RAM, after they were replaced wholesale
+void Vdp2MarkAllDirty(void);
+
+// Color RAM entries already converted the way the current color RAM mode
+// reads them, indexed by color number & 0x7FF. 24-bit mode only has 0x400
+// colors, they show up twice.
+extern u32 Vdp2ColorRamColors[0x800];
+
+// Converts all of color RAM again, after it or the mode changed wholesale
+void Vdp2ColorRamUpdateColors(void);
+
 u8 FASTCALL     Vdp2RamReadByte(u32);
 u16 FASTCALL    Vdp2RamReadWord(u32);
 u32 FASTCALL    Vdp2RamReadLong(u32);
@@ -376,7 +411,37 @@ typedef struct {
 extern Vdp2Internal_struct Vdp2Internal;
 extern u64 lastticks;
 extern int vdp2_is_odd_frame;
-extern Vdp2 Vdp2Lines[270];
+
+// Register writes made while a frame is displayed. Instead of latching all of
+// Vdp2 on every line, the registers are latched once on line 0 and each write
+// after that is logged with the first line it shows up on. The renderers replay
+// the log through a Vdp2LineRegs as they walk down the screen.
+typedef struct
+{
+   u16 line;
+   u16 addr;
+   u16 val;
+} Vdp2LineWrite;
+
+// a register is logged at most once per line
+#define VDP2_LINE_LOG_SIZE (270 * 0x90)
+
+typedef struct
+{
+   Vdp2 regs;
+   u32 count;
+   Vdp2LineWrite writes[VDP2_LINE_LOG_SIZE];
+} Vdp2LineLog;
+
+typedef struct
+{
+   const Vdp2LineLog * log;
+   u32 next;
+   int line;
+   Vdp2 regs;
+} Vdp2LineRegs;
+
+extern Vdp2LineLog Vdp2Lines;
 
 struct CellScrollData
 {
@@ -417,8 +482,8 @@ void FASTCALL   Sh2Vdp2WriteByte(SH2_struct *, u32, u8);
 void FASTCALL   Sh2Vdp2WriteWord(SH2_struct *, u32, u16);
 void FASTCALL   Sh2Vdp2WriteLong(SH2_struct *, u32, u32);
 
-int Vdp2SaveState(FILE *fp);
-int Vdp2LoadState(FILE *fp, int version, int size);
+int Vdp2SaveState(ystream_struct *fp);
+int Vdp2LoadState(ystream_struct *fp, int version, int size);
 
 void ToggleNBG0(void);
 void ToggleNBG1(void);
@@ -429,6 +494,8 @@ void ToggleFullScreen(void);
 void EnableAutoFrameSkip(void);
 void DisableAutoFrameSkip(void);
 
-Vdp2 * Vdp2RestoreRegs(int line, Vdp2* lines);
+void Vdp2LineLogCopy(Vdp2LineLog * dst, const Vdp2LineLog * src);
+void Vdp2LineRegsInit(Vdp2LineRegs * lines, const Vdp2LineLog * log);
+Vdp2 * Vdp2RestoreRegs(int line, Vdp2LineRegs * lines);
 
 #endif
@@ -2392,6 +2392,9 @@ static void Vdp2DrawMapPerLine(vdp2draw_struct *info, YglEsTexture *texture){
     const int plane_mask = 0x1FF;
     const int page_shift = 9 - 7 + (64/info->pagewh);
     const int page_mask = 0x0f >> ((info->pagewh/32)-1);
+    Vdp2LineRegs line_regs;
+
+    Vdp2LineRegsInit(&line_regs, &Vdp2Lines);
 
 	info->patternpixelwh = 8*info->patternwh;
 	info->draww = (int)((float)vdp2width / info->coordincx);
@@ -2423,7 +2426,7 @@ static void Vdp2DrawMapPerLine(vdp2draw_struct *info, YglEsTexture *texture){
 		if (info->coordincx < info->maxzoom) info->coordincx = info->maxzoom;
 		info->draww = (int)((float)vdp2width / info->coordincx);
 
-		regs = Vdp2RestoreRegs(v, Vdp2Lines);
+		regs = Vdp2RestoreRegs(v, &line_regs);
 		if (regs) ReadVdp2ColorOffset(regs, info, info->linecheck_mask);
 
 		// determine which chara shoud be used.
@@ -2731,6 +2734,7 @@ static void FASTCALL Vdp2DrawRotation(vdp2draw_struct *info, vdp2rotationparamet
    int linecl = 0xFF;
    vdp2rotationparameter_struct *parameter;
    Vdp2 * regs;
+   Vdp2LineRegs line_regs;
    if ((Vdp2Regs->CCCTL >> 5) & 0x01){
 	   linecl = ((~Vdp2Regs->CCRLB & 0x1F) << 3) + 0x7;
    }
@@ -2782,7 +2786,8 @@ static void FASTCALL Vdp2DrawRotation(vdp2draw_struct *info, vdp2rotationparamet
       patternshift = 0;      
    }
    
-   regs = Vdp2RestoreRegs(3, Vdp2Lines);
+   Vdp2LineRegsInit(&line_regs, &Vdp2Lines);
+   regs = Vdp2RestoreRegs(3, &line_regs);
    if (regs) ReadVdp2ColorOffset(regs, info, info->linecheck_mask);
 
    line_texture.textdata = NULL;
@@ -183,7 +183,7 @@ typedef struct
    vdp2rotationparameter_struct * FASTCALL (*GetRParam)(void *, int h,int v);
    u32 LineColorBase;
    
-   void (*LoadLineParams)(void *, void *, int line, Vdp2* lines);
+   void (*LoadLineParams)(void *, void *, int line, Vdp2LineRegs * lines);
 
    int bad_cycle_setting;
 
@@ -45,6 +45,7 @@
 #include "threads.h"
 
 #include "profiler.h"
+#include "profile.h"
 
 #include <stdlib.h>
 #include <limits.h>
@@ -103,10 +104,14 @@ void VIDSoftVdp2SetResolution(u16 TVMD);
 void VIDSoftGetGlSize(int *width, int *height);
 void VIDSoftVdp1SwapFrameBuffer(void);
 void VIDSoftVdp1EraseFrameBuffer(Vdp1* regs, u8 * back_framebuffer);
-void VidsoftDrawSprite(Vdp2 * vdp2_regs, u8 * sprite_window_mask, u8* vdp1_front_framebuffer, u8 * vdp2_ram, Vdp1* vdp1_regs, Vdp2* vdp2_lines, u8*color_ram);
+void VidsoftDrawSprite(Vdp2 * vdp2_regs, u8 * sprite_window_mask, u8* vdp1_front_framebuffer, u8 * vdp2_ram, Vdp1* vdp1_regs, Vdp2LineLog * vdp2_lines, u32*color_ram);
+static void VidsoftDrawSpriteLines(Vdp2 * vdp2_regs, u8 * spr_window_mask, u8* vdp1_front_framebuffer, u8 * vdp2_ram, Vdp1* vdp1_regs, Vdp2LineLog * vdp2_lines, u32*color_ram, int band_start, int band_end);
 void VIDSoftGetNativeResolution(int *width, int *height, int*interlace);
 void VIDSoftVdp2DispOff(void);
 static pixel_t* VIDSoftgetFramebuffer(void);
+static void VidsoftVdp1DrawCommands(u8 * ram, Vdp1 * regs, u8 * back_framebuffer);
+static int VidsoftVdp1PoolInit(void);
+static void VidsoftVdp1PoolDeInit(void);
 
 VideoInterface_struct VIDSoft = {
 VIDCORE_SOFT,
@@ -172,6 +177,7 @@ int vdp2_interlace = 0;
 static int rbg0height = 0;
 int bilinear = 0;
 int vidsoft_num_layer_threads = 0;
+int vidsoft_num_vdp1_threads = 0;
 int bad_cycle_setting[6] = { 0 };
 
 struct VidsoftVdp1ThreadContext
@@ -180,13 +186,48 @@ struct VidsoftVdp1ThreadContext
    volatile int need_draw;
    Vdp1 regs;
    u8 ram[0x80000];
-   u8 back_framebuffer[0x40000];
+   // vdp1backframebuffer when the draw started, only touched by the thread
+   // until draw_finished since every other user waits for it first
+   u8 * back_framebuffer;
 }vidsoft_vdp1_thread_context;
 
 int vidsoft_vdp1_thread_enabled = 0;
 
+enum
+{
+   VIDSOFT_JOB_NONE,
+   VIDSOFT_JOB_SCROLL,
+   VIDSOFT_JOB_ROTATION,
+   VIDSOFT_JOB_SPRITE
+};
+
+// A layer set up on the main thread, its bands are drawn by the worker pool
+typedef struct
+{
+   int type;
+   int single_band;
+   vdp2draw_struct info;
+   vdp2rotationparameterfp_struct parameter[2];
+   Vdp2LineLog * lines;
+   Vdp2* regs;
+   u8* ram;
+   u32* color_ram;
+   struct CellScrollData * cell_data;
+} vidsoft_layer_job;
+
 typedef struct { s16 x; s16 y; } vdp1vertex;
 
+// An 8x8 palette cell expanded to colors, see Vdp2FetchCellPixel
+typedef struct
+{
+   u32 key;
+   u32 serial;
+   u32 color[64];
+   // low nibble of the dot for special priority and color calculation,
+   // 0x80 when the dot is transparent
+   u8 dot[64];
+} vidsoft_cell;
+
 typedef struct
 {
    int pagepixelwh, pagepixelwh_bits, pagepixelwh_mask;
@@ -197,39 +238,15 @@ typedef struct
    int oldcellx, oldcelly, oldcellcheck;
    int xmask, ymask;
    u32 planetbl[16];
+   vidsoft_cell * cells;
+   vidsoft_cell * cell;
 } screeninfo_struct;
 
 //////////////////////////////////////////////////////////////////////////////
 
-static INLINE u32 FASTCALL Vdp2ColorRamGetColor(u32 addr, u8* vdp2_color_ram)
+static INLINE u32 FASTCALL Vdp2ColorRamGetColor(u32 addr, u32* vdp2_color_ram)
 {
-   switch(Vdp2Internal.ColorMode)
-   {
-      case 0:
-      {
-         u32 tmp;
-         addr <<= 1;
-         tmp = T2ReadWord(vdp2_color_ram, addr & 0xFFF);
-         /* we preserve MSB for special color calculation mode 3 (see Vdp2 user's manual 3.4 and 12.3) */
-         return (((tmp & 0x1F) << 3) | ((tmp & 0x03E0) << 6) | ((tmp & 0x7C00) << 9)) | ((tmp & 0x8000) << 16);
-      }
-      case 1:
-      {
-         u32 tmp;
-         addr <<= 1;
-         tmp = T2ReadWord(vdp2_color_ram, addr & 0xFFF);
-         /* we preserve MSB for special color calculation mode 3 (see Vdp2 user's manual 3.4 and 12.3) */
-         return (((tmp & 0x1F) << 3) | ((tmp & 0x03E0) << 6) | ((tmp & 0x7C00) << 9)) | ((tmp & 0x8000) << 16);
-      }
-      case 2:
-      {
-         addr <<= 2;   
-         return T2ReadLong(vdp2_color_ram, addr & 0xFFF);
-      }
-      default: break;
-   }
-
-   return 0;
+   return vdp2_color_ram[addr & 0x7FF];
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -380,7 +397,7 @@ static INLINE void ReadVdp2ColorOffset(Vdp2 * regs, vdp2draw_struct *info, int c
 
 //////////////////////////////////////////////////////////////////////////////
 
-static INLINE int Vdp2FetchPixel(vdp2draw_struct *info, int x, int y, u32 *color, u32 *dot, u8 * ram, int charaddr, int paladdr, u8* vdp2_color_ram)
+static INLINE int Vdp2FetchPixel(vdp2draw_struct *info, int x, int y, u32 *color, u32 *dot, u8 * ram, int charaddr, int paladdr, u32* vdp2_color_ram)
 {
    switch(info->colornumber)
    {
@@ -430,6 +447,129 @@ static INLINE int Vdp2FetchPixel(vdp2draw_struct *info, int x, int y, u32 *color
    }
 }
 
+//////////////////////////////////////////////////////////////////////////////
+// Decoded cell cache
+//
+// Palette cells are expanded to colors the first time a layer draws them and
+// reused until VDP2 RAM under the cell, color RAM or the color RAM mode
+// change. Every thread that draws bands owns a cache so no locking is needed.
+//////////////////////////////////////////////////////////////////////////////
+
+#define VIDSOFT_CELL_CACHE_BITS 12
+#define VIDSOFT_CELL_CACHE_SIZE (1 << VIDSOFT_CELL_CACHE_BITS)
+// the layer workers plus the main thread
+#define VIDSOFT_CELL_CACHES (YAB_THREAD_VIDSOFT_WORKER_LAST - YAB_THREAD_VIDSOFT_WORKER_0 + 2)
+
+static vidsoft_cell * vidsoft_cell_cache;
+// Vdp2WriteSerial when the VDP2 RAM being drawn was taken
+static u32 vidsoft_cell_serial;
+
+//////////////////////////////////////////////////////////////////////////////
+
+static INLINE vidsoft_cell * VidsoftCellCache(int which)
+{
+   if (vidsoft_cell_cache == NULL)
+      return NULL;
+
+   return vidsoft_cell_cache + which * VIDSOFT_CELL_CACHE_SIZE;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static int Vdp2CellIsCurrent(vidsoft_cell * cell, int colornumber, u32 celladdr)
+{
+   u32 block = celladdr >> VDP2_RAM_BLOCK_SHIFT;
+   int i;
+
+   if (cell->serial == vidsoft_cell_serial)
+      return 1;
+
+   if (cell->serial == 0 || Vdp2ColorRamSerial >= cell->serial)
+      return 0;
+
+   // 32, 64 or 128 bytes
+   for (i = 0; i < (1 << colornumber); i++)
+   {
+      if (Vdp2RamBlockSerial[(block + i) & ((0x80000 >> VDP2_RAM_BLOCK_SHIFT) - 1)] >= cell->serial)
+         return 0;
+   }
+
+   cell->serial = vidsoft_cell_serial;
+   return 1;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void Vdp2DecodeCell(vidsoft_cell * cell, int colornumber, u8 * ram, u32 celladdr, u32 palbase, u32 * color_ram)
+{
+   int i;
+
+   for (i = 0; i < 64; i++)
+   {
+      u32 dot;
+
+      switch (colornumber)
+      {
+         case 0: // 4 BPP
+            dot = T1ReadByte(ram, (celladdr + i / 2) & 0x7FFFF);
+            if (!(i & 0x1)) dot >>= 4;
+            dot &= 0xF;
+            break;
+         case 1: // 8 BPP
+            dot = T1ReadByte(ram, (celladdr + i) & 0x7FFFF);
+            break;
+         default: // 16 BPP(palette)
+            dot = T1ReadWord(ram, (celladdr + i * 2) & 0x7FFFF);
+            break;
+      }
+
+      cell->color[i] = Vdp2ColorRamGetColor(palbase + dot, color_ram);
+      cell->dot[i] = (dot & 0xF) | (dot ? 0 : 0x80);
+   }
+
+   cell->serial = vidsoft_cell_serial;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+// Same as Vdp2FetchPixel, except that palette cells come out of the cache.
+// The cell found last is kept in sinfo so a run of pixels from the same cell
+// only costs a key compare.
+static INLINE int Vdp2FetchCellPixel(vdp2draw_struct *info, screeninfo_struct *sinfo, int x, int y, u32 *color, u32 *dot, u8 * ram, int charaddr, int paladdr, u32* color_ram)
+{
+   vidsoft_cell * cell;
+   u32 celladdr, palbase, key;
+   int i;
+
+   if (info->isbitmap || info->colornumber > 2 || sinfo->cells == NULL)
+      return Vdp2FetchPixel(info, x, y, color, dot, ram, charaddr, paladdr, color_ram);
+
+   // 16x16 characters are four cells one after the other, y picks the cell
+   celladdr = (charaddr + ((y >> 3) << (5 + info->colornumber))) & 0x7FFFF;
+   palbase = (info->coloroffset + (info->colornumber < 2 ? paladdr : 0)) & 0x7FF;
+   key = (celladdr >> VDP2_RAM_BLOCK_SHIFT) | (palbase << 14) | (info->colornumber << 25) | (Vdp2Internal.ColorMode << 27);
+
+   cell = sinfo->cell;
+   if (cell == NULL || cell->key != key)
+   {
+      cell = &sinfo->cells[(key * 2654435761U) >> (32 - VIDSOFT_CELL_CACHE_BITS)];
+      if (cell->key != key || !Vdp2CellIsCurrent(cell, info->colornumber, celladdr))
+      {
+         cell->key = key;
+         Vdp2DecodeCell(cell, info->colornumber, ram, celladdr, palbase, color_ram);
+      }
+      sinfo->cell = cell;
+   }
+
+   i = ((y & 7) << 3) | x;
+   if ((cell->dot[i] & 0x80) && info->transparencyenable)
+      return 0;
+
+   *dot = cell->dot[i] & 0xF;
+   *color = cell->color[i];
+   return 1;
+}
+
 //////////////////////////////////////////////////////////////////////////////
 
 static INLINE int TestWindow(int wctl, int enablemask, int inoutmask, clipping_struct *clip, int x, int y)
@@ -800,6 +940,22 @@ int PixelIsSpecialPriority(int specialcode, int dot)
 
 //////////////////////////////////////////////////////////////////////////////
 
+static int mosaic_table[16][1024];
+
+static void Vdp2InitMosaicTable(void)
+{
+   int i, j;
+
+   for (i = 0; i < 16; i++)
+   {
+      int m = i + 1;
+      for (j = 0; j < 1024; j++)
+         mosaic_table[i][j] = j / m*m;
+   }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
 void Vdp2GetInterlaceInfo(int * start_line, int * line_increment)
 {
    if (vdp2_interlace)
@@ -824,7 +980,7 @@ void Vdp2GetInterlaceInfo(int * start_line, int * line_increment)
 
 //////////////////////////////////////////////////////////////////////////////
 
-static void FASTCALL Vdp2DrawScroll(vdp2draw_struct *info, Vdp2* lines, Vdp2* regs, u8* ram, u8* color_ram, struct CellScrollData * cell_data)
+static void FASTCALL Vdp2DrawScroll(vdp2draw_struct *info, Vdp2LineLog * lines, Vdp2* regs, u8* ram, u32* color_ram, struct CellScrollData * cell_data, vidsoft_cell * cells, int band_start, int band_end)
 {
    int i, j;
    int x, y;
@@ -842,9 +998,13 @@ static void FASTCALL Vdp2DrawScroll(vdp2draw_struct *info, Vdp2* lines, Vdp2* re
    u32 linescrollx_table[512] = { 0 };
    u32 linescrolly_table[512] = { 0 };
    float lineszoom_table[512] = { 0 };
+   Vdp2LineRegs line_regs;
    int num_vertical_cell_scroll_enabled = 0;
 
+   Vdp2LineRegsInit(&line_regs, lines);
    SetupScreenVars(info, &sinfo, info->PlaneAddr, regs);
+   sinfo.cells = cells;
+   sinfo.cell = NULL;
 
    scrolly = info->y;
 
@@ -857,32 +1017,21 @@ static void FASTCALL Vdp2DrawScroll(vdp2draw_struct *info, Vdp2* lines, Vdp2* re
    line_window_base[1] = linewnd1addr;
    /* color calculation window: in => no color calc, out => color calc */
    ReadWindowData(regs->WCTLD >> 8, colorcalcwindow, regs);
-   {
-	   static int tables_initialized = 0;
-	   static int mosaic_table[16][1024];
-	   if(!tables_initialized)
-	   {
-		   tables_initialized = 1;
-			for(i=0;i<16;i++)
-			{
-				int m = i+1;
-				for(j=0;j<1024;j++)
-					mosaic_table[i][j] = j/m*m;
-			}
-	   }
-	   mosaic_x = mosaic_table[info->mosaicxmask-1];
-	   mosaic_y = mosaic_table[info->mosaicymask-1];
-   }
+   mosaic_x = mosaic_table[info->mosaicxmask-1];
+   mosaic_y = mosaic_table[info->mosaicymask-1];
 
    Vdp2GetInterlaceInfo(&start_line, &line_increment);
 
+   if (band_end > vdp2height)
+      band_end = vdp2height;
+
    if (regs->SCRCTL & 1)
       num_vertical_cell_scroll_enabled++;
    if (regs->SCRCTL & 0x100)
       num_vertical_cell_scroll_enabled++;
 
    //pre-generate line scroll tables
-   for (j = start_line; j < vdp2height; j++)
+   for (j = start_line; j < band_end; j++)
    {
       if (info->islinescroll)
       {
@@ -916,10 +1065,11 @@ static void FASTCALL Vdp2DrawScroll(vdp2draw_struct *info, Vdp2* lines, Vdp2* re
       }
    }
 
-   for (j = start_line; j < vdp2height; j += line_increment)
+   for (j = start_line; j < band_end; j += line_increment)
    {
       int Y;
       int linescrollx = 0;
+      int span_x = -1, span_y = 0, span_flip = 0;
       // precalculate the coordinate for the line(it's faster) and do line
       // scroll
       if (info->islinescroll)
@@ -993,13 +1143,20 @@ static void FASTCALL Vdp2DrawScroll(vdp2draw_struct *info, Vdp2* lines, Vdp2* re
       Y=y;
 
       if (vdp2_interlace)
-         info->LoadLineParams(info, &sinfo, j / 2, lines);
+         info->LoadLineParams(info, &sinfo, j / 2, &line_regs);
       else
-         info->LoadLineParams(info, &sinfo, j, lines);
+         info->LoadLineParams(info, &sinfo, j, &line_regs);
 
       if (!info->enable)
          continue;
 
+      // lines above the band only keep the line state in step
+      if (j < band_start)
+      {
+         output_y++;
+         continue;
+      }
+
       for (i = 0; i < vdp2width; i++)
       {
          u32 color, dot;
@@ -1026,9 +1183,22 @@ static void FASTCALL Vdp2DrawScroll(vdp2draw_struct *info, Vdp2* lines, Vdp2* re
          // Fetch Pixel, if it isn't transparent, continue
          if (!info->isbitmap)
          {
-            // Tile
-            y=Y;
-            Vdp2MapCalcXY(info, &x, &y, &sinfo, regs, ram, bad_cycle);
+            // Tile, the rest of a cell's row is known once its first
+            // pixel went through the map
+            if ((x >> 3) == span_x)
+            {
+               x = (x & 7) ^ span_flip;
+               y = span_y;
+            }
+            else
+            {
+               if (!bad_cycle)
+                  span_x = x >> 3;
+               y=Y;
+               Vdp2MapCalcXY(info, &x, &y, &sinfo, regs, ram, bad_cycle);
+               span_y = y;
+               span_flip = (info->flipfunction & 1) ? 7 : 0;
+            }
          }
 
          if (!bad_cycle)
@@ -1042,7 +1212,7 @@ static void FASTCALL Vdp2DrawScroll(vdp2draw_struct *info, Vdp2* lines, Vdp2* re
             paladdr = info->pipe[0].paladdr;
          }
 
-         if (!Vdp2FetchPixel(info, x, y, &color, &dot, ram, charaddr, paladdr,color_ram))
+         if (!Vdp2FetchCellPixel(info, &sinfo, x, y, &color, &dot, ram, charaddr, paladdr, color_ram))
          {
             continue;
          }
@@ -1134,7 +1304,7 @@ int Rbg0CheckRam(Vdp2* regs)
    return 0;
 }
 
-static void FASTCALL Vdp2DrawRotationFP(vdp2draw_struct *info, vdp2rotationparameterfp_struct *parameter, Vdp2* lines, Vdp2* regs, u8* ram, u8* color_ram, struct CellScrollData * cell_data)
+static void FASTCALL Vdp2DrawRotationFP(vdp2draw_struct *info, vdp2rotationparameterfp_struct *parameter, Vdp2LineLog * lines, Vdp2* regs, u8* ram, u32* color_ram, struct CellScrollData * cell_data, vidsoft_cell * cells, int band_start, int band_end)
 {
    int i, j;
    int x, y;
@@ -1142,6 +1312,9 @@ static void FASTCALL Vdp2DrawRotationFP(vdp2draw_struct *info, vdp2rotationparam
    vdp2rotationparameterfp_struct *p=&parameter[info->rotatenum];
    clipping_struct clip[2];
    u32 linewnd0addr, linewnd1addr;
+   Vdp2LineRegs line_regs;
+
+   Vdp2LineRegsInit(&line_regs, lines);
 
    clip[0].xstart = clip[0].ystart = clip[0].xend = clip[0].yend = 0;
    clip[1].xstart = clip[1].ystart = clip[1].xend = clip[1].yend = 0;
@@ -1172,12 +1345,21 @@ static void FASTCALL Vdp2DrawRotationFP(vdp2draw_struct *info, vdp2rotationparam
          CalculateRotationValuesFP(p);
 
          SetupScreenVars(info, &sinfo, info->PlaneAddr, regs);
+         sinfo.cells = cells;
+         sinfo.cell = NULL;
 
-         for (j = 0; j < vdp2height; j++)
+         for (j = 0; j < vdp2height && j < band_end; j++)
          {
-            info->LoadLineParams(info, &sinfo, j, lines);
+            info->LoadLineParams(info, &sinfo, j, &line_regs);
             ReadLineWindowClip(info->islinewindow, clip, &linewnd0addr, &linewnd1addr, ram, regs);
 
+            if (j < band_start)
+            {
+               xmul += p->deltaXst;
+               ymul += p->deltaYst;
+               continue;
+            }
+
             for (i = 0; i < rbg0width; i++)
             {
                u32 color, dot;
@@ -1196,7 +1378,7 @@ static void FASTCALL Vdp2DrawRotationFP(vdp2draw_struct *info, vdp2rotationparam
                }
  
                // Fetch pixel
-               if (!Vdp2FetchPixel(info, x, y, &color, &dot, ram, info->charaddr,info->paladdr, color_ram))
+               if (!Vdp2FetchCellPixel(info, &sinfo, x, y, &color, &dot, ram, info->charaddr, info->paladdr, color_ram))
                {
                   continue;
                }
@@ -1247,6 +1429,8 @@ static void FASTCALL Vdp2DrawRotationFP(vdp2draw_struct *info, vdp2rotationparam
       CalculateRotationValuesFP(p);
 
       SetupScreenVars(info, &sinfo, p->PlaneAddr, regs);
+      sinfo.cells = cells;
+      sinfo.cell = NULL;
       coefx = coefy = 0;
       rcoefx = rcoefy = 0;
 
@@ -1287,132 +1471,161 @@ static void FASTCALL Vdp2DrawRotationFP(vdp2draw_struct *info, vdp2rotationparam
          lineInc = regs->LCTA.part.U & 0x8000 ? 2 : 0;
       }
 
-      for (j = 0; j < rbg0height; j++)
+      for (j = 0; j < rbg0height && j < band_end; j++)
       {
-         if (p->deltaKAx == 0)
-         {
-            Vdp2ReadCoefficientFP(p,
-                                  p->coeftbladdr +
-                                  (coefy + touint(rcoefy)) *
-                                  p->coefdatasize, ram);
-         }
-         if ((p2 != NULL) && p2->coefenab && (p2->deltaKAx == 0))
-         {
-            Vdp2ReadCoefficientFP(p2,
-                                  p2->coeftbladdr +
-                                  (coefy2 + touint(rcoefy2)) *
-                                  p2->coefdatasize, ram);
-         }
-
-         if (info->linescreen > 1)
+         if (j < band_start)
          {
-            lineColorAddr = (T1ReadWord(ram, lineAddr) & 0x780) | p->linescreen;
-            lineColor = Vdp2ColorRamGetColor(lineColorAddr, color_ram);
-            lineAddr += lineInc;
-            TitanPutLineHLine(info->linescreen, j, COLSAT2YAB32(0x3F, lineColor));
-         }
+            // Lines above the band only advance the per line state. The
+            // line color of the first band line comes from the last
+            // coefficient read on the line before it.
+            if (info->linescreen > 1)
+               lineAddr += lineInc;
 
-         info->LoadLineParams(info, &sinfo, j, lines);
-         ReadLineWindowClip(info->islinewindow, clip, &linewnd0addr, &linewnd1addr, ram, regs);
+            ReadLineWindowClip(info->islinewindow, clip, &linewnd0addr, &linewnd1addr, ram, regs);
 
-         if (userpwindow)
-            ReadLineWindowClip(isrplinewindow, rpwindow, &rplinewnd0addr, &rplinewnd1addr, ram, regs);
+            if (userpwindow)
+               ReadLineWindowClip(isrplinewindow, rpwindow, &rplinewnd0addr, &rplinewnd1addr, ram, regs);
 
-         for (i = 0; i < rbg0width; i++)
+            if (j == band_start - 1 && p->deltaKAx != 0)
+            {
+               for (i = 0; i < rbg0width; i++)
+               {
+                  Vdp2ReadCoefficientFP(p,
+                                        p->coeftbladdr +
+                                        (coefy + coefx + toint(rcoefx + rcoefy)) *
+                                        p->coefdatasize, ram);
+                  coefx += toint(p->deltaKAx);
+                  rcoefx += decipart(p->deltaKAx);
+               }
+            }
+         }
+         else
          {
-            u32 color, dot;
-
-            if (p->deltaKAx != 0)
+            if (p->deltaKAx == 0)
             {
                Vdp2ReadCoefficientFP(p,
                                      p->coeftbladdr +
-                                     (coefy + coefx + toint(rcoefx + rcoefy)) *
+                                     (coefy + touint(rcoefy)) *
                                      p->coefdatasize, ram);
-               coefx += toint(p->deltaKAx);
-               rcoefx += decipart(p->deltaKAx);
             }
-            if ((p2 != NULL) && p2->coefenab && (p2->deltaKAx != 0))
+            if ((p2 != NULL) && p2->coefenab && (p2->deltaKAx == 0))
             {
                Vdp2ReadCoefficientFP(p2,
                                      p2->coeftbladdr +
-                                     (coefy2 + coefx2 + toint(rcoefx2 + rcoefy2)) *
+                                     (coefy2 + touint(rcoefy2)) *
                                      p2->coefdatasize, ram);
-               coefx2 += toint(p2->deltaKAx);
-               rcoefx2 += decipart(p2->deltaKAx);
             }
 
-            if (!TestBothWindow(info->wctl, clip, i, j))
-               continue;
-
-            if (((! userpwindow) && p->msb) || (userpwindow && (! TestBothWindow(regs->WCTLD, rpwindow, i, j))))
+            if (info->linescreen > 1)
             {
-               if ((p2 == NULL) || (p2->coefenab && p2->msb)) continue;
+               lineColorAddr = (T1ReadWord(ram, lineAddr) & 0x780) | p->linescreen;
+               lineColor = Vdp2ColorRamGetColor(lineColorAddr, color_ram);
+               lineAddr += lineInc;
+               TitanPutLineHLine(info->linescreen, j, COLSAT2YAB32(0x3F, lineColor));
+            }
 
-               x = GenerateRotatedXPosFP(p2, i, xmul2, ymul2, C2);
-               y = GenerateRotatedYPosFP(p2, i, xmul2, ymul2, F2);
+            info->LoadLineParams(info, &sinfo, j, &line_regs);
+            ReadLineWindowClip(info->islinewindow, clip, &linewnd0addr, &linewnd1addr, ram, regs);
 
-               switch(p2->screenover) {
-                  case 0:
-                     x &= sinfo2.xmask;
-                     y &= sinfo2.ymask;
-                     break;
-                  case 1:
-                     VDP2LOG("Screen-over mode 1 not implemented");
-                     x &= sinfo2.xmask;
-                     y &= sinfo2.ymask;
-                     break;
-                  case 2:
-                     if ((x > sinfo2.xmask) || (y > sinfo2.ymask)) continue;
-                     break;
-                  case 3:
-                     if ((x > 512) || (y > 512)) continue;
+            if (userpwindow)
+               ReadLineWindowClip(isrplinewindow, rpwindow, &rplinewnd0addr, &rplinewnd1addr, ram, regs);
+
+            for (i = 0; i < rbg0width; i++)
+            {
+               u32 color, dot;
+
+               if (p->deltaKAx != 0)
+               {
+                  Vdp2ReadCoefficientFP(p,
+                                        p->coeftbladdr +
+                                        (coefy + coefx + toint(rcoefx + rcoefy)) *
+                                        p->coefdatasize, ram);
+                  coefx += toint(p->deltaKAx);
+                  rcoefx += decipart(p->deltaKAx);
+               }
+               if ((p2 != NULL) && p2->coefenab && (p2->deltaKAx != 0))
+               {
+                  Vdp2ReadCoefficientFP(p2,
+                                        p2->coeftbladdr +
+                                        (coefy2 + coefx2 + toint(rcoefx2 + rcoefy2)) *
+                                        p2->coefdatasize, ram);
+                  coefx2 += toint(p2->deltaKAx);
+                  rcoefx2 += decipart(p2->deltaKAx);
                }
 
-               // Convert coordinates into graphics
-               if (!info->isbitmap)
+               if (!TestBothWindow(info->wctl, clip, i, j))
+                  continue;
+
+               if (((! userpwindow) && p->msb) || (userpwindow && (! TestBothWindow(regs->WCTLD, rpwindow, i, j))))
                {
-                  // Tile
-                  Vdp2MapCalcXY(info, &x, &y, &sinfo2, regs, ram, 0);
+                  if ((p2 == NULL) || (p2->coefenab && p2->msb)) continue;
+
+                  x = GenerateRotatedXPosFP(p2, i, xmul2, ymul2, C2);
+                  y = GenerateRotatedYPosFP(p2, i, xmul2, ymul2, F2);
+
+                  switch(p2->screenover) {
+                     case 0:
+                        x &= sinfo2.xmask;
+                        y &= sinfo2.ymask;
+                        break;
+                     case 1:
+                        VDP2LOG("Screen-over mode 1 not implemented");
+                        x &= sinfo2.xmask;
+                        y &= sinfo2.ymask;
+                        break;
+                     case 2:
+                        if ((x > sinfo2.xmask) || (y > sinfo2.ymask)) continue;
+                        break;
+                     case 3:
+                        if ((x > 512) || (y > 512)) continue;
+                  }
+
+                  // Convert coordinates into graphics
+                  if (!info->isbitmap)
+                  {
+                     // Tile
+                     Vdp2MapCalcXY(info, &x, &y, &sinfo2, regs, ram, 0);
+                  }
                }
-            }
-            else if (p->msb) continue;
-            else
-            {
-               x = GenerateRotatedXPosFP(p, i, xmul, ymul, C);
-               y = GenerateRotatedYPosFP(p, i, xmul, ymul, F);
+               else if (p->msb) continue;
+               else
+               {
+                  x = GenerateRotatedXPosFP(p, i, xmul, ymul, C);
+                  y = GenerateRotatedYPosFP(p, i, xmul, ymul, F);
 
-               switch(p->screenover) {
-                  case 0:
-                     x &= sinfo.xmask;
-                     y &= sinfo.ymask;
-                     break;
-                  case 1:
-                     VDP2LOG("Screen-over mode 1 not implemented");
-                     x &= sinfo.xmask;
-                     y &= sinfo.ymask;
-                     break;
-                  case 2:
-                     if ((x > sinfo.xmask) || (y > sinfo.ymask)) continue;
-                     break;
-                  case 3:
-                     if ((x > 512) || (y > 512)) continue;
+                  switch(p->screenover) {
+                     case 0:
+                        x &= sinfo.xmask;
+                        y &= sinfo.ymask;
+                        break;
+                     case 1:
+                        VDP2LOG("Screen-over mode 1 not implemented");
+                        x &= sinfo.xmask;
+                        y &= sinfo.ymask;
+                        break;
+                     case 2:
+                        if ((x > sinfo.xmask) || (y > sinfo.ymask)) continue;
+                        break;
+                     case 3:
+                        if ((x > 512) || (y > 512)) continue;
+                  }
+
+                  // Convert coordinates into graphics
+                  if (!info->isbitmap)
+                  {
+                     // Tile
+                     Vdp2MapCalcXY(info, &x, &y, &sinfo, regs, ram, 0);
+                  }
                }
 
-               // Convert coordinates into graphics
-               if (!info->isbitmap)
+               // Fetch pixel
+               if (!Vdp2FetchCellPixel(info, &sinfo, x, y, &color, &dot, ram, info->charaddr, info->paladdr, color_ram))
                {
-                  // Tile
-                  Vdp2MapCalcXY(info, &x, &y, &sinfo, regs, ram, 0);
+                  continue;
                }
-            }
 
-            // Fetch pixel
-            if (!Vdp2FetchPixel(info, x, y, &color, &dot, ram, info->charaddr, info->paladdr, color_ram))
-            {
-               continue;
+               Rbg0PutPixel(info, color, dot, i, j);
             }
-
-            Rbg0PutPixel(info, color, dot, i, j);
          }
          xmul += p->deltaXst;
          ymul += p->deltaYst;
@@ -1437,7 +1650,7 @@ static void FASTCALL Vdp2DrawRotationFP(vdp2draw_struct *info, vdp2rotationparam
       return;
    }
 
-   Vdp2DrawScroll(info, lines, regs, ram, color_ram, cell_data);
+   Vdp2DrawScroll(info, lines, regs, ram, color_ram, cell_data, cells, band_start, band_end);
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -1516,7 +1729,7 @@ static void Vdp2DrawLineScreen(void)
       for (i = 0; i < vdp2height; i++)
       {
          color = T1ReadWord(Vdp2Ram, scrAddr) & 0x7FF;
-         dot = Vdp2ColorRamGetColor(color, Vdp2ColorRam);
+         dot = Vdp2ColorRamGetColor(color, Vdp2ColorRamColors);
          scrAddr += 2;
 
          TitanPutLineHLine(1, i, COLSAT2YAB32(alpha, dot));
@@ -1526,7 +1739,7 @@ static void Vdp2DrawLineScreen(void)
    {
       /* single color, implemented but not tested... */
       color = T1ReadWord(Vdp2Ram, scrAddr) & 0x7FF;
-      dot = Vdp2ColorRamGetColor(color, Vdp2ColorRam);
+      dot = Vdp2ColorRamGetColor(color, Vdp2ColorRamColors);
       for (i = 0; i < vdp2height; i++)
          TitanPutLineHLine(1, i, COLSAT2YAB32(alpha, dot));
    }
@@ -1534,7 +1747,36 @@ static void Vdp2DrawLineScreen(void)
 
 //////////////////////////////////////////////////////////////////////////////
 
-static void LoadLineParamsNBG0(vdp2draw_struct * info, screeninfo_struct * sinfo, int line, Vdp2* lines)
+// Draws a whole layer right away, or when job isn't NULL keeps what the band
+// workers need to draw it later
+static void Vdp2DrawLayer(vidsoft_layer_job * job, vdp2draw_struct *info, vdp2rotationparameterfp_struct *parameter, Vdp2LineLog * lines, Vdp2* regs, u8* ram, u32* color_ram, struct CellScrollData * cell_data)
+{
+   if (job == NULL)
+   {
+      if (parameter)
+         Vdp2DrawRotationFP(info, parameter, lines, regs, ram, color_ram, cell_data, VidsoftCellCache(VIDSOFT_CELL_CACHES - 1), 0, vdp2height);
+      else
+         Vdp2DrawScroll(info, lines, regs, ram, color_ram, cell_data, VidsoftCellCache(VIDSOFT_CELL_CACHES - 1), 0, vdp2height);
+      return;
+   }
+
+   job->type = parameter ? VIDSOFT_JOB_ROTATION : VIDSOFT_JOB_SCROLL;
+   job->info = *info;
+   if (parameter)
+      memcpy(job->parameter, parameter, sizeof(job->parameter));
+   job->lines = lines;
+   job->regs = regs;
+   job->ram = ram;
+   job->color_ram = color_ram;
+   job->cell_data = cell_data;
+
+   // the bad cycle tile pipeline carries over from one line to the next
+   job->single_band = bad_cycle_setting[info->titan_which_layer];
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void LoadLineParamsNBG0(vdp2draw_struct * info, screeninfo_struct * sinfo, int line, Vdp2LineRegs * lines)
 {
    Vdp2 * regs;
 
@@ -1548,10 +1790,10 @@ static void LoadLineParamsNBG0(vdp2draw_struct * info, screeninfo_struct * sinfo
 
 //////////////////////////////////////////////////////////////////////////////
 
-static void Vdp2DrawNBG0(Vdp2* lines, Vdp2* regs, u8* ram, u8* color_ram, struct CellScrollData * cell_data)
+static void Vdp2DrawNBG0(Vdp2LineLog * lines, Vdp2* regs, u8* ram, u32* color_ram, struct CellScrollData * cell_data, vidsoft_layer_job * job)
 {
    vdp2draw_struct info = { 0 };
-   vdp2rotationparameterfp_struct parameter[2];
+   vdp2rotationparameterfp_struct parameter[2] = { { 0 } };
 
    info.titan_which_layer = TITAN_NBG0;
    info.titan_shadow_enabled = (regs->SDCTL >> 0) & 1;
@@ -1668,23 +1910,23 @@ static void Vdp2DrawNBG0(Vdp2* lines, Vdp2* regs, u8* ram, u8* color_ram, struct
       info.isverticalscroll = 0;
    info.wctl = regs->WCTLA;
 
-   info.LoadLineParams = (void (*)(void *, void *,int ,Vdp2*)) LoadLineParamsNBG0;
+   info.LoadLineParams = (void (*)(void *, void *,int ,Vdp2LineRegs *)) LoadLineParamsNBG0;
 
    if (info.enable == 1)
    {
       // NBG0 draw
-      Vdp2DrawScroll(&info, lines, regs, ram, color_ram, cell_data);
+      Vdp2DrawLayer(job, &info, NULL, lines, regs, ram, color_ram, cell_data);
    }
    else
    {
       // RBG1 draw
-      Vdp2DrawRotationFP(&info, parameter, lines, regs, ram, color_ram, cell_data);
+      Vdp2DrawLayer(job, &info, parameter, lines, regs, ram, color_ram, cell_data);
    }
 }
 
 //////////////////////////////////////////////////////////////////////////////
 
-static void LoadLineParamsNBG1(vdp2draw_struct * info, screeninfo_struct * sinfo, int line, Vdp2* lines)
+static void LoadLineParamsNBG1(vdp2draw_struct * info, screeninfo_struct * sinfo, int line, Vdp2LineRegs * lines)
 {
    Vdp2 * regs;
 
@@ -1698,7 +1940,7 @@ static void LoadLineParamsNBG1(vdp2draw_struct * info, screeninfo_struct * sinfo
 
 //////////////////////////////////////////////////////////////////////////////
 
-static void Vdp2DrawNBG1(Vdp2* lines, Vdp2* regs, u8* ram, u8* color_ram, struct CellScrollData * cell_data)
+static void Vdp2DrawNBG1(Vdp2LineLog * lines, Vdp2* regs, u8* ram, u32* color_ram, struct CellScrollData * cell_data, vidsoft_layer_job * job)
 {
    vdp2draw_struct info = { 0 };
 
@@ -1783,14 +2025,14 @@ static void Vdp2DrawNBG1(Vdp2* lines, Vdp2* regs, u8* ram, u8* color_ram, struct
       info.isverticalscroll = 0;
    info.wctl = regs->WCTLA >> 8;
 
-   info.LoadLineParams = (void(*)(void *, void*, int, Vdp2*)) LoadLineParamsNBG1;
+   info.LoadLineParams = (void(*)(void *, void*, int, Vdp2LineRegs *)) LoadLineParamsNBG1;
 
-   Vdp2DrawScroll(&info, lines, regs, ram, color_ram, cell_data);
+   Vdp2DrawLayer(job, &info, NULL, lines, regs, ram, color_ram, cell_data);
 }
 
 //////////////////////////////////////////////////////////////////////////////
 
-static void LoadLineParamsNBG2(vdp2draw_struct * info, screeninfo_struct * sinfo, int line, Vdp2* lines)
+static void LoadLineParamsNBG2(vdp2draw_struct * info, screeninfo_struct * sinfo, int line, Vdp2LineRegs * lines)
 {
    Vdp2 * regs;
 
@@ -1804,7 +2046,7 @@ static void LoadLineParamsNBG2(vdp2draw_struct * info, screeninfo_struct * sinfo
 
 //////////////////////////////////////////////////////////////////////////////
 
-static void Vdp2DrawNBG2(Vdp2* lines, Vdp2* regs, u8* ram, u8* color_ram, struct CellScrollData * cell_data)
+static void Vdp2DrawNBG2(Vdp2LineLog * lines, Vdp2* regs, u8* ram, u32* color_ram, struct CellScrollData * cell_data, vidsoft_layer_job * job)
 {
    vdp2draw_struct info = { 0 };
 
@@ -1855,14 +2097,14 @@ static void Vdp2DrawNBG2(Vdp2* lines, Vdp2* regs, u8* ram, u8* color_ram, struct
    info.wctl = regs->WCTLB;
    info.isbitmap = 0;
 
-   info.LoadLineParams = (void(*)(void *,void*, int, Vdp2*)) LoadLineParamsNBG2;
+   info.LoadLineParams = (void(*)(void *,void*, int, Vdp2LineRegs *)) LoadLineParamsNBG2;
 
-   Vdp2DrawScroll(&info, lines, regs, ram, color_ram, cell_data);
+   Vdp2DrawLayer(job, &info, NULL, lines, regs, ram, color_ram, cell_data);
 }
 
 //////////////////////////////////////////////////////////////////////////////
 
-static void LoadLineParamsNBG3(vdp2draw_struct * info, screeninfo_struct * sinfo, int line, Vdp2* lines)
+static void LoadLineParamsNBG3(vdp2draw_struct * info, screeninfo_struct * sinfo, int line, Vdp2LineRegs * lines)
 {
    Vdp2 * regs;
 
@@ -1876,7 +2118,7 @@ static void LoadLineParamsNBG3(vdp2draw_struct * info, screeninfo_struct * sinfo
 
 //////////////////////////////////////////////////////////////////////////////
 
-static void Vdp2DrawNBG3(Vdp2* lines, Vdp2* regs, u8* ram, u8* color_ram, struct CellScrollData * cell_data)
+static void Vdp2DrawNBG3(Vdp2LineLog * lines, Vdp2* regs, u8* ram, u32* color_ram, struct CellScrollData * cell_data, vidsoft_layer_job * job)
 {
    vdp2draw_struct info = { 0 };
 
@@ -1929,14 +2171,14 @@ static void Vdp2DrawNBG3(Vdp2* lines, Vdp2* regs, u8* ram, u8* color_ram, struct
    info.wctl = regs->WCTLB >> 8;
    info.isbitmap = 0;
 
-   info.LoadLineParams = (void(*)(void *, void*, int, Vdp2*)) LoadLineParamsNBG3;
+   info.LoadLineParams = (void(*)(void *, void*, int, Vdp2LineRegs *)) LoadLineParamsNBG3;
 
-   Vdp2DrawScroll(&info, lines, regs, ram, color_ram, cell_data);
+   Vdp2DrawLayer(job, &info, NULL, lines, regs, ram, color_ram, cell_data);
 }
 
 //////////////////////////////////////////////////////////////////////////////
 
-static void LoadLineParamsRBG0(vdp2draw_struct * info, screeninfo_struct * sinfo, int line, Vdp2* lines)
+static void LoadLineParamsRBG0(vdp2draw_struct * info, screeninfo_struct * sinfo, int line, Vdp2LineRegs * lines)
 {
    Vdp2 * regs;
 
@@ -1948,10 +2190,10 @@ static void LoadLineParamsRBG0(vdp2draw_struct * info, screeninfo_struct * sinfo
 
 //////////////////////////////////////////////////////////////////////////////
 
-static void Vdp2DrawRBG0(Vdp2* lines, Vdp2* regs, u8* ram, u8* color_ram, struct CellScrollData * cell_data)
+static void Vdp2DrawRBG0(Vdp2LineLog * lines, Vdp2* regs, u8* ram, u32* color_ram, struct CellScrollData * cell_data, vidsoft_layer_job * job)
 {
    vdp2draw_struct info = { 0 };
-   vdp2rotationparameterfp_struct parameter[2];
+   vdp2rotationparameterfp_struct parameter[2] = { { 0 } };
 
    info.titan_which_layer = TITAN_RBG0;
    info.titan_shadow_enabled = (regs->SDCTL >> 4) & 1;
@@ -2053,14 +2295,14 @@ static void Vdp2DrawRBG0(Vdp2* lines, Vdp2* regs, u8* ram, u8* color_ram, struct
    info.isverticalscroll = 0;
    info.wctl = regs->WCTLC;
 
-   info.LoadLineParams = (void(*)(void *, void*, int, Vdp2*)) LoadLineParamsRBG0;
+   info.LoadLineParams = (void(*)(void *, void*, int, Vdp2LineRegs *)) LoadLineParamsRBG0;
 
-   Vdp2DrawRotationFP(&info, parameter, lines, regs, ram, color_ram, cell_data);
+   Vdp2DrawLayer(job, &info, parameter, lines, regs, ram, color_ram, cell_data);
 }
 
 //////////////////////////////////////////////////////////////////////////////
 
-static void LoadLineParamsSprite(vdp2draw_struct * info, int line, Vdp2* lines)
+static void LoadLineParamsSprite(vdp2draw_struct * info, int line, Vdp2LineRegs * lines)
 {
    Vdp2 * regs;
 
@@ -2072,105 +2314,391 @@ static void LoadLineParamsSprite(vdp2draw_struct * info, int line, Vdp2* lines)
 //////////////////////////////////////////////////////////////////////////////
 
 struct {
-   volatile int need_draw[6];
-   volatile int draw_finished[6];
-   Vdp2 lines[270];
+   Vdp2LineLog lines;
    Vdp2 regs;
    u8 ram[0x80000];
-   u8 color_ram[0x1000];
-   struct CellScrollData cell_scroll_data[270];
+   u32 color_ram[0x800];
+   struct CellScrollData cell_data[270];
 }vidsoft_thread_context;
 
-#define DECLARE_THREAD(NAME, LAYER, FUNC) \
-void NAME(void * data) \
-{ \
-   for (;;) \
-   { \
-      if (vidsoft_thread_context.need_draw[LAYER]) \
-      { \
-         vidsoft_thread_context.need_draw[LAYER] = 0; \
-         FUNC(vidsoft_thread_context.lines, &vidsoft_thread_context.regs, vidsoft_thread_context.ram, vidsoft_thread_context.color_ram, vidsoft_thread_context.cell_scroll_data); \
-         vidsoft_thread_context.draw_finished[LAYER] = 1; \
-      } \
-      YabThreadSleep(); \
-   } \
-}
-
-DECLARE_THREAD(VidsoftRbg0Thread, TITAN_RBG0, Vdp2DrawRBG0)
-DECLARE_THREAD(VidsoftNbg0Thread, TITAN_NBG0, Vdp2DrawNBG0)
-DECLARE_THREAD(VidsoftNbg1Thread, TITAN_NBG1, Vdp2DrawNBG1)
-DECLARE_THREAD(VidsoftNbg2Thread, TITAN_NBG2, Vdp2DrawNBG2)
-DECLARE_THREAD(VidsoftNbg3Thread, TITAN_NBG3, Vdp2DrawNBG3)
-
+//////////////////////////////////////////////////////////////////////////////
+// Layer worker pool
+//
+// Each frame the enabled layers are set up on the main thread and cut into
+// bands of scanlines. The bands are dealt out to one queue per worker plus
+// one for the main thread. A worker pops bands from the front of its own
+// queue and steals from the back of the others once it runs dry, so one
+// heavy layer ends up spread over every thread.
 //////////////////////////////////////////////////////////////////////////////
 
-void VIDSoftSetNumLayerThreads(int num)
+#define VIDSOFT_MAX_WORKERS (YAB_THREAD_VIDSOFT_WORKER_LAST - YAB_THREAD_VIDSOFT_WORKER_0 + 1)
+#define VIDSOFT_NUM_QUEUES (VIDSOFT_MAX_WORKERS + 1)
+#define VIDSOFT_BAND_LINES 16
+#define VIDSOFT_MAX_BANDS (6 * 512 / VIDSOFT_BAND_LINES)
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#define VIDSOFT_CAS(p, o, n) (_InterlockedCompareExchange((volatile long *)(p), (long)(n), (long)(o)) == (long)(o))
+#define VIDSOFT_DEC(p) _InterlockedDecrement((volatile long *)(p))
+#define VIDSOFT_PUBLISH(p, v) _InterlockedExchange((volatile long *)(p), (long)(v))
+#define VIDSOFT_READ(p) (*(p))
+#else
+#define VIDSOFT_CAS(p, o, n) __sync_bool_compare_and_swap((p), (o), (n))
+#define VIDSOFT_DEC(p) __sync_sub_and_fetch((p), 1)
+#define VIDSOFT_PUBLISH(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define VIDSOFT_READ(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#endif
+
+typedef struct
 {
-   vidsoft_num_layer_threads = num;
-}
+   u16 layers;
+   u16 start;
+   u16 end;
+} vidsoft_band;
+
+// same order as the single threaded path
+static const int vidsoft_layer_order[6] = { TITAN_SPRITE, TITAN_NBG0, TITAN_NBG1, TITAN_NBG2, TITAN_NBG3, TITAN_RBG0 };
+
+typedef struct
+{
+   // front in the low half, back in the high half, so that the owner and
+   // the thieves claim bands with a single compare and swap
+   volatile u32 range;
+   vidsoft_band bands[VIDSOFT_MAX_BANDS];
+} vidsoft_band_queue;
+
+static struct
+{
+   vidsoft_layer_job jobs[6];
+   vidsoft_band_queue queues[VIDSOFT_NUM_QUEUES];
+   YabSem * wake[VIDSOFT_MAX_WORKERS];
+   YabSem * done;
+   int num_started;
+   int num_active;
+   int busy;
+   volatile int quit;
+   volatile long pending;
+} vidsoft_pool;
 
 //////////////////////////////////////////////////////////////////////////////
 
-void VidsoftVdp1Thread(void* data)
+static int VidsoftTakeBand(vidsoft_band_queue * queue, int steal, vidsoft_band * band)
 {
    for (;;)
    {
-      if (vidsoft_vdp1_thread_context.need_draw)
+      u32 range = VIDSOFT_READ(&queue->range);
+      u32 front = range & 0xFFFF;
+      u32 back = range >> 16;
+
+      if (front >= back)
+         return 0;
+
+      if (steal)
       {
-         vidsoft_vdp1_thread_context.need_draw = 0;
-         Vdp1DrawCommands(vidsoft_vdp1_thread_context.ram, &vidsoft_vdp1_thread_context.regs, vidsoft_vdp1_thread_context.back_framebuffer);
-         memcpy(vdp1backframebuffer, vidsoft_vdp1_thread_context.back_framebuffer, 0x40000);
-         vidsoft_vdp1_thread_context.draw_finished = 1;
+         if (VIDSOFT_CAS(&queue->range, range, front | ((back - 1) << 16)))
+         {
+            *band = queue->bands[back - 1];
+            return 1;
+         }
+      }
+      else if (VIDSOFT_CAS(&queue->range, range, (front + 1) | (back << 16)))
+      {
+         *band = queue->bands[front];
+         return 1;
       }
-
-      YabThreadSleep();
    }
 }
 
 //////////////////////////////////////////////////////////////////////////////
 
-void VidsoftWaitForVdp1Thread()
+static void VidsoftDrawBand(vidsoft_band * band, vidsoft_cell * cells)
 {
-   if (vidsoft_vdp1_thread_enabled)
+   int i;
+
+   for (i = 0; i < 6; i++)
    {
-      while (!vidsoft_vdp1_thread_context.draw_finished){}
+      vidsoft_layer_job * job = &vidsoft_pool.jobs[vidsoft_layer_order[i]];
+      vdp2draw_struct info;
+      vdp2rotationparameterfp_struct parameter[2];
+
+      if (!(band->layers & (1 << vidsoft_layer_order[i])))
+         continue;
+
+      info = job->info;
+
+      switch (job->type)
+      {
+         case VIDSOFT_JOB_SCROLL:
+            PROFILE_START(VDP2LAYER);
+            Vdp2DrawScroll(&info, job->lines, job->regs, job->ram, job->color_ram, job->cell_data, cells, band->start, band->end);
+            PROFILE_STOP(VDP2LAYER);
+            break;
+         case VIDSOFT_JOB_ROTATION:
+            PROFILE_START(VDP2LAYER);
+            memcpy(parameter, job->parameter, sizeof(parameter));
+            Vdp2DrawRotationFP(&info, parameter, job->lines, job->regs, job->ram, job->color_ram, job->cell_data, cells, band->start, band->end);
+            PROFILE_STOP(VDP2LAYER);
+            break;
+         case VIDSOFT_JOB_SPRITE:
+            PROFILE_START(SPRITE);
+            VidsoftDrawSpriteLines(job->regs, sprite_window_mask, vdp1frontframebuffer, job->ram, Vdp1Regs, job->lines, job->color_ram, band->start, band->end);
+            PROFILE_STOP(SPRITE);
+            break;
+      }
    }
 }
 
 //////////////////////////////////////////////////////////////////////////////
 
-void VIDSoftSetVdp1ThreadEnable(int b)
+// Draws bands until no queue has any left, self is the caller's own queue
+static void VidsoftRunBands(int self)
 {
-   vidsoft_vdp1_thread_enabled = b;
+   vidsoft_band band;
+   int num_queues = vidsoft_pool.num_active + 1;
+
+   for (;;)
+   {
+      int i;
+
+      if (!VidsoftTakeBand(&vidsoft_pool.queues[self], 0, &band))
+      {
+         for (i = 1; i < num_queues; i++)
+         {
+            if (VidsoftTakeBand(&vidsoft_pool.queues[(self + i) % num_queues], 1, &band))
+               break;
+         }
+
+         if (i == num_queues)
+            return;
+      }
 
+      VidsoftDrawBand(&band, VidsoftCellCache(self));
+
+      if (VIDSOFT_DEC(&vidsoft_pool.pending) == 0)
+         YabSemPost(vidsoft_pool.done);
+   }
 }
 
-void VidsoftSpriteThread(void * data)
+//////////////////////////////////////////////////////////////////////////////
+
+static void VidsoftWorkerThread(void * data)
+{
+   int id = (int)(pointer)data;
+
+   PROFILE_THREAD_NAME("VidsoftWorker");
+   for (;;)
+   {
+      YabSemWait(vidsoft_pool.wake[id]);
+      if (vidsoft_pool.quit)
+         break;
+      VidsoftRunBands(id);
+   }
+   PROFILE_THREAD_EXIT();
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static int VidsoftPoolInit(void)
+{
+   memset(&vidsoft_pool, 0, sizeof(vidsoft_pool));
+
+   if ((vidsoft_pool.done = YabSemInit(0)) == NULL)
+      return -1;
+
+   return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void VidsoftPoolDeInit(void)
+{
+   int i;
+
+   vidsoft_pool.quit = 1;
+   for (i = 0; i < vidsoft_pool.num_started; i++)
+   {
+      YabSemPost(vidsoft_pool.wake[i]);
+      YabThreadWait(YAB_THREAD_VIDSOFT_WORKER_0 + i);
+      YabSemDeInit(vidsoft_pool.wake[i]);
+   }
+
+   YabSemDeInit(vidsoft_pool.done);
+   memset(&vidsoft_pool, 0, sizeof(vidsoft_pool));
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+// Starts workers as the thread count goes up, extra ones are left asleep
+static void VidsoftPoolResize(int num)
+{
+   if (num > VIDSOFT_MAX_WORKERS)
+      num = VIDSOFT_MAX_WORKERS;
+
+   while (vidsoft_pool.num_started < num)
+   {
+      int id = vidsoft_pool.num_started;
+
+      if ((vidsoft_pool.wake[id] = YabSemInit(0)) == NULL)
+         break;
+
+      if (YabThreadStart(YAB_THREAD_VIDSOFT_WORKER_0 + id, VidsoftWorkerThread, (void *)(pointer)id) != 0)
+      {
+         YabSemDeInit(vidsoft_pool.wake[id]);
+         vidsoft_pool.wake[id] = NULL;
+         break;
+      }
+
+      vidsoft_pool.num_started++;
+   }
+
+   vidsoft_pool.num_active = num < vidsoft_pool.num_started ? num : vidsoft_pool.num_started;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+// Cuts the set up layers into bands, deals them out and wakes the workers
+static void VidsoftPoolStart(void)
+{
+   int i, layer;
+   int num_queues = vidsoft_pool.num_active + 1;
+   int num_bands = 0;
+   int band_lines = VIDSOFT_BAND_LINES;
+   u32 count[VIDSOFT_NUM_QUEUES] = { 0 };
+   u16 merged[6] = { 0 };
+   vidsoft_layer_job * rbg1 = &vidsoft_pool.jobs[TITAN_NBG0];
+   vidsoft_layer_job * rbg0 = &vidsoft_pool.jobs[TITAN_RBG0];
+
+   // interlaced frames only draw every other line
+   if (vdp2_interlace)
+      band_lines *= 2;
+
+   for (layer = 0; layer < 6; layer++)
+      merged[layer] = 1 << layer;
+
+   // RBG0 and RBG1 can both write the line color table, drawing them in
+   // the same bands keeps the single threaded order for each line
+   if (rbg1->type == VIDSOFT_JOB_ROTATION && rbg0->type != VIDSOFT_JOB_NONE &&
+      (rbg1->info.linescreen || rbg0->info.linescreen))
+   {
+      merged[TITAN_NBG0] |= 1 << TITAN_RBG0;
+      merged[TITAN_RBG0] = 0;
+      rbg1->single_band = rbg0->single_band = rbg1->single_band | rbg0->single_band;
+   }
+
+   for (layer = 0; layer < 6; layer++)
+   {
+      vidsoft_layer_job * job = &vidsoft_pool.jobs[layer];
+      int start;
+
+      if (job->type == VIDSOFT_JOB_NONE || merged[layer] == 0)
+         continue;
+
+      for (start = 0; start < vdp2height; start += band_lines)
+      {
+         vidsoft_band * band = &vidsoft_pool.queues[num_bands % num_queues].bands[count[num_bands % num_queues]++];
+
+         band->layers = merged[layer];
+         band->start = start;
+         band->end = job->single_band ? vdp2height : start + band_lines;
+         num_bands++;
+
+         if (job->single_band)
+            break;
+      }
+   }
+
+   if (num_bands == 0)
+      return;
+
+   vidsoft_pool.pending = num_bands;
+   vidsoft_pool.busy = 1;
+
+   for (i = 0; i < num_queues; i++)
+      VIDSOFT_PUBLISH(&vidsoft_pool.queues[i].range, count[i] << 16);
+
+   for (i = 0; i < vidsoft_pool.num_active && i < num_bands; i++)
+      YabSemPost(vidsoft_pool.wake[i]);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+// The main thread helps with whatever is left, then blocks until the
+// workers are done with the bands they already took
+static void VidsoftPoolWait(void)
+{
+   if (!vidsoft_pool.busy)
+      return;
+
+   VidsoftRunBands(vidsoft_pool.num_active);
+   YabSemWait(vidsoft_pool.done);
+   vidsoft_pool.busy = 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void VIDSoftSetNumLayerThreads(int num)
+{
+   vidsoft_num_layer_threads = num;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void VIDSoftSetNumVdp1Threads(int num)
+{
+   vidsoft_num_vdp1_threads = num;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void VidsoftVdp1Thread(void* data)
 {
+   PROFILE_THREAD_NAME("VidsoftVdp1Thread");
    for (;;)
    {
-      if (vidsoft_thread_context.need_draw[TITAN_SPRITE])
+      if (vidsoft_vdp1_thread_context.need_draw)
       {
-         vidsoft_thread_context.need_draw[TITAN_SPRITE] = 0;
-         VidsoftDrawSprite(&vidsoft_thread_context.regs, sprite_window_mask, vdp1frontframebuffer, vidsoft_thread_context.ram, Vdp1Regs,vidsoft_thread_context.lines, vidsoft_thread_context.color_ram);
-         vidsoft_thread_context.draw_finished[TITAN_SPRITE] = 1;
+         vidsoft_vdp1_thread_context.need_draw = 0;
+         PROFILE_START(VDP1DRAW);
+         VidsoftVdp1DrawCommands(vidsoft_vdp1_thread_context.ram, &vidsoft_vdp1_thread_context.regs, vidsoft_vdp1_thread_context.back_framebuffer);
+         PROFILE_STOP(VDP1DRAW);
+         vidsoft_vdp1_thread_context.draw_finished = 1;
       }
+
       YabThreadSleep();
    }
 }
 
 //////////////////////////////////////////////////////////////////////////////
 
-int VIDSoftInit(void)
+void VidsoftWaitForVdp1Thread()
 {
-   int i;
+   if (vidsoft_vdp1_thread_enabled)
+   {
+      while (!vidsoft_vdp1_thread_context.draw_finished){}
+   }
+}
 
+//////////////////////////////////////////////////////////////////////////////
+
+void VIDSoftSetVdp1ThreadEnable(int b)
+{
+   vidsoft_vdp1_thread_enabled = b;
+
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+int VIDSoftInit(void)
+{
    if (TitanInit() == -1)
       return -1;
 
    if ((dispbuffer = (pixel_t *)calloc(sizeof(pixel_t), 704 * 512)) == NULL)
       return -1;
 
+   if ((vidsoft_cell_cache = (vidsoft_cell *)calloc(sizeof(vidsoft_cell), VIDSOFT_CELL_CACHES * VIDSOFT_CELL_CACHE_SIZE)) == NULL)
+      return -1;
+
    // Initialize VDP1 framebuffer 1
    if ((vdp1framebuffer[0] = (u8 *)calloc(sizeof(u8), 0x40000)) == NULL)
       return -1;
@@ -2188,22 +2716,16 @@ int VIDSoftInit(void)
    VIDSoftSetupGL();
 #endif
 
-   for (i = 0; i < 6; i++)
-   {
-      vidsoft_thread_context.draw_finished[i] = 1;
-      vidsoft_thread_context.need_draw[i] = 0;
-   }
+   Vdp2InitMosaicTable();
 
    vidsoft_vdp1_thread_context.need_draw = 0;
    vidsoft_vdp1_thread_context.draw_finished = 1;
+   memset(Vdp1RamSnapshotPages, 1, sizeof(Vdp1RamSnapshotPages));
    YabThreadStart(YAB_THREAD_VIDSOFT_VDP1, VidsoftVdp1Thread, 0);
 
-   YabThreadStart(YAB_THREAD_VIDSOFT_LAYER_RBG0, VidsoftRbg0Thread, 0);
-   YabThreadStart(YAB_THREAD_VIDSOFT_LAYER_NBG0, VidsoftNbg0Thread, 0);
-   YabThreadStart(YAB_THREAD_VIDSOFT_LAYER_NBG1, VidsoftNbg1Thread, 0);
-   YabThreadStart(YAB_THREAD_VIDSOFT_LAYER_NBG2, VidsoftNbg2Thread, 0);
-   YabThreadStart(YAB_THREAD_VIDSOFT_LAYER_NBG3, VidsoftNbg3Thread, 0);
-   YabThreadStart(YAB_THREAD_VIDSOFT_LAYER_SPRITE, VidsoftSpriteThread, 0);
+   // without semaphores everything is drawn on the main thread
+   VidsoftPoolInit();
+   VidsoftVdp1PoolInit();
 
    return 0;
 }
@@ -2319,12 +2841,22 @@ void VIDSoftSetupGL(void)
 
 void VIDSoftDeInit(void)
 {
+   VidsoftPoolWait();
+   VidsoftPoolDeInit();
+   VidsoftVdp1PoolDeInit();
+
    if (dispbuffer)
    {
       free(dispbuffer);
       dispbuffer = NULL;
    }
 
+   if (vidsoft_cell_cache)
+   {
+      free(vidsoft_cell_cache);
+      vidsoft_cell_cache = NULL;
+   }
+
    if (vdp1framebuffer[0])
       free(vdp1framebuffer[0]);
 
@@ -2414,6 +2946,25 @@ void VIDSoftVdp1DrawStartBody(Vdp1* regs, u8 * back_framebuffer)
 }
 //////////////////////////////////////////////////////////////////////////////
 
+// Brings the thread's copy of VDP1 RAM up to date, only the pages written
+// since the previous frame are copied
+static void VidsoftVdp1SnapshotRam(u8 * ram)
+{
+   u32 page;
+
+   for (page = 0; page < 0x80; page++)
+   {
+      if (Vdp1RamSnapshotPages[page])
+      {
+         u32 offset = page << RAM_DIRTY_PAGE_SHIFT;
+         Vdp1RamSnapshotPages[page] = 0;
+         memcpy(ram + offset, Vdp1Ram + offset, 1 << RAM_DIRTY_PAGE_SHIFT);
+      }
+   }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
 void VIDSoftVdp1DrawStart()
 {
    if (vidsoft_vdp1_thread_enabled)
@@ -2421,9 +2972,9 @@ void VIDSoftVdp1DrawStart()
       VidsoftWaitForVdp1Thread();
 
       //take a snapshot of the vdp1 state, to be used by the thread
-      memcpy(vidsoft_vdp1_thread_context.ram, Vdp1Ram, 0x80000);
+      VidsoftVdp1SnapshotRam(vidsoft_vdp1_thread_context.ram);
       memcpy(&vidsoft_vdp1_thread_context.regs, Vdp1Regs, sizeof(Vdp1));
-      memcpy(vidsoft_vdp1_thread_context.back_framebuffer, vdp1backframebuffer, 0x40000);
+      vidsoft_vdp1_thread_context.back_framebuffer = vdp1backframebuffer;
 
       VIDSoftVdp1DrawStartBody(&vidsoft_vdp1_thread_context.regs, vidsoft_vdp1_thread_context.back_framebuffer);
 
@@ -2437,7 +2988,9 @@ void VIDSoftVdp1DrawStart()
    else
    {
       VIDSoftVdp1DrawStartBody(Vdp1Regs, vdp1backframebuffer);
-      Vdp1DrawCommands(Vdp1Ram, Vdp1Regs, vdp1backframebuffer);
+      PROFILE_START(VDP1DRAW);
+      VidsoftVdp1DrawCommands(Vdp1Ram, Vdp1Regs, vdp1backframebuffer);
+      PROFILE_STOP(VDP1DRAW);
    }
 }
 
@@ -2498,16 +3051,27 @@ typedef struct _COLOR_PARAMS
 	double r,g,b;
 } COLOR_PARAMS;
 
-COLOR_PARAMS leftColumnColor;
-
-
-
-int currentPixel;
-int currentPixelIsVisible;
-int characterWidth;
-int characterHeight;
-
-static int getpixel(int linenumber, int currentlineindex, vdp1cmd_struct *cmd, u8 * ram) {
+// The state of one VDP1 command while it is rasterized, each call has its
+// own so that several tiles of the framebuffer can be drawn at once
+typedef struct
+{
+   Vdp1 * regs;
+   u8 * ram;
+   u8 * back_framebuffer;
+   // the dots that may be written, as offsets into back_framebuffer
+   u32 tile_start;
+   u32 tile_end;
+   // skip what can't touch the tile, off when color mode 7 is in the list
+   int cull;
+   int characterWidth;
+   int characterHeight;
+   // the prohibited color mode 7 keeps the last dot that was read
+   int currentPixel;
+   int currentPixelIsVisible;
+   COLOR_PARAMS leftColumnColor;
+} vdp1raster_struct;
+
+static int getpixel(vdp1raster_struct * r, int linenumber, int currentlineindex, vdp1cmd_struct *cmd) {
 
 	u32 characterAddress;
 	u32 colorlut;
@@ -2536,17 +3100,17 @@ static int getpixel(int linenumber, int currentlineindex, vdp1cmd_struct *cmd, u
 	switch( flip ) {
 		case 1:
 			// Horizontal flipping
-			currentlineindex = characterWidth - currentlineindex-1;
+			currentlineindex = r->characterWidth - currentlineindex-1;
 			break;
 		case 2:
 			// Vertical flipping
-			linenumber = characterHeight - linenumber-1;
+			linenumber = r->characterHeight - linenumber-1;
 
 			break;
 		case 3:
 			// Horizontal/Vertical flipping
-			linenumber = characterHeight - linenumber-1;
-			currentlineindex = characterWidth - currentlineindex-1;
+			linenumber = r->characterHeight - linenumber-1;
+			currentlineindex = r->characterWidth - currentlineindex-1;
 			break;
 	}
 
@@ -2554,22 +3118,22 @@ static int getpixel(int linenumber, int currentlineindex, vdp1cmd_struct *cmd, u
 	{
 		case 0x0: //4bpp bank
 			endcode = 0xf;
-			currentPixel = Vdp1ReadPattern16( characterAddress + (linenumber*(characterWidth>>1)), currentlineindex , ram);
-			if(isTextured && endcodesEnabled && currentPixel == endcode)
+			r->currentPixel = Vdp1ReadPattern16( characterAddress + (linenumber*(r->characterWidth>>1)), currentlineindex , r->ram);
+			if(isTextured && endcodesEnabled && r->currentPixel == endcode)
 				return 1;
-			if (!((currentPixel == 0) && !SPD)) 
-				currentPixel = (colorbank &0xfff0)| currentPixel;
-			currentPixelIsVisible = 0xf;
+			if (!((r->currentPixel == 0) && !SPD)) 
+				r->currentPixel = (colorbank &0xfff0)| r->currentPixel;
+			r->currentPixelIsVisible = 0xf;
 			break;
 
 		case 0x1://4bpp lut
 			endcode = 0xf;
-         currentPixel = Vdp1ReadPattern16(characterAddress + (linenumber*(characterWidth >> 1)), currentlineindex, ram);
-			if(isTextured && endcodesEnabled && currentPixel == endcode)
+         r->currentPixel = Vdp1ReadPattern16(characterAddress + (linenumber*(r->characterWidth >> 1)), currentlineindex, r->ram);
+			if(isTextured && endcodesEnabled && r->currentPixel == endcode)
 				return 1;
-			if (!(currentPixel == 0 && !SPD))
-				currentPixel = T1ReadWord(ram, (currentPixel * 2 + colorlut) & 0x7FFFF);
-			currentPixelIsVisible = 0xffff;
+			if (!(r->currentPixel == 0 && !SPD))
+				r->currentPixel = T1ReadWord(r->ram, (r->currentPixel * 2 + colorlut) & 0x7FFFF);
+			r->currentPixelIsVisible = 0xffff;
 			break;
 		case 0x2://8pp bank (64 color)
 			//is there a hardware bug with endcodes in this color mode?
@@ -2580,51 +3144,51 @@ static int getpixel(int linenumber, int currentlineindex, vdp1cmd_struct *cmd, u
 			//this needs more hardware testing
 
 			endcode = 63;
-         currentPixel = Vdp1ReadPattern64(characterAddress + (linenumber*(characterWidth)), currentlineindex, ram);
-			if(isTextured && endcodesEnabled && currentPixel == endcode)
-				currentPixel = 0;
+         r->currentPixel = Vdp1ReadPattern64(characterAddress + (linenumber*(r->characterWidth)), currentlineindex, r->ram);
+			if(isTextured && endcodesEnabled && r->currentPixel == endcode)
+				r->currentPixel = 0;
 		//		return 1;
-			if (!((currentPixel == 0) && !SPD)) 
-				currentPixel = (colorbank&0xffc0) | currentPixel;
-			currentPixelIsVisible = 0x3f;
+			if (!((r->currentPixel == 0) && !SPD)) 
+				r->currentPixel = (colorbank&0xffc0) | r->currentPixel;
+			r->currentPixelIsVisible = 0x3f;
 			break;
 		case 0x3://128 color
 			endcode = 0xff;
-         currentPixel = Vdp1ReadPattern128(characterAddress + (linenumber*characterWidth), currentlineindex, ram);
-			if(isTextured && endcodesEnabled && currentPixel == endcode)
+         r->currentPixel = Vdp1ReadPattern128(characterAddress + (linenumber*r->characterWidth), currentlineindex, r->ram);
+			if(isTextured && endcodesEnabled && r->currentPixel == endcode)
 				return 1;
-			if (!((currentPixel == 0) && !SPD)) 
-				currentPixel = (colorbank&0xff80) | currentPixel;//dead or alive needs colorbank to be masked
-			currentPixelIsVisible = 0x7f;
+			if (!((r->currentPixel == 0) && !SPD)) 
+				r->currentPixel = (colorbank&0xff80) | r->currentPixel;//dead or alive needs colorbank to be masked
+			r->currentPixelIsVisible = 0x7f;
 			break;
 		case 0x4://256 color
 			endcode = 0xff;
-         currentPixel = Vdp1ReadPattern256(characterAddress + (linenumber*characterWidth), currentlineindex, ram);
-			if(isTextured && endcodesEnabled && currentPixel == endcode)
+         r->currentPixel = Vdp1ReadPattern256(characterAddress + (linenumber*r->characterWidth), currentlineindex, r->ram);
+			if(isTextured && endcodesEnabled && r->currentPixel == endcode)
 				return 1;
-			currentPixelIsVisible = 0xff;
-			if (!((currentPixel == 0) && !SPD)) 
-				currentPixel = (colorbank&0xff00) | currentPixel;
+			r->currentPixelIsVisible = 0xff;
+			if (!((r->currentPixel == 0) && !SPD)) 
+				r->currentPixel = (colorbank&0xff00) | r->currentPixel;
 			break;
 		case 0x5://16bpp bank
 		case 0x6://prohibited, used by (at least) Beach de Reach and seems to behave like 0x5
 			endcode = 0x7fff;
-         currentPixel = Vdp1ReadPattern64k(characterAddress + (linenumber*characterWidth * 2), currentlineindex, ram);
-			if(isTextured && endcodesEnabled && currentPixel == endcode)
+         r->currentPixel = Vdp1ReadPattern64k(characterAddress + (linenumber*r->characterWidth * 2), currentlineindex, r->ram);
+			if(isTextured && endcodesEnabled && r->currentPixel == endcode)
 				return 1;
 
 			/* the transparent pixel in 16bpp is supposed to be 0x0000
 			but some games use pixels with invalid values and expect
 			them to be transparent (see vdp1 doc p. 92) */
-			if (!(currentPixel & 0x8000) && !SPD)
-				currentPixel = 0;
+			if (!(r->currentPixel & 0x8000) && !SPD)
+				r->currentPixel = 0;
 
-			currentPixelIsVisible = 0xffff;
+			r->currentPixelIsVisible = 0xffff;
 			break;
 	}
 
 	if(!isTextured)
-		currentPixel = untexturedColor;
+		r->currentPixel = untexturedColor;
 
 	//force the MSB to be on if MSBON is set
 	//currentPixel |= cmd.CMDPMOD & (1 << 15);
@@ -2697,91 +3261,103 @@ int IsClipped(int x, int y, Vdp1* regs, vdp1cmd_struct * cmd)
    }
 }
 
-static void putpixel8(int x, int y, Vdp1 * regs, vdp1cmd_struct *cmd, u8 * back_framebuffer) {
+// Another thread draws the dots outside the tile
+static INLINE int IsOutsideTile(vdp1raster_struct * r, u32 offset)
+{
+   return offset < r->tile_start || offset >= r->tile_end;
+}
+
+static void putpixel8(vdp1raster_struct * r, int x, int y, vdp1cmd_struct *cmd) {
 
     int y2 = y / vdp1interlace;
-    u8 * iPix = &back_framebuffer[(y2 * vdp1width) + x];
+    u8 * iPix = &r->back_framebuffer[(y2 * vdp1width) + x];
     int mesh = cmd->CMDPMOD & 0x0100;
     int SPD = ((cmd->CMDPMOD & 0x40) != 0);//show the actual color of transparent pixels if 1 (they won't be drawn transparent)
 
-    if (iPix >= (back_framebuffer + 0x40000))
+    if (iPix >= (r->back_framebuffer + 0x40000))
         return;
 
-    if (CheckDil(y, regs))
+    if (CheckDil(y, r->regs))
        return;
 
-    currentPixel &= 0xFF;
+    r->currentPixel &= 0xFF;
 
     if (mesh && ((x ^ y2) & 1)) {
        return;
     }
 
-    if (IsClipped(x, y, regs, cmd))
+    if (IsClipped(x, y, r->regs, cmd))
        return;
 
-    if ( SPD || (currentPixel & currentPixelIsVisible))
+    if (IsOutsideTile(r, (u32)(iPix - r->back_framebuffer)))
+       return;
+
+    if ( SPD || (r->currentPixel & r->currentPixelIsVisible))
     {
         switch( cmd->CMDPMOD & 0x7 )//we want bits 0,1,2
         {
         default:
         case 0:	// replace
-            if (!((currentPixel == 0) && !SPD))
-                *(iPix) = currentPixel;
+            if (!((r->currentPixel == 0) && !SPD))
+                *(iPix) = r->currentPixel;
             break;
         }
     }
 }
 
-static void putpixel(int x, int y, Vdp1* regs, vdp1cmd_struct * cmd, u8 * back_framebuffer) {
+static void putpixel(vdp1raster_struct * r, int x, int y, vdp1cmd_struct * cmd) {
 
 	u16* iPix;
 	int mesh = cmd->CMDPMOD & 0x0100;
 	int SPD = ((cmd->CMDPMOD & 0x40) != 0);//show the actual color of transparent pixels if 1 (they won't be drawn transparent)
    int original_y = y;
 
-   if (CheckDil(y, regs))
+   if (CheckDil(y, r->regs))
       return;
 
 	y /= vdp1interlace;
-   iPix = &((u16 *)back_framebuffer)[(y * vdp1width) + x];
+   iPix = &((u16 *)r->back_framebuffer)[(y * vdp1width) + x];
 
-   if (iPix >= (u16*)(back_framebuffer + 0x40000))
+   if (iPix >= (u16*)(r->back_framebuffer + 0x40000))
 		return;
 
 	if(mesh && (x^y)&1)
 		return;
 
-   if (IsClipped(x, original_y, regs, cmd))
+   if (IsClipped(x, original_y, r->regs, cmd))
+      return;
+
+   if (IsOutsideTile(r, (u32)(iPix - (u16 *)r->back_framebuffer)))
       return;
 
 	if (cmd->CMDPMOD & (1 << 15))
 	{
-		if (currentPixel) {
+		if (r->currentPixel) {
 			*iPix |= 0x8000;
 			return;
 		}
 	}
 
-	if ( SPD || (currentPixel & currentPixelIsVisible))
+	if ( SPD || (r->currentPixel & r->currentPixelIsVisible))
 	{
 		switch( cmd->CMDPMOD & 0x7 )//we want bits 0,1,2
 		{
 		case 0:	// replace
-			if (!((currentPixel == 0) && !SPD)) 
-				*(iPix) = currentPixel;
+			if (!((r->currentPixel == 0) && !SPD)) 
+				*(iPix) = r->currentPixel;
 			break;
 		case 1: // shadow
 			if (*(iPix) & (1 << 15)) // only if MSB of framebuffer data is set
 				*(iPix) = alphablend16(*(iPix), 0, (1 << 7)) | (1 << 15);
 			break;
 		case 2: // half luminance
-			*(iPix) = ((currentPixel & ~0x8421) >> 1) | (1 << 15);
+			*(iPix) = ((r->currentPixel & ~0x8421) >> 1) | (1 << 15);
 			break;
 		case 3: // half transparent
 			if ( *(iPix) & (1 << 15) )//only if MSB of framebuffer data is set 
-				*(iPix) = alphablend16( *(iPix), currentPixel, (1 << 7) ) | (1 << 15);
+				*(iPix) = alphablend16( *(iPix), r->currentPixel, (1 << 7) ) | (1 << 15);
 			else
-				*(iPix) = currentPixel;
+				*(iPix) = r->currentPixel;
 			break;
 		case 4: //gouraud
 			#define COLOR(r,g,b)    (((r)&0x1F)|(((g)&0x1F)<<5)|(((b)&0x1F)<<10) |0x8000 )
@@ -2791,31 +3367,31 @@ static void putpixel(int x, int y, Vdp1* regs, vdp1cmd_struct * cmd, u8 * back_f
 			if(
 				(((cmd->CMDPMOD >> 3) & 0x7) != 5) &&
 				(((cmd->CMDPMOD >> 3) & 0x7) != 1) && 
-				(int)leftColumnColor.g == 16 && 
-				(int)leftColumnColor.b == 16) 
+				(int)r->leftColumnColor.g == 16 && 
+				(int)r->leftColumnColor.b == 16) 
 			{
-				int c = (int)(leftColumnColor.r-0x10);
+				int c = (int)(r->leftColumnColor.r-0x10);
 				if(c < 0) c = 0;
-				currentPixel = currentPixel+c;
-				*(iPix) = currentPixel;
+				r->currentPixel = r->currentPixel+c;
+				*(iPix) = r->currentPixel;
 				break;
 			}
 			*(iPix) = COLOR(
 				gouraudAdjust(
-				currentPixel&0x001F,
-				(int)leftColumnColor.r),
+				r->currentPixel&0x001F,
+				(int)r->leftColumnColor.r),
 
 				gouraudAdjust(
-				(currentPixel&0x03e0) >> 5,
-				(int)leftColumnColor.g),
+				(r->currentPixel&0x03e0) >> 5,
+				(int)r->leftColumnColor.g),
 
 				gouraudAdjust(
-				(currentPixel&0x7c00) >> 10,
-				(int)leftColumnColor.b)
+				(r->currentPixel&0x7c00) >> 10,
+				(int)r->leftColumnColor.b)
 				);
 			break;
 		default:
-			*(iPix) = alphablend16( COLOR((int)leftColumnColor.r,(int)leftColumnColor.g, (int)leftColumnColor.b), currentPixel, (1 << 7) ) | (1 << 15);
+			*(iPix) = alphablend16( COLOR((int)r->leftColumnColor.r,(int)r->leftColumnColor.g, (int)r->leftColumnColor.b), r->currentPixel, (1 << 7) ) | (1 << 15);
 			break;
 		}
 	}
@@ -2911,27 +3487,29 @@ typedef struct {
 	double xbluestep;
 	int endcodesdetected;
 	int previousStep;
+	vdp1raster_struct *raster;
 } DrawLineData;
 
 static int DrawLineCallback(int x, int y, int i, void *data, Vdp1* regs, vdp1cmd_struct * cmd, u8* ram, u8* back_framebuffer)
 {
 	int currentStep;
 	DrawLineData *linedata = data;
+	vdp1raster_struct *r = linedata->raster;
 
-	leftColumnColor.r += linedata->xredstep;
-	leftColumnColor.g += linedata->xgreenstep;
-	leftColumnColor.b += linedata->xbluestep;
+	r->leftColumnColor.r += linedata->xredstep;
+	r->leftColumnColor.g += linedata->xgreenstep;
+	r->leftColumnColor.b += linedata->xbluestep;
 
 	currentStep = (int)i * linedata->texturestep;
-	if (getpixel(linedata->linenumber, currentStep, cmd, ram)) {
+	if (getpixel(r, linedata->linenumber, currentStep, cmd)) {
 		if (currentStep != linedata->previousStep) {
 			linedata->previousStep = currentStep;
 			linedata->endcodesdetected ++;
 		}
 	} else if (vdp1pixelsize == 2) {
-		putpixel(x, y, regs, cmd, back_framebuffer);
+		putpixel(r, x, y, cmd);
 	} else {
-      putpixel8(x, y, regs, cmd, back_framebuffer);
+      putpixel8(r, x, y, cmd);
     }
 
 	if (linedata->endcodesdetected == 2) return -1;
@@ -2939,7 +3517,7 @@ static int DrawLineCallback(int x, int y, int i, void *data, Vdp1* regs, vdp1cmd
 	return 0;
 }
 
-static int DrawLine(int x1, int y1, int x2, int y2, int greedy, double linenumber, double texturestep, double xredstep, double xgreenstep, double xbluestep, Vdp1* regs, vdp1cmd_struct *cmd, u8 * ram, u8* back_framebuffer)
+static int DrawLine(vdp1raster_struct *r, int x1, int y1, int x2, int y2, int greedy, double linenumber, double texturestep, double xredstep, double xgreenstep, double xbluestep, vdp1cmd_struct *cmd)
 {
 	DrawLineData data;
 
@@ -2950,8 +3528,9 @@ static int DrawLine(int x1, int y1, int x2, int y2, int greedy, double linenumbe
 	data.xbluestep = xbluestep;
 	data.endcodesdetected = 0;
 	data.previousStep = 123456789;
+	data.raster = r;
 
-   return iterateOverLine(x1, y1, x2, y2, greedy, &data, DrawLineCallback, regs, cmd, ram, back_framebuffer);
+   return iterateOverLine(x1, y1, x2, y2, greedy, &data, DrawLineCallback, r->regs, cmd, r->ram, r->back_framebuffer);
 }
 
 static INLINE double interpolate(double start, double end, int numberofsteps) {
@@ -2983,12 +3562,8 @@ typedef union _COLOR { // xbgr x555
 	u16 value;
 } COLOR;
 
-COLOR gouraudA;
-COLOR gouraudB;
-COLOR gouraudC;
-COLOR gouraudD;
-
-static void gouraudTable(u8* ram, Vdp1* regs, vdp1cmd_struct * cmd)
+// Reads the A, B, C and D colors
+static void gouraudTable(u8* ram, vdp1cmd_struct * cmd, COLOR * table)
 {
 	int gouraudTableAddress;
 
@@ -2996,17 +3571,12 @@ static void gouraudTable(u8* ram, Vdp1* regs, vdp1cmd_struct * cmd)
 
 	gouraudTableAddress = (((unsigned int)cmd->CMDGRDA) << 3);
 
-   gouraudA.value = T1ReadWord(ram, gouraudTableAddress);
-   gouraudB.value = T1ReadWord(ram, gouraudTableAddress + 2);
-   gouraudC.value = T1ReadWord(ram, gouraudTableAddress + 4);
-   gouraudD.value = T1ReadWord(ram, gouraudTableAddress + 6);
+   table[0].value = T1ReadWord(ram, gouraudTableAddress);
+   table[1].value = T1ReadWord(ram, gouraudTableAddress + 2);
+   table[2].value = T1ReadWord(ram, gouraudTableAddress + 4);
+   table[3].value = T1ReadWord(ram, gouraudTableAddress + 6);
 }
 
-int xleft[1000];
-int yleft[1000];
-int xright[1000];
-int yright[1000];
-
 static int
 storeLineCoords(int x, int y, int i, void *arrays, Vdp1* regs, vdp1cmd_struct * cmd, u8* ram, u8* back_framebuffer) {
 	int **intArrays = arrays;
@@ -3020,48 +3590,720 @@ storeLineCoords(int x, int y, int i, void *arrays, Vdp1* regs, vdp1cmd_struct *
 //skip objects that are completely outside of system clipping
 int is_pre_clipped(s16 tl_x, s16 tl_y, s16 bl_x, s16 bl_y, s16 tr_x, s16 tr_y, s16 br_x, s16 br_y, Vdp1* regs)
 {
-   int y_val = regs->systemclipY2;
+   int y_val = regs->systemclipY2;
+
+   if (vdp1interlace)
+      y_val *= 2;
+
+   //if all x values are to the left of the screen
+   if ((tl_x < 0) &&
+      (bl_x < 0) &&
+      (tr_x < 0) &&
+      (br_x < 0))
+      return 1;
+
+   //to the right
+   if ((tl_x > regs->systemclipX2) &&
+      (bl_x > regs->systemclipX2) &&
+      (tr_x > regs->systemclipX2) &&
+      (br_x > regs->systemclipX2))
+      return 1;
+
+   //above
+   if ((tl_y < 0) &&
+      (bl_y < 0) &&
+      (tr_y < 0) &&
+      (br_y < 0))
+      return 1;
+
+   //below
+   if ((tl_y > y_val) &&
+      (bl_y > y_val) &&
+      (tr_y > y_val) &&
+      (br_y > y_val))
+      return 1;
+
+   return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// Specialized VDP1 spans
+//
+// The quads and lines used to be drawn through iterateOverLine with a
+// callback per dot, stepping the texture in double and decoding CMDPMOD in
+// getpixel and putpixel every time. The spans walk the same greedy lines but
+// step the texture with integers, and every combination of color mode,
+// color calculation, mesh and end codes gets its own inner loop.
+//////////////////////////////////////////////////////////////////////////////
+
+#if defined(_MSC_VER)
+#define VDP1_FORCE_INLINE __forceinline
+#elif defined(__GNUC__)
+#define VDP1_FORCE_INLINE INLINE __attribute__((always_inline))
+#else
+#define VDP1_FORCE_INLINE INLINE
+#endif
+
+#define VDP1_CALC_REPLACE 0
+#define VDP1_CALC_SHADOW 1
+#define VDP1_CALC_HALF_LUMINANCE 2
+#define VDP1_CALC_HALF_TRANSPARENT 3
+#define VDP1_CALC_GOURAUD 4
+#define VDP1_CALC_GOURAUD_HALF_TRANSPARENT 5
+#define VDP1_CALC_8BPP 6
+
+typedef struct
+{
+   Vdp1 * regs;
+   u8 * ram;
+   u8 * back_framebuffer;
+   u32 tile_start;
+   u32 tile_end;
+   u32 character_address;
+   u32 colorlut;
+   u16 colorbank;
+   int character_width;
+   int character_height;
+   int flip;
+   int spd;
+   int textured;
+   int untextured_color;
+   int msbon;
+   int user_clip;
+   int outside_clip;
+   int gouraud_index;
+   double redstep;
+   double greenstep;
+   double bluestep;
+} vdp1span_struct;
+
+// Steps (int)(i * ((double)num / den)) for i = 0, 1, 2... with integers. The
+// two only disagree when the product is a whole number, which is the one
+// case that still multiplies in double.
+typedef struct
+{
+   int value;
+   int frac;
+   int int_step;
+   int frac_step;
+   int den;
+   int i;
+   double step;
+} vdp1step_struct;
+
+typedef struct
+{
+   vdp1step_struct texture;
+   int linenumber;
+   int endcodes_detected;
+   int previous_step;
+   int pixel;
+   int visible;
+   double color[3];
+} vdp1dot_struct;
+
+typedef void (*vdp1spanfunc)(vdp1span_struct * s, vdp1dot_struct * t, const s16 * xs, const s16 * ys, int count);
+
+static INLINE void Vdp1StepInit(vdp1step_struct * s, int num, int den)
+{
+   s->value = s->frac = s->i = 0;
+   s->int_step = num / den;
+   s->frac_step = num % den;
+   s->den = den;
+   s->step = (double)num / den;
+}
+
+static INLINE int Vdp1StepGet(vdp1step_struct * s)
+{
+   if (s->frac == 0 && s->frac_step != 0)
+      return (int)(s->i * s->step);
+
+   return s->value;
+}
+
+static INLINE void Vdp1StepNext(vdp1step_struct * s)
+{
+   s->i++;
+   s->value += s->int_step;
+   s->frac += s->frac_step;
+   if (s->frac >= s->den)
+   {
+      s->frac -= s->den;
+      s->value++;
+   }
+}
+
+// Same count as iterateOverLine without a callback
+static INLINE int Vdp1LineLength(int x1, int y1, int x2, int y2, int greedy)
+{
+   int dx = abs(x2 - x1);
+   int dy = abs(y2 - y1);
+
+   if (dx > 999 || dy > 999)
+      return INT_MAX;
+
+   if (dx > dy)
+      return dx + (greedy ? dy : 0) + 1;
+
+   return dy + (greedy ? dx : 0) + 1;
+}
+
+static INLINE int Vdp1SpanClipped(vdp1span_struct * s, int x, int y)
+{
+   if (s->user_clip)
+   {
+      int is_user_clipped = IsUserClipped(x, y, s->regs);
+
+      if (s->outside_clip)
+         is_user_clipped = !is_user_clipped;
+
+      return is_user_clipped || IsSystemClipped(x, y, s->regs);
+   }
+
+   return IsSystemClipped(x, y, s->regs);
+}
+
+// getpixel for one color mode, returns 1 on an end code
+static VDP1_FORCE_INLINE int Vdp1SpanFetch(vdp1span_struct * s, int linenumber, int index, vdp1dot_struct * t, const int colormode, const int endcodes)
+{
+   int pixel;
+
+   if (!s->textured)
+   {
+      static const int visible[6] = { 0xf, 0xffff, 0x3f, 0x7f, 0xff, 0xffff };
+
+      t->pixel = s->untextured_color;
+      t->visible = visible[colormode];
+      return 0;
+   }
+
+   if (s->flip & 1)
+      index = s->character_width - index - 1;
+   if (s->flip & 2)
+      linenumber = s->character_height - linenumber - 1;
+
+   switch (colormode)
+   {
+      case 0: // 4bpp bank
+         pixel = Vdp1ReadPattern16(s->character_address + (linenumber * (s->character_width >> 1)), index, s->ram);
+         if (endcodes && pixel == 0xf)
+         {
+            t->pixel = pixel;
+            return 1;
+         }
+         if (!((pixel == 0) && !s->spd))
+            pixel = (s->colorbank & 0xfff0) | pixel;
+         t->visible = 0xf;
+         break;
+      case 1: // 4bpp lut
+         pixel = Vdp1ReadPattern16(s->character_address + (linenumber * (s->character_width >> 1)), index, s->ram);
+         if (endcodes && pixel == 0xf)
+         {
+            t->pixel = pixel;
+            return 1;
+         }
+         if (!(pixel == 0 && !s->spd))
+            pixel = T1ReadWord(s->ram, (pixel * 2 + s->colorlut) & 0x7FFFF);
+         t->visible = 0xffff;
+         break;
+      case 2: // 8bpp bank (64 color), see getpixel about the end code
+         pixel = Vdp1ReadPattern64(s->character_address + (linenumber * s->character_width), index, s->ram);
+         if (endcodes && pixel == 63)
+            pixel = 0;
+         if (!((pixel == 0) && !s->spd))
+            pixel = (s->colorbank & 0xffc0) | pixel;
+         t->visible = 0x3f;
+         break;
+      case 3: // 128 color, the pattern can never match its end code
+         pixel = Vdp1ReadPattern128(s->character_address + (linenumber * s->character_width), index, s->ram);
+         if (!((pixel == 0) && !s->spd))
+            pixel = (s->colorbank & 0xff80) | pixel;
+         t->visible = 0x7f;
+         break;
+      case 4: // 256 color
+         pixel = Vdp1ReadPattern256(s->character_address + (linenumber * s->character_width), index, s->ram);
+         if (endcodes && pixel == 0xff)
+         {
+            t->pixel = pixel;
+            return 1;
+         }
+         t->visible = 0xff;
+         if (!((pixel == 0) && !s->spd))
+            pixel = (s->colorbank & 0xff00) | pixel;
+         break;
+      default: // 16bpp bank
+         pixel = Vdp1ReadPattern64k(s->character_address + (linenumber * s->character_width * 2), index, s->ram);
+         if (endcodes && pixel == 0x7fff)
+         {
+            t->pixel = pixel;
+            return 1;
+         }
+         if (!(pixel & 0x8000) && !s->spd)
+            pixel = 0;
+         t->visible = 0xffff;
+         break;
+   }
+
+   t->pixel = pixel;
+   return 0;
+}
+
+// putpixel and putpixel8 for one color calculation
+static VDP1_FORCE_INLINE void Vdp1SpanPut(vdp1span_struct * s, vdp1dot_struct * t, int x, int y, const int calc, const int mesh)
+{
+   int y2;
+
+   if (calc == VDP1_CALC_8BPP)
+   {
+      u8 * iPix;
+
+      y2 = y / vdp1interlace;
+      iPix = &s->back_framebuffer[(y2 * vdp1width) + x];
+
+      if (iPix >= (s->back_framebuffer + 0x40000))
+         return;
+
+      if (CheckDil(y, s->regs))
+         return;
+
+      t->pixel &= 0xFF;
+
+      if (mesh && ((x ^ y2) & 1))
+         return;
+
+      if (Vdp1SpanClipped(s, x, y))
+         return;
+
+      if ((u32)(iPix - s->back_framebuffer) - s->tile_start >= s->tile_end - s->tile_start)
+         return;
+
+      if ((s->spd || (t->pixel & t->visible)) && !((t->pixel == 0) && !s->spd))
+         *iPix = t->pixel;
+   }
+   else
+   {
+      u16 * iPix;
+
+      if (CheckDil(y, s->regs))
+         return;
+
+      y2 = y / vdp1interlace;
+      iPix = &((u16 *)s->back_framebuffer)[(y2 * vdp1width) + x];
+
+      if (iPix >= (u16 *)(s->back_framebuffer + 0x40000))
+         return;
+
+      if (mesh && ((x ^ y2) & 1))
+         return;
+
+      if (Vdp1SpanClipped(s, x, y))
+         return;
+
+      if ((u32)(iPix - (u16 *)s->back_framebuffer) - s->tile_start >= s->tile_end - s->tile_start)
+         return;
+
+      if (s->msbon && t->pixel)
+      {
+         *iPix |= 0x8000;
+         return;
+      }
+
+      if (!s->spd && !(t->pixel & t->visible))
+         return;
+
+      switch (calc)
+      {
+         case VDP1_CALC_REPLACE:
+            if (!((t->pixel == 0) && !s->spd))
+               *iPix = t->pixel;
+            break;
+         case VDP1_CALC_SHADOW:
+            if (*iPix & (1 << 15))
+               *iPix = alphablend16(*iPix, 0, (1 << 7)) | (1 << 15);
+            break;
+         case VDP1_CALC_HALF_LUMINANCE:
+            *iPix = ((t->pixel & ~0x8421) >> 1) | (1 << 15);
+            break;
+         case VDP1_CALC_HALF_TRANSPARENT:
+            if (*iPix & (1 << 15))
+               *iPix = alphablend16(*iPix, t->pixel, (1 << 7)) | (1 << 15);
+            else
+               *iPix = t->pixel;
+            break;
+         case VDP1_CALC_GOURAUD:
+            if (s->gouraud_index && (int)t->color[1] == 16 && (int)t->color[2] == 16)
+            {
+               int c = (int)(t->color[0] - 0x10);
+               if (c < 0) c = 0;
+               t->pixel = t->pixel + c;
+               *iPix = t->pixel;
+               break;
+            }
+            *iPix = COLOR(
+               gouraudAdjust(t->pixel & 0x001F, (int)t->color[0]),
+               gouraudAdjust((t->pixel & 0x03e0) >> 5, (int)t->color[1]),
+               gouraudAdjust((t->pixel & 0x7c00) >> 10, (int)t->color[2]));
+            break;
+         default:
+            *iPix = alphablend16(COLOR((int)t->color[0], (int)t->color[1], (int)t->color[2]), t->pixel, (1 << 7)) | (1 << 15);
+            break;
+      }
+   }
+}
+
+// DrawLineCallback, returns 1 once the second end code stops the span
+static VDP1_FORCE_INLINE int Vdp1SpanDot(vdp1span_struct * s, vdp1dot_struct * t, int x, int y, const int colormode, const int calc, const int mesh, const int endcodes)
+{
+   int step;
+
+   if (calc == VDP1_CALC_GOURAUD || calc == VDP1_CALC_GOURAUD_HALF_TRANSPARENT)
+   {
+      t->color[0] += s->redstep;
+      t->color[1] += s->greenstep;
+      t->color[2] += s->bluestep;
+   }
+
+   step = Vdp1StepGet(&t->texture);
+   Vdp1StepNext(&t->texture);
+
+   if (Vdp1SpanFetch(s, t->linenumber, step, t, colormode, endcodes))
+   {
+      if (step != t->previous_step)
+      {
+         t->previous_step = step;
+         t->endcodes_detected++;
+      }
+   }
+   else
+      Vdp1SpanPut(s, t, x, y, calc, mesh);
+
+   return endcodes && t->endcodes_detected == 2;
+}
+
+// The dots iterateOverLine visits, in the same order
+static int Vdp1WalkLine(int x1, int y1, int x2, int y2, int greedy, s16 * xs, s16 * ys)
+{
+   int i = 0, a = 0, ax, ay, dx, dy;
+
+   dx = x2 - x1;
+   dy = y2 - y1;
+   ax = (dx >= 0) ? 1 : -1;
+   ay = (dy >= 0) ? 1 : -1;
+
+   if (abs(dx) > 999 || abs(dy) > 999)
+      return 0;
+
+   if (abs(dx) > abs(dy))
+   {
+      if (ax != ay) dx = -dx;
+
+      for (; x1 != x2; x1 += ax)
+      {
+         xs[i] = x1; ys[i++] = y1;
+
+         a += dy;
+         if (abs(a) >= abs(dx))
+         {
+            a -= dx;
+            y1 += ay;
+
+            if (greedy)
+            {
+               if (ax == ay)
+               {
+                  xs[i] = x1 + ax; ys[i++] = y1 - ay;
+               }
+               else
+               {
+                  xs[i] = x1; ys[i++] = y1;
+               }
+            }
+         }
+      }
+   }
+   else
+   {
+      if (ax != ay) dy = -dy;
+
+      for (; y1 != y2; y1 += ay)
+      {
+         xs[i] = x1; ys[i++] = y1;
+
+         a += dx;
+         if (abs(a) >= abs(dy))
+         {
+            a -= dy;
+            x1 += ax;
+
+            if (greedy)
+            {
+               if (ay == ax)
+               {
+                  xs[i] = x1; ys[i++] = y1;
+               }
+               else
+               {
+                  xs[i] = x1 - ax; ys[i++] = y1 + ay;
+               }
+            }
+         }
+      }
+   }
+
+   xs[i] = x2; ys[i++] = y2;
+
+   return i;
+}
+
+static VDP1_FORCE_INLINE void Vdp1DrawSpanGeneric(vdp1span_struct * s, vdp1dot_struct * t, const s16 * xs, const s16 * ys, int count, const int colormode, const int calc, const int mesh, const int endcodes)
+{
+   int i;
+
+   for (i = 0; i < count; i++)
+   {
+      if (Vdp1SpanDot(s, t, xs[i], ys[i], colormode, calc, mesh, endcodes))
+         return;
+   }
+}
+
+#define VDP1_SPAN_FUNC(cm, calc, mesh, end) \
+static void Vdp1DrawSpan_##cm##_##calc##_##mesh##_##end(vdp1span_struct * s, vdp1dot_struct * t, const s16 * xs, const s16 * ys, int count) \
+{ \
+   Vdp1DrawSpanGeneric(s, t, xs, ys, count, cm, calc, mesh, end); \
+}
+
+#define VDP1_SPAN_FUNCS(cm, calc) \
+   VDP1_SPAN_FUNC(cm, calc, 0, 0) VDP1_SPAN_FUNC(cm, calc, 0, 1) \
+   VDP1_SPAN_FUNC(cm, calc, 1, 0) VDP1_SPAN_FUNC(cm, calc, 1, 1)
+
+#define VDP1_SPAN_FUNCS_ALL_CALC(cm) \
+   VDP1_SPAN_FUNCS(cm, 0) VDP1_SPAN_FUNCS(cm, 1) VDP1_SPAN_FUNCS(cm, 2) VDP1_SPAN_FUNCS(cm, 3) \
+   VDP1_SPAN_FUNCS(cm, 4) VDP1_SPAN_FUNCS(cm, 5) VDP1_SPAN_FUNCS(cm, 6)
+
+VDP1_SPAN_FUNCS_ALL_CALC(0)
+VDP1_SPAN_FUNCS_ALL_CALC(1)
+VDP1_SPAN_FUNCS_ALL_CALC(2)
+VDP1_SPAN_FUNCS_ALL_CALC(3)
+VDP1_SPAN_FUNCS_ALL_CALC(4)
+VDP1_SPAN_FUNCS_ALL_CALC(5)
+
+#define VDP1_SPAN_ENTRY(cm, calc) \
+   { { Vdp1DrawSpan_##cm##_##calc##_0_0, Vdp1DrawSpan_##cm##_##calc##_0_1 }, \
+     { Vdp1DrawSpan_##cm##_##calc##_1_0, Vdp1DrawSpan_##cm##_##calc##_1_1 } }
+
+#define VDP1_SPAN_ENTRIES_ALL_CALC(cm) \
+   { VDP1_SPAN_ENTRY(cm, 0), VDP1_SPAN_ENTRY(cm, 1), VDP1_SPAN_ENTRY(cm, 2), VDP1_SPAN_ENTRY(cm, 3), \
+     VDP1_SPAN_ENTRY(cm, 4), VDP1_SPAN_ENTRY(cm, 5), VDP1_SPAN_ENTRY(cm, 6) }
+
+// [color mode][color calculation][mesh][end codes]
+static const vdp1spanfunc vdp1_span_funcs[6][7][2][2] = {
+   VDP1_SPAN_ENTRIES_ALL_CALC(0),
+   VDP1_SPAN_ENTRIES_ALL_CALC(1),
+   VDP1_SPAN_ENTRIES_ALL_CALC(2),
+   VDP1_SPAN_ENTRIES_ALL_CALC(3),
+   VDP1_SPAN_ENTRIES_ALL_CALC(4),
+   VDP1_SPAN_ENTRIES_ALL_CALC(5)
+};
+
+// Picks the span for a command. Returns NULL for the prohibited color mode 7,
+// getpixel leaves the previous dot in place there so it keeps the old path.
+static vdp1spanfunc Vdp1SetupSpan(vdp1span_struct * s, vdp1raster_struct * r, vdp1cmd_struct * cmd)
+{
+   int colormode = (cmd->CMDPMOD >> 3) & 0x7;
+   int shape = cmd->CMDCTRL & 0x7;
+   int calc;
+
+   if (colormode == 7)
+      return NULL;
+
+   s->regs = r->regs;
+   s->ram = r->ram;
+   s->back_framebuffer = r->back_framebuffer;
+   s->tile_start = r->tile_start;
+   s->tile_end = r->tile_end;
+   s->character_address = cmd->CMDSRCA << 3;
+   s->colorbank = cmd->CMDCOLR;
+   s->colorlut = (u32)s->colorbank << 3;
+   s->character_width = r->characterWidth;
+   s->character_height = r->characterHeight;
+   s->flip = (cmd->CMDCTRL & 0x30) >> 4;
+   s->spd = ((cmd->CMDPMOD & 0x40) != 0);
+   s->textured = !(shape == 4 || shape == 5 || shape == 6);
+   s->untextured_color = cmd->CMDCOLR;
+   s->msbon = (cmd->CMDPMOD & (1 << 15)) != 0;
+   s->user_clip = (cmd->CMDPMOD & 0x0400) != 0;
+   s->outside_clip = ((cmd->CMDPMOD >> 9) & 0x3) == 0x3;
+   s->gouraud_index = colormode != 5 && colormode != 1;
+   s->redstep = s->greenstep = s->bluestep = 0;
+
+   if (vdp1pixelsize != 2)
+      calc = VDP1_CALC_8BPP;
+   else if ((calc = cmd->CMDPMOD & 0x7) > VDP1_CALC_GOURAUD_HALF_TRANSPARENT)
+      calc = VDP1_CALC_GOURAUD_HALF_TRANSPARENT;
+
+   if (colormode == 6)
+      colormode = 5;
+
+   return vdp1_span_funcs[colormode][calc][(cmd->CMDPMOD & 0x0100) != 0][s->textured && (cmd->CMDPMOD & 0x80) == 0];
+}
+
+// DrawLine through a span, texture_width texels are stretched over the line
+static void Vdp1DrawSpan(vdp1spanfunc func, vdp1span_struct * s, vdp1raster_struct * r, int x1, int y1, int x2, int y2, int greedy, int linenumber, int texture_width, int length)
+{
+   vdp1dot_struct t;
+   s16 xs[2000], ys[2000];
+   int count = Vdp1WalkLine(x1, y1, x2, y2, greedy, xs, ys);
+
+   Vdp1StepInit(&t.texture, texture_width, length);
+   t.linenumber = linenumber;
+   t.endcodes_detected = 0;
+   t.previous_step = 123456789;
+   t.pixel = r->currentPixel;
+   t.visible = r->currentPixelIsVisible;
+   t.color[0] = r->leftColumnColor.r;
+   t.color[1] = r->leftColumnColor.g;
+   t.color[2] = r->leftColumnColor.b;
+
+   func(s, &t, xs, ys, count);
+
+   r->currentPixel = t.pixel;
+   r->currentPixelIsVisible = t.visible;
+   r->leftColumnColor.r = t.color[0];
+   r->leftColumnColor.g = t.color[1];
+   r->leftColumnColor.b = t.color[2];
+}
+
+static void Vdp1DrawLine(vdp1raster_struct * r, int x1, int y1, int x2, int y2, double redstep, double greenstep, double bluestep, vdp1cmd_struct *cmd)
+{
+   vdp1span_struct span;
+   vdp1spanfunc func = Vdp1SetupSpan(&span, r, cmd);
+
+   if (func == NULL)
+   {
+      DrawLine(r, x1, y1, x2, y2, 0, 0, 0, redstep, greenstep, bluestep, cmd);
+      return;
+   }
+
+   span.redstep = redstep;
+   span.greenstep = greenstep;
+   span.bluestep = bluestep;
+   Vdp1DrawSpan(func, &span, r, x1, y1, x2, y2, 0, 0, 0, 1);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// VDP1 command buffer
+//
+// The command list is handled in two passes. Vdp1DrawCommands calls the draw
+// functions below, which only copy each command into vidsoft_vdp1 together
+// with the clipping, local coordinates and gouraud table it was read with.
+// Once the list has ended the back framebuffer is cut into tiles of
+// scanlines and each tile is rasterized by one thread going through the
+// commands in order, so every dot is written in the same order as when the
+// commands were drawn one after another.
+//////////////////////////////////////////////////////////////////////////////
+
+#define VIDSOFT_VDP1_MAX_PRIMS 2000
+#define VIDSOFT_VDP1_MAX_WORKERS (YAB_THREAD_VIDSOFT_VDP1_WORKER_LAST - YAB_THREAD_VIDSOFT_VDP1_WORKER_0 + 1)
+#define VIDSOFT_VDP1_TILE_LINES 32
+
+enum
+{
+   VDP1_PRIM_QUAD,
+   VDP1_PRIM_POLYLINE,
+   VDP1_PRIM_LINE
+};
+
+typedef struct
+{
+   int type;
+   vdp1cmd_struct cmd;
+   // clipping, local coordinates and DIL when the command was read
+   Vdp1 regs;
+   // quads are top left, bottom left, top right, bottom right
+   int x[4];
+   int y[4];
+   COLOR gouraud[4];
+   // lines are set up with A and B of the table read before their own
+   COLOR previous_gouraud[2];
+   // and keep the character size of the last quad
+   int character_width;
+   int character_height;
+   // the framebuffer offsets the command can write to
+   u32 first;
+   u32 last;
+} vdp1prim_struct;
+
+static struct
+{
+   vdp1prim_struct prims[VIDSOFT_VDP1_MAX_PRIMS];
+   int num_prims;
+   // color mode 7 reuses the dot of the previous command, a list using it
+   // is drawn as a single tile
+   int serial;
+   // the last gouraud table and character size read, carried over to the
+   // next list
+   COLOR gouraud[4];
+   int character_width;
+   int character_height;
+   u8 * ram;
+   u8 * back_framebuffer;
+   u32 tile_dots;
+   // next tile in the low half, tile count in the high half
+   volatile u32 range;
+   volatile long pending;
+   YabSem * wake[VIDSOFT_VDP1_MAX_WORKERS];
+   YabSem * done;
+   int num_started;
+   int num_active;
+   volatile int quit;
+} vidsoft_vdp1;
 
-   if (vdp1interlace)
-      y_val *= 2;
+//////////////////////////////////////////////////////////////////////////////
 
-   //if all x values are to the left of the screen
-   if ((tl_x < 0) &&
-      (bl_x < 0) &&
-      (tr_x < 0) &&
-      (br_x < 0))
-      return 1;
+// The framebuffer offsets a shape can write to. Every dot lies within the
+// bounding box of the vertices and only dots with x >= 0 and y >= 0 pass
+// system clipping.
+static void Vdp1Bounds(const int * x, const int * y, int count, u32 * first, u32 * last)
+{
+   int min_x = x[0], max_x = x[0];
+   int min_y = y[0], max_y = y[0];
+   int i;
 
-   //to the right
-   if ((tl_x > regs->systemclipX2) &&
-      (bl_x > regs->systemclipX2) &&
-      (tr_x > regs->systemclipX2) &&
-      (br_x > regs->systemclipX2))
-      return 1;
+   for (i = 1; i < count; i++)
+   {
+      if (x[i] < min_x) min_x = x[i];
+      if (x[i] > max_x) max_x = x[i];
+      if (y[i] < min_y) min_y = y[i];
+      if (y[i] > max_y) max_y = y[i];
+   }
 
-   //above
-   if ((tl_y < 0) &&
-      (bl_y < 0) &&
-      (tr_y < 0) &&
-      (br_y < 0))
-      return 1;
+   if (max_x < 0 || max_y < 0)
+   {
+      *first = 0xFFFFFFFF;
+      *last = 0;
+      return;
+   }
 
-   //below
-   if ((tl_y > y_val) &&
-      (bl_y > y_val) &&
-      (tr_y > y_val) &&
-      (br_y > y_val))
-      return 1;
+   if (min_x < 0) min_x = 0;
+   if (min_y < 0) min_y = 0;
 
-   return 0;
+   *first = (min_y / vdp1interlace) * vdp1width + min_x;
+   *last = (max_y / vdp1interlace) * vdp1width + max_x;
 }
 
+//////////////////////////////////////////////////////////////////////////////
+
 //a real vdp1 draws with arbitrary lines
 //this is why endcodes are possible
 //this is also the reason why half-transparent shading causes moire patterns
 //and the reason why gouraud shading can be applied to a single line draw command
-static void drawQuad(s16 tl_x, s16 tl_y, s16 bl_x, s16 bl_y, s16 tr_x, s16 tr_y, s16 br_x, s16 br_y, u8 * ram, Vdp1* regs, vdp1cmd_struct * cmd, u8* back_framebuffer){
+static void drawQuad(vdp1raster_struct * r, vdp1prim_struct * prim){
 
+	vdp1cmd_struct * cmd = &prim->cmd;
+	int xleft[1000];
+	int yleft[1000];
+	int xright[1000];
+	int yright[1000];
 	int totalleft;
 	int totalright;
 	int total;
@@ -3071,35 +4313,29 @@ static void drawQuad(s16 tl_x, s16 tl_y, s16 bl_x, s16 bl_y, s16 tr_x, s16 tr_y,
 	COLOR_PARAMS topLeftToBottomLeftColorStep = {0,0,0}, topRightToBottomRightColorStep = {0,0,0};
 		
 	//how quickly we step through the line arrays
-	double leftLineStep = 1;
-	double rightLineStep = 1; 
+	vdp1step_struct leftLineStep, rightLineStep, ytexturestep;
 
 	//a lookup table for the gouraud colors
 	COLOR colors[4];
 
-   if (is_pre_clipped(tl_x, tl_y, bl_x, bl_y, tr_x, tr_y, br_x, br_y, regs))
-      return;
+	vdp1span_struct span;
+	vdp1spanfunc span_func;
 
-	characterWidth = ((cmd->CMDSIZE >> 8) & 0x3F) * 8;
-   characterHeight = cmd->CMDSIZE & 0xFF;
+	r->characterWidth = ((cmd->CMDSIZE >> 8) & 0x3F) * 8;
+   r->characterHeight = cmd->CMDSIZE & 0xFF;
 
+	//the edges were checked against the size limit when the command was read
 	intarrays[0] = xleft; intarrays[1] = yleft;
-   totalleft = iterateOverLine(tl_x, tl_y, bl_x, bl_y, 0, intarrays, storeLineCoords, regs, cmd, ram, back_framebuffer);
+   totalleft = iterateOverLine(prim->x[0], prim->y[0], prim->x[1], prim->y[1], 0, intarrays, storeLineCoords, r->regs, cmd, r->ram, r->back_framebuffer);
 	intarrays[0] = xright; intarrays[1] = yright;
-   totalright = iterateOverLine(tr_x, tr_y, br_x, br_y, 0, intarrays, storeLineCoords, regs, cmd, ram, back_framebuffer);
-
-	//just for now since burning rangers will freeze up trying to draw huge shapes
-	if(totalleft == INT_MAX || totalright == INT_MAX)
-		return;
+   totalright = iterateOverLine(prim->x[2], prim->y[2], prim->x[3], prim->y[3], 0, intarrays, storeLineCoords, r->regs, cmd, r->ram, r->back_framebuffer);
 
 	total = totalleft > totalright ? totalleft : totalright;
 
 
    if (cmd->CMDPMOD & (1 << 2)) {
 
-		gouraudTable(ram, regs, cmd);
-
-		{ colors[0] = gouraudA; colors[1] = gouraudD; colors[2] = gouraudB; colors[3] = gouraudC; }
+		{ colors[0] = prim->gouraud[0]; colors[1] = prim->gouraud[3]; colors[2] = prim->gouraud[1]; colors[3] = prim->gouraud[2]; }
 
 		topLeftToBottomLeftColorStep.r = interpolate(colors[0].r,colors[1].r,total);
 		topLeftToBottomLeftColorStep.g = interpolate(colors[0].g,colors[1].g,total);
@@ -3112,41 +4348,53 @@ static void drawQuad(s16 tl_x, s16 tl_y, s16 bl_x, s16 bl_y, s16 tr_x, s16 tr_y,
 
 	//we have to step the equivalent of less than one pixel on the shorter side
 	//to make sure textures stretch properly and the shape is correct
+	Vdp1StepInit(&leftLineStep, 1, 1);
+	Vdp1StepInit(&rightLineStep, 1, 1);
+
 	if(total == totalleft && totalleft != totalright) {
 		//left side is larger
-		leftLineStep = 1;
-		rightLineStep = (double)totalright / totalleft;
+		Vdp1StepInit(&rightLineStep, totalright, totalleft);
 	}
 	else if(totalleft != totalright){
 		//right side is larger
-		rightLineStep = 1;
-		leftLineStep = (double)totalleft / totalright;
+		Vdp1StepInit(&leftLineStep, totalleft, totalright);
 	}
 
+	//now we need to interpolate the y texture coordinate across multiple lines
+	Vdp1StepInit(&ytexturestep, r->characterHeight, total);
+
+	span_func = Vdp1SetupSpan(&span, r, cmd);
+
 	for(i = 0; i < total; i++) {
 
 		int xlinelength;
-
-		double xtexturestep;
-		double ytexturestep;
+		int left = Vdp1StepGet(&leftLineStep);
+		int right = Vdp1StepGet(&rightLineStep);
+		int linenumber = Vdp1StepGet(&ytexturestep);
 
 		COLOR_PARAMS rightColumnColor;
 
 		COLOR_PARAMS leftToRightStep = {0,0,0};
 
-		//get the length of the line we are about to draw
-		xlinelength = iterateOverLine(
-			xleft[(int)(i*leftLineStep)],
-			yleft[(int)(i*leftLineStep)],
-			xright[(int)(i*rightLineStep)],
-			yright[(int)(i*rightLineStep)],
-         1, NULL, NULL, regs, cmd, ram, back_framebuffer);
+		Vdp1StepNext(&leftLineStep);
+		Vdp1StepNext(&rightLineStep);
+		Vdp1StepNext(&ytexturestep);
+
+		//each line starts over, the ones that miss the tile can be skipped
+		if (r->cull) {
+			int x[2], y[2];
+			u32 first, last;
 
-		//so from 0 to the width of the texture / the length of the line is how far we need to step
-		xtexturestep=interpolate(0,characterWidth,xlinelength);
+			x[0] = xleft[left]; y[0] = yleft[left];
+			x[1] = xright[right]; y[1] = yright[right];
+			Vdp1Bounds(x, y, 2, &first, &last);
+
+			if (last < r->tile_start || first >= r->tile_end)
+				continue;
+		}
 
-		//now we need to interpolate the y texture coordinate across multiple lines
-		ytexturestep=interpolate(0,characterHeight,total);
+		//get the length of the line we are about to draw
+		xlinelength = Vdp1LineLength(xleft[left], yleft[left], xright[right], yright[right], 1);
 
 		//gouraud interpolation
 		if(cmd->CMDPMOD & (1 << 2)) {
@@ -3155,38 +4403,88 @@ static void drawQuad(s16 tl_x, s16 tl_y, s16 bl_x, s16 bl_y, s16 tr_x, s16 tr_y,
 			//and add the orignal color + the number of steps taken times the step value to the bottom of the shape
 			//to get the current colors to use to interpolate across the line
 
-			leftColumnColor.r = colors[0].r +(topLeftToBottomLeftColorStep.r*i);
-			leftColumnColor.g = colors[0].g +(topLeftToBottomLeftColorStep.g*i);
-			leftColumnColor.b = colors[0].b +(topLeftToBottomLeftColorStep.b*i);
+			r->leftColumnColor.r = colors[0].r +(topLeftToBottomLeftColorStep.r*i);
+			r->leftColumnColor.g = colors[0].g +(topLeftToBottomLeftColorStep.g*i);
+			r->leftColumnColor.b = colors[0].b +(topLeftToBottomLeftColorStep.b*i);
 
 			rightColumnColor.r = colors[2].r +(topRightToBottomRightColorStep.r*i);
 			rightColumnColor.g = colors[2].g +(topRightToBottomRightColorStep.g*i);
 			rightColumnColor.b = colors[2].b +(topRightToBottomRightColorStep.b*i);
 
 			//interpolate colors across to get the right step values
-			leftToRightStep.r = interpolate(leftColumnColor.r,rightColumnColor.r,xlinelength);
-			leftToRightStep.g = interpolate(leftColumnColor.g,rightColumnColor.g,xlinelength);
-			leftToRightStep.b = interpolate(leftColumnColor.b,rightColumnColor.b,xlinelength);
+			leftToRightStep.r = interpolate(r->leftColumnColor.r,rightColumnColor.r,xlinelength);
+			leftToRightStep.g = interpolate(r->leftColumnColor.g,rightColumnColor.g,xlinelength);
+			leftToRightStep.b = interpolate(r->leftColumnColor.b,rightColumnColor.b,xlinelength);
 		}
 
-		DrawLine(
-			xleft[(int)(i*leftLineStep)],
-			yleft[(int)(i*leftLineStep)],
-			xright[(int)(i*rightLineStep)],
-			yright[(int)(i*rightLineStep)],
-			1,
-			ytexturestep*i, 
-			xtexturestep,
-			leftToRightStep.r,
-			leftToRightStep.g,
-			leftToRightStep.b,
-         regs,
-         cmd,
-         ram, back_framebuffer
-			);
+		if (span_func == NULL)
+		{
+			//so from 0 to the width of the texture / the length of the line is how far we need to step
+			DrawLine(r, xleft[left], yleft[left], xright[right], yright[right], 1,
+				linenumber, interpolate(0,r->characterWidth,xlinelength),
+				leftToRightStep.r, leftToRightStep.g, leftToRightStep.b,
+				cmd);
+		}
+		else if (xlinelength != INT_MAX)
+		{
+			span.redstep = leftToRightStep.r;
+			span.greenstep = leftToRightStep.g;
+			span.bluestep = leftToRightStep.b;
+			Vdp1DrawSpan(span_func, &span, r, xleft[left], yleft[left], xright[right], yright[right], 1,
+				linenumber, r->characterWidth, xlinelength);
+		}
 	}
 }
 
+static vdp1prim_struct * Vdp1AddPrim(int type, Vdp1 * regs, vdp1cmd_struct * cmd)
+{
+   vdp1prim_struct * prim;
+
+   if (vidsoft_vdp1.num_prims == VIDSOFT_VDP1_MAX_PRIMS)
+      return NULL;
+
+   prim = &vidsoft_vdp1.prims[vidsoft_vdp1.num_prims++];
+   prim->type = type;
+   prim->cmd = *cmd;
+   prim->regs = *regs;
+
+   if (((cmd->CMDPMOD >> 3) & 0x7) == 7)
+      vidsoft_vdp1.serial = 1;
+
+   return prim;
+}
+
+static void Vdp1AddQuad(s16 tl_x, s16 tl_y, s16 bl_x, s16 bl_y, s16 tr_x, s16 tr_y, s16 br_x, s16 br_y, u8 * ram, Vdp1 * regs, vdp1cmd_struct * cmd)
+{
+   vdp1prim_struct * prim;
+
+   if (is_pre_clipped(tl_x, tl_y, bl_x, bl_y, tr_x, tr_y, br_x, br_y, regs))
+      return;
+
+   vidsoft_vdp1.character_width = ((cmd->CMDSIZE >> 8) & 0x3F) * 8;
+   vidsoft_vdp1.character_height = cmd->CMDSIZE & 0xFF;
+
+   //just for now since burning rangers will freeze up trying to draw huge shapes
+   if (Vdp1LineLength(tl_x, tl_y, bl_x, bl_y, 0) == INT_MAX || Vdp1LineLength(tr_x, tr_y, br_x, br_y, 0) == INT_MAX)
+      return;
+
+   if ((prim = Vdp1AddPrim(VDP1_PRIM_QUAD, regs, cmd)) == NULL)
+      return;
+
+   prim->x[0] = tl_x; prim->y[0] = tl_y;
+   prim->x[1] = bl_x; prim->y[1] = bl_y;
+   prim->x[2] = tr_x; prim->y[2] = tr_y;
+   prim->x[3] = br_x; prim->y[3] = br_y;
+
+   if (cmd->CMDPMOD & (1 << 2))
+   {
+      gouraudTable(ram, cmd, prim->gouraud);
+      memcpy(vidsoft_vdp1.gouraud, prim->gouraud, sizeof(prim->gouraud));
+   }
+
+   Vdp1Bounds(prim->x, prim->y, 4, &prim->first, &prim->last);
+}
+
 void VIDSoftVdp1NormalSpriteDraw(u8 * ram, Vdp1 * regs, u8 * back_framebuffer) {
 
 	s16 topLeftx,topLefty,topRightx,topRighty,bottomRightx,bottomRighty,bottomLeftx,bottomLefty;
@@ -3207,7 +4505,7 @@ void VIDSoftVdp1NormalSpriteDraw(u8 * ram, Vdp1 * regs, u8 * back_framebuffer) {
 	bottomLeftx = topLeftx;
 	bottomLefty = topLefty + (spriteHeight - 1);
 
-   drawQuad(topLeftx, topLefty, bottomLeftx, bottomLefty, topRightx, topRighty, bottomRightx, bottomRighty, ram, regs, &cmd, back_framebuffer);
+   Vdp1AddQuad(topLeftx, topLefty, bottomLeftx, bottomLefty, topRightx, topRighty, bottomRightx, bottomRighty, ram, regs, &cmd);
 }
 
 void VIDSoftVdp1ScaledSpriteDraw(u8* ram, Vdp1*regs, u8 * back_framebuffer){
@@ -3305,7 +4603,7 @@ void VIDSoftVdp1ScaledSpriteDraw(u8* ram, Vdp1*regs, u8 * back_framebuffer){
 	bottomLeftx = topLeftx;
 	bottomLefty = y1+y0 - 1;
 
-   drawQuad(topLeftx, topLefty, bottomLeftx, bottomLefty, topRightx, topRighty, bottomRightx, bottomRighty, ram, regs, &cmd, back_framebuffer);
+   Vdp1AddQuad(topLeftx, topLefty, bottomLeftx, bottomLefty, topRightx, topRighty, bottomRightx, bottomRighty, ram, regs, &cmd);
 }
 
 void VIDSoftVdp1DistortedSpriteDraw(u8* ram, Vdp1*regs, u8 * back_framebuffer) {
@@ -3327,28 +4625,48 @@ void VIDSoftVdp1DistortedSpriteDraw(u8* ram, Vdp1*regs, u8 * back_framebuffer) {
     xd = (s32)(cmd.CMDXD + regs->localX);
     yd = (s32)(cmd.CMDYD + regs->localY);
 
-    drawQuad(xa, ya, xd, yd, xb, yb, xc, yc, ram, regs, &cmd, back_framebuffer);
+    Vdp1AddQuad(xa, ya, xd, yd, xb, yb, xc, yc, ram, regs, &cmd);
 }
 
-static void gouraudLineSetup(double * redstep, double * greenstep, double * bluestep, int length, COLOR table1, COLOR table2, u8* ram, Vdp1* regs, vdp1cmd_struct * cmd, u8 * back_framebuffer) {
-
-	gouraudTable(ram ,regs, cmd);
+static void gouraudLineSetup(vdp1raster_struct * r, double * redstep, double * greenstep, double * bluestep, int length, COLOR table1, COLOR table2) {
 
 	*redstep =interpolate(table1.r,table2.r,length);
 	*greenstep =interpolate(table1.g,table2.g,length);
 	*bluestep =interpolate(table1.b,table2.b,length);
 
-	leftColumnColor.r = table1.r;
-	leftColumnColor.g = table1.g;
-	leftColumnColor.b = table1.b;
+	r->leftColumnColor.r = table1.r;
+	r->leftColumnColor.g = table1.g;
+	r->leftColumnColor.b = table1.b;
+}
+
+static void Vdp1AddLines(int type, int * X, int * Y, u8 * ram, Vdp1 * regs, vdp1cmd_struct * cmd)
+{
+   vdp1prim_struct * prim = Vdp1AddPrim(type, regs, cmd);
+   int i;
+
+   if (prim == NULL)
+      return;
+
+   for (i = 0; i < 4; i++)
+   {
+      prim->x[i] = X[i];
+      prim->y[i] = Y[i];
+   }
+
+   prim->previous_gouraud[0] = vidsoft_vdp1.gouraud[0];
+   prim->previous_gouraud[1] = vidsoft_vdp1.gouraud[1];
+   prim->character_width = vidsoft_vdp1.character_width;
+   prim->character_height = vidsoft_vdp1.character_height;
+   gouraudTable(ram, cmd, prim->gouraud);
+   memcpy(vidsoft_vdp1.gouraud, prim->gouraud, sizeof(prim->gouraud));
+
+   Vdp1Bounds(prim->x, prim->y, type == VDP1_PRIM_LINE ? 2 : 4, &prim->first, &prim->last);
 }
 
 void VIDSoftVdp1PolylineDraw(u8* ram, Vdp1*regs, u8 * back_framebuffer)
 {
 	int X[4];
 	int Y[4];
-	double redstep = 0, greenstep = 0, bluestep = 0;
-	int length;
    vdp1cmd_struct cmd;
 
    Vdp1ReadCommand(&cmd, regs->addr, ram);
@@ -3362,40 +4680,260 @@ void VIDSoftVdp1PolylineDraw(u8* ram, Vdp1*regs, u8 * back_framebuffer)
 	X[3] = (int)regs->localX + (int)((s16)T1ReadWord(ram, regs->addr + 0x18));
 	Y[3] = (int)regs->localY + (int)((s16)T1ReadWord(ram, regs->addr + 0x1A));
 
-   length = iterateOverLine(X[0], Y[0], X[1], Y[1], 1, NULL, NULL, regs, &cmd, ram, back_framebuffer);
-   gouraudLineSetup(&redstep, &greenstep, &bluestep, length, gouraudA, gouraudB, ram, regs, &cmd, back_framebuffer);
-   DrawLine(X[0], Y[0], X[1], Y[1], 0, 0, 0, redstep, greenstep, bluestep, regs, &cmd, ram, back_framebuffer);
+   Vdp1AddLines(VDP1_PRIM_POLYLINE, X, Y, ram, regs, &cmd);
+}
+
+void VIDSoftVdp1LineDraw(u8* ram, Vdp1*regs, u8* back_framebuffer)
+{
+	int X[4] = { 0 };
+	int Y[4] = { 0 };
+   vdp1cmd_struct cmd;
 
-   length = iterateOverLine(X[1], Y[1], X[2], Y[2], 1, NULL, NULL, regs, &cmd, ram, back_framebuffer);
-   gouraudLineSetup(&redstep, &greenstep, &bluestep, length, gouraudB, gouraudC, ram, regs, &cmd, back_framebuffer);
-   DrawLine(X[1], Y[1], X[2], Y[2], 0, 0, 0, redstep, greenstep, bluestep, regs, &cmd, ram, back_framebuffer);
+   Vdp1ReadCommand(&cmd, regs->addr, ram);
 
-   length = iterateOverLine(X[2], Y[2], X[3], Y[3], 1, NULL, NULL, regs, &cmd, ram, back_framebuffer);
-   gouraudLineSetup(&redstep, &greenstep, &bluestep, length, gouraudD, gouraudC, ram, regs, &cmd, back_framebuffer);
-   DrawLine(X[3], Y[3], X[2], Y[2], 0, 0, 0, redstep, greenstep, bluestep, regs, &cmd, ram, back_framebuffer);
+	X[0] = (int)regs->localX + (int)((s16)T1ReadWord(ram, regs->addr + 0x0C));
+	Y[0] = (int)regs->localY + (int)((s16)T1ReadWord(ram, regs->addr + 0x0E));
+	X[1] = (int)regs->localX + (int)((s16)T1ReadWord(ram, regs->addr + 0x10));
+	Y[1] = (int)regs->localY + (int)((s16)T1ReadWord(ram, regs->addr + 0x12));
 
-   length = iterateOverLine(X[3], Y[3], X[0], Y[0], 1, NULL, NULL, regs, &cmd, ram, back_framebuffer);
-   gouraudLineSetup(&redstep, &greenstep, &bluestep, length, gouraudA, gouraudD, ram, regs, &cmd, back_framebuffer);
-   DrawLine(X[0], Y[0], X[3], Y[3], 0, 0, 0, redstep, greenstep, bluestep, regs, &cmd, ram, back_framebuffer);
+   Vdp1AddLines(VDP1_PRIM_LINE, X, Y, ram, regs, &cmd);
 }
 
-void VIDSoftVdp1LineDraw(u8* ram, Vdp1*regs, u8* back_framebuffer)
+static void drawPolyline(vdp1raster_struct * r, vdp1prim_struct * prim)
 {
-	int x1, y1, x2, y2;
+	int * X = prim->x;
+	int * Y = prim->y;
+	COLOR * gouraud = prim->gouraud;
 	double redstep = 0, greenstep = 0, bluestep = 0;
 	int length;
-   vdp1cmd_struct cmd;
 
-   Vdp1ReadCommand(&cmd, regs->addr, ram);
+   length = Vdp1LineLength(X[0], Y[0], X[1], Y[1], 1);
+   gouraudLineSetup(r, &redstep, &greenstep, &bluestep, length, prim->previous_gouraud[0], prim->previous_gouraud[1]);
+   Vdp1DrawLine(r, X[0], Y[0], X[1], Y[1], redstep, greenstep, bluestep, &prim->cmd);
+
+   length = Vdp1LineLength(X[1], Y[1], X[2], Y[2], 1);
+   gouraudLineSetup(r, &redstep, &greenstep, &bluestep, length, gouraud[1], gouraud[2]);
+   Vdp1DrawLine(r, X[1], Y[1], X[2], Y[2], redstep, greenstep, bluestep, &prim->cmd);
+
+   length = Vdp1LineLength(X[2], Y[2], X[3], Y[3], 1);
+   gouraudLineSetup(r, &redstep, &greenstep, &bluestep, length, gouraud[3], gouraud[2]);
+   Vdp1DrawLine(r, X[3], Y[3], X[2], Y[2], redstep, greenstep, bluestep, &prim->cmd);
+
+   length = Vdp1LineLength(X[3], Y[3], X[0], Y[0], 1);
+   gouraudLineSetup(r, &redstep, &greenstep, &bluestep, length, gouraud[0], gouraud[3]);
+   Vdp1DrawLine(r, X[0], Y[0], X[3], Y[3], redstep, greenstep, bluestep, &prim->cmd);
+}
+
+static void drawLine(vdp1raster_struct * r, vdp1prim_struct * prim)
+{
+	double redstep = 0, greenstep = 0, bluestep = 0;
+	int length;
+
+   length = Vdp1LineLength(prim->x[0], prim->y[0], prim->x[1], prim->y[1], 1);
+   gouraudLineSetup(r, &redstep, &bluestep, &greenstep, length, prim->previous_gouraud[0], prim->previous_gouraud[1]);
+   Vdp1DrawLine(r, prim->x[0], prim->y[0], prim->x[1], prim->y[1], redstep, greenstep, bluestep, &prim->cmd);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+// Draws the commands that can touch the dots [start, end) in list order
+static void Vdp1DrawTile(u32 start, u32 end, int cull)
+{
+   vdp1raster_struct r;
+   int i;
+
+   memset(&r, 0, sizeof(r));
+   r.ram = vidsoft_vdp1.ram;
+   r.back_framebuffer = vidsoft_vdp1.back_framebuffer;
+   r.tile_start = start;
+   r.tile_end = end;
+   r.cull = cull;
+
+   for (i = 0; i < vidsoft_vdp1.num_prims; i++)
+   {
+      vdp1prim_struct * prim = &vidsoft_vdp1.prims[i];
+
+      if (cull && (prim->last < start || prim->first >= end))
+         continue;
+
+      r.regs = &prim->regs;
+      r.characterWidth = prim->character_width;
+      r.characterHeight = prim->character_height;
 
-	x1 = (int)regs->localX + (int)((s16)T1ReadWord(ram, regs->addr + 0x0C));
-	y1 = (int)regs->localY + (int)((s16)T1ReadWord(ram, regs->addr + 0x0E));
-	x2 = (int)regs->localX + (int)((s16)T1ReadWord(ram, regs->addr + 0x10));
-	y2 = (int)regs->localY + (int)((s16)T1ReadWord(ram, regs->addr + 0x12));
+      switch (prim->type)
+      {
+         case VDP1_PRIM_QUAD:
+            drawQuad(&r, prim);
+            break;
+         case VDP1_PRIM_POLYLINE:
+            drawPolyline(&r, prim);
+            break;
+         case VDP1_PRIM_LINE:
+            drawLine(&r, prim);
+            break;
+      }
+   }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static int VidsoftVdp1TakeTile(u32 * tile)
+{
+   for (;;)
+   {
+      u32 range = VIDSOFT_READ(&vidsoft_vdp1.range);
+
+      if ((range & 0xFFFF) >= range >> 16)
+         return 0;
+
+      if (VIDSOFT_CAS(&vidsoft_vdp1.range, range, range + 1))
+      {
+         *tile = range & 0xFFFF;
+         return 1;
+      }
+   }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void VidsoftVdp1RunTiles(void)
+{
+   u32 tile;
+
+   while (VidsoftVdp1TakeTile(&tile))
+   {
+      PROFILE_START(VDP1TILE);
+      Vdp1DrawTile(tile * vidsoft_vdp1.tile_dots, (tile + 1) * vidsoft_vdp1.tile_dots, 1);
+      PROFILE_STOP(VDP1TILE);
+
+      if (VIDSOFT_DEC(&vidsoft_vdp1.pending) == 0)
+         YabSemPost(vidsoft_vdp1.done);
+   }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void VidsoftVdp1WorkerThread(void * data)
+{
+   int id = (int)(pointer)data;
+
+   PROFILE_THREAD_NAME("VidsoftVdp1Worker");
+   for (;;)
+   {
+      YabSemWait(vidsoft_vdp1.wake[id]);
+      if (vidsoft_vdp1.quit)
+         break;
+      VidsoftVdp1RunTiles();
+   }
+   PROFILE_THREAD_EXIT();
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static int VidsoftVdp1PoolInit(void)
+{
+   vidsoft_vdp1.num_started = vidsoft_vdp1.num_active = 0;
+   vidsoft_vdp1.quit = 0;
+
+   if ((vidsoft_vdp1.done = YabSemInit(0)) == NULL)
+      return -1;
+
+   return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void VidsoftVdp1PoolDeInit(void)
+{
+   int i;
+
+   vidsoft_vdp1.quit = 1;
+   for (i = 0; i < vidsoft_vdp1.num_started; i++)
+   {
+      YabSemPost(vidsoft_vdp1.wake[i]);
+      YabThreadWait(YAB_THREAD_VIDSOFT_VDP1_WORKER_0 + i);
+      YabSemDeInit(vidsoft_vdp1.wake[i]);
+      vidsoft_vdp1.wake[i] = NULL;
+   }
+
+   YabSemDeInit(vidsoft_vdp1.done);
+   vidsoft_vdp1.done = NULL;
+   vidsoft_vdp1.num_started = vidsoft_vdp1.num_active = 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+// Starts workers as the thread count goes up, extra ones are left asleep
+static void VidsoftVdp1PoolResize(int num)
+{
+   if (num > VIDSOFT_VDP1_MAX_WORKERS)
+      num = VIDSOFT_VDP1_MAX_WORKERS;
+
+   while (vidsoft_vdp1.num_started < num)
+   {
+      int id = vidsoft_vdp1.num_started;
+
+      if ((vidsoft_vdp1.wake[id] = YabSemInit(0)) == NULL)
+         break;
+
+      if (YabThreadStart(YAB_THREAD_VIDSOFT_VDP1_WORKER_0 + id, VidsoftVdp1WorkerThread, (void *)(pointer)id) != 0)
+      {
+         YabSemDeInit(vidsoft_vdp1.wake[id]);
+         vidsoft_vdp1.wake[id] = NULL;
+         break;
+      }
+
+      vidsoft_vdp1.num_started++;
+   }
+
+   vidsoft_vdp1.num_active = num < vidsoft_vdp1.num_started ? num : vidsoft_vdp1.num_started;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+// Rasterizes the commands read since VidsoftVdp1DrawCommands started, the
+// calling thread takes tiles too and returns once all of them are drawn
+static void VidsoftVdp1Render(void)
+{
+   u32 dots = 0x40000 / vdp1pixelsize;
+   u32 num_tiles;
+   int i;
+
+   if (vidsoft_vdp1.num_prims == 0)
+      return;
+
+   if (vidsoft_vdp1.serial || vidsoft_num_vdp1_threads < 2 || vidsoft_vdp1.done == NULL)
+   {
+      Vdp1DrawTile(0, dots, 0);
+      return;
+   }
+
+   VidsoftVdp1PoolResize(vidsoft_num_vdp1_threads - 1);
+
+   vidsoft_vdp1.tile_dots = VIDSOFT_VDP1_TILE_LINES * vdp1width;
+   num_tiles = (dots + vidsoft_vdp1.tile_dots - 1) / vidsoft_vdp1.tile_dots;
+   vidsoft_vdp1.pending = num_tiles;
+   VIDSOFT_PUBLISH(&vidsoft_vdp1.range, num_tiles << 16);
+
+   for (i = 0; i < vidsoft_vdp1.num_active; i++)
+      YabSemPost(vidsoft_vdp1.wake[i]);
+
+   VidsoftVdp1RunTiles();
+   YabSemWait(vidsoft_vdp1.done);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void VidsoftVdp1DrawCommands(u8 * ram, Vdp1 * regs, u8 * back_framebuffer)
+{
+   vidsoft_vdp1.num_prims = 0;
+   vidsoft_vdp1.serial = 0;
+   vidsoft_vdp1.ram = ram;
+   vidsoft_vdp1.back_framebuffer = back_framebuffer;
+
+   Vdp1DrawCommands(ram, regs, back_framebuffer);
 
-   length = iterateOverLine(x1, y1, x2, y2, 1, NULL, NULL, regs, &cmd, ram, back_framebuffer);
-   gouraudLineSetup(&redstep, &bluestep, &greenstep, length, gouraudA, gouraudB, ram, regs, &cmd, back_framebuffer);
-   DrawLine(x1, y1, x2, y2, 0, 0, 0, redstep, greenstep, bluestep, regs, &cmd, ram, back_framebuffer);
+   VidsoftVdp1Render();
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -3531,7 +5069,7 @@ void VIDSoftVdp2DrawStart(void)
 //////////////////////////////////////////////////////////////////////////////
 
 
-void VidsoftDrawSprite(Vdp2 * vdp2_regs, u8 * spr_window_mask, u8* vdp1_front_framebuffer, u8 * vdp2_ram, Vdp1* vdp1_regs, Vdp2* vdp2_lines, u8*color_ram)
+static void VidsoftDrawSpriteLines(Vdp2 * vdp2_regs, u8 * spr_window_mask, u8* vdp1_front_framebuffer, u8 * vdp2_ram, Vdp1* vdp1_regs, Vdp2LineLog * vdp2_lines, u32*color_ram, int band_start, int band_end)
 {
    int i, i2;
    u16 pixel;
@@ -3548,11 +5086,9 @@ void VidsoftDrawSprite(Vdp2 * vdp2_regs, u8 * spr_window_mask, u8* vdp1_front_fr
    int start_line = 0, line_increment = 0;
    int sprite_window_enabled = vdp2_regs->SPCTL & 0x10;
    int vdp1spritetype = 0;
+   Vdp2LineRegs line_regs;
 
-   if (sprite_window_enabled)
-   {
-      memset(spr_window_mask, 0, 704 * 512);
-   }
+   Vdp2LineRegsInit(&line_regs, vdp2_lines);
 
    // Figure out whether to draw vdp1 framebuffer or vdp2 framebuffer pixels
    // based on priority
@@ -3606,16 +5142,16 @@ void VidsoftDrawSprite(Vdp2 * vdp2_regs, u8 * spr_window_mask, u8* vdp1_front_fr
 
       Vdp2GetInterlaceInfo(&start_line, &line_increment);
 
-      for (i2 = start_line; i2 < vdp2height; i2 += line_increment)
+      for (i2 = start_line; i2 < vdp2height && i2 < band_end; i2 += line_increment)
       {
          float framebuffer_readout_pos = 0;
 
          ReadLineWindowClip(islinewindow, clip, &linewnd0addr, &linewnd1addr, vdp2_ram, vdp2_regs);
 
          if (vdp2_interlace)
-            LoadLineParamsSprite(&info, i2 / 2, vdp2_lines);
+            LoadLineParamsSprite(&info, i2 / 2, &line_regs);
          else
-            LoadLineParamsSprite(&info, i2, vdp2_lines);
+            LoadLineParamsSprite(&info, i2, &line_regs);
 
          if (vdp2_interlace)
          {
@@ -3627,6 +5163,12 @@ void VidsoftDrawSprite(Vdp2 * vdp2_regs, u8 * spr_window_mask, u8* vdp1_front_fr
             y = i2;
          }
 
+         if (i2 < band_start)
+         {
+            output_y++;
+            continue;
+         }
+
          for (i = 0; i < vdp2width; i++)
          {
 
@@ -3876,19 +5418,31 @@ void VidsoftDrawSprite(Vdp2 * vdp2_regs, u8 * spr_window_mask, u8* vdp1_front_fr
    }
 }
 
+//////////////////////////////////////////////////////////////////////////////
+
+static void VidsoftClearSpriteWindow(Vdp2 * vdp2_regs, u8 * spr_window_mask)
+{
+   if (vdp2_regs->SPCTL & 0x10)
+      memset(spr_window_mask, 0, 704 * 512);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void VidsoftDrawSprite(Vdp2 * vdp2_regs, u8 * spr_window_mask, u8* vdp1_front_framebuffer, u8 * vdp2_ram, Vdp1* vdp1_regs, Vdp2LineLog * vdp2_lines, u32*color_ram)
+{
+   VidsoftClearSpriteWindow(vdp2_regs, spr_window_mask);
+   VidsoftDrawSpriteLines(vdp2_regs, spr_window_mask, vdp1_front_framebuffer, vdp2_ram, vdp1_regs, vdp2_lines, color_ram, 0, vdp2height);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
 void VIDSoftVdp2DrawEnd(void)
 {
-   if (vidsoft_num_layer_threads > 0)
-   {
-      while (!vidsoft_thread_context.draw_finished[TITAN_NBG0]){}
-      while (!vidsoft_thread_context.draw_finished[TITAN_NBG1]){}
-      while (!vidsoft_thread_context.draw_finished[TITAN_NBG2]){}
-      while (!vidsoft_thread_context.draw_finished[TITAN_NBG3]){}
-      while (!vidsoft_thread_context.draw_finished[TITAN_RBG0]){}
-      while (!vidsoft_thread_context.draw_finished[TITAN_SPRITE]){}
-   }
+   VidsoftPoolWait();
 
+   PROFILE_START(TITAN);
    TitanRender(dispbuffer);
+   PROFILE_STOP(TITAN);
 
    VIDSoftVdp1SwapFrameBuffer();
 
@@ -3914,22 +5468,12 @@ void VIDSoftVdp2DrawEnd(void)
 
 //////////////////////////////////////////////////////////////////////////////
 
-void VidsoftStartLayerThread(int * layer_priority, int * draw_priority_0, int * num_threads_dispatched, int which_layer, void(*layer_func) (Vdp2* lines, Vdp2* regs, u8* ram, u8* color_ram, struct CellScrollData * cell_data))
+static void VidsoftSetupLayerJob(int * layer_priority, int * draw_priority_0, int which_layer, void(*layer_func) (Vdp2LineLog * lines, Vdp2* regs, u8* ram, u32* color_ram, struct CellScrollData * cell_data, vidsoft_layer_job * job))
 {
+   vidsoft_pool.jobs[which_layer].type = VIDSOFT_JOB_NONE;
+
    if (layer_priority[which_layer] > 0 || draw_priority_0[which_layer])
-   {
-      if (*num_threads_dispatched < vidsoft_num_layer_threads)
-      {
-         vidsoft_thread_context.need_draw[which_layer] = 1;
-         vidsoft_thread_context.draw_finished[which_layer] = 0;
-         YabThreadWake(YAB_THREAD_VIDSOFT_LAYER_NBG3 + which_layer);
-         *num_threads_dispatched = *num_threads_dispatched + 1;
-      }
-      else
-      {
-        (*layer_func) (Vdp2Lines, Vdp2Regs, Vdp2Ram, Vdp2ColorRam, cell_scroll_data);
-      }
-   }
+      (*layer_func) (&vidsoft_thread_context.lines, &vidsoft_thread_context.regs, vidsoft_thread_context.ram, vidsoft_thread_context.color_ram, vidsoft_thread_context.cell_data, &vidsoft_pool.jobs[which_layer]);
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -3966,7 +5510,10 @@ void VIDSoftVdp2DrawScreens(void)
 {
    int draw_priority_0[6] = { 0 };
    int layer_priority[6] = { 0 };
-   int num_threads_dispatched = 0;
+   int use_pool = vidsoft_num_layer_threads > 0 && vidsoft_pool.done != NULL;
+
+   VidsoftPoolWait();
+   vidsoft_cell_serial = ++Vdp2WriteSerial;
 
    VIDSoftVdp2SetResolution(Vdp2Regs->TVMD);
    layer_priority[TITAN_NBG0] = Vdp2Regs->PRINA & 0x7;
@@ -3986,43 +5533,52 @@ void VIDSoftVdp2DrawScreens(void)
       draw_priority_0[TITAN_RBG0] = (Vdp2Regs->SFPRMD >> 8) & 0x3;
    }
 
-   if (vidsoft_num_layer_threads > 0)
+   if (use_pool)
    {
-      memcpy(vidsoft_thread_context.lines, Vdp2Lines, sizeof(Vdp2) * 270);
+      VidsoftPoolResize(vidsoft_num_layer_threads);
+
+      Vdp2LineLogCopy(&vidsoft_thread_context.lines, &Vdp2Lines);
       memcpy(&vidsoft_thread_context.regs, Vdp2Regs, sizeof(Vdp2));
       memcpy(vidsoft_thread_context.ram, Vdp2Ram, 0x80000);
-      memcpy(vidsoft_thread_context.color_ram, Vdp2ColorRam, 0x1000);
-      memcpy(vidsoft_thread_context.cell_scroll_data, cell_scroll_data, sizeof(struct CellScrollData) * 270);
+      memcpy(vidsoft_thread_context.color_ram, Vdp2ColorRamColors, sizeof(Vdp2ColorRamColors));
+      memcpy(vidsoft_thread_context.cell_data, cell_scroll_data, sizeof(struct CellScrollData) * 270);
    }
 
-   //draw vdp2 sprite layer on a thread if sprite window is not enabled
-   if (CanUseSpriteThread() && vidsoft_num_layer_threads > 0)
+   //draw vdp2 sprite layer in the pool if sprite window is not enabled
+   if (CanUseSpriteThread() && use_pool)
    {
-      vidsoft_thread_context.need_draw[TITAN_SPRITE] = 1;
-      vidsoft_thread_context.draw_finished[TITAN_SPRITE] = 0;
-      YabThreadWake(YAB_THREAD_VIDSOFT_LAYER_SPRITE);
-      num_threads_dispatched++;
+      vidsoft_layer_job * job = &vidsoft_pool.jobs[TITAN_SPRITE];
+
+      VidsoftClearSpriteWindow(&vidsoft_thread_context.regs, sprite_window_mask);
+      job->type = VIDSOFT_JOB_SPRITE;
+      job->single_band = 0;
+      job->lines = &vidsoft_thread_context.lines;
+      job->regs = &vidsoft_thread_context.regs;
+      job->ram = vidsoft_thread_context.ram;
+      job->color_ram = vidsoft_thread_context.color_ram;
    }
    else
    {
-      VidsoftDrawSprite(Vdp2Regs, sprite_window_mask, vdp1frontframebuffer, Vdp2Ram, Vdp1Regs, Vdp2Lines, Vdp2ColorRam);
+      vidsoft_pool.jobs[TITAN_SPRITE].type = VIDSOFT_JOB_NONE;
+      VidsoftDrawSprite(Vdp2Regs, sprite_window_mask, vdp1frontframebuffer, Vdp2Ram, Vdp1Regs, &Vdp2Lines, Vdp2ColorRamColors);
    }
 
-   if (vidsoft_num_layer_threads > 0)
+   if (use_pool)
    {
-      VidsoftStartLayerThread(layer_priority, draw_priority_0, &num_threads_dispatched, TITAN_NBG0, Vdp2DrawNBG0);
-      VidsoftStartLayerThread(layer_priority, draw_priority_0, &num_threads_dispatched, TITAN_RBG0, Vdp2DrawRBG0);
-      VidsoftStartLayerThread(layer_priority, draw_priority_0, &num_threads_dispatched, TITAN_NBG1, Vdp2DrawNBG1);
-      VidsoftStartLayerThread(layer_priority, draw_priority_0, &num_threads_dispatched, TITAN_NBG2, Vdp2DrawNBG2);
-      VidsoftStartLayerThread(layer_priority, draw_priority_0, &num_threads_dispatched, TITAN_NBG3, Vdp2DrawNBG3);
+      VidsoftSetupLayerJob(layer_priority, draw_priority_0, TITAN_NBG0, Vdp2DrawNBG0);
+      VidsoftSetupLayerJob(layer_priority, draw_priority_0, TITAN_RBG0, Vdp2DrawRBG0);
+      VidsoftSetupLayerJob(layer_priority, draw_priority_0, TITAN_NBG1, Vdp2DrawNBG1);
+      VidsoftSetupLayerJob(layer_priority, draw_priority_0, TITAN_NBG2, Vdp2DrawNBG2);
+      VidsoftSetupLayerJob(layer_priority, draw_priority_0, TITAN_NBG3, Vdp2DrawNBG3);
+      VidsoftPoolStart();
    }
    else
    {
-      Vdp2DrawNBG0(Vdp2Lines, Vdp2Regs, Vdp2Ram, Vdp2ColorRam, cell_scroll_data);
-      Vdp2DrawNBG1(Vdp2Lines, Vdp2Regs, Vdp2Ram, Vdp2ColorRam, cell_scroll_data);
-      Vdp2DrawNBG2(Vdp2Lines, Vdp2Regs, Vdp2Ram, Vdp2ColorRam, cell_scroll_data);
-      Vdp2DrawNBG3(Vdp2Lines, Vdp2Regs, Vdp2Ram, Vdp2ColorRam, cell_scroll_data);
-      Vdp2DrawRBG0(Vdp2Lines, Vdp2Regs, Vdp2Ram, Vdp2ColorRam, cell_scroll_data);
+      Vdp2DrawNBG0(&Vdp2Lines, Vdp2Regs, Vdp2Ram, Vdp2ColorRamColors, cell_scroll_data, NULL);
+      Vdp2DrawNBG1(&Vdp2Lines, Vdp2Regs, Vdp2Ram, Vdp2ColorRamColors, cell_scroll_data, NULL);
+      Vdp2DrawNBG2(&Vdp2Lines, Vdp2Regs, Vdp2Ram, Vdp2ColorRamColors, cell_scroll_data, NULL);
+      Vdp2DrawNBG3(&Vdp2Lines, Vdp2Regs, Vdp2Ram, Vdp2ColorRamColors, cell_scroll_data, NULL);
+      Vdp2DrawRBG0(&Vdp2Lines, Vdp2Regs, Vdp2Ram, Vdp2ColorRamColors, cell_scroll_data, NULL);
    }
 }
 
@@ -4030,24 +5586,26 @@ void VIDSoftVdp2DrawScreens(void)
 
 void VIDSoftVdp2DrawScreen(int screen)
 {
+   VidsoftPoolWait();
+   vidsoft_cell_serial = ++Vdp2WriteSerial;
    VIDSoftVdp2SetResolution(Vdp2Regs->TVMD);
 
    switch(screen)
    {
       case 0:
-         Vdp2DrawNBG0(Vdp2Lines, Vdp2Regs, Vdp2Ram, Vdp2ColorRam, cell_scroll_data);
+         Vdp2DrawNBG0(&Vdp2Lines, Vdp2Regs, Vdp2Ram, Vdp2ColorRamColors, cell_scroll_data, NULL);
          break;
       case 1:
-         Vdp2DrawNBG1(Vdp2Lines, Vdp2Regs, Vdp2Ram, Vdp2ColorRam, cell_scroll_data);
+         Vdp2DrawNBG1(&Vdp2Lines, Vdp2Regs, Vdp2Ram, Vdp2ColorRamColors, cell_scroll_data, NULL);
          break;
       case 2:
-         Vdp2DrawNBG2(Vdp2Lines, Vdp2Regs, Vdp2Ram, Vdp2ColorRam, cell_scroll_data);
+         Vdp2DrawNBG2(&Vdp2Lines, Vdp2Regs, Vdp2Ram, Vdp2ColorRamColors, cell_scroll_data, NULL);
          break;
       case 3:
-         Vdp2DrawNBG3(Vdp2Lines, Vdp2Regs, Vdp2Ram, Vdp2ColorRam, cell_scroll_data);
+         Vdp2DrawNBG3(&Vdp2Lines, Vdp2Regs, Vdp2Ram, Vdp2ColorRamColors, cell_scroll_data, NULL);
          break;
       case 4:
-         Vdp2DrawRBG0(Vdp2Lines, Vdp2Regs, Vdp2Ram, Vdp2ColorRam, cell_scroll_data);
+         Vdp2DrawRBG0(&Vdp2Lines, Vdp2Regs, Vdp2Ram, Vdp2ColorRamColors, cell_scroll_data, NULL);
          break;
    }
 }
@@ -38,6 +38,8 @@ void Vdp2GetInterlaceInfo(int * start_line, int * line_increment);
 
 void VIDSoftSetNumLayerThreads(int num);
 
+void VIDSoftSetNumVdp1Threads(int num);
+
 void VIDSoftSetVdp1ThreadEnable(int b);
 
 void VidsoftWaitForVdp1Thread();
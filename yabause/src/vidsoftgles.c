@@ -193,7 +193,7 @@ struct
 {
    volatile int need_draw[5];
    volatile int draw_finished[5];
-   volatile void (*draw[5])(Vdp2* lines, Vdp2* regs, u8* ram, u8* color_ram, struct CellScrollData * cell_data);
+   volatile void (*draw[5])(Vdp2LineLog * lines, Vdp2* regs, u8* ram, u8* color_ram, struct CellScrollData * cell_data);
 } screen_render_thread_context;
 
 #define DECLARE_SCREEN_RENDER_THREAD(FUNC_NAME, THREAD_NUMBER) \
@@ -204,7 +204,7 @@ void FUNC_NAME(void* data) \
       if (screen_render_thread_context.need_draw[THREAD_NUMBER]) \
       { \
          screen_render_thread_context.need_draw[THREAD_NUMBER] = 0; \
-         if (screen_render_thread_context.draw[THREAD_NUMBER] != NULL) screen_render_thread_context.draw[THREAD_NUMBER](Vdp2Lines, Vdp2Regs, Vdp2Ram, Vdp2ColorRam, cell_scroll_data); \
+         if (screen_render_thread_context.draw[THREAD_NUMBER] != NULL) screen_render_thread_context.draw[THREAD_NUMBER](&Vdp2Lines, Vdp2Regs, Vdp2Ram, Vdp2ColorRam, cell_scroll_data); \
          screen_render_thread_context.draw_finished[THREAD_NUMBER] = 1; \
       } \
       YabThreadSleep(); \
@@ -833,7 +833,7 @@ static int PixelIsSpecialPriority(int specialcode, int dot)
 
 //////////////////////////////////////////////////////////////////////////////
 
-static void FASTCALL Vdp2DrawScroll(vdp2draw_struct *info, Vdp2* lines, Vdp2* regs, u8* ram, u8* color_ram, struct CellScrollData * cell_data)
+static void FASTCALL Vdp2DrawScroll(vdp2draw_struct *info, Vdp2LineLog * lines, Vdp2* regs, u8* ram, u8* color_ram, struct CellScrollData * cell_data)
 {
 
    int i, j;
@@ -853,7 +853,9 @@ static void FASTCALL Vdp2DrawScroll(vdp2draw_struct *info, Vdp2* lines, Vdp2* re
    u32 linescrolly_table[512] = { 0 };
    float lineszoom_table[512] = { 0 };
    int num_vertical_cell_scroll_enabled = 0;
+   Vdp2LineRegs line_regs;
 
+   Vdp2LineRegsInit(&line_regs, lines);
    SetupScreenVars(info, &sinfo, info->PlaneAddr, regs);
 
    scrolly = info->y;
@@ -1003,9 +1005,9 @@ static void FASTCALL Vdp2DrawScroll(vdp2draw_struct *info, Vdp2* lines, Vdp2* re
       Y=y;
 
       if (vdp2_interlace)
-         info->LoadLineParams(info, &sinfo, j / 2, lines);
+         info->LoadLineParams(info, &sinfo, j / 2, &line_regs);
       else
-         info->LoadLineParams(info, &sinfo, j, lines);
+         info->LoadLineParams(info, &sinfo, j, &line_regs);
 
       if (!info->enable)
          continue;
@@ -1147,7 +1149,7 @@ static int Rbg0CheckRam(Vdp2* regs)
    return 0;
 }
 
-static void FASTCALL Vdp2DrawRotationFP(vdp2draw_struct *info, vdp2rotationparameterfp_struct *parameter, Vdp2* lines, Vdp2* regs, u8* ram, u8* color_ram, struct CellScrollData * cell_data)
+static void FASTCALL Vdp2DrawRotationFP(vdp2draw_struct *info, vdp2rotationparameterfp_struct *parameter, Vdp2LineLog * lines, Vdp2* regs, u8* ram, u8* color_ram, struct CellScrollData * cell_data)
 {
 
    int i, j;
@@ -1156,6 +1158,9 @@ static void FASTCALL Vdp2DrawRotationFP(vdp2draw_struct *info, vdp2rotationparam
    vdp2rotationparameterfp_struct *p=&parameter[info->rotatenum];
    clipping_struct clip[2];
    u32 linewnd0addr, linewnd1addr;
+   Vdp2LineRegs line_regs;
+
+   Vdp2LineRegsInit(&line_regs, lines);
 
    clip[0].xstart = clip[0].ystart = clip[0].xend = clip[0].yend = 0;
    clip[1].xstart = clip[1].ystart = clip[1].xend = clip[1].yend = 0;
@@ -1189,7 +1194,7 @@ static void FASTCALL Vdp2DrawRotationFP(vdp2draw_struct *info, vdp2rotationparam
 
          for (j = 0; j < vdp2height; j++)
          {
-            info->LoadLineParams(info, &sinfo, j, lines);
+            info->LoadLineParams(info, &sinfo, j, &line_regs);
             ReadLineWindowClip(info->islinewindow, clip, &linewnd0addr, &linewnd1addr, ram, regs);
 
             for (i = 0; i < rbg0width; i++)
@@ -1326,7 +1331,7 @@ static void FASTCALL Vdp2DrawRotationFP(vdp2draw_struct *info, vdp2rotationparam
             TitanPutLineHLine(info->linescreen, j, COLSAT2YAB32(0xFF, lineColor));
          }
 
-         info->LoadLineParams(info, &sinfo, j, lines);
+         info->LoadLineParams(info, &sinfo, j, &line_regs);
          ReadLineWindowClip(info->islinewindow, clip, &linewnd0addr, &linewnd1addr, ram, regs);
 
          if (userpwindow)
@@ -1550,7 +1555,7 @@ static void Vdp2DrawLineScreen(void)
 
 //////////////////////////////////////////////////////////////////////////////
 
-static void LoadLineParamsNBG0(vdp2draw_struct * info, screeninfo_struct * sinfo, int line, Vdp2* lines)
+static void LoadLineParamsNBG0(vdp2draw_struct * info, screeninfo_struct * sinfo, int line, Vdp2LineRegs * lines)
 {
 
    Vdp2 * regs;
@@ -1565,7 +1570,7 @@ static void LoadLineParamsNBG0(vdp2draw_struct * info, screeninfo_struct * sinfo
 
 //////////////////////////////////////////////////////////////////////////////
 
-static void Vdp2DrawNBG0(Vdp2* lines, Vdp2* regs, u8* ram, u8* color_ram, struct CellScrollData * cell_data)
+static void Vdp2DrawNBG0(Vdp2LineLog * lines, Vdp2* regs, u8* ram, u8* color_ram, struct CellScrollData * cell_data)
 {
 
    vdp2draw_struct info = { 0 };
@@ -1686,7 +1691,7 @@ static void Vdp2DrawNBG0(Vdp2* lines, Vdp2* regs, u8* ram, u8* color_ram, struct
       info.isverticalscroll = 0;
    info.wctl = regs->WCTLA;
 
-   info.LoadLineParams = (void (*)(void *, void *,int ,Vdp2*)) LoadLineParamsNBG0;
+   info.LoadLineParams = (void (*)(void *, void *,int ,Vdp2LineRegs *)) LoadLineParamsNBG0;
 
    if (info.enable == 1)
    {
@@ -1702,7 +1707,7 @@ static void Vdp2DrawNBG0(Vdp2* lines, Vdp2* regs, u8* ram, u8* color_ram, struct
 
 //////////////////////////////////////////////////////////////////////////////
 
-static void LoadLineParamsNBG1(vdp2draw_struct * info, screeninfo_struct * sinfo, int line, Vdp2* lines)
+static void LoadLineParamsNBG1(vdp2draw_struct * info, screeninfo_struct * sinfo, int line, Vdp2LineRegs * lines)
 {
 
    Vdp2 * regs;
@@ -1717,7 +1722,7 @@ static void LoadLineParamsNBG1(vdp2draw_struct * info, screeninfo_struct * sinfo
 
 //////////////////////////////////////////////////////////////////////////////
 
-static void Vdp2DrawNBG1(Vdp2* lines, Vdp2* regs, u8* ram, u8* color_ram, struct CellScrollData * cell_data)
+static void Vdp2DrawNBG1(Vdp2LineLog * lines, Vdp2* regs, u8* ram, u8* color_ram, struct CellScrollData * cell_data)
 {
 
    vdp2draw_struct info = { 0 };
@@ -1803,14 +1808,14 @@ static void Vdp2DrawNBG1(Vdp2* lines, Vdp2* regs, u8* ram, u8* color_ram, struct
       info.isverticalscroll = 0;
    info.wctl = regs->WCTLA >> 8;
 
-   info.LoadLineParams = (void(*)(void *, void*, int, Vdp2*)) LoadLineParamsNBG1;
+   info.LoadLineParams = (void(*)(void *, void*, int, Vdp2LineRegs *)) LoadLineParamsNBG1;
 
    Vdp2DrawScroll(&info, lines, regs, ram, color_ram, cell_data);
 }
 
 //////////////////////////////////////////////////////////////////////////////
 
-static void LoadLineParamsNBG2(vdp2draw_struct * info, screeninfo_struct * sinfo, int line, Vdp2* lines)
+static void LoadLineParamsNBG2(vdp2draw_struct * info, screeninfo_struct * sinfo, int line, Vdp2LineRegs * lines)
 {
 
    Vdp2 * regs;
@@ -1825,7 +1830,7 @@ static void LoadLineParamsNBG2(vdp2draw_struct * info, screeninfo_struct * sinfo
 
 //////////////////////////////////////////////////////////////////////////////
 
-static void Vdp2DrawNBG2(Vdp2* lines, Vdp2* regs, u8* ram, u8* color_ram, struct CellScrollData * cell_data)
+static void Vdp2DrawNBG2(Vdp2LineLog * lines, Vdp2* regs, u8* ram, u8* color_ram, struct CellScrollData * cell_data)
 {
 
    vdp2draw_struct info = { 0 };
@@ -1877,14 +1882,14 @@ static void Vdp2DrawNBG2(Vdp2* lines, Vdp2* regs, u8* ram, u8* color_ram, struct
    info.wctl = regs->WCTLB;
    info.isbitmap = 0;
 
-   info.LoadLineParams = (void(*)(void *,void*, int, Vdp2*)) LoadLineParamsNBG2;
+   info.LoadLineParams = (void(*)(void *,void*, int, Vdp2LineRegs *)) LoadLineParamsNBG2;
 
    Vdp2DrawScroll(&info, lines, regs, ram, color_ram, cell_data);
 }
 
 //////////////////////////////////////////////////////////////////////////////
 
-static void LoadLineParamsNBG3(vdp2draw_struct * info, screeninfo_struct * sinfo, int line, Vdp2* lines)
+static void LoadLineParamsNBG3(vdp2draw_struct * info, screeninfo_struct * sinfo, int line, Vdp2LineRegs * lines)
 {
 
    Vdp2 * regs;
@@ -1899,7 +1904,7 @@ static void LoadLineParamsNBG3(vdp2draw_struct * info, screeninfo_struct * sinfo
 
 //////////////////////////////////////////////////////////////////////////////
 
-static void Vdp2DrawNBG3(Vdp2* lines, Vdp2* regs, u8* ram, u8* color_ram, struct CellScrollData * cell_data)
+static void Vdp2DrawNBG3(Vdp2LineLog * lines, Vdp2* regs, u8* ram, u8* color_ram, struct CellScrollData * cell_data)
 {
 
    vdp2draw_struct info = { 0 };
@@ -1953,14 +1958,14 @@ static void Vdp2DrawNBG3(Vdp2* lines, Vdp2* regs, u8* ram, u8* color_ram, struct
    info.wctl = regs->WCTLB >> 8;
    info.isbitmap = 0;
 
-   info.LoadLineParams = (void(*)(void *, void*, int, Vdp2*)) LoadLineParamsNBG3;
+   info.LoadLineParams = (void(*)(void *, void*, int, Vdp2LineRegs *)) LoadLineParamsNBG3;
 
    Vdp2DrawScroll(&info, lines, regs, ram, color_ram, cell_data);
 }
 
 //////////////////////////////////////////////////////////////////////////////
 
-static void LoadLineParamsRBG0(vdp2draw_struct * info, screeninfo_struct * sinfo, int line, Vdp2* lines)
+static void LoadLineParamsRBG0(vdp2draw_struct * info, screeninfo_struct * sinfo, int line, Vdp2LineRegs * lines)
 {
 
    Vdp2 * regs;
@@ -1973,7 +1978,7 @@ static void LoadLineParamsRBG0(vdp2draw_struct * info, screeninfo_struct * sinfo
 
 //////////////////////////////////////////////////////////////////////////////
 
-static void Vdp2DrawRBG0(Vdp2* lines, Vdp2* regs, u8* ram, u8* color_ram, struct CellScrollData * cell_data)
+static void Vdp2DrawRBG0(Vdp2LineLog * lines, Vdp2* regs, u8* ram, u8* color_ram, struct CellScrollData * cell_data)
 {
 
    vdp2draw_struct info = { 0 };
@@ -2079,14 +2084,14 @@ static void Vdp2DrawRBG0(Vdp2* lines, Vdp2* regs, u8* ram, u8* color_ram, struct
    info.isverticalscroll = 0;
    info.wctl = regs->WCTLC;
 
-   info.LoadLineParams = (void(*)(void *, void*, int, Vdp2*)) LoadLineParamsRBG0;
+   info.LoadLineParams = (void(*)(void *, void*, int, Vdp2LineRegs *)) LoadLineParamsRBG0;
 
    Vdp2DrawRotationFP(&info, parameter, lines, regs, ram, color_ram, cell_data);
 }
 
 //////////////////////////////////////////////////////////////////////////////
 
-static void LoadLineParamsSprite(vdp2draw_struct * info, int line, Vdp2* lines)
+static void LoadLineParamsSprite(vdp2draw_struct * info, int line, Vdp2LineRegs * lines)
 {
 
    Vdp2 * regs;
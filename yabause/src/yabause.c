@@ -35,9 +35,11 @@
 #include "cs2.h"
 #include "debug.h"
 #include "error.h"
+#include "jitprof.h"
 #include "memory.h"
 #include "m68kcore.h"
 #include "peripheral.h"
+#include "rewind.h"
 #include "scsp.h"
 #include "scspdsp.h"
 #include "scu.h"
@@ -78,7 +80,6 @@
 #ifdef SYS_PROFILE_H
  #include SYS_PROFILE_H
 #else
- #define DONT_PROFILE
  #include "profile.h"
 #endif
 
@@ -129,6 +130,8 @@ void print_usage(const char *program_name) {
    printf("   -ns        --nosound              turn sound off\n");
    printf("   -a         --autostart            autostart emulation\n");
    printf("   -f         --fullscreen           start in fullscreen mode\n");
+   printf("              --jit-perf-map         name recompiled code in /tmp/perf-<pid>.map\n");
+   printf("              --jit-dump             write recompiled code to /tmp/jit-<pid>.dump\n");
 }
 #endif
 
@@ -366,6 +369,13 @@ int YabauseInit(yabauseinit_struct *init)
 
    YabauseResetNoLoad();
 
+   yabsys.use_rewind = init->use_rewind;
+   if (yabsys.use_rewind && RewindInit(init->rewind_budget) != 0)
+   {
+      YabSetError(YAB_ERR_CANNOTINIT, _("Rewind"));
+      return -1;
+   }
+
 #ifdef YAB_WANT_SSF
 
    if (init->play_ssf && init->ssfpath != NULL && strlen(init->ssfpath))
@@ -419,13 +429,21 @@ int YabauseInit(yabauseinit_struct *init)
       int num = yabsys.NumThreads < 1 ? 1 : yabsys.NumThreads;
       VIDSoftSetVdp1ThreadEnable(num == 1 ? 0 : 1);
       VIDSoftSetNumLayerThreads(num);
+      VIDSoftSetNumVdp1Threads(num);
       VIDSoftSetNumPriorityThreads(num);
+#ifndef USE_SCSP2
+      ScspSetSoundThread(num == 1 ? 0 : 1);
+#endif
    }
    else
    {
       VIDSoftSetVdp1ThreadEnable(0);
       VIDSoftSetNumLayerThreads(0);
+      VIDSoftSetNumVdp1Threads(0);
       VIDSoftSetNumPriorityThreads(0);
+#ifndef USE_SCSP2
+      ScspSetSoundThread(0);
+#endif
    }
 
    yabsys.use_scsp_dsp_jit = init->use_scsp_dsp_dynarec;
@@ -453,6 +471,9 @@ void YabFlushBackups(void)
 void YabauseDeInit(void) {
    SH2DeInit();
 
+   RewindDeInit();
+   yabsys.use_rewind = 0;
+
    if (BiosRom)
       T2MemoryDeInit(BiosRom);
    BiosRom = NULL;
@@ -484,6 +505,7 @@ void YabauseDeInit(void) {
    PerDeInit();
    VideoDeInit();
    CheatDeInit();
+   PROFILE_DEINIT();
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -499,6 +521,7 @@ void YabauseResetNoLoad(void) {
    YabauseStopSlave();
    memset(HighWram, 0, 0x100000);
    memset(LowWram, 0, 0x100000);
+   MemoryMarkAllDirty();
 
    // Reset CS0 area here
    // Reset CS1 area here
@@ -649,6 +672,7 @@ int YabauseEmulate(void) {
 #endif
    
    DoMovie();
+   JitProfFrame();
 
    #if defined(SH2_DYNAREC)
    if(SH2Core->id==2) {
@@ -656,13 +680,23 @@ int YabauseEmulate(void) {
        YabauseDynarecOneFrameExec(722,0); // m68kcycles,m68kcenticycles
      else
        YabauseDynarecOneFrameExec(716,20);
+     if (yabsys.use_rewind)
+       RewindSnapshot();
      return 0;
    }
    #endif
 
+   PROFILE_START(FRAME);
+
+   // Everything is still stepped in deciline slices rather than from an
+   // event queue. The slice edges are where MSH2, SSH2, the SCU and the 68K
+   // see each other's writes, interrupts and DMA progress, so letting a CPU
+   // run ahead to the next event would change the interleaving games rely
+   // on. Idle CPUs and the CD block/SMPC already skip their work per slice,
+   // which leaves only the slice loop itself.
    while (!oneframeexec)
    {
-      PROFILE_START("Total Emulation");
+      PROFILE_START(TOTAL);
 
       if (yabsys.DecilineMode) {
 
@@ -676,34 +710,34 @@ int YabauseEmulate(void) {
 
          if (!yabsys.playing_ssf)
          {
-            PROFILE_START("MSH2");
+            PROFILE_START(MSH2);
             SH2Exec(MSH2, sh2cycles);
-            PROFILE_STOP("MSH2");
+            PROFILE_STOP(MSH2);
 
-            PROFILE_START("SSH2");
+            PROFILE_START(SSH2);
             if (yabsys.IsSSH2Running)
                SH2Exec(SSH2, sh2cycles);
-            PROFILE_STOP("SSH2");
+            PROFILE_STOP(SSH2);
          }
 
 #ifdef USE_SCSP2
-         PROFILE_START("SCSP");
+         PROFILE_START(SCSP);
          ScspExec(1);
-         PROFILE_STOP("SCSP");
+         PROFILE_STOP(SCSP);
 #endif
 
          yabsys.DecilineCount++;
          if(yabsys.DecilineCount == 9)
          {
             // HBlankIN
-            PROFILE_START("hblankin");
+            PROFILE_START(HBLANKIN);
             Vdp2HBlankIN();
-            PROFILE_STOP("hblankin");
+            PROFILE_STOP(HBLANKIN);
          }
 
-         PROFILE_START("SCU");
+         PROFILE_START(SCU);
          ScuExec(sh2cycles);
-         PROFILE_STOP("SCU");
+         PROFILE_STOP(SCU);
 
       } else {  // !DecilineMode
 
@@ -714,89 +748,95 @@ int YabauseEmulate(void) {
          yabsys.SH2CycleFrac &= ((YABSYS_TIMING_MASK << 1) | 1);
          if (!yabsys.playing_ssf)
          {
-            PROFILE_START("MSH2");
+            PROFILE_START(MSH2);
             SH2Exec(MSH2, sh2cycles - decilinecycles);
-            PROFILE_STOP("MSH2");
-            PROFILE_START("SSH2");
+            PROFILE_STOP(MSH2);
+            PROFILE_START(SSH2);
             if (yabsys.IsSSH2Running)
                SH2Exec(SSH2, sh2cycles - decilinecycles);
-            PROFILE_STOP("SSH2");
+            PROFILE_STOP(SSH2);
          }
 
-         PROFILE_START("hblankin");
+         PROFILE_START(HBLANKIN);
          Vdp2HBlankIN();
-         PROFILE_STOP("hblankin");
+         PROFILE_STOP(HBLANKIN);
 
          if (!yabsys.playing_ssf)
          {
-            PROFILE_START("MSH2");
+            PROFILE_START(MSH2);
             SH2Exec(MSH2, decilinecycles);
-            PROFILE_STOP("MSH2");
-            PROFILE_START("SSH2");
+            PROFILE_STOP(MSH2);
+            PROFILE_START(SSH2);
             if (yabsys.IsSSH2Running)
                SH2Exec(SSH2, decilinecycles);
-            PROFILE_STOP("SSH2");
+            PROFILE_STOP(SSH2);
          }
 
 #ifdef USE_SCSP2
-         PROFILE_START("SCSP");
+         PROFILE_START(SCSP);
          ScspExec(10);
-         PROFILE_STOP("SCSP");
+         PROFILE_STOP(SCSP);
 #endif
 
-         PROFILE_START("SCU");
+         PROFILE_START(SCU);
          ScuExec(sh2cycles);
-         PROFILE_STOP("SCU");
+         PROFILE_STOP(SCU);
 
       }  // if (yabsys.DecilineMode)
 
 #ifndef USE_SCSP2
-      PROFILE_START("68K");
+      PROFILE_START(M68K);
       M68KSync();  // Wait for the previous iteration to finish
-      PROFILE_STOP("68K");
+      PROFILE_STOP(M68K);
 #endif
 
       if (!yabsys.DecilineMode || yabsys.DecilineCount == 10)
       {
          // HBlankOUT
-         PROFILE_START("hblankout");
+         PROFILE_START(HBLANKOUT);
          Vdp2HBlankOUT();
-         PROFILE_STOP("hblankout");
+         PROFILE_STOP(HBLANKOUT);
 #ifndef USE_SCSP2
-         PROFILE_START("SCSP");
+         PROFILE_START(SCSP);
          ScspExec();
-         PROFILE_STOP("SCSP");
+         PROFILE_STOP(SCSP);
 #endif
          yabsys.DecilineCount = 0;
          yabsys.LineCount++;
          if (yabsys.LineCount == yabsys.VBlankLineCount)
          {
-            PROFILE_START("vblankin");
+            PROFILE_START(VBLANKIN);
             // VBlankIN
             SmpcINTBACKEnd();
             Vdp2VBlankIN();
-            PROFILE_STOP("vblankin");
+            PROFILE_STOP(VBLANKIN);
             CheatDoPatches();
          }
          else if (yabsys.LineCount == yabsys.MaxLineCount)
          {
             // VBlankOUT
-            PROFILE_START("VDP1/VDP2");
+            PROFILE_START(VDP);
             Vdp2VBlankOUT();
             set_mpeg_video_irq();//guessing: set video irq once per frame
             yabsys.LineCount = 0;
             oneframeexec = 1;
-            PROFILE_STOP("VDP1/VDP2");
+            PROFILE_STOP(VDP);
          }
       }
 
+      // The SMPC only counts down while a command is pending, and the CD
+      // block saves its time up until one of its own timers expires, so on
+      // most slices neither does any work here.
       yabsys.UsecFrac += usecinc;
-      PROFILE_START("SMPC");
-      SmpcExec(yabsys.UsecFrac >> YABSYS_TIMING_BITS);
-      PROFILE_STOP("SMPC");
-      PROFILE_START("CDB");
+      if (SmpcInternalVars->timing > 0)
+      {
+         PROFILE_START(SMPC);
+         SmpcExec(yabsys.UsecFrac >> YABSYS_TIMING_BITS);
+         PROFILE_STOP(SMPC);
+      }
+      PROFILE_START(CDB);
       Cs2Exec(yabsys.UsecFrac >> YABSYS_TIMING_BITS);
-      PROFILE_STOP("CDB");
+      PROFILE_STOP(CDB);
       yabsys.UsecFrac &= YABSYS_TIMING_MASK;
       
 #ifndef USE_SCSP2
@@ -804,7 +844,7 @@ int YabauseEmulate(void) {
       {
          int cycles;
 
-         PROFILE_START("68K");
+         PROFILE_START(M68K);
          cycles = m68kcycles;
 	 saved_centicycles += m68kcenticycles;
          if (saved_centicycles >= 100) {
@@ -812,7 +852,7 @@ int YabauseEmulate(void) {
             saved_centicycles -= 100;
          }
          M68KExec(cycles);
-         PROFILE_STOP("68K");
+         PROFILE_STOP(M68K);
       }
       else
       {
@@ -844,13 +884,15 @@ int YabauseEmulate(void) {
          saved_cdd_cycles -= cdd_integer_part << SCSP_FRACTIONAL_BITS;
       }
 
-      PROFILE_STOP("Total Emulation");
+      PROFILE_STOP(TOTAL);
    }
 
 #ifndef USE_SCSP2
    M68KSync();
 #endif
 
+   PROFILE_STOP(FRAME);
+
 #ifdef YAB_WANT_SSF
 
    if (yabsys.playing_ssf)
@@ -864,6 +906,13 @@ int YabauseEmulate(void) {
    //flush tsunami output once per frame
    tsunami_flush();
 
+   if (yabsys.use_rewind)
+   {
+      PROFILE_START(REWIND);
+      RewindSnapshot();
+      PROFILE_STOP(REWIND);
+   }
+
    return 0;
 }
 
@@ -61,6 +61,8 @@ typedef struct
    int sh2_cache_enabled;
    int use_scsp_dsp_dynarec;
    int use_scu_dsp_jit;
+   int use_rewind;     // snapshot every frame so RewindStepBack can go back
+   u32 rewind_budget;  // bytes kept for older snapshots, 0 = default
 } yabauseinit_struct;
 
 #define CLKTYPE_26MHZ           0
@@ -119,6 +121,7 @@ typedef struct
    int sh2_cache_enabled;
    int use_scsp_dsp_jit;
    int use_scu_dsp_jit;
+   int use_rewind;
 } yabsys_struct;
 
 extern yabsys_struct yabsys;